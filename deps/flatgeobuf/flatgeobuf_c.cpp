@@ -28,7 +28,11 @@
 #include "geometryreader.h"
 #include "packedrtree.h"
 
+#include <algorithm>
 #include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 using namespace flatbuffers;
 using namespace FlatGeobuf;
@@ -206,25 +210,39 @@ flatgeobuf_encode_feature(ctx *ctx)
 void
 flatgeobuf_create_index(ctx *ctx)
 {
-	// convert to structure expected by packedrtree
-	std::vector<std::shared_ptr<Item>> items;
-	for (uint64_t i = 0; i < ctx->features_count; i++)
-	{
-		const auto item = std::make_shared<FeatureItem>();
-		item->nodeItem = {ctx->items[i]->xmin, ctx->items[i]->ymin, ctx->items[i]->xmax, ctx->items[i]->ymax};
-		item->offset = ctx->items[i]->offset;
-		item->size = ctx->items[i]->size;
-		items.push_back(item);
-	}
-	// sort items
-	hilbertSort(items);
 	// calc extent
-	auto extent = calcExtent(items);
+	NodeItem extent = NodeItem::create(0);
+	for (uint64_t i = 0; i < ctx->features_count; i++)
+		extent.expand({ctx->items[i]->xmin, ctx->items[i]->ymin, ctx->items[i]->xmax, ctx->items[i]->ymax});
 	ctx->has_extent = true;
 	ctx->xmin = extent.minX;
 	ctx->ymin = extent.minY;
 	ctx->xmax = extent.maxX;
 	ctx->ymax = extent.maxY;
+	// compute each hilbert value once instead of twice per comparison
+	std::vector<std::pair<uint32_t, uint64_t>> keys;
+	keys.reserve(ctx->features_count);
+	for (uint64_t i = 0; i < ctx->features_count; i++)
+	{
+		NodeItem n = {ctx->items[i]->xmin, ctx->items[i]->ymin, ctx->items[i]->xmax, ctx->items[i]->ymax};
+		keys.emplace_back(hilbert(n, HILBERT_MAX, extent.minX, extent.minY, extent.width(), extent.height()), i);
+	}
+	// sort items
+	std::sort(keys.begin(), keys.end(), [](const std::pair<uint32_t, uint64_t> &a, const std::pair<uint32_t, uint64_t> &b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	});
+	// convert to structure expected by packedrtree
+	std::vector<std::shared_ptr<Item>> items;
+	items.reserve(ctx->features_count);
+	for (const auto &key : keys)
+	{
+		const flatgeobuf_item *src = ctx->items[key.second];
+		const auto item = std::make_shared<FeatureItem>();
+		item->nodeItem = {src->xmin, src->ymin, src->xmax, src->ymax};
+		item->offset = src->offset;
+		item->size = src->size;
+		items.push_back(item);
+	}
 	// allocate new buffer and write magicbytes
 	auto oldbuf = ctx->buf;
 	auto oldoffset = ctx->offset;
@@ -241,10 +259,10 @@ flatgeobuf_create_index(ctx *ctx)
 		featureItem->nodeItem.offset = featureOffset;
 		featureOffset += featureItem->size;
 	}
-	// create and write index
+	// create and write index, growing the buffer once for index and features
 	PackedRTree tree(items, extent, ctx->index_node_size);
+	ctx->buf = (uint8_t *)lwrealloc(ctx->buf, ctx->offset + tree.size() + featureOffset);
 	const auto writeData = [&ctx](const void *data, const size_t size) {
-		ctx->buf = (uint8_t *)lwrealloc(ctx->buf, ctx->offset + size);
 		memcpy(ctx->buf + ctx->offset, data, size);
 		ctx->offset += size;
 	};
@@ -253,7 +271,6 @@ flatgeobuf_create_index(ctx *ctx)
 	for (auto item : items)
 	{
 		auto featureItem = std::static_pointer_cast<FeatureItem>(item);
-		ctx->buf = (uint8_t *)lwrealloc(ctx->buf, ctx->offset + featureItem->size);
 		LWDEBUGF(2, "copy from offset %llu", featureItem->offset);
 		memcpy(ctx->buf + ctx->offset, oldbuf + featureItem->offset, featureItem->size);
 		ctx->offset += featureItem->size;
@@ -378,8 +395,59 @@ flatgeobuf_decode_header(ctx *ctx)
 			return -1;
 		}
 		LWDEBUGF(2, "Adding tree size %llu to offset", treeSize);
+		ctx->index_offset = ctx->offset;
 		ctx->offset += treeSize;
 	}
+	ctx->features_offset = ctx->offset;
+
+	return 0;
+}
+
+int
+flatgeobuf_index_search(ctx *ctx, double xmin, double ymin, double xmax, double ymax)
+{
+	std::vector<SearchResultItem> results;
+
+	if (ctx->index_node_size == 0 || ctx->features_count == 0)
+	{
+		lwerror("flatgeobuf: input has no spatial index");
+		return -1;
+	}
+
+	// decode_header has already checked that the whole tree is in the buffer
+	const auto treeSize = PackedRTree::size(ctx->features_count, ctx->index_node_size);
+	const auto readNode = [&ctx, treeSize](uint8_t *buf, size_t offset, size_t length) {
+		if (offset > treeSize || length > treeSize - offset)
+			throw std::runtime_error("node read past end of index");
+		memcpy(buf, ctx->buf + ctx->index_offset + offset, length);
+	};
+
+	try
+	{
+		NodeItem n{xmin, ymin, xmax, ymax, 0};
+		results = PackedRTree::streamSearch(ctx->features_count, ctx->index_node_size, n, readNode);
+	}
+	catch (const std::exception &e)
+	{
+		lwerror("flatgeobuf: index search failed: %s", e.what());
+		return -1;
+	}
+
+	LWDEBUGF(2, "index search found %zu features", results.size());
+
+	ctx->search_results_len = results.size();
+	ctx->search_results_pos = 0;
+	ctx->search_results = NULL;
+	if (results.size() > 0)
+	{
+		ctx->search_results =
+		    (flatgeobuf_search_result *)lwalloc(sizeof(flatgeobuf_search_result) * results.size());
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			ctx->search_results[i].offset = results[i].offset;
+			ctx->search_results[i].index = results[i].index;
+		}
+	}
 
 	return 0;
 }
@@ -77,6 +77,12 @@ typedef struct flatgeobuf_item
 	uint64_t offset;
 } flatgeobuf_item;
 
+typedef struct flatgeobuf_search_result
+{
+	uint64_t offset; // feature offset relative to the first feature
+	uint64_t index;  // feature position in file order
+} flatgeobuf_search_result;
+
 typedef struct flatgeobuf_ctx
 {
 	// header contents
@@ -102,6 +108,13 @@ typedef struct flatgeobuf_ctx
 	uint64_t offset;
 	uint64_t size;
 
+	// decode spatial index bookkeeping
+	uint64_t index_offset;
+	uint64_t features_offset;
+	flatgeobuf_search_result *search_results;
+	uint64_t search_results_len;
+	uint64_t search_results_pos;
+
 	LWGEOM *lwgeom;
 	uint8_t lwgeom_type;
 	uint8_t *properties;
@@ -124,6 +137,7 @@ void flatgeobuf_create_index(flatgeobuf_ctx *ctx);
 
 int flatgeobuf_decode_header(flatgeobuf_ctx *ctx);
 int flatgeobuf_decode_feature(flatgeobuf_ctx *ctx);
+int flatgeobuf_index_search(flatgeobuf_ctx *ctx, double xmin, double ymin, double xmax, double ymax);
 
 #ifdef __cplusplus
 }
@@ -100,6 +100,17 @@ bytebuffer_makeroom(bytebuffer_t *s, size_t size_to_add)
 	return;
 }
 
+/**
+* Make room for size more bytes, for callers that write straight
+* at the write cursor and advance it themselves.
+*/
+uint8_t *
+bytebuffer_reserve(bytebuffer_t *s, size_t size)
+{
+	bytebuffer_makeroom(s, size);
+	return s->writecursor;
+}
+
 /** Returns a copy of the internal buffer */
 lwvarlena_t *
 bytebuffer_get_buffer_varlena(const bytebuffer_t *s)
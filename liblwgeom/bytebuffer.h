@@ -53,6 +53,7 @@ void bytebuffer_append_byte(bytebuffer_t *s, const uint8_t val);
 void bytebuffer_append_bytebuffer(bytebuffer_t *write_to, bytebuffer_t *write_from);
 void bytebuffer_append_varint(bytebuffer_t *s, const int64_t val);
 void bytebuffer_append_uvarint(bytebuffer_t *s, const uint64_t val);
+uint8_t *bytebuffer_reserve(bytebuffer_t *s, size_t size);
 size_t bytebuffer_getlength(const bytebuffer_t *s);
 lwvarlena_t *bytebuffer_get_buffer_varlena(const bytebuffer_t *s);
 const uint8_t* bytebuffer_get_buffer(const bytebuffer_t *s, size_t *buffer_length);
@@ -0,0 +1,254 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+
+#include "liblwgeom_internal.h"
+#include "cu_tester.h"
+
+/* Write the geometries to an Arrow IPC stream, NULL entries as nulls */
+static lwvarlena_t *
+write_geoarrow(const char **wkt, int n, const char *srs)
+{
+	LWGEOARROW_LAYOUT layout;
+	LWGEOARROW_WRITER *w;
+	GSERIALIZED *g[8];
+	LWGEOM *geom;
+	lwvarlena_t *v;
+	int i;
+
+	memset(&layout, 0, sizeof(LWGEOARROW_LAYOUT));
+	for (i = 0; i < n; i++)
+	{
+		g[i] = NULL;
+		if (!wkt[i])
+			continue;
+		geom = lwgeom_from_wkt(wkt[i], LW_PARSER_CHECK_NONE);
+		lwgeoarrow_layout_add(&layout, geom->type, FLAGS_GET_Z(geom->flags), FLAGS_GET_M(geom->flags));
+		g[i] = gserialized_from_lwgeom(geom, NULL);
+		lwgeom_free(geom);
+	}
+
+	w = lwgeoarrow_writer_create(&layout, srs);
+	for (i = 0; i < n; i++)
+		lwgeoarrow_writer_add(w, g[i]);
+	v = lwgeoarrow_writer_finish(w);
+	for (i = 0; i < n; i++)
+		if (g[i])
+			lwfree(g[i]);
+	return v;
+}
+
+/* Read the stream back, expecting the geometries as WKT */
+static void
+check_geoarrow(const uint8_t *buf, size_t size, const char **exp, int n, const char *exp_srs)
+{
+	LWGEOARROW_ITERATOR *it;
+	LWGEOM *geom;
+	char *srs = NULL, *wkt;
+	int i;
+
+	it = lwgeoarrow_iterator_create(buf, size, &srs);
+	CU_ASSERT_FATAL(it != NULL);
+	if (exp_srs)
+	{
+		CU_ASSERT_FATAL(srs != NULL);
+		ASSERT_STRING_EQUAL(srs, exp_srs);
+	}
+	else
+		CU_ASSERT(srs == NULL);
+
+	for (i = 0; i < n; i++)
+	{
+		CU_ASSERT_EQUAL_FATAL(lwgeoarrow_iterator_next(it, &geom), LW_TRUE);
+		if (!exp[i])
+		{
+			CU_ASSERT(geom == NULL);
+			continue;
+		}
+		CU_ASSERT_FATAL(geom != NULL);
+		wkt = lwgeom_to_wkt(geom, WKT_ISO, 15, NULL);
+		ASSERT_STRING_EQUAL(wkt, exp[i]);
+		lwfree(wkt);
+		lwgeom_free(geom);
+	}
+	CU_ASSERT_EQUAL(lwgeoarrow_iterator_next(it, &geom), LW_FALSE);
+	lwgeoarrow_iterator_destroy(it);
+	if (srs)
+		lwfree(srs);
+}
+
+static void
+do_geoarrow_test(const char **wkt, const char **exp, int n, const char *srs)
+{
+	lwvarlena_t *v = write_geoarrow(wkt, n, srs);
+	check_geoarrow((uint8_t *)v->data, LWSIZE_GET(v->size) - LWVARHDRSZ, exp, n, srs);
+	lwfree(v);
+}
+
+static void
+geoarrow_test_native(void)
+{
+	const char *points[] = {"POINT(1 2)", NULL, "POINT EMPTY", "POINT(3 4)"};
+	const char *points_z[] = {"POINT Z (1 2 3)", "POINT Z (4 5 6)"};
+	const char *lines[] = {"LINESTRING(0 0,1 1)", "LINESTRING EMPTY", NULL, "LINESTRING(2 2,3 3,4 4)"};
+	const char *polys[] = {"POLYGON((0 0,1 0,1 1,0 0),(0.1 0.1,0.2 0.1,0.2 0.2,0.1 0.1))", "POLYGON EMPTY"};
+	const char *lines_zm[] = {"MULTILINESTRING ZM ((0 0 1 2,1 1 3 4),(5 5 5 5,6 6 6 6))", NULL};
+
+	do_geoarrow_test(points, points, 4, "EPSG:4326");
+	do_geoarrow_test(points_z, points_z, 2, NULL);
+	do_geoarrow_test(lines, lines, 4, NULL);
+	do_geoarrow_test(polys, polys, 2, "EPSG:3857");
+	do_geoarrow_test(lines_zm, lines_zm, 2, NULL);
+}
+
+static void
+geoarrow_test_promote(void)
+{
+	/* Single geometries in a multi column */
+	const char *points[] = {"POINT M (1 2 3)", "MULTIPOINT M ((4 5 6),(7 8 9))", NULL};
+	const char *multipoints[] = {"MULTIPOINT M ((1 2 3))", "MULTIPOINT M ((4 5 6),(7 8 9))", NULL};
+	const char *polys[] = {"POLYGON((0 0,1 0,1 1,0 0))",
+			       "MULTIPOLYGON(((0 0,2 0,2 2,0 0),(0.5 0.5,1 0.5,1 1,0.5 0.5)),((5 5,6 5,6 6,5 5)))",
+			       "POLYGON EMPTY"};
+	const char *multipolys[] = {"MULTIPOLYGON(((0 0,1 0,1 1,0 0)))",
+				    "MULTIPOLYGON(((0 0,2 0,2 2,0 0),(0.5 0.5,1 0.5,1 1,0.5 0.5)),((5 5,6 5,6 6,5 5)))",
+				    "MULTIPOLYGON EMPTY"};
+
+	do_geoarrow_test(points, multipoints, 3, NULL);
+	do_geoarrow_test(polys, multipolys, 3, NULL);
+}
+
+static void
+geoarrow_test_wkb(void)
+{
+	/* Mixed types and dimensions fall back to WKB */
+	const char *mixed[] = {"POINT(1 2)", "LINESTRING(0 0,1 1)", NULL, "GEOMETRYCOLLECTION(POINT(1 1))"};
+	const char *dims[] = {"POINT(1 2)", "POINT Z (1 2 3)"};
+	const char *curves[] = {"CIRCULARSTRING(0 0,1 1,2 0)"};
+	const char *nulls[] = {NULL, NULL};
+
+	do_geoarrow_test(mixed, mixed, 4, "EPSG:4326");
+	do_geoarrow_test(dims, dims, 2, NULL);
+	do_geoarrow_test(curves, curves, 1, NULL);
+	do_geoarrow_test(nulls, nulls, 2, NULL);
+}
+
+/*
+ * A stream written by pyarrow: an int32 column before an interleaved
+ * geoarrow.linestring column, in two record batches.
+ */
+static const char *pyarrow_stream =
+	"FFFFFFFFC80100001000000000000A000C000600050008000A00000000010400"
+	"0C00000008000800000004000800000004000000020000006401000018000000"
+	"0000120018000800060007000C00000010001400120000000000010C18000000"
+	"C0000000080000001800000001000000B40000000400000067656F6D00000000"
+	"020000005800000004000000B8FFFFFF2400000004000000140000007B226372"
+	"73223A22455053473A3332363331227D00000000180000004152524F573A6578"
+	"74656E73696F6E3A6D657461646174610000000008000C000400080008000000"
+	"20000000040000001300000067656F6172726F772E6C696E65737472696E6700"
+	"140000004152524F573A657874656E73696F6E3A6E616D650000000004000400"
+	"0400000098FFFFFF000001101400000024000000040000000100000020000000"
+	"08000000766572746963657300000600080004000600000002000000D0FFFFFF"
+	"00000103100000001C0000000400000000000000020000007879000000000600"
+	"080006000600000000000200100014000800060007000C000000100010000000"
+	"00000102100000001C0000000400000000000000020000006964000008000C00"
+	"08000700080000000000000120000000FFFFFFFF080100001400000000000000"
+	"0C0016000600050008000C000C00000000030400180000004000000000000000"
+	"00000A0018000C00040008000A0000008C000000100000000200000000000000"
+	"0000000007000000000000000000000000000000000000000000000000000000"
+	"0800000000000000080000000000000001000000000000001000000000000000"
+	"0C00000000000000200000000000000000000000000000002000000000000000"
+	"0000000000000000200000000000000020000000000000000000000004000000"
+	"0200000000000000000000000000000002000000000000000100000000000000"
+	"0200000000000000000000000000000004000000000000000000000000000000"
+	"0100000002000000010000000000000000000000020000000200000000000000"
+	"00000000000000000000000000000000000000000000F03F0000000000000040"
+	"FFFFFFFF0801000014000000000000000C0016000600050008000C000C000000"
+	"0003040018000000400000000000000000000A0018000C00040008000A000000"
+	"8C00000010000000010000000000000000000000070000000000000000000000"
+	"0000000000000000000000000000000004000000000000000800000000000000"
+	"0000000000000000080000000000000008000000000000001000000000000000"
+	"0000000000000000100000000000000000000000000000001000000000000000"
+	"3000000000000000000000000400000001000000000000000000000000000000"
+	"0100000000000000000000000000000003000000000000000000000000000000"
+	"0600000000000000000000000000000003000000000000000000000003000000"
+	"0000000000000840000000000000104000000000000014400000000000001840"
+	"0000000000001C400000000000002040FFFFFFFF00000000";
+
+static void
+geoarrow_test_pyarrow(void)
+{
+	const char *exp[] = {"LINESTRING(0 0,1 2)", NULL, "LINESTRING(3 4,5 6,7 8)"};
+	size_t size = strlen(pyarrow_stream) / 2;
+	uint8_t *buf = bytes_from_hexbytes(pyarrow_stream, strlen(pyarrow_stream));
+
+	check_geoarrow(buf, size, exp, 3, "EPSG:32631");
+	lwfree(buf);
+}
+
+static void
+geoarrow_test_errors(void)
+{
+	const char *lines[] = {"LINESTRING(0 0,1 1)", "LINESTRING(2 2,3 3,4 4)"};
+	lwvarlena_t *v = write_geoarrow(lines, 2, NULL);
+	uint8_t *buf = (uint8_t *)v->data;
+	size_t size = LWSIZE_GET(v->size) - LWVARHDRSZ;
+	LWGEOARROW_ITERATOR *it;
+	const int32_t offsets[] = {0, 2, 5};
+	LWGEOM *geom;
+	char *srs;
+	size_t i;
+
+	/* Empty */
+	cu_error_msg_reset();
+	it = lwgeoarrow_iterator_create(buf, 0, &srs);
+	CU_ASSERT(it == NULL);
+	ASSERT_STRING_EQUAL(cu_error_msg, "invalid Arrow IPC stream (at offset 0)");
+
+	/* Schema only */
+	it = lwgeoarrow_iterator_create(buf, 8 + buf[4] + 256 * buf[5], &srs);
+	CU_ASSERT_FATAL(it != NULL);
+	CU_ASSERT_EQUAL(lwgeoarrow_iterator_next(it, &geom), LW_FALSE);
+	lwgeoarrow_iterator_destroy(it);
+
+	/* Offsets past the vertices */
+	cu_error_msg_reset();
+	for (i = 0; i + sizeof(offsets) <= size; i++)
+		if (!memcmp(buf + i, offsets, sizeof(offsets)))
+			break;
+	CU_ASSERT_FATAL(i + sizeof(offsets) <= size);
+	buf[i + 8] = 6;
+	it = lwgeoarrow_iterator_create(buf, size, &srs);
+	CU_ASSERT_FATAL(it != NULL);
+	CU_ASSERT_EQUAL(lwgeoarrow_iterator_next(it, &geom), LW_TRUE);
+	lwgeom_free(geom);
+	CU_ASSERT_EQUAL(lwgeoarrow_iterator_next(it, &geom), LW_FALSE);
+	ASSERT_STRING_EQUAL(cu_error_msg, "invalid GeoArrow geometry at row 1");
+	lwgeoarrow_iterator_destroy(it);
+	lwfree(v);
+}
+
+/*
+** Used by test harness to register the tests in this file.
+*/
+void geoarrow_suite_setup(void);
+void geoarrow_suite_setup(void)
+{
+	CU_pSuite suite = CU_add_suite("geoarrow", NULL, NULL);
+	PG_ADD_TEST(suite, geoarrow_test_native);
+	PG_ADD_TEST(suite, geoarrow_test_promote);
+	PG_ADD_TEST(suite, geoarrow_test_wkb);
+	PG_ADD_TEST(suite, geoarrow_test_pyarrow);
+	PG_ADD_TEST(suite, geoarrow_test_errors);
+}
@@ -1697,6 +1697,43 @@ void test_gbox_geocentric_get_gbox_cartesian(void)
 	BOX3D_BOXLL_TEST(-100,10, 120,10);
 }
 
+static void test_gbox_geocentric_expand(void)
+{
+	const double angle = 50000.0 / WGS84_RADIUS;
+	GEOGRAPHIC_POINT center, edge;
+	POINT3D p;
+	GBOX gbox;
+	int i;
+
+	/* Box of a single point at 80N */
+	geographic_point_init(0.0, 80.0, &center);
+	geog2cart(&center, &p);
+	gbox_init(&gbox);
+	gbox.xmin = gbox.xmax = p.x;
+	gbox.ymin = gbox.ymax = p.y;
+	gbox.zmin = gbox.zmax = p.z;
+	gbox_geocentric_expand(&gbox, angle);
+
+	/* Every point on the circle around it is inside */
+	for (i = 0; i < 360; i += 5)
+	{
+		sphere_project(&center, angle, deg2rad(i), &edge);
+		geog2cart(&edge, &p);
+		CU_ASSERT(p.x >= gbox.xmin - 1e-12 && p.x <= gbox.xmax + 1e-12);
+		CU_ASSERT(p.y >= gbox.ymin - 1e-12 && p.y <= gbox.ymax + 1e-12);
+		CU_ASSERT(p.z >= gbox.zmin - 1e-12 && p.z <= gbox.zmax + 1e-12);
+	}
+
+	/* Z grows by about angle * cos(80), far less than a flat expansion */
+	CU_ASSERT_DOUBLE_EQUAL(gbox.zmax - gbox.zmin, 2 * angle * cos(deg2rad(80.0)), 1e-6);
+	CU_ASSERT_DOUBLE_EQUAL(gbox.ymax - gbox.ymin, 2 * angle, 1e-6);
+
+	/* Reaching past a pole saturates the axis */
+	gbox_geocentric_expand(&gbox, M_PI);
+	CU_ASSERT_DOUBLE_EQUAL(gbox.zmin, -1.0, 1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(gbox.zmax, 1.0, 1e-12);
+}
+
 
 /*
 ** Used by test harness to register the tests in this file.
@@ -1729,5 +1766,6 @@ void geodetic_suite_setup(void)
 	PG_ADD_TEST(suite, test_ptarray_contains_point_sphere_iowa);
 	PG_ADD_TEST(suite, test_gbox_to_string_truncated);
 	PG_ADD_TEST(suite, test_gbox_geocentric_get_gbox_cartesian);
+	PG_ADD_TEST(suite, test_gbox_geocentric_expand);
 	PG_ADD_TEST(suite, test_geography_substring);
 }
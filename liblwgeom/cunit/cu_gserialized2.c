@@ -101,6 +101,63 @@ static void test_gserialized2_extended_flags(void)
 
 }
 
+static void test_gserialized2_stored_hash(void)
+{
+	LWGEOM *lwg;
+	GSERIALIZED *g, *gh, *gs;
+	size_t size = 0;
+	int32_t hash = 0, stored = 0;
+	char *ewkt;
+
+	/* A plain serialization carries no hash */
+	lwg = lwgeom_from_wkt("SRID=4326;LINESTRING(0 0, 1 1, 2 0)", LW_PARSER_CHECK_NONE);
+	g = gserialized2_from_lwgeom(lwg, &size);
+	CU_ASSERT_EQUAL(gserialized2_get_stored_hash(g, &stored), LW_FAILURE);
+	hash = gserialized2_hash(g);
+
+	/* Storing it inserts the extended flags and keeps the computed value */
+	gh = gserialized2_set_hash(g);
+	CU_ASSERT(gh != g);
+	CU_ASSERT_EQUAL(LWSIZE_GET(gh->size), size + 8);
+	CU_ASSERT_EQUAL(1, G2FLAGS_GET_EXTENDED(gh->gflags));
+	CU_ASSERT_EQUAL(gserialized2_get_stored_hash(gh, &stored), LW_SUCCESS);
+	CU_ASSERT_EQUAL(stored, hash);
+	CU_ASSERT_EQUAL(gserialized2_hash(gh), hash);
+	CU_ASSERT_EQUAL(gserialized_cmp(g, gh), 0);
+	lwgeom_free(lwg);
+
+	/* The hashed copy still deserializes to the same geometry */
+	lwg = lwgeom_from_gserialized2(gh);
+	ewkt = lwgeom_to_ewkt(lwg);
+	CU_ASSERT_STRING_EQUAL(ewkt, "SRID=4326;LINESTRING(0 0,1 1,2 0)");
+	lwfree(ewkt);
+	lwgeom_free(lwg);
+
+	/* Changing the SRID leaves the stored hash to be refreshed in place */
+	gserialized2_set_srid(gh, 3857);
+	gserialized2_set_srid(g, 3857);
+	CU_ASSERT_EQUAL(gserialized2_get_stored_hash(gh, &stored), LW_SUCCESS);
+	CU_ASSERT_EQUAL(stored, hash);
+	CU_ASSERT(gserialized2_set_hash(gh) == gh);
+	CU_ASSERT_EQUAL(gserialized2_get_stored_hash(gh, &stored), LW_SUCCESS);
+	CU_ASSERT_EQUAL(stored, gserialized2_hash(g));
+	CU_ASSERT_NOT_EQUAL(stored, hash);
+
+	/* Extended flags already in place are reused, solid flag is kept */
+	lwg = lwgeom_from_wkt("POINT(100 100)", LW_PARSER_CHECK_NONE);
+	FLAGS_SET_SOLID(lwg->flags, 1);
+	gs = gserialized2_from_lwgeom(lwg, &size);
+	CU_ASSERT(gserialized2_set_hash(gs) == gs);
+	CU_ASSERT_EQUAL(LWSIZE_GET(gs->size), size);
+	CU_ASSERT_EQUAL(1, FLAGS_GET_SOLID(gserialized2_get_lwflags(gs)));
+	CU_ASSERT_EQUAL(gserialized2_get_stored_hash(gs, &stored), LW_SUCCESS);
+	lwgeom_free(lwg);
+
+	lwfree(g);
+	lwfree(gh);
+	lwfree(gs);
+}
+
 static void test_gserialized2_srid(void)
 {
 	GSERIALIZED s;
@@ -794,6 +851,152 @@ test_gserialized2_wkb_roundtrip_float_rounded_box(void)
 	lwfree(wkb);
 }
 
+/*
+ * Extended WKB written straight from the serialization must match the
+ * output for the deserialized geometry, in binary and hex.
+ */
+static void
+test_gserialized2_to_wkb(void)
+{
+	const char *wkts[] = {
+	    "SRID=4326;POINT(1 2)",
+	    "POINT EMPTY",
+	    "POINT ZM EMPTY",
+	    "SRID=3857;LINESTRING M (0 0 1,1 1 2)",
+	    "POLYGON EMPTY",
+	    "POLYGON Z ((0 0 1,1 0 1,1 1 1,0 0 1),(0.1 0.1 1,0.2 0.1 1,0.2 0.2 1,0.1 0.1 1))",
+	    "MULTIPOINT(EMPTY,1 2)",
+	    "SRID=4326;GEOMETRYCOLLECTION(POINT(1 2),GEOMETRYCOLLECTION(LINESTRING EMPTY))",
+	    "MULTISURFACE(((0 0,1 0,1 1,0 0)),CURVEPOLYGON(CIRCULARSTRING(0 0,1 1,2 0,1 -1,0 0)))",
+	    "TRIANGLE EMPTY",
+	    "TIN(((0 0 0,1 0 0,0 1 0,0 0 0)))",
+	    "NURBSCURVE(2, (0 0, 1 1, 2 0))"};
+	uint8_t variants[] = {WKB_EXTENDED, WKB_EXTENDED | WKB_HEX, WKB_EXTENDED | WKB_XDR, WKB_ISO};
+	size_t i, j;
+
+	for (i = 0; i < sizeof(wkts) / sizeof(wkts[0]); i++)
+	{
+		LWGEOM *lwgeom = lwgeom_from_wkt(wkts[i], LW_PARSER_CHECK_NONE);
+		GSERIALIZED *g = gserialized2_from_lwgeom(lwgeom, NULL);
+		for (j = 0; j < sizeof(variants) / sizeof(variants[0]); j++)
+		{
+			lwvarlena_t *expected = lwgeom_to_wkb_varlena(lwgeom, variants[j]);
+			lwvarlena_t *obtained = gserialized_to_wkb_varlena(g, variants[j]);
+			CU_ASSERT_EQUAL_FATAL(LWSIZE_GET(obtained->size), LWSIZE_GET(expected->size));
+			CU_ASSERT_EQUAL(memcmp(obtained->data, expected->data, LWSIZE_GET(expected->size) - LWVARHDRSZ), 0);
+			lwfree(expected);
+			lwfree(obtained);
+		}
+		lwgeom_free(lwgeom);
+		lwfree(g);
+	}
+
+	/* Only the machine order extended form is written directly */
+	{
+		LWGEOM *lwgeom = lwgeom_from_wkt("LINESTRING(0 0,1 1)", LW_PARSER_CHECK_NONE);
+		GSERIALIZED *g = gserialized2_from_lwgeom(lwgeom, NULL);
+		char *hex = (char *)gserialized_to_wkb_buffer(g, WKB_EXTENDED | WKB_HEX);
+		char *expected = lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED);
+		CU_ASSERT_STRING_EQUAL(hex, expected);
+		CU_ASSERT_NOT_EQUAL(gserialized2_to_wkb_size(g, WKB_EXTENDED), 0);
+		CU_ASSERT_EQUAL(gserialized2_to_wkb_size(g, WKB_ISO), 0);
+		lwfree(hex);
+		lwfree(expected);
+		lwgeom_free(lwgeom);
+		lwfree(g);
+	}
+}
+
+static void
+test_gserialized2_from_wkb(void)
+{
+	const char *wkts[] = {
+	    "SRID=4326;POINT(1 2)",
+	    "POINT EMPTY",
+	    "POINT ZM EMPTY",
+	    "SRID=3857;LINESTRING M (0 0 1,1 1 2)",
+	    "LINESTRING(0 0,1 1,2 0)",
+	    "POLYGON EMPTY",
+	    "POLYGON Z ((0 0 1,1 0 1,1 1 1,0 0 1),(0.1 0.1 1,0.2 0.1 1,0.2 0.2 1,0.1 0.1 1))",
+	    "MULTIPOINT(1 2)",
+	    "MULTIPOINT(EMPTY,1 2)",
+	    "MULTILINESTRING((0 0,1 1))",
+	    "MULTIPOLYGON(((0 0,1 0,1 1,0 0)),EMPTY,((5 5,6 5,6 6,5 5)))",
+	    "SRID=4326;GEOMETRYCOLLECTION(POINT(1 2),GEOMETRYCOLLECTION(LINESTRING EMPTY))",
+	    "GEOMETRYCOLLECTION(POINT EMPTY)",
+	    "TRIANGLE EMPTY",
+	    "TRIANGLE((0 0,1 0,0 1,0 0))",
+	    "TIN(((0 0 0,1 0 0,0 1 0,0 0 0)))",
+	    "POLYHEDRALSURFACE(((0 0 0,0 1 0,1 1 0,0 0 0)))",
+	    "MULTISURFACE(((0 0,1 0,1 1,0 0)),CURVEPOLYGON(CIRCULARSTRING(0 0,1 1,2 0,1 -1,0 0)))",
+	    "NURBSCURVE(2, (0 0, 1 1, 2 0))"};
+	uint8_t variants[] = {WKB_EXTENDED, WKB_EXTENDED | WKB_XDR, WKB_ISO | WKB_NDR};
+	size_t i, j;
+
+	for (i = 0; i < sizeof(wkts) / sizeof(wkts[0]); i++)
+	{
+		LWGEOM *lwgeom = lwgeom_from_wkt(wkts[i], LW_PARSER_CHECK_NONE);
+		for (j = 0; j < sizeof(variants) / sizeof(variants[0]); j++)
+		{
+			lwvarlena_t *v = lwgeom_to_wkb_varlena(lwgeom, variants[j]);
+			const uint8_t *wkb = (const uint8_t *)v->data;
+			size_t wkb_size = LWSIZE_GET(v->size) - LWVARHDRSZ;
+			size_t expected_size, obtained_size;
+			LWGEOM *parsed;
+			GSERIALIZED *expected, *obtained;
+
+			parsed = lwgeom_from_wkb(wkb, wkb_size, LW_PARSER_CHECK_ALL);
+			expected = gserialized2_from_lwgeom(parsed, &expected_size);
+			obtained = gserialized_from_wkb(wkb, wkb_size, LW_PARSER_CHECK_ALL, &obtained_size);
+			CU_ASSERT_EQUAL_FATAL(obtained_size, expected_size);
+			CU_ASSERT_EQUAL(memcmp(obtained, expected, expected_size), 0);
+
+			lwgeom_free(parsed);
+			lwfree(expected);
+			lwfree(obtained);
+			lwfree(v);
+		}
+		lwgeom_free(lwgeom);
+	}
+
+	/* Linear input is serialized directly, curves go through an LWGEOM */
+	{
+		LWGEOM *lwgeom;
+		/* POLYGON((0 0,1 0,1 1,0 0),EMPTY) */
+		const char *hex_poly =
+		    "01030000000200000004000000000000000000000000000000000000000000000000"
+		    "00F03F0000000000000000000000000000F03F000000000000F03F00000000000000"
+		    "00000000000000000000000000";
+		/* CIRCULARSTRING(0 0,1 1,2 0) */
+		const char *hex_circ =
+		    "01080000000300000000000000000000000000000000000000000000000000F03F"
+		    "000000000000F03F00000000000000400000000000000000";
+		uint8_t *wkb = bytes_from_hexbytes(hex_poly, strlen(hex_poly));
+		GSERIALIZED *g = gserialized2_from_wkb(wkb, strlen(hex_poly) / 2, LW_PARSER_CHECK_NONE, NULL);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(g);
+		/* The empty ring is dropped, like lwgeom_from_wkb does */
+		CU_ASSERT_EQUAL(gserialized_get_type(g), POLYGONTYPE);
+		CU_ASSERT_EQUAL(gserialized_has_bbox(g), LW_TRUE);
+		lwgeom = lwgeom_from_gserialized(g);
+		CU_ASSERT_EQUAL(lwgeom_count_rings(lwgeom), 1);
+		lwgeom_free(lwgeom);
+		/* Which fails the minimum points check */
+		CU_ASSERT_PTR_NULL(gserialized2_from_wkb(wkb, strlen(hex_poly) / 2, LW_PARSER_CHECK_ALL, NULL));
+		/* Truncated */
+		CU_ASSERT_PTR_NULL(gserialized2_from_wkb(wkb, strlen(hex_poly) / 2 - 1, LW_PARSER_CHECK_NONE, NULL));
+		lwfree(g);
+		lwfree(wkb);
+
+		wkb = bytes_from_hexbytes(hex_circ, strlen(hex_circ));
+		CU_ASSERT_PTR_NULL(gserialized2_from_wkb(wkb, strlen(hex_circ) / 2, LW_PARSER_CHECK_NONE, NULL));
+		g = gserialized_from_wkb(wkb, strlen(hex_circ) / 2, LW_PARSER_CHECK_NONE, NULL);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(g);
+		CU_ASSERT_EQUAL(gserialized_get_type(g), CIRCSTRINGTYPE);
+		lwfree(g);
+		lwfree(wkb);
+	}
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -811,6 +1014,7 @@ void gserialized2_suite_setup(void)
 	PG_ADD_TEST(suite, test_gserialized2_peek_gbox_p_gets_correct_box);
 	PG_ADD_TEST(suite, test_gserialized2_peek_gbox_p_fails_for_unsupported_cases);
 	PG_ADD_TEST(suite, test_gserialized2_extended_flags);
+	PG_ADD_TEST(suite, test_gserialized2_stored_hash);
 	PG_ADD_TEST(suite, test_gserialized2_peek_first_point);
 	PG_ADD_TEST(suite, test_gserialized2_malformed_collection_count);
 	PG_ADD_TEST(suite, test_gserialized2_malformed_nurbs_degree);
@@ -820,4 +1024,6 @@ void gserialized2_suite_setup(void)
 	PG_ADD_TEST(suite, test_gserialized2_malformed_declared_size);
 	PG_ADD_TEST(suite, test_gserialized2_malformed_short_allocation);
 	PG_ADD_TEST(suite, test_gserialized2_wkb_roundtrip_float_rounded_box);
+	PG_ADD_TEST(suite, test_gserialized2_to_wkb);
+	PG_ADD_TEST(suite, test_gserialized2_from_wkb);
 }
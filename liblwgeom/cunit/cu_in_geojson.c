@@ -235,6 +235,95 @@ static void in_geojson_test_geoms(void)
 	    NULL);
 }
 
+static void in_geojson_test_members(void)
+{
+	/* Type after the coordinates */
+	do_geojson_test(
+	    "MULTIPOLYGON(((0 1,2 3,4 5,0 1)),EMPTY)",
+	    "{\"coordinates\":[[[[0,1],[2,3],[4,5],[0,1]]],[]],\"bbox\":[0,1,4,5],\"type\":\"MultiPolygon\"}",
+	    NULL);
+
+	/* Type after the geometries, crs first, foreign members */
+	do_geojson_test(
+	    "GEOMETRYCOLLECTION(POINT(0 1 2),LINESTRING(2 3 0,4 5 0))",
+	    "{\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"EPSG:4326\"}},\"properties\":{\"a\":[1,{\"b\":\"\\\"\"}]},"
+	    "\"geometries\":[{\"coordinates\":[0,1,2],\"type\":\"Point\"},{\"type\":\"LineString\",\"coordinates\":[[2,3],[4,5]]}],"
+	    "\"type\":\"GeometryCollection\"}",
+	    "EPSG:4326");
+
+	/* Integers and exponents */
+	do_geojson_test(
+	    "LINESTRING(0 -1.5,1200 123456789012345)",
+	    "{ \"type\" : \"LineString\" ,\n \"coordinates\" : [ [ -0 , -15e-1 ] , [ 1.2E3 , 123456789012345 ] ] }",
+	    NULL);
+
+	/* Not strict JSON, read by json-c */
+	do_geojson_test(
+	    "POINT(1 2)",
+	    "{'type':'Point','coordinates':[1,2]}",
+	    NULL);
+}
+
+static void in_geojson_test_features(void)
+{
+	const char *json =
+	    "{\"type\":\"FeatureCollection\",\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"EPSG:3857\"}},"
+	    "\"features\":["
+	    "{\"type\":\"Feature\",\"properties\":{\"name\":\"a\"},\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}},"
+	    "{\"type\":\"Feature\",\"geometry\":null,\"properties\":null},"
+	    "{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[1,2,3],[4,5,6]]},\"properties\":[1, 2]}"
+	    "]}";
+	LWGEOJSON_ITERATOR *it;
+	LWGEOM *g;
+	const char *props;
+	size_t len;
+	char *srs = NULL;
+	char *wkt;
+
+	it = lwgeojson_iterator_create(json, &srs);
+	CU_ASSERT_FATAL(it != NULL);
+	ASSERT_STRING_EQUAL(srs, "EPSG:3857");
+
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_TRUE);
+	wkt = lwgeom_to_wkt(g, WKT_EXTENDED, 15, NULL);
+	ASSERT_STRING_EQUAL(wkt, "POINT(1 2)");
+	CU_ASSERT_EQUAL(len, strlen("{\"name\":\"a\"}"));
+	CU_ASSERT(strncmp(props, "{\"name\":\"a\"}", len) == 0);
+	lwfree(wkt);
+	lwgeom_free(g);
+
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_TRUE);
+	CU_ASSERT(g == NULL);
+	CU_ASSERT(props == NULL);
+
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_TRUE);
+	wkt = lwgeom_to_wkt(g, WKT_EXTENDED, 15, NULL);
+	ASSERT_STRING_EQUAL(wkt, "LINESTRING(1 2 3,4 5 6)");
+	CU_ASSERT(strncmp(props, "[1, 2]", len) == 0);
+	lwfree(wkt);
+	lwgeom_free(g);
+
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_FALSE);
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_FALSE);
+	lwgeojson_iterator_destroy(it);
+	lwfree(srs);
+
+	/* Not a FeatureCollection */
+	cu_error_msg_reset();
+	it = lwgeojson_iterator_create("{\"type\":\"Point\",\"coordinates\":[1,2]}", &srs);
+	CU_ASSERT(it == NULL);
+	ASSERT_STRING_EQUAL(cu_error_msg, "GeoJSON type is not FeatureCollection");
+
+	/* Truncated */
+	cu_error_msg_reset();
+	it = lwgeojson_iterator_create("{\"features\":[{\"geometry\":null}", &srs);
+	CU_ASSERT_FATAL(it != NULL);
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_TRUE);
+	CU_ASSERT_EQUAL(lwgeojson_iterator_next(it, &g, &props, &len), LW_FALSE);
+	ASSERT_STRING_EQUAL(cu_error_msg, "invalid GeoJSON FeatureCollection (at offset 30)");
+	lwgeojson_iterator_destroy(it);
+}
+
 /*
 ** Used by test harness to register the tests in this file.
 */
@@ -245,4 +334,6 @@ void in_geojson_suite_setup(void)
 	PG_ADD_TEST(suite, in_geojson_test_srid);
 	PG_ADD_TEST(suite, in_geojson_test_bbox);
 	PG_ADD_TEST(suite, in_geojson_test_geoms);
+	PG_ADD_TEST(suite, in_geojson_test_members);
+	PG_ADD_TEST(suite, in_geojson_test_features);
 }
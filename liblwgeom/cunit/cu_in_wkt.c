@@ -406,6 +406,71 @@ static void test_wkt_double(void)
 	lwgeom_parser_result_free(&p);
 }
 
+static void test_wkt_in_numbers(void)
+{
+	/* Every spelling must read exactly like strtod */
+	const char *numbers[] = {
+		"0", "-0", "1", "-1", "0.1", "-.5", ".5", "5.", "00012.5000", "1e22", "1e23",
+		"1E5", "1e+5", "1.5e-3", "123.456e-7", "9007199254740992", "9007199254740993",
+		"123456789012345678901234", "0.30000000000000004", "1.7976931348623157e308",
+		"2.2250738585072014e-308", "4.9e-324", "-1e400", "1e-400", "179.999999999",
+		"-89.12345678901234567"
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+	{
+		char wkt[128];
+		double expected = strtod(numbers[i], NULL);
+		LWGEOM *g;
+		POINT4D pt;
+
+		snprintf(wkt, sizeof(wkt), "MULTIPOINT(%s 0,(1 %s))", numbers[i], numbers[i]);
+		g = lwgeom_from_wkt(wkt, LW_PARSER_CHECK_NONE);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(g);
+		getPoint4d_p(lwgeom_as_lwpoint(lwgeom_as_lwcollection(g)->geoms[0])->point, 0, &pt);
+		CU_ASSERT_EQUAL(memcmp(&pt.x, &expected, sizeof(double)), 0);
+		getPoint4d_p(lwgeom_as_lwpoint(lwgeom_as_lwcollection(g)->geoms[1])->point, 0, &pt);
+		CU_ASSERT_EQUAL(memcmp(&pt.y, &expected, sizeof(double)), 0);
+		lwgeom_free(g);
+	}
+
+	/* Not numbers for the lexer */
+	s = "POINT(1.e5 0)";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "parse error - invalid geometry");
+	lwfree(r);
+
+	s = "POINT(+1 0)";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "parse error - invalid geometry");
+	lwfree(r);
+
+	s = "POINT(1 2";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "parse error - invalid geometry");
+	lwfree(r);
+}
+
+static void test_wkt_in_nested_dims(void)
+{
+	s = "GEOMETRYCOLLECTION ZM (GEOMETRYCOLLECTION(POINT ZM (1 2 3 4),POINT EMPTY))";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "GEOMETRYCOLLECTION ZM (GEOMETRYCOLLECTION ZM (POINT ZM (1 2 3 4),POINT ZM EMPTY))");
+	lwfree(r);
+
+	/* Relabeling the XYM point as XYZM would read past its coordinates */
+	s = "GEOMETRYCOLLECTION ZM (GEOMETRYCOLLECTION(POINT ZM (1 2 3 4),POINT M (1 2 3)))";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "can not mix dimensionality in a geometry");
+	lwfree(r);
+
+	s = "GEOMETRYCOLLECTION Z (MULTIPOINT(1 2 3,1 2))";
+	r = cu_wkt_in(s, WKT_ISO);
+	ASSERT_STRING_EQUAL(r, "can not mix dimensionality in a geometry");
+	lwfree(r);
+}
+
 static void test_wkt_leak(void)
 {
 	/* OSS-FUZZ: https://trac.osgeo.org/postgis/ticket/4537 */
@@ -444,5 +509,7 @@ void wkt_in_suite_setup(void)
 	PG_ADD_TEST(suite, test_wkt_in_polyhedralsurface);
 	PG_ADD_TEST(suite, test_wkt_in_errlocation);
 	PG_ADD_TEST(suite, test_wkt_double);
+	PG_ADD_TEST(suite, test_wkt_in_numbers);
+	PG_ADD_TEST(suite, test_wkt_in_nested_dims);
 	PG_ADD_TEST(suite, test_wkt_leak);
 }
@@ -143,6 +143,25 @@ static void test_twkb_out_linestring(void)
 	cu_twkb("LINESTRING EMPTY", 0, 0, 0, 0);
 	ASSERT_STRING_EQUAL(s,"0210");
 	// printf("TWKB: %s\n",s);
+
+	/* 130 points with 5 duplicates, npoints shrinks to a single byte */
+	{
+		char wkt[2048] = "LINESTRING(";
+		char expected[1024] = "02007D0000";
+		size_t len = strlen(wkt);
+		int i;
+		for ( i = 0; i < 125; i++ )
+		{
+			len += sprintf(wkt + len, "%s%d 0", i ? "," : "", i);
+			if ( i % 25 == 10 )
+				len += sprintf(wkt + len, ",%d 0", i);
+			if ( i )
+				strcat(expected, "0200");
+		}
+		strcat(wkt, ")");
+		cu_twkb(wkt, 0, 0, 0, 0);
+		ASSERT_STRING_EQUAL(s, expected);
+	}
 }
 
 static void test_twkb_out_polygon(void)
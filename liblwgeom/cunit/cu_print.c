@@ -367,6 +367,14 @@ test_lwprint(void)
 	assert_lwprint_equal(1.005, 2, "1");
 	assert_lwprint_equal(2.05, 1, "2");
 	assert_lwprint_equal(2.005, 2, "2");
+	assert_lwprint_equal(2.675, 2, "2.68");
+	assert_lwprint_equal(-562949953421.3125, 2, "-562949953421.31");
+
+	/* Values too large to be scaled to every decimal asked for */
+	assert_lwprint_equal(0.1 + 0.2, 15, "0.3");
+	assert_lwprint_equal(1234.5678, 15, "1234.5678");
+	assert_lwprint_equal(562949953421.3125, 15, "562949953421.3125");
+	assert_lwprint_equal(999999999999999.9, 15, "999999999999999.9");
 
 	for (int i = 0; i < 15; i++)
 		assert_lwprint_equal(-0.99999999999999988898, i, "-1");
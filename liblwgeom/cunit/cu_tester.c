@@ -38,6 +38,7 @@ extern void clean_suite_setup(void);
 extern void clip_by_rect_suite_setup(void);
 extern void force_dims_suite_setup(void);
 extern void force_sfs_suite_setup(void);
+extern void geoarrow_suite_setup(void);
 extern void geodetic_suite_setup(void);
 extern void geos_suite_setup(void);
 extern void geos_cluster_suite_setup(void);
@@ -92,6 +93,7 @@ PG_SuiteSetup setupfuncs[] = {algorithms_suite_setup,
 			      clip_by_rect_suite_setup,
 			      force_dims_suite_setup,
 			      force_sfs_suite_setup,
+			      geoarrow_suite_setup,
 			      geodetic_suite_setup,
 			      geos_suite_setup,
 			      geos_cluster_suite_setup,
@@ -29,6 +29,8 @@
 // uint64_t varint_u64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size);
 //
 // size_t varint_size(const uint8_t *the_start, const uint8_t *the_end);
+// size_t varint_s64_encode_block(const int64_t *vals, size_t nvals, uint8_t *buf);
+// size_t varint_s64_decode_block(const uint8_t *the_start, const uint8_t *the_end, int64_t *vals, size_t nvals);
 //
 
 static void do_test_u32_varint(uint32_t nr, int expected_size, char* expected_res)
@@ -210,6 +212,34 @@ static void test_varint_roundtrip(void)
 	}
 }
 
+static void test_varint_block(void)
+{
+	int64_t vals_in[] = {0, 1, -1, 63, -64, 64, -65, 8191, -8192, 8192, -8193,
+	                     INT32_MAX, INT32_MIN, INT64_MAX, -INT64_MAX, 0};
+	size_t nvals = sizeof(vals_in) / sizeof(int64_t);
+	int64_t vals_out[16];
+	uint8_t block[16 * 10];
+	uint8_t single[16 * 10];
+	size_t block_size, single_size = 0;
+	size_t i;
+
+	/* Packing a block matches packing the values one by one */
+	block_size = varint_s64_encode_block(vals_in, nvals, block);
+	for ( i = 0; i < nvals; i++ )
+		single_size += varint_s64_encode_buf(vals_in[i], single + single_size);
+	CU_ASSERT_EQUAL(block_size, single_size);
+	CU_ASSERT_EQUAL(memcmp(block, single, block_size), 0);
+
+	/* And unpacks back to the same values */
+	CU_ASSERT_EQUAL(varint_s64_decode_block(block, block + block_size, vals_out, nvals), block_size);
+	for ( i = 0; i < nvals; i++ )
+		CU_ASSERT_EQUAL(vals_in[i], vals_out[i]);
+
+	/* A truncated block is not decoded */
+	CU_ASSERT_EQUAL(varint_s64_decode_block(block, block + block_size - 1, vals_out, nvals), 0);
+	CU_ASSERT_EQUAL(varint_s64_decode_block(block, block + 2, vals_out, 3), 0);
+}
+
 static void test_zigzag(void)
 {
 	int64_t a;
@@ -254,4 +284,5 @@ void varint_suite_setup(void)
 	PG_ADD_TEST(suite, test_zigzag);
 	PG_ADD_TEST(suite, test_varint);
 	PG_ADD_TEST(suite, test_varint_roundtrip);
+	PG_ADD_TEST(suite, test_varint_block);
 }
@@ -148,6 +148,34 @@ gserialized_hash(const GSERIALIZED *g)
 		return gserialized1_hash(g);
 }
 
+/**
+* Read the hash stored by #gserialized_set_hash, if any.
+* Returns #LW_FAILURE when the hash has to be computed.
+*/
+int
+gserialized_get_stored_hash(const GSERIALIZED *g, int32_t *hash)
+{
+	if (GFLAGS_GET_VERSION(g->gflags))
+		return gserialized2_get_stored_hash(g, hash);
+	else
+		return LW_FAILURE;
+}
+
+/**
+* Store the #gserialized_hash in the serialized form so later
+* calls can read it back instead of hashing the coordinates.
+* If necessary a new #GSERIALIZED will be allocated. Test
+* that input != output before freeing input.
+*/
+GSERIALIZED *
+gserialized_set_hash(GSERIALIZED *g)
+{
+	if (GFLAGS_GET_VERSION(g->gflags))
+		return gserialized2_set_hash(g);
+	else
+		return g;
+}
+
 /**
 * Extract the SRID from the serialized form (it is packed into
 * three bytes so this is a handy function).
@@ -253,6 +281,25 @@ GSERIALIZED* gserialized_from_lwgeom(LWGEOM *geom, size_t *size)
 	return gserialized2_from_lwgeom(geom, size);
 }
 
+/**
+* Allocate a new #GSERIALIZED from WKB. Common geometries are serialized
+* straight from the WKB, anything else goes through an #LWGEOM.
+*/
+GSERIALIZED *
+gserialized_from_wkb(const uint8_t *wkb, size_t wkb_size, char check, size_t *size)
+{
+	GSERIALIZED *g = gserialized2_from_wkb(wkb, wkb_size, check, size);
+	if (!g)
+	{
+		LWGEOM *lwgeom = lwgeom_from_wkb(wkb, wkb_size, check);
+		if (!lwgeom)
+			return NULL;
+		g = gserialized_from_lwgeom(lwgeom, size);
+		lwgeom_free(lwgeom);
+	}
+	return g;
+}
+
 /**
 * Return the memory size a GSERIALIZED will occupy for a given LWGEOM.
 */
@@ -274,6 +321,65 @@ LWGEOM* lwgeom_from_gserialized(const GSERIALIZED *g)
 }
 
 
+/**
+* Write the WKB of a #GSERIALIZED. Extended WKB in machine byte order
+* is copied straight from the serialization, anything else goes through
+* an #LWGEOM. Hex output is null terminated.
+*/
+uint8_t *
+gserialized_to_wkb_buffer(const GSERIALIZED *g, uint8_t variant)
+{
+	size_t b_size = 0;
+
+	if (GFLAGS_GET_VERSION(g->gflags))
+		b_size = gserialized2_to_wkb_size(g, variant);
+
+	if (b_size)
+	{
+		uint8_t *buffer = lwalloc((variant & WKB_HEX) ? 2 * b_size + 1 : b_size);
+		uint8_t *end = gserialized2_to_wkb_buf(g, buffer, variant);
+		if (variant & WKB_HEX)
+			*end = '\0';
+		return buffer;
+	}
+	else
+	{
+		LWGEOM *lwgeom = lwgeom_from_gserialized(g);
+		uint8_t *buffer = lwgeom_to_wkb_buffer(lwgeom, variant);
+		lwgeom_free(lwgeom);
+		return buffer;
+	}
+}
+
+lwvarlena_t *
+gserialized_to_wkb_varlena(const GSERIALIZED *g, uint8_t variant)
+{
+	size_t b_size = 0;
+
+	if (GFLAGS_GET_VERSION(g->gflags))
+		b_size = gserialized2_to_wkb_size(g, variant);
+
+	if (b_size)
+	{
+		lwvarlena_t *v;
+		uint8_t *end;
+		if (variant & WKB_HEX)
+			b_size *= 2;
+		v = lwalloc(b_size + LWVARHDRSZ);
+		end = gserialized2_to_wkb_buf(g, (uint8_t *)v->data, variant);
+		LWSIZE_SET(v->size, (end - (uint8_t *)v->data) + LWVARHDRSZ);
+		return v;
+	}
+	else
+	{
+		LWGEOM *lwgeom = lwgeom_from_gserialized(g);
+		lwvarlena_t *v = lwgeom_to_wkb_varlena(lwgeom, variant);
+		lwgeom_free(lwgeom);
+		return v;
+	}
+}
+
+
 const float * gserialized_get_float_box_p(const GSERIALIZED *g, size_t *ndims)
 {
 	if (GFLAGS_GET_VERSION(g->gflags))
@@ -33,7 +33,7 @@
 *  <srid               3 bytes                g->srid
 *   gflags>            1 byte                 g->gflags
 *  [<extendedflags>   Optional extended flags (check flags for cue)
-*   <extendedflags>]
+*   <extendedflags>]  upper 32 bits: hash, if G2FLAG_X_HAS_HASH
 *  [<bbox-xmin>       Optional bounding box (check flags for cue)
 *   <bbox-xmax>       Number of dimensions is variable
 *   <bbox-ymin>       and also indicated in the flags
@@ -47,6 +47,7 @@
 #include "lwgeodetic.h"
 #include "gserialized2.h"
 
+#include <limits.h>
 #include <stddef.h>
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
@@ -662,8 +663,8 @@ int gserialized2_is_empty(const GSERIALIZED *g)
 /* pb = IN: secondary initval, OUT: secondary hash */
 void hashlittle2(const void *key, size_t length, uint32_t *pc, uint32_t *pb);
 
-int32_t
-gserialized2_hash(const GSERIALIZED *g1)
+static int32_t
+gserialized2_compute_hash(const GSERIALIZED *g1)
 {
 	int32_t hval;
 	int32_t pb = 0, pc = 0;
@@ -688,6 +689,65 @@ gserialized2_hash(const GSERIALIZED *g1)
 	return hval;
 }
 
+int32_t
+gserialized2_hash(const GSERIALIZED *g1)
+{
+	int32_t hval;
+	if (gserialized2_get_stored_hash(g1, &hval))
+		return hval;
+	return gserialized2_compute_hash(g1);
+}
+
+int
+gserialized2_get_stored_hash(const GSERIALIZED *g, int32_t *hash)
+{
+	uint64_t xflags;
+
+	if (!gserialized2_has_extended(g))
+		return LW_FAILURE;
+
+	memcpy(&xflags, g->data, sizeof(uint64_t));
+	if (!(xflags & G2FLAG_X_HAS_HASH))
+		return LW_FAILURE;
+
+	*hash = (int32_t)(uint32_t)(xflags >> 32);
+	return LW_SUCCESS;
+}
+
+GSERIALIZED *
+gserialized2_set_hash(GSERIALIZED *g)
+{
+	uint32_t hval = (uint32_t)gserialized2_compute_hash(g);
+	GSERIALIZED *g_out = NULL;
+	uint64_t xflags = 0;
+
+	/* Serialized already has room for extended flags. */
+	if (G2FLAGS_GET_EXTENDED(g->gflags))
+	{
+		g_out = g;
+		memcpy(&xflags, g->data, sizeof(uint64_t));
+	}
+	/* Make room for the extended flags right after the header */
+	else
+	{
+		size_t varsize_in = LWSIZE_GET(g->size);
+		size_t varsize_out = varsize_in + sizeof(uint64_t);
+		uint8_t *ptr_out, *ptr_in;
+		g_out = lwalloc(varsize_out);
+		ptr_out = (uint8_t *)g_out;
+		ptr_in = (uint8_t *)g;
+		memcpy(ptr_out, ptr_in, 8);
+		memcpy(ptr_out + 16, ptr_in + 8, varsize_in - 8);
+		G2FLAGS_SET_EXTENDED(g_out->gflags, 1);
+		LWSIZE_SET(g_out->size, varsize_out);
+	}
+
+	/* The hash lives in the upper half, readers before 3.7 only look at the lower bits */
+	xflags = (xflags & 0xFFFFFFFFULL) | G2FLAG_X_HAS_HASH | ((uint64_t)hval << 32);
+	memcpy(g_out->data, &xflags, sizeof(uint64_t));
+	return g_out;
+}
+
 
 const float * gserialized2_get_float_box_p(const GSERIALIZED *g, size_t *ndims)
 {
@@ -2518,6 +2578,862 @@ LWGEOM* lwgeom_from_gserialized2(const GSERIALIZED *g)
 	return lwgeom;
 }
 
+/*
+* Extended WKB straight from the serialization. The WKB layout mirrors
+* the serialized one closely enough that the output functions can copy
+* coordinates in bulk, without building an LWGEOM tree first. Output
+* matches lwgeom_to_wkb_buf for the same variant.
+*/
+
+static uint32_t
+gserialized2_wkb_type(uint32_t type)
+{
+	switch (type)
+	{
+	case POINTTYPE:
+		return WKB_POINT_TYPE;
+	case LINETYPE:
+		return WKB_LINESTRING_TYPE;
+	case POLYGONTYPE:
+		return WKB_POLYGON_TYPE;
+	case MULTIPOINTTYPE:
+		return WKB_MULTIPOINT_TYPE;
+	case MULTILINETYPE:
+		return WKB_MULTILINESTRING_TYPE;
+	case MULTIPOLYGONTYPE:
+		return WKB_MULTIPOLYGON_TYPE;
+	case COLLECTIONTYPE:
+		return WKB_GEOMETRYCOLLECTION_TYPE;
+	case CIRCSTRINGTYPE:
+		return WKB_CIRCULARSTRING_TYPE;
+	case COMPOUNDTYPE:
+		return WKB_COMPOUNDCURVE_TYPE;
+	case CURVEPOLYTYPE:
+		return WKB_CURVEPOLYGON_TYPE;
+	case MULTICURVETYPE:
+		return WKB_MULTICURVE_TYPE;
+	case MULTISURFACETYPE:
+		return WKB_MULTISURFACE_TYPE;
+	case POLYHEDRALSURFACETYPE:
+		return WKB_POLYHEDRALSURFACE_TYPE;
+	case TINTYPE:
+		return WKB_TIN_TYPE;
+	case TRIANGLETYPE:
+		return WKB_TRIANGLE_TYPE;
+	default:
+		return 0;
+	}
+}
+
+/*
+* Add the WKB size of the serialized geometry at p to wkb_size and
+* return the number of serialized bytes it takes, or zero for types
+* left to lwgeom_to_wkb (NURBS curves). The buffer must be validated.
+*/
+static size_t
+gserialized2_wkb_size_recurse(const uint8_t *p, size_t ndims, size_t *wkb_size)
+{
+	uint32_t type = gserialized2_get_uint32_t(p);
+	uint32_t count = gserialized2_get_uint32_t(p + 4);
+	size_t ptsize = ndims * sizeof(double);
+	size_t size = 8;
+	size_t npoints = 0;
+	uint32_t i;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		/* POINT EMPTY is written as NaN ordinates */
+		*wkb_size += WKB_BYTE_SIZE + WKB_INT_SIZE + ndims * WKB_DOUBLE_SIZE;
+		return size + count * ptsize;
+
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+		*wkb_size += WKB_BYTE_SIZE + 2 * WKB_INT_SIZE + count * ptsize;
+		return size + count * ptsize;
+
+	case TRIANGLETYPE:
+		/* An empty triangle has no ring at all */
+		*wkb_size += WKB_BYTE_SIZE + 2 * WKB_INT_SIZE;
+		if (count)
+			*wkb_size += WKB_INT_SIZE + count * ptsize;
+		return size + count * ptsize;
+
+	case POLYGONTYPE:
+		for (i = 0; i < count; i++)
+			npoints += gserialized2_get_uint32_t(p + 8 + 4 * i);
+		/* An empty shell makes the whole polygon empty */
+		*wkb_size += WKB_BYTE_SIZE + 2 * WKB_INT_SIZE;
+		if (count && gserialized2_get_uint32_t(p + 8))
+			*wkb_size += count * WKB_INT_SIZE + npoints * ptsize;
+		return size + 4 * (size_t)(count + count % 2) + npoints * ptsize;
+
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	case MULTIPOLYGONTYPE:
+	case COMPOUNDTYPE:
+	case CURVEPOLYTYPE:
+	case MULTICURVETYPE:
+	case MULTISURFACETYPE:
+	case POLYHEDRALSURFACETYPE:
+	case TINTYPE:
+	case COLLECTIONTYPE:
+		*wkb_size += WKB_BYTE_SIZE + 2 * WKB_INT_SIZE;
+		for (i = 0; i < count; i++)
+		{
+			size_t subsize = gserialized2_wkb_size_recurse(p + size, ndims, wkb_size);
+			if (!subsize)
+				return 0;
+			size += subsize;
+		}
+		return size;
+
+	default:
+		return 0;
+	}
+}
+
+static inline uint8_t *
+gserialized2_wkb_header(uint8_t *buf, uint32_t type, uint32_t wkbflags, int32_t srid)
+{
+	uint32_t wkbtype = gserialized2_wkb_type(type) | wkbflags;
+
+	if (srid != SRID_UNKNOWN)
+		wkbtype |= WKBSRIDFLAG;
+
+	*buf++ = IS_BIG_ENDIAN ? 0 : 1;
+	memcpy(buf, &wkbtype, WKB_INT_SIZE);
+	buf += WKB_INT_SIZE;
+	if (srid != SRID_UNKNOWN)
+	{
+		memcpy(buf, &srid, WKB_INT_SIZE);
+		buf += WKB_INT_SIZE;
+	}
+	return buf;
+}
+
+static inline uint8_t *
+gserialized2_wkb_count(uint8_t *buf, uint32_t count)
+{
+	memcpy(buf, &count, WKB_INT_SIZE);
+	return buf + WKB_INT_SIZE;
+}
+
+/*
+* Write the serialized geometry at *p as WKB into buf, advancing *p
+* past it, and return the end of the output. Only the top level
+* carries the SRID.
+*/
+static uint8_t *
+gserialized2_wkb_write_recurse(const uint8_t **p, uint8_t *buf, size_t ndims, uint32_t wkbflags, int32_t srid)
+{
+	const uint8_t *ptr = *p;
+	uint32_t type = gserialized2_get_uint32_t(ptr);
+	uint32_t count = gserialized2_get_uint32_t(ptr + 4);
+	size_t ptsize = ndims * sizeof(double);
+	size_t nbytes;
+	uint32_t i;
+
+	buf = gserialized2_wkb_header(buf, type, wkbflags, srid);
+	ptr += 8;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		if (count)
+		{
+			memcpy(buf, ptr, ptsize);
+			ptr += ptsize;
+		}
+		else
+		{
+			static const uint8_t ndr_nan[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8, 0x7f};
+			static const uint8_t xdr_nan[8] = {0x7f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+			for (i = 0; i < ndims; i++)
+				memcpy(buf + i * WKB_DOUBLE_SIZE, IS_BIG_ENDIAN ? xdr_nan : ndr_nan, WKB_DOUBLE_SIZE);
+		}
+		buf += ndims * WKB_DOUBLE_SIZE;
+		break;
+
+	case LINETYPE:
+	case CIRCSTRINGTYPE:
+		nbytes = count * ptsize;
+		buf = gserialized2_wkb_count(buf, count);
+		memcpy(buf, ptr, nbytes);
+		buf += nbytes;
+		ptr += nbytes;
+		break;
+
+	case TRIANGLETYPE:
+		nbytes = count * ptsize;
+		if (count)
+		{
+			buf = gserialized2_wkb_count(buf, 1);
+			buf = gserialized2_wkb_count(buf, count);
+			memcpy(buf, ptr, nbytes);
+			buf += nbytes;
+			ptr += nbytes;
+		}
+		else
+			buf = gserialized2_wkb_count(buf, 0);
+		break;
+
+	case POLYGONTYPE:
+	{
+		const uint8_t *ring_counts = ptr;
+		int empty = (count == 0 || gserialized2_get_uint32_t(ring_counts) == 0);
+
+		ptr += 4 * (size_t)(count + count % 2);
+		buf = gserialized2_wkb_count(buf, empty ? 0 : count);
+		for (i = 0; i < count; i++)
+		{
+			uint32_t npoints = gserialized2_get_uint32_t(ring_counts + 4 * i);
+			nbytes = npoints * ptsize;
+			if (!empty)
+			{
+				buf = gserialized2_wkb_count(buf, npoints);
+				memcpy(buf, ptr, nbytes);
+				buf += nbytes;
+			}
+			ptr += nbytes;
+		}
+		break;
+	}
+
+	default:
+		/* Collections, sub-geometries inherit the SRID */
+		buf = gserialized2_wkb_count(buf, count);
+		for (i = 0; i < count; i++)
+			buf = gserialized2_wkb_write_recurse(&ptr, buf, ndims, wkbflags, SRID_UNKNOWN);
+		break;
+	}
+
+	*p = ptr;
+	return buf;
+}
+
+/*
+* We only handle the variant the output and send functions use: extended
+* WKB in machine byte order, binary or hex.
+*/
+static int
+gserialized2_wkb_variant_supported(uint8_t variant)
+{
+	int ndr = (variant & WKB_NDR) != 0;
+	int xdr = (variant & WKB_XDR) != 0;
+
+	if ((variant & ~(WKB_NDR | WKB_XDR | WKB_HEX)) != WKB_EXTENDED)
+		return LW_FALSE;
+	if (ndr != xdr && ndr == IS_BIG_ENDIAN)
+		return LW_FALSE;
+	return LW_TRUE;
+}
+
+size_t
+gserialized2_to_wkb_size(const GSERIALIZED *g, uint8_t variant)
+{
+	uint8_t *data_ptr, *data_end;
+	size_t wkb_size = 0;
+
+	if (!gserialized2_wkb_variant_supported(variant))
+		return 0;
+
+	if (gserialized2_payload_bounds(g, &data_ptr, &data_end) == LW_FAILURE)
+	{
+		lwerror("%s: invalid GSERIALIZED header size", __func__);
+		return 0;
+	}
+	if (gserialized2_validate_geometry_buffer(data_ptr, data_end, gserialized2_get_lwflags(g), NULL) == LW_FAILURE)
+		return 0;
+
+	if (!gserialized2_wkb_size_recurse(data_ptr, G2FLAGS_NDIMS(g->gflags), &wkb_size))
+		return 0;
+
+	if (gserialized2_get_srid(g) != SRID_UNKNOWN)
+		wkb_size += WKB_INT_SIZE;
+
+	return wkb_size;
+}
+
+uint8_t *
+gserialized2_to_wkb_buf(const GSERIALIZED *g, uint8_t *buf, uint8_t variant)
+{
+	const uint8_t *data_ptr = gserialized2_get_geometry_p(g);
+	uint32_t wkbflags = 0;
+	uint8_t *end;
+
+	if (G2FLAGS_GET_Z(g->gflags))
+		wkbflags |= WKBZOFFSET;
+	if (G2FLAGS_GET_M(g->gflags))
+		wkbflags |= WKBMOFFSET;
+
+	end = gserialized2_wkb_write_recurse(&data_ptr, buf, G2FLAGS_NDIMS(g->gflags), wkbflags, gserialized2_get_srid(g));
+
+	/* Expand to hex in place, back to front, so no input byte is overwritten before it is read */
+	if (variant & WKB_HEX)
+	{
+		static const char *hexchr = "0123456789ABCDEF";
+		size_t size = end - buf;
+		while (size--)
+		{
+			uint8_t b = buf[size];
+			buf[2 * size] = hexchr[b >> 4];
+			buf[2 * size + 1] = hexchr[b & 0x0F];
+		}
+		end = buf + 2 * (end - buf);
+	}
+	return end;
+}
+
+/*
+* Serialization straight from WKB, for the input and receive functions.
+* A first pass validates the WKB and sizes the serialization, a second
+* one copies the coordinates across and computes the bounding box on the
+* way. Output matches gserialized2_from_lwgeom on lwgeom_from_wkb for
+* the same parser checks. Curves, nested SRIDs, mixed dimensions and
+* anything lwgeom_from_wkb would reject are left to it, it has the
+* error messages.
+*/
+
+#define GSERIALIZED2_FROM_WKB_MAX_DEPTH 200
+
+typedef struct
+{
+	const uint8_t *pos;
+	const uint8_t *end;
+	int swap;          /* byte order of the current geometry is not ours */
+	int8_t check;      /* LW_PARSER_CHECK flags */
+	int has_z;         /* dimensions of the top level geometry */
+	int has_m;
+	size_t size;       /* serialized size of the geometry data */
+	uint64_t npoints;  /* vertex count, for the bounding box test */
+	uint32_t ngeoms;   /* top level element count, for the same */
+} gserialized2_from_wkb_state;
+
+typedef struct
+{
+	int set;
+	double min[4];
+	double max[4];
+} gserialized2_from_wkb_box;
+
+static inline int
+gserialized2_from_wkb_available(const gserialized2_from_wkb_state *s, size_t n)
+{
+	return (size_t)(s->end - s->pos) >= n;
+}
+
+static inline void
+gserialized2_from_wkb_copy_swapped(uint8_t *dst, const uint8_t *src, size_t width)
+{
+	size_t i;
+	for (i = 0; i < width; i++)
+		dst[i] = src[width - i - 1];
+}
+
+static inline uint32_t
+gserialized2_from_wkb_get_uint32(gserialized2_from_wkb_state *s)
+{
+	uint32_t i;
+	if (s->swap)
+		gserialized2_from_wkb_copy_swapped((uint8_t *)&i, s->pos, WKB_INT_SIZE);
+	else
+		memcpy(&i, s->pos, WKB_INT_SIZE);
+	s->pos += WKB_INT_SIZE;
+	return i;
+}
+
+static inline double
+gserialized2_from_wkb_get_double(const gserialized2_from_wkb_state *s, const uint8_t *p)
+{
+	double d;
+	if (s->swap)
+		gserialized2_from_wkb_copy_swapped((uint8_t *)&d, p, WKB_DOUBLE_SIZE);
+	else
+		memcpy(&d, p, WKB_DOUBLE_SIZE);
+	return d;
+}
+
+/* Read a count, which the caller has to check the bounds of itself */
+static inline int
+gserialized2_from_wkb_read_count(gserialized2_from_wkb_state *s, uint32_t *count)
+{
+	if (!gserialized2_from_wkb_available(s, WKB_INT_SIZE))
+		return LW_FAILURE;
+	*count = gserialized2_from_wkb_get_uint32(s);
+	return LW_SUCCESS;
+}
+
+/* Read a point count and check the points are all there */
+static inline int
+gserialized2_from_wkb_read_npoints(gserialized2_from_wkb_state *s, size_t ptsize, uint32_t *npoints)
+{
+	if (!gserialized2_from_wkb_read_count(s, npoints))
+		return LW_FAILURE;
+	if (*npoints > UINT_MAX / WKB_DOUBLE_SIZE / 4)
+		return LW_FAILURE;
+	return *npoints <= (size_t)(s->end - s->pos) / ptsize;
+}
+
+/*
+* Read the byte order and type of a geometry, decoding the type the
+* way lwin_wkb does. Fails on anything we do not handle here.
+*/
+static int
+gserialized2_from_wkb_read_type(gserialized2_from_wkb_state *s, uint32_t *type, int *has_z, int *has_m, int *has_srid)
+{
+	uint32_t wkb_type;
+	uint8_t wkb_little_endian;
+
+	if (!gserialized2_from_wkb_available(s, WKB_BYTE_SIZE + WKB_INT_SIZE))
+		return LW_FAILURE;
+
+	wkb_little_endian = *s->pos++;
+	if (wkb_little_endian > 1)
+		return LW_FAILURE;
+	s->swap = (IS_BIG_ENDIAN != 0) == (wkb_little_endian != 0);
+
+	wkb_type = gserialized2_from_wkb_get_uint32(s);
+	*has_z = (wkb_type & WKBZOFFSET) != 0;
+	*has_m = (wkb_type & WKBMOFFSET) != 0;
+	*has_srid = (wkb_type & WKBSRIDFLAG) != 0;
+
+	wkb_type &= 0x0FFFFFFF;
+	if (wkb_type >= 4000)
+		return LW_FAILURE;
+	if (wkb_type >= 3000)
+		*has_z = *has_m = LW_TRUE;
+	else if (wkb_type >= 2000)
+		*has_m = LW_TRUE;
+	else if (wkb_type >= 1000)
+		*has_z = LW_TRUE;
+
+	switch (wkb_type % 1000)
+	{
+	case WKB_POINT_TYPE:
+		*type = POINTTYPE;
+		break;
+	case WKB_LINESTRING_TYPE:
+		*type = LINETYPE;
+		break;
+	case WKB_POLYGON_TYPE:
+		*type = POLYGONTYPE;
+		break;
+	case WKB_MULTIPOINT_TYPE:
+		*type = MULTIPOINTTYPE;
+		break;
+	case WKB_MULTILINESTRING_TYPE:
+		*type = MULTILINETYPE;
+		break;
+	case WKB_MULTIPOLYGON_TYPE:
+		*type = MULTIPOLYGONTYPE;
+		break;
+	case WKB_GEOMETRYCOLLECTION_TYPE:
+		*type = COLLECTIONTYPE;
+		break;
+	case WKB_POLYHEDRALSURFACE_TYPE:
+		*type = POLYHEDRALSURFACETYPE;
+		break;
+	case WKB_TIN_TYPE:
+		*type = TINTYPE;
+		break;
+	case WKB_TRIANGLE_TYPE:
+		*type = TRIANGLETYPE;
+		break;
+	default:
+		/* Curves need their arcs boxed, leave them to the LWGEOM path */
+		return LW_FAILURE;
+	}
+	return LW_SUCCESS;
+}
+
+static int
+gserialized2_from_wkb_is_closed(const gserialized2_from_wkb_state *s, uint32_t npoints, size_t ptsize, size_t ndims)
+{
+	/* Same as ptarray_is_closed_2d and ptarray_is_closed_3d */
+	if (npoints <= 1)
+		return npoints;
+	return memcmp(s->pos, s->pos + (npoints - 1) * ptsize, ndims * WKB_DOUBLE_SIZE) == 0;
+}
+
+/*
+* First pass: validate the geometry body at s->pos, the header having
+* been read already, and add its serialized size to s->size.
+*/
+static int
+gserialized2_from_wkb_scan_recurse(gserialized2_from_wkb_state *s, uint32_t type, uint32_t depth, int *empty)
+{
+	size_t ndims = 2 + s->has_z + s->has_m;
+	size_t ptsize = ndims * WKB_DOUBLE_SIZE;
+	uint32_t count, npoints, i;
+	int8_t check = s->check;
+
+	*empty = LW_TRUE;
+	s->size += 8;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		if (!gserialized2_from_wkb_available(s, ptsize))
+			return LW_FAILURE;
+		/* POINT(NaN NaN) is POINT EMPTY */
+		if (!(isnan(gserialized2_from_wkb_get_double(s, s->pos)) &&
+		      isnan(gserialized2_from_wkb_get_double(s, s->pos + WKB_DOUBLE_SIZE))))
+		{
+			*empty = LW_FALSE;
+			s->size += ptsize;
+			s->npoints++;
+		}
+		s->pos += ptsize;
+		return LW_SUCCESS;
+
+	case LINETYPE:
+		if (!gserialized2_from_wkb_read_npoints(s, ptsize, &npoints))
+			return LW_FAILURE;
+		if (npoints && npoints < 2 && (check & LW_PARSER_CHECK_MINPOINTS))
+			return LW_FAILURE;
+		*empty = (npoints == 0);
+		s->pos += npoints * ptsize;
+		s->size += npoints * ptsize;
+		s->npoints += npoints;
+		return LW_SUCCESS;
+
+	case POLYGONTYPE:
+	{
+		uint32_t nrings = 0;
+		if (!gserialized2_from_wkb_read_count(s, &count))
+			return LW_FAILURE;
+		for (i = 0; i < count; i++)
+		{
+			if (!gserialized2_from_wkb_read_npoints(s, ptsize, &npoints))
+				return LW_FAILURE;
+			if ((check & LW_PARSER_CHECK_MINPOINTS) && npoints < 4)
+				return LW_FAILURE;
+			if ((check & LW_PARSER_CHECK_CLOSURE) && !gserialized2_from_wkb_is_closed(s, npoints, ptsize, 2))
+				return LW_FAILURE;
+			/* Empty rings are dropped */
+			if (npoints)
+				nrings++;
+			s->pos += npoints * ptsize;
+			s->size += npoints * ptsize;
+			s->npoints += npoints;
+		}
+		*empty = (nrings == 0);
+		s->size += 4 * (size_t)(nrings + nrings % 2);
+		return LW_SUCCESS;
+	}
+
+	case TRIANGLETYPE:
+		if (!gserialized2_from_wkb_read_count(s, &count))
+			return LW_FAILURE;
+		if (count == 0)
+			return LW_SUCCESS;
+		if (count != 1)
+			return LW_FAILURE;
+		if (!gserialized2_from_wkb_read_npoints(s, ptsize, &npoints) || npoints == 0)
+			return LW_FAILURE;
+		if ((check & LW_PARSER_CHECK_MINPOINTS) && npoints < 4)
+			return LW_FAILURE;
+		if ((check & LW_PARSER_CHECK_ZCLOSURE) &&
+		    !gserialized2_from_wkb_is_closed(s, npoints, ptsize, s->has_z ? 3 : 2))
+			return LW_FAILURE;
+		*empty = LW_FALSE;
+		s->pos += npoints * ptsize;
+		s->size += npoints * ptsize;
+		s->npoints += npoints;
+		return LW_SUCCESS;
+
+	default:
+		if (!gserialized2_from_wkb_read_count(s, &count))
+			return LW_FAILURE;
+		if (depth == 1)
+			s->ngeoms = count;
+		if (count == 0)
+			return LW_SUCCESS;
+		if (depth + 1 >= GSERIALIZED2_FROM_WKB_MAX_DEPTH)
+			return LW_FAILURE;
+		/* Be strict in polyhedral surface closures */
+		if (type == POLYHEDRALSURFACETYPE)
+			s->check |= LW_PARSER_CHECK_ZCLOSURE;
+		for (i = 0; i < count; i++)
+		{
+			uint32_t subtype;
+			int has_z, has_m, has_srid, subempty;
+			if (!gserialized2_from_wkb_read_type(s, &subtype, &has_z, &has_m, &has_srid))
+				return LW_FAILURE;
+			if (has_srid || has_z != s->has_z || has_m != s->has_m)
+				return LW_FAILURE;
+			if (!lwcollection_allows_subtype(type, subtype))
+				return LW_FAILURE;
+			if (!gserialized2_from_wkb_scan_recurse(s, subtype, depth + 1, &subempty))
+				return LW_FAILURE;
+			*empty = *empty && subempty;
+		}
+		s->check = check;
+		return LW_SUCCESS;
+	}
+}
+
+/* Copy npoints points into buf in our byte order and return the end */
+static inline uint8_t *
+gserialized2_from_wkb_copy_points(gserialized2_from_wkb_state *s, uint8_t *buf, uint32_t npoints, size_t ndims)
+{
+	size_t nbytes = npoints * ndims * WKB_DOUBLE_SIZE;
+	if (s->swap)
+	{
+		size_t i;
+		for (i = 0; i < nbytes; i += WKB_DOUBLE_SIZE)
+			gserialized2_from_wkb_copy_swapped(buf + i, s->pos + i, WKB_DOUBLE_SIZE);
+	}
+	else
+		memcpy(buf, s->pos, nbytes);
+	s->pos += nbytes;
+	return buf + nbytes;
+}
+
+/* Box the (aligned) points just written, the way ptarray_calculate_gbox_cartesian does */
+static void
+gserialized2_from_wkb_box_points(gserialized2_from_wkb_box *box, const uint8_t *buf, uint32_t npoints, size_t ndims)
+{
+	const double *d = (const double *)buf;
+	uint32_t i;
+	size_t j;
+
+	box->set = (npoints > 0);
+	for (j = 0; j < ndims && npoints; j++)
+		box->min[j] = box->max[j] = d[j];
+	for (i = 1; i < npoints; i++)
+	{
+		d += ndims;
+		for (j = 0; j < ndims; j++)
+		{
+			box->min[j] = FP_MIN(box->min[j], d[j]);
+			box->max[j] = FP_MAX(box->max[j], d[j]);
+		}
+	}
+}
+
+static inline uint8_t *
+gserialized2_from_wkb_write_uint32(uint8_t *buf, uint32_t i)
+{
+	memcpy(buf, &i, sizeof(uint32_t));
+	return buf + sizeof(uint32_t);
+}
+
+/*
+* Second pass: write the geometry body at s->pos into buf, boxing it
+* into box, and return the end of the output. The WKB is validated.
+*/
+static uint8_t *
+gserialized2_from_wkb_write_recurse(gserialized2_from_wkb_state *s, uint8_t *buf, uint32_t type, gserialized2_from_wkb_box *box)
+{
+	size_t ndims = 2 + s->has_z + s->has_m;
+	size_t ptsize = ndims * WKB_DOUBLE_SIZE;
+	uint32_t count, npoints, i;
+	uint8_t *loc;
+
+	box->set = LW_FALSE;
+	buf = gserialized2_from_wkb_write_uint32(buf, type);
+
+	switch (type)
+	{
+	case POINTTYPE:
+		if (isnan(gserialized2_from_wkb_get_double(s, s->pos)) &&
+		    isnan(gserialized2_from_wkb_get_double(s, s->pos + WKB_DOUBLE_SIZE)))
+		{
+			s->pos += ptsize;
+			return gserialized2_from_wkb_write_uint32(buf, 0);
+		}
+		buf = gserialized2_from_wkb_write_uint32(buf, 1);
+		loc = gserialized2_from_wkb_copy_points(s, buf, 1, ndims);
+		gserialized2_from_wkb_box_points(box, buf, 1, ndims);
+		return loc;
+
+	case LINETYPE:
+		npoints = gserialized2_from_wkb_get_uint32(s);
+		buf = gserialized2_from_wkb_write_uint32(buf, npoints);
+		loc = gserialized2_from_wkb_copy_points(s, buf, npoints, ndims);
+		gserialized2_from_wkb_box_points(box, buf, npoints, ndims);
+		return loc;
+
+	case POLYGONTYPE:
+	{
+		const uint8_t *rings = s->pos;
+		uint32_t nrings = 0;
+
+		/* Count the non-empty rings first, they go ahead of the coordinates */
+		count = gserialized2_from_wkb_get_uint32(s);
+		for (i = 0; i < count; i++)
+		{
+			npoints = gserialized2_from_wkb_get_uint32(s);
+			nrings += (npoints != 0);
+			s->pos += npoints * ptsize;
+		}
+
+		s->pos = rings + WKB_INT_SIZE;
+		buf = gserialized2_from_wkb_write_uint32(buf, nrings);
+		loc = buf + 4 * (size_t)(nrings + nrings % 2);
+		if (nrings % 2)
+			memset(loc - 4, 0, 4);
+		for (i = 0; i < count; i++)
+		{
+			uint8_t *ring = loc;
+			npoints = gserialized2_from_wkb_get_uint32(s);
+			if (!npoints)
+				continue;
+			buf = gserialized2_from_wkb_write_uint32(buf, npoints);
+			loc = gserialized2_from_wkb_copy_points(s, ring, npoints, ndims);
+			/* Just the shell makes the box */
+			if (!box->set)
+				gserialized2_from_wkb_box_points(box, ring, npoints, ndims);
+		}
+		return loc;
+	}
+
+	case TRIANGLETYPE:
+		count = gserialized2_from_wkb_get_uint32(s);
+		if (count == 0)
+			return gserialized2_from_wkb_write_uint32(buf, 0);
+		npoints = gserialized2_from_wkb_get_uint32(s);
+		buf = gserialized2_from_wkb_write_uint32(buf, npoints);
+		loc = gserialized2_from_wkb_copy_points(s, buf, npoints, ndims);
+		gserialized2_from_wkb_box_points(box, buf, npoints, ndims);
+		return loc;
+
+	default:
+		/* Merge the element boxes the way lwcollection_calculate_gbox_cartesian does */
+		count = gserialized2_from_wkb_get_uint32(s);
+		buf = gserialized2_from_wkb_write_uint32(buf, count);
+		for (i = 0; i < count; i++)
+		{
+			gserialized2_from_wkb_box subbox;
+			uint32_t subtype;
+			int has_z, has_m, has_srid;
+			size_t j;
+
+			gserialized2_from_wkb_read_type(s, &subtype, &has_z, &has_m, &has_srid);
+			buf = gserialized2_from_wkb_write_recurse(s, buf, subtype, &subbox);
+			if (!subbox.set)
+				continue;
+			if (!box->set)
+			{
+				*box = subbox;
+				continue;
+			}
+			for (j = 0; j < ndims; j++)
+			{
+				if (subbox.min[j] < box->min[j])
+					box->min[j] = subbox.min[j];
+				if (subbox.max[j] > box->max[j])
+					box->max[j] = subbox.max[j];
+			}
+		}
+		return buf;
+	}
+}
+
+GSERIALIZED *
+gserialized2_from_wkb(const uint8_t *wkb, size_t wkb_size, int8_t check, size_t *size)
+{
+	gserialized2_from_wkb_state s;
+	gserialized2_from_wkb_box box;
+	const uint8_t *data;
+	uint32_t type;
+	uint32_t srid = 0;
+	int has_srid, swap, empty, has_bbox;
+	lwflags_t flags;
+	size_t ndims, box_size, total_size;
+	uint8_t *ptr, *end;
+	GSERIALIZED *g;
+
+	if (!wkb || !wkb_size)
+		return NULL;
+
+	memset(&s, 0, sizeof(s));
+	s.pos = wkb;
+	s.end = wkb + wkb_size;
+	s.check = check;
+
+	if (!gserialized2_from_wkb_read_type(&s, &type, &s.has_z, &s.has_m, &has_srid))
+		return NULL;
+	if (has_srid)
+	{
+		if (!gserialized2_from_wkb_available(&s, WKB_INT_SIZE))
+			return NULL;
+		srid = gserialized2_from_wkb_get_uint32(&s);
+	}
+	data = s.pos;
+	swap = s.swap;
+
+	if (!gserialized2_from_wkb_scan_recurse(&s, type, 1, &empty))
+		return NULL;
+
+	/* Same answer as lwgeom_needs_bbox, for non-empty geometries */
+	switch (type)
+	{
+	case POINTTYPE:
+		has_bbox = LW_FALSE;
+		break;
+	case LINETYPE:
+		has_bbox = s.npoints > 2;
+		break;
+	case MULTIPOINTTYPE:
+		has_bbox = s.ngeoms != 1;
+		break;
+	case MULTILINETYPE:
+		has_bbox = s.ngeoms != 1 || s.npoints > 2;
+		break;
+	default:
+		has_bbox = LW_TRUE;
+		break;
+	}
+	has_bbox = has_bbox && !empty;
+
+	flags = lwflags(s.has_z, s.has_m, 0);
+	FLAGS_SET_BBOX(flags, has_bbox);
+	ndims = FLAGS_NDIMS(flags);
+	box_size = has_bbox ? 2 * ndims * sizeof(float) : 0;
+	total_size = 8 + box_size + s.size;
+
+	g = lwalloc(total_size);
+	gserialized2_set_srid(g, has_srid ? clamp_srid((int32_t)srid) : SRID_UNKNOWN);
+	LWSIZE_SET(g->size, total_size);
+	g->gflags = lwflags_get_g2flags(flags);
+
+	ptr = (uint8_t *)g + 8;
+	s.pos = data;
+	s.swap = swap;
+	end = gserialized2_from_wkb_write_recurse(&s, ptr + box_size, type, &box);
+	assert((size_t)(end - (uint8_t *)g) == total_size);
+	(void)end;
+
+	if (has_bbox)
+	{
+		GBOX gbox;
+		memset(&gbox, 0, sizeof(GBOX));
+		gbox.flags = lwflags(s.has_z, s.has_m, 0);
+		gbox.xmin = box.min[0];
+		gbox.xmax = box.max[0];
+		gbox.ymin = box.min[1];
+		gbox.ymax = box.max[1];
+		if (s.has_z)
+		{
+			gbox.zmin = box.min[2];
+			gbox.zmax = box.max[2];
+		}
+		if (s.has_m)
+		{
+			gbox.mmin = box.min[ndims - 1];
+			gbox.mmax = box.max[ndims - 1];
+		}
+		gserialized2_from_gbox(&gbox, ptr);
+	}
+
+	if (size)
+		*size = total_size;
+	return g;
+}
+
 /**
 * Update the bounding box of a #GSERIALIZED, allocating a fresh one
 * if there is not enough space to just write the new box in.
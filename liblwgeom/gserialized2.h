@@ -16,7 +16,7 @@
 #define G2FLAG_X_SOLID            0x00000001
 #define G2FLAG_X_CHECKED_VALID    0x00000002 // To Be Implemented?
 #define G2FLAG_X_IS_VALID         0x00000004 // To Be Implemented?
-#define G2FLAG_X_HAS_HASH         0x00000008 // To Be Implemented?
+#define G2FLAG_X_HAS_HASH         0x00000008 // Upper 32 bits hold gserialized2_hash()
 
 #define G2FLAGS_GET_VERSION(gflags)  (((gflags) & G2FLAG_VER_0)>>6)
 #define G2FLAGS_GET_Z(gflags)         ((gflags) & G2FLAG_Z)
@@ -95,6 +95,20 @@ uint32_t gserialized2_max_header_size(void);
 */
 int32_t gserialized2_hash(const GSERIALIZED *g);
 
+/**
+* Read the hash stored in the extended flags by #gserialized2_set_hash.
+* Returns #LW_FAILURE if there is none. Only the header is read, so
+* a toast slice of #gserialized2_max_header_size bytes is enough.
+*/
+int gserialized2_get_stored_hash(const GSERIALIZED *g, int32_t *hash);
+
+/**
+* Store the #gserialized2_hash of the geometry in its extended flags.
+* If necessary a new #GSERIALIZED will be allocated. Test
+* that input != output before freeing input.
+*/
+GSERIALIZED *gserialized2_set_hash(GSERIALIZED *g);
+
 /**
 * Extract the SRID from the serialized form (it is packed into
 * three bytes so this is a handy function).
@@ -165,6 +179,28 @@ size_t gserialized2_from_lwgeom_size(const LWGEOM *geom);
 */
 LWGEOM* lwgeom_from_gserialized2(const GSERIALIZED *g);
 
+/**
+* Return the size of the extended WKB of a #GSERIALIZED written by
+* #gserialized2_to_wkb_buf, before any hex encoding, or zero if the
+* variant or geometry is not handled there and lwgeom_to_wkb is needed.
+*/
+size_t gserialized2_to_wkb_size(const GSERIALIZED *g, uint8_t variant);
+
+/**
+* Write the extended WKB of a #GSERIALIZED into buf, which must hold
+* the size from #gserialized2_to_wkb_size (twice that for WKB_HEX),
+* and return the end of the output.
+*/
+uint8_t *gserialized2_to_wkb_buf(const GSERIALIZED *g, uint8_t *buf, uint8_t variant);
+
+/**
+* Allocate a new #GSERIALIZED straight from WKB, the same as
+* #gserialized2_from_lwgeom on the output of #lwgeom_from_wkb, bounding
+* box included. Returns NULL, without raising an error, for any input
+* not handled there, which then has to go through #lwgeom_from_wkb.
+*/
+GSERIALIZED *gserialized2_from_wkb(const uint8_t *wkb, size_t wkb_size, int8_t check, size_t *size);
+
 /**
 * Point into the float box area of the serialization
 */
@@ -0,0 +1,110 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+/*
+ * Constants of the Arrow IPC format and the GeoArrow extension types,
+ * shared by lwout_geoarrow.c and lwin_geoarrow.c.
+ *
+ * An Arrow IPC stream is a sequence of messages, each made of a
+ * continuation marker, the size of a flatbuffer encoded Message and
+ * the Message itself, followed by the message body. The stream ends
+ * with a marker and a zero size.
+ *
+ * https://arrow.apache.org/docs/format/Columnar.html
+ * https://geoarrow.org/format.html
+ */
+
+#ifndef _LWGEOARROW_H
+#define _LWGEOARROW_H 1
+
+#define ARROW_CONTINUATION 0xFFFFFFFFU
+#define ARROW_FILE_MAGIC "ARROW1"
+#define ARROW_ALIGNMENT 8
+
+/* MetadataVersion */
+#define ARROW_METADATA_V4 3
+#define ARROW_METADATA_V5 4
+
+/* MessageHeader union */
+#define ARROW_MESSAGE_SCHEMA 1
+#define ARROW_MESSAGE_DICTIONARY_BATCH 2
+#define ARROW_MESSAGE_RECORD_BATCH 3
+
+/* Type union */
+#define ARROW_TYPE_NULL 1
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_BINARY 4
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_BOOL 6
+#define ARROW_TYPE_DECIMAL 7
+#define ARROW_TYPE_DATE 8
+#define ARROW_TYPE_TIME 9
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TYPE_INTERVAL 11
+#define ARROW_TYPE_LIST 12
+#define ARROW_TYPE_STRUCT 13
+#define ARROW_TYPE_UNION 14
+#define ARROW_TYPE_FIXED_SIZE_BINARY 15
+#define ARROW_TYPE_FIXED_SIZE_LIST 16
+#define ARROW_TYPE_MAP 17
+#define ARROW_TYPE_DURATION 18
+#define ARROW_TYPE_LARGE_BINARY 19
+#define ARROW_TYPE_LARGE_UTF8 20
+#define ARROW_TYPE_LARGE_LIST 21
+#define ARROW_TYPE_RUN_END_ENCODED 22
+
+/* FloatingPoint precision */
+#define ARROW_PRECISION_DOUBLE 2
+
+/* Union mode */
+#define ARROW_UNION_SPARSE 0
+
+/* Field members of the flatbuffer tables, in schema order */
+#define ARROW_MESSAGE_VERSION 0
+#define ARROW_MESSAGE_HEADER_TYPE 1
+#define ARROW_MESSAGE_HEADER 2
+#define ARROW_MESSAGE_BODY_LENGTH 3
+
+#define ARROW_SCHEMA_FIELDS 1
+
+#define ARROW_FIELD_NAME 0
+#define ARROW_FIELD_NULLABLE 1
+#define ARROW_FIELD_TYPE_TYPE 2
+#define ARROW_FIELD_TYPE 3
+#define ARROW_FIELD_DICTIONARY 4
+#define ARROW_FIELD_CHILDREN 5
+#define ARROW_FIELD_CUSTOM_METADATA 6
+
+#define ARROW_KEYVALUE_KEY 0
+#define ARROW_KEYVALUE_VALUE 1
+
+#define ARROW_RECORD_BATCH_LENGTH 0
+#define ARROW_RECORD_BATCH_NODES 1
+#define ARROW_RECORD_BATCH_BUFFERS 2
+#define ARROW_RECORD_BATCH_COMPRESSION 3
+
+/* Size of the FieldNode and Buffer structs, two longs each */
+#define ARROW_STRUCT_SIZE 16
+
+#define GEOARROW_EXTENSION_NAME "ARROW:extension:name"
+#define GEOARROW_EXTENSION_METADATA "ARROW:extension:metadata"
+
+#endif /* _LWGEOARROW_H */
@@ -3749,3 +3749,35 @@ int gbox_geocentric_get_gbox_cartesian(const GBOX *gbox_geocentric, GBOX *gbox_p
 	return LW_TRUE;
 }
 
+
+/*
+* Grow one axis of a geocentric box. A point within the angle of
+* a point whose direction cosine on the axis is t has a direction
+* cosine between cos(acos(t) + angle) and cos(acos(t) - angle).
+*/
+static inline void
+geocentric_axis_expand(double *min, double *max, double angle)
+{
+	double amin = acos(FP_MAX(-1.0, FP_MIN(1.0, *max)));
+	double amax = acos(FP_MAX(-1.0, FP_MIN(1.0, *min)));
+	*max = amin > angle ? cos(amin - angle) : 1.0;
+	*min = amax + angle < M_PI ? cos(amax + angle) : -1.0;
+}
+
+/*
+* Expand a geocentric bounding volume to hold every point of the
+* sphere within the angle (in radians) of the points it bounds.
+* Unlike a flat gbox_expand by the angle, the growth of each axis
+* shrinks as the box lines up with that axis, so boxes at high
+* latitudes only grow a little along Z.
+*/
+void gbox_geocentric_expand(GBOX *gbox, double angle)
+{
+	if (angle <= 0.0)
+		return;
+
+	geocentric_axis_expand(&(gbox->xmin), &(gbox->xmax), angle);
+	geocentric_axis_expand(&(gbox->ymin), &(gbox->ymax), angle);
+	geocentric_axis_expand(&(gbox->zmin), &(gbox->zmax), angle);
+}
+
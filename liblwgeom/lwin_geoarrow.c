@@ -0,0 +1,927 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "lwgeoarrow.h"
+
+/*
+ * Flatbuffer reading. Every read is checked against the message, a
+ * failed one sets the error flag and returns zero, which is never a
+ * valid position of a table, vector or string member.
+ */
+typedef struct
+{
+	const uint8_t *buf;
+	size_t size;
+	int error;
+} fb_reader;
+
+static inline uint64_t
+fb_read(fb_reader *fb, size_t pos, uint8_t size)
+{
+	uint64_t value = 0;
+	uint8_t i;
+	if (fb->error || pos > fb->size || size > fb->size - pos)
+	{
+		fb->error = LW_TRUE;
+		return 0;
+	}
+	for (i = 0; i < size; i++)
+		value |= (uint64_t)fb->buf[pos + i] << (8 * i);
+	return value;
+}
+
+/* Follow the offset stored at pos to a table */
+static size_t
+fb_table(fb_reader *fb, size_t pos)
+{
+	size_t table = pos + fb_read(fb, pos, 4);
+	int64_t vtable = (int64_t)table - (int32_t)fb_read(fb, table, 4);
+	uint16_t vsize;
+
+	if (fb->error || vtable < 0 || (size_t)vtable > fb->size)
+		return (fb->error = LW_TRUE, 0);
+	vsize = fb_read(fb, vtable, 2);
+	if (fb->error || vsize < 4 || (size_t)vsize > fb->size - vtable)
+		return (fb->error = LW_TRUE, 0);
+	return table;
+}
+
+/* Position of a member of the table, 0 when it is absent */
+static size_t
+fb_member(fb_reader *fb, size_t table, int id)
+{
+	size_t vtable;
+	uint16_t offset;
+	if (!table)
+		return 0;
+	vtable = table - (int32_t)fb_read(fb, table, 4);
+	if ((size_t)(4 + 2 * id) >= fb_read(fb, vtable, 2))
+		return 0;
+	offset = fb_read(fb, vtable + 4 + 2 * id, 2);
+	return offset ? table + offset : 0;
+}
+
+static inline uint64_t
+fb_scalar(fb_reader *fb, size_t table, int id, uint8_t size, uint64_t dflt)
+{
+	size_t pos = fb_member(fb, table, id);
+	return pos ? fb_read(fb, pos, size) : dflt;
+}
+
+static inline size_t
+fb_table_member(fb_reader *fb, size_t table, int id)
+{
+	size_t pos = fb_member(fb, table, id);
+	return pos ? fb_table(fb, pos) : 0;
+}
+
+/* Position of the first element of a vector member, 0 when it is absent */
+static size_t
+fb_vector(fb_reader *fb, size_t table, int id, size_t elemsize, uint32_t *n)
+{
+	size_t pos = fb_member(fb, table, id);
+	size_t vector;
+
+	*n = 0;
+	if (!pos)
+		return 0;
+	vector = pos + fb_read(fb, pos, 4);
+	*n = fb_read(fb, vector, 4);
+	if (fb->error || vector + 4 > fb->size || *n > (fb->size - vector - 4) / elemsize)
+	{
+		*n = 0;
+		return (fb->error = LW_TRUE, 0);
+	}
+	return vector + 4;
+}
+
+static const char *
+fb_string(fb_reader *fb, size_t table, int id, uint32_t *len)
+{
+	size_t pos = fb_vector(fb, table, id, 1, len);
+	return pos ? (const char *)fb->buf + pos : NULL;
+}
+
+static inline int
+fb_string_equals(const char *str, uint32_t len, const char *expected)
+{
+	return str && len == strlen(expected) && !memcmp(str, expected, len);
+}
+
+/*
+ * Just enough JSON to find the crs of the column metadata, given either
+ * as an authority and code or as PROJJSON with an "id" member.
+ */
+static const char *
+json_space(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
+	return p;
+}
+
+/* Returns past the closing quote, NULL if there is none */
+static const char *
+json_string(const char *p, const char *end)
+{
+	if (p >= end || *p != '"')
+		return NULL;
+	for (p++; p < end; p++)
+	{
+		if (*p == '\\')
+			p++;
+		else if (*p == '"')
+			return p + 1;
+	}
+	return NULL;
+}
+
+static const char *
+json_value(const char *p, const char *end, int depth)
+{
+	char close;
+
+	p = json_space(p, end);
+	if (p >= end || depth > 64)
+		return NULL;
+	if (*p == '"')
+		return json_string(p, end);
+	if (*p != '{' && *p != '[')
+	{
+		while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n')
+			p++;
+		return p;
+	}
+
+	close = *p == '{' ? '}' : ']';
+	p = json_space(p + 1, end);
+	if (p < end && *p == close)
+		return p + 1;
+	while (p && p < end)
+	{
+		if (close == '}')
+		{
+			p = json_string(json_space(p, end), end);
+			p = p ? json_space(p, end) : NULL;
+			if (!p || p >= end || *p != ':')
+				return NULL;
+			p++;
+		}
+		p = json_value(p, end, depth + 1);
+		p = p ? json_space(p, end) : NULL;
+		if (!p || p >= end)
+			return NULL;
+		if (*p == close)
+			return p + 1;
+		if (*p != ',')
+			return NULL;
+		p++;
+	}
+	return NULL;
+}
+
+/* Value of a member of the object at p, NULL if there is none */
+static const char *
+json_member(const char *p, const char *end, const char *key)
+{
+	size_t keylen = strlen(key);
+	const char *name;
+
+	p = json_space(p, end);
+	if (p >= end || *p != '{')
+		return NULL;
+	p = json_space(p + 1, end);
+	while (p < end && *p == '"')
+	{
+		name = p + 1;
+		p = json_string(p, end);
+		if (!p)
+			return NULL;
+		p = json_space(p, end);
+		if (p >= end || *p != ':')
+			return NULL;
+		p = json_space(p + 1, end);
+		if ((size_t)(p - name) > keylen + 1 && !strncmp(name, key, keylen) && name[keylen] == '"')
+			return p;
+		p = json_value(p, end, 0);
+		p = p ? json_space(p, end) : NULL;
+		if (!p || p >= end || *p != ',')
+			return NULL;
+		p = json_space(p + 1, end);
+	}
+	return NULL;
+}
+
+/* Copy of a string or number value, without the quotes */
+static char *
+json_scalar(const char *p, const char *end)
+{
+	const char *e = json_value(p, end, 0);
+	char *str;
+	if (!e || *p == '{' || *p == '[')
+		return NULL;
+	if (*p == '"')
+	{
+		p++;
+		e--;
+	}
+	str = lwalloc(e - p + 1);
+	memcpy(str, p, e - p);
+	str[e - p] = '\0';
+	return str;
+}
+
+static char *
+geoarrow_crs(const char *metadata, uint32_t len)
+{
+	const char *end = metadata + len;
+	const char *crs = json_member(metadata, end, "crs");
+	const char *id;
+	char *authority, *code, *srs = NULL;
+
+	if (!crs || crs >= end)
+		return NULL;
+	if (*crs == '"')
+	{
+		/* Authority and code, anything longer is likely WKT */
+		srs = json_scalar(crs, end);
+		if (srs && (strlen(srs) > 64 || !strchr(srs, ':') || strchr(srs, ' ')))
+		{
+			lwfree(srs);
+			srs = NULL;
+		}
+		return srs;
+	}
+
+	id = json_member(crs, end, "id");
+	if (!id)
+		return NULL;
+	authority = json_member(id, end, "authority") ? json_scalar(json_member(id, end, "authority"), end) : NULL;
+	code = json_member(id, end, "code") ? json_scalar(json_member(id, end, "code"), end) : NULL;
+	if (authority && code)
+	{
+		srs = lwalloc(strlen(authority) + strlen(code) + 2);
+		sprintf(srs, "%s:%s", authority, code);
+	}
+	if (authority)
+		lwfree(authority);
+	if (code)
+		lwfree(code);
+	return srs;
+}
+
+#define GEOARROW_MAX_DEPTH 3
+
+struct LWGEOARROW_ITERATOR
+{
+	const uint8_t *buf;
+	size_t size;
+	size_t pos; /* next message */
+	int done;
+
+	/* Layout of the geometry column */
+	uint8_t type; /* native geometry type, 0 for WKB */
+	uint8_t depth;
+	uint8_t large[GEOARROW_MAX_DEPTH]; /* 64-bit offsets */
+	uint8_t interleaved;
+	uint8_t has_z;
+	uint8_t has_m;
+	uint8_t ndims;
+	uint32_t node;   /* first node of the column in a record batch */
+	uint32_t buffer; /* and its first buffer */
+
+	/* Current record batch */
+	int64_t nrows;
+	int64_t row;
+	const uint8_t *validity;
+	const uint8_t *offsets[GEOARROW_MAX_DEPTH];
+	int64_t nitems[GEOARROW_MAX_DEPTH]; /* length of the array below the offsets */
+	const uint8_t *coords[4];           /* per ordinate, all of them, or the WKB data */
+};
+
+static const struct
+{
+	const char *name;
+	uint8_t type;
+	uint8_t depth;
+} geoarrow_types[] = {
+	{"geoarrow.wkb", 0, 1},
+	{"geoarrow.point", POINTTYPE, 0},
+	{"geoarrow.linestring", LINETYPE, 1},
+	{"geoarrow.polygon", POLYGONTYPE, 2},
+	{"geoarrow.multipoint", MULTIPOINTTYPE, 1},
+	{"geoarrow.multilinestring", MULTILINETYPE, 2},
+	{"geoarrow.multipolygon", MULTIPOLYGONTYPE, 3}
+};
+
+static void
+geoarrow_error(LWGEOARROW_ITERATOR *s)
+{
+	s->done = LW_TRUE;
+	lwerror("invalid Arrow IPC stream (at offset %zu)", s->pos);
+}
+
+/*
+ * Read the message at the current position, returns the message
+ * table, or 0 at the end of the stream. Sets the body of the message.
+ */
+static size_t
+geoarrow_message(LWGEOARROW_ITERATOR *s, fb_reader *fb, const uint8_t **body, uint64_t *body_length)
+{
+	fb_reader frame = {s->buf, s->size, 0};
+	uint32_t size;
+	size_t start = s->pos + 4, message;
+
+	/* No more messages, or the end of stream marker */
+	if (s->pos + 4 > s->size)
+		return 0;
+	size = fb_read(&frame, s->pos, 4);
+	if (size == ARROW_CONTINUATION)
+	{
+		size = fb_read(&frame, start, 4);
+		start += 4;
+	}
+	if (frame.error || size == 0)
+		return 0;
+	if (size > s->size - start)
+		return (geoarrow_error(s), 0);
+
+	fb->buf = s->buf + start;
+	fb->size = size;
+	fb->error = 0;
+	message = fb_table(fb, 0);
+	*body_length = fb_scalar(fb, message, ARROW_MESSAGE_BODY_LENGTH, 8, 0);
+	if (fb->error || *body_length > s->size - start - size ||
+	    fb_scalar(fb, message, ARROW_MESSAGE_VERSION, 2, 0) < ARROW_METADATA_V4)
+		return (geoarrow_error(s), 0);
+
+	*body = s->buf + start + size;
+	s->pos = start + size + *body_length;
+	return message;
+}
+
+/* Count the nodes and buffers a column takes in a record batch */
+static int
+geoarrow_count(fb_reader *fb, size_t field, uint32_t *nnodes, uint32_t *nbuffers, int depth)
+{
+	uint32_t i, nchildren;
+	size_t children;
+
+	if (depth > 64)
+		return LW_FAILURE;
+	(*nnodes)++;
+
+	/* Dictionary encoded columns only have their indices here */
+	if (fb_member(fb, field, ARROW_FIELD_DICTIONARY))
+	{
+		*nbuffers += 2;
+		return LW_SUCCESS;
+	}
+
+	switch (fb_scalar(fb, field, ARROW_FIELD_TYPE_TYPE, 1, 0))
+	{
+	case ARROW_TYPE_NULL:
+	case ARROW_TYPE_RUN_END_ENCODED:
+		break;
+	case ARROW_TYPE_STRUCT:
+	case ARROW_TYPE_FIXED_SIZE_LIST:
+		*nbuffers += 1;
+		break;
+	case ARROW_TYPE_UNION:
+		*nbuffers += fb_scalar(fb, fb_table_member(fb, field, ARROW_FIELD_TYPE), 0, 2, 0) == ARROW_UNION_SPARSE ? 1 : 2;
+		break;
+	case ARROW_TYPE_INT:
+	case ARROW_TYPE_FLOATING_POINT:
+	case ARROW_TYPE_BOOL:
+	case ARROW_TYPE_DECIMAL:
+	case ARROW_TYPE_DATE:
+	case ARROW_TYPE_TIME:
+	case ARROW_TYPE_TIMESTAMP:
+	case ARROW_TYPE_INTERVAL:
+	case ARROW_TYPE_DURATION:
+	case ARROW_TYPE_FIXED_SIZE_BINARY:
+	case ARROW_TYPE_LIST:
+	case ARROW_TYPE_LARGE_LIST:
+	case ARROW_TYPE_MAP:
+		*nbuffers += 2;
+		break;
+	case ARROW_TYPE_BINARY:
+	case ARROW_TYPE_UTF8:
+	case ARROW_TYPE_LARGE_BINARY:
+	case ARROW_TYPE_LARGE_UTF8:
+		*nbuffers += 3;
+		break;
+	default:
+		return LW_FAILURE;
+	}
+
+	children = fb_vector(fb, field, ARROW_FIELD_CHILDREN, 4, &nchildren);
+	for (i = 0; i < nchildren; i++)
+		if (!geoarrow_count(fb, fb_table(fb, children + 4 * i), nnodes, nbuffers, depth + 1))
+			return LW_FAILURE;
+	return !fb->error;
+}
+
+static inline uint8_t
+geoarrow_field_type(fb_reader *fb, size_t field)
+{
+	return fb_scalar(fb, field, ARROW_FIELD_TYPE_TYPE, 1, 0);
+}
+
+static inline int
+geoarrow_is_double(fb_reader *fb, size_t field)
+{
+	return geoarrow_field_type(fb, field) == ARROW_TYPE_FLOATING_POINT &&
+	       fb_scalar(fb, fb_table_member(fb, field, ARROW_FIELD_TYPE), 0, 2, 0) == ARROW_PRECISION_DOUBLE;
+}
+
+static size_t
+geoarrow_child(fb_reader *fb, size_t field, uint32_t i, uint32_t *nchildren)
+{
+	size_t children = fb_vector(fb, field, ARROW_FIELD_CHILDREN, 4, nchildren);
+	return i < *nchildren ? fb_table(fb, children + 4 * i) : 0;
+}
+
+/* Read the lists and coordinates of a GeoArrow column into the iterator */
+static int
+geoarrow_layout(LWGEOARROW_ITERATOR *s, fb_reader *fb, size_t field)
+{
+	uint32_t i, n, nchildren, len;
+	uint8_t type = geoarrow_field_type(fb, field);
+	const char *name;
+
+	/* WKB in a binary column */
+	if (!s->type)
+	{
+		s->large[0] = type == ARROW_TYPE_LARGE_BINARY;
+		return type == ARROW_TYPE_BINARY || type == ARROW_TYPE_LARGE_BINARY;
+	}
+
+	for (i = 0; i < s->depth; i++)
+	{
+		type = geoarrow_field_type(fb, field);
+		if (type != ARROW_TYPE_LIST && type != ARROW_TYPE_LARGE_LIST)
+			return LW_FAILURE;
+		s->large[i] = type == ARROW_TYPE_LARGE_LIST;
+		field = geoarrow_child(fb, field, 0, &n);
+		if (n != 1)
+			return LW_FAILURE;
+	}
+
+	/* Coordinates, ordinates in a struct or interleaved in a fixed size list */
+	type = geoarrow_field_type(fb, field);
+	if (type == ARROW_TYPE_STRUCT)
+	{
+		geoarrow_child(fb, field, 0, &n);
+		if (n < 2 || n > 4)
+			return LW_FAILURE;
+		for (i = 0; i < n; i++)
+		{
+			size_t child = geoarrow_child(fb, field, i, &nchildren);
+			name = fb_string(fb, child, ARROW_FIELD_NAME, &len);
+			if (!geoarrow_is_double(fb, child))
+				return LW_FAILURE;
+			if (i == 2 && fb_string_equals(name, len, "m"))
+				s->has_m = LW_TRUE;
+			else if (i == 2)
+				s->has_z = LW_TRUE;
+			else if (i == 3)
+				s->has_m = LW_TRUE;
+		}
+		s->ndims = n;
+	}
+	else if (type == ARROW_TYPE_FIXED_SIZE_LIST)
+	{
+		size_t child = geoarrow_child(fb, field, 0, &n);
+		s->ndims = fb_scalar(fb, fb_table_member(fb, field, ARROW_FIELD_TYPE), 0, 4, 0);
+		if (n != 1 || !geoarrow_is_double(fb, child) || s->ndims < 2 || s->ndims > 4)
+			return LW_FAILURE;
+		name = fb_string(fb, child, ARROW_FIELD_NAME, &len);
+		s->has_m = s->ndims == 4 || (s->ndims == 3 && fb_string_equals(name, len, "xym"));
+		s->has_z = s->ndims == 4 || (s->ndims == 3 && !s->has_m);
+		s->interleaved = LW_TRUE;
+	}
+	else
+		return LW_FAILURE;
+	return !fb->error;
+}
+
+/* Find the geometry column in the schema */
+static int
+geoarrow_schema(LWGEOARROW_ITERATOR *s, fb_reader *fb, size_t schema, char **srs)
+{
+	const size_t ntypes = sizeof(geoarrow_types) / sizeof(geoarrow_types[0]);
+	size_t fields, field, metadata, keyvalue, column = 0;
+	uint32_t nfields, nmetadata, nnodes = 0, nbuffers = 0, i, j, t, len, crs_len = 0;
+	const char *key, *value, *crs = NULL;
+	int found = LW_FALSE;
+
+	if (fb_scalar(fb, schema, 0, 2, 0) != (IS_BIG_ENDIAN ? 1 : 0))
+	{
+		s->done = LW_TRUE;
+		lwerror("Arrow IPC stream is not in machine byte order");
+		return LW_FAILURE;
+	}
+
+	fields = fb_vector(fb, schema, ARROW_SCHEMA_FIELDS, 4, &nfields);
+	for (i = 0; i < nfields && !found; i++)
+	{
+		field = fb_table(fb, fields + 4 * i);
+		metadata = fb_vector(fb, field, ARROW_FIELD_CUSTOM_METADATA, 4, &nmetadata);
+		crs = NULL;
+		for (j = 0; j < nmetadata; j++)
+		{
+			keyvalue = fb_table(fb, metadata + 4 * j);
+			key = fb_string(fb, keyvalue, ARROW_KEYVALUE_KEY, &len);
+			if (fb_string_equals(key, len, GEOARROW_EXTENSION_METADATA))
+				crs = fb_string(fb, keyvalue, ARROW_KEYVALUE_VALUE, &crs_len);
+			if (!fb_string_equals(key, len, GEOARROW_EXTENSION_NAME))
+				continue;
+
+			value = fb_string(fb, keyvalue, ARROW_KEYVALUE_VALUE, &len);
+			if (!value || len < 9 || strncmp(value, "geoarrow.", 9))
+				continue;
+			for (t = 0; t < ntypes; t++)
+				if (fb_string_equals(value, len, geoarrow_types[t].name))
+					break;
+			if (t == ntypes)
+			{
+				s->done = LW_TRUE;
+				lwerror("Unsupported GeoArrow extension type '%.*s'", (int)len, value);
+				return LW_FAILURE;
+			}
+			s->type = geoarrow_types[t].type;
+			s->depth = geoarrow_types[t].depth;
+			found = LW_TRUE;
+		}
+
+		/* Without a GeoArrow column, take the first binary one */
+		if (found || (!column && !fb_member(fb, field, ARROW_FIELD_DICTIONARY) &&
+			      (geoarrow_field_type(fb, field) == ARROW_TYPE_BINARY ||
+			       geoarrow_field_type(fb, field) == ARROW_TYPE_LARGE_BINARY)))
+		{
+			column = field;
+			s->node = nnodes;
+			s->buffer = nbuffers;
+		}
+		if (!found && !geoarrow_count(fb, field, &nnodes, &nbuffers, 0))
+		{
+			s->done = LW_TRUE;
+			lwerror("Unsupported Arrow column type before the geometry column");
+			return LW_FAILURE;
+		}
+	}
+
+	if (!column)
+	{
+		s->done = LW_TRUE;
+		lwerror("No GeoArrow geometry column found in the Arrow IPC stream");
+		return LW_FAILURE;
+	}
+	if (!found)
+	{
+		s->type = 0;
+		s->depth = 1;
+		crs = NULL;
+	}
+
+	if (fb_member(fb, column, ARROW_FIELD_DICTIONARY) || !geoarrow_layout(s, fb, column))
+	{
+		s->done = LW_TRUE;
+		lwerror("Unsupported Arrow type for the GeoArrow geometry column");
+		return LW_FAILURE;
+	}
+
+	if (srs && crs)
+		*srs = geoarrow_crs(crs, crs_len);
+	return LW_SUCCESS;
+}
+
+LWGEOARROW_ITERATOR *
+lwgeoarrow_iterator_create(const uint8_t *buf, size_t size, char **srs)
+{
+	LWGEOARROW_ITERATOR *s = lwalloc(sizeof(LWGEOARROW_ITERATOR));
+	fb_reader fb = {NULL, 0, 0};
+	const uint8_t *body;
+	uint64_t body_length;
+	size_t message;
+
+	memset(s, 0, sizeof(LWGEOARROW_ITERATOR));
+	s->buf = buf;
+	s->size = size;
+	if (srs)
+		*srs = NULL;
+
+	/* The file format wraps a stream */
+	if (size >= 8 && !memcmp(buf, ARROW_FILE_MAGIC, strlen(ARROW_FILE_MAGIC)))
+		s->pos = 8;
+
+	message = geoarrow_message(s, &fb, &body, &body_length);
+	if (!s->done && (!message || fb_scalar(&fb, message, ARROW_MESSAGE_HEADER_TYPE, 1, 0) != ARROW_MESSAGE_SCHEMA))
+		geoarrow_error(s);
+	if (!s->done && geoarrow_schema(s, &fb, fb_table_member(&fb, message, ARROW_MESSAGE_HEADER), srs) && fb.error)
+		geoarrow_error(s);
+
+	if (s->done)
+	{
+		if (srs && *srs)
+		{
+			lwfree(*srs);
+			*srs = NULL;
+		}
+		lwfree(s);
+		return NULL;
+	}
+	return s;
+}
+
+static inline int64_t
+geoarrow_node(fb_reader *fb, size_t nodes, uint32_t node, int64_t *nulls)
+{
+	int64_t length = fb_read(fb, nodes + ARROW_STRUCT_SIZE * node, 8);
+	if (nulls)
+		*nulls = fb_read(fb, nodes + ARROW_STRUCT_SIZE * node + 8, 8);
+	if (length < 0 || length > INT64_MAX / 32)
+		return (fb->error = LW_TRUE, 0);
+	return length;
+}
+
+/* Contents of a buffer, which must hold at least need bytes */
+static const uint8_t *
+geoarrow_buffer(fb_reader *fb, size_t buffers, uint32_t buffer, const uint8_t *body, uint64_t body_length, uint64_t need, uint64_t *length)
+{
+	uint64_t offset = fb_read(fb, buffers + ARROW_STRUCT_SIZE * buffer, 8);
+	*length = fb_read(fb, buffers + ARROW_STRUCT_SIZE * buffer + 8, 8);
+	if (offset > body_length || *length > body_length - offset || *length < need)
+		return (fb->error = LW_TRUE, body);
+	return body + offset;
+}
+
+/*
+ * Point at the buffers of the geometry column in a record batch. Lists
+ * and WKB have a validity bitmap and offsets, WKB then its data. The
+ * coordinates have a validity bitmap, then each double array its own
+ * and the values. Only the column itself is read for nulls.
+ */
+static int
+geoarrow_record_batch(LWGEOARROW_ITERATOR *s, fb_reader *fb, size_t batch, const uint8_t *body, uint64_t body_length)
+{
+	uint32_t nnodes, nbuffers, node = s->node, buffer = s->buffer;
+	size_t nodes = fb_vector(fb, batch, ARROW_RECORD_BATCH_NODES, ARROW_STRUCT_SIZE, &nnodes);
+	size_t buffers = fb_vector(fb, batch, ARROW_RECORD_BATCH_BUFFERS, ARROW_STRUCT_SIZE, &nbuffers);
+	uint32_t ndoubles = s->interleaved ? 1 : s->ndims;
+	int64_t length, nulls;
+	uint64_t size;
+	uint8_t level, d;
+
+	if (fb_member(fb, batch, ARROW_RECORD_BATCH_COMPRESSION))
+	{
+		s->done = LW_TRUE;
+		lwerror("Compressed Arrow record batches are not supported");
+		return LW_FAILURE;
+	}
+
+	if (s->type ? (node + s->depth + 1 + ndoubles > nnodes || buffer + 2 * s->depth + 1 + 2 * ndoubles > nbuffers)
+		    : (node + 1 > nnodes || buffer + 3 > nbuffers))
+		return LW_FAILURE;
+
+	s->nrows = fb_scalar(fb, batch, ARROW_RECORD_BATCH_LENGTH, 8, 0);
+	s->row = 0;
+	s->validity = NULL;
+	length = s->nrows;
+	if (length < 0 || length > INT64_MAX / 32)
+		return LW_FAILURE;
+
+	for (level = 0; level <= s->depth; level++)
+	{
+		if (geoarrow_node(fb, nodes, node++, &nulls) < length)
+			return LW_FAILURE;
+		if (level == 0 && nulls)
+			s->validity = geoarrow_buffer(fb, buffers, buffer, body, body_length, (length + 7) / 8, &size);
+		buffer++;
+		if (level == s->depth)
+			break;
+
+		s->offsets[level] = geoarrow_buffer(fb, buffers, buffer++, body, body_length, (length + 1) * (s->large[level] ? 8 : 4), &size);
+		if (!s->type)
+		{
+			s->coords[0] = geoarrow_buffer(fb, buffers, buffer, body, body_length, 0, &size);
+			s->nitems[0] = size;
+			return !fb->error;
+		}
+		length = s->nitems[level] = geoarrow_node(fb, nodes, node, NULL);
+	}
+
+	if (s->interleaved)
+		length *= s->ndims;
+	for (d = 0; d < ndoubles; d++)
+	{
+		if (geoarrow_node(fb, nodes, node++, NULL) < length)
+			return LW_FAILURE;
+		buffer++;
+		s->coords[d] = geoarrow_buffer(fb, buffers, buffer++, body, body_length, length * sizeof(double), &size);
+	}
+	return !fb->error;
+}
+
+static inline int64_t
+geoarrow_offset(const LWGEOARROW_ITERATOR *s, int level, int64_t i)
+{
+	int32_t offset32;
+	int64_t offset64;
+	if (s->large[level])
+	{
+		memcpy(&offset64, s->offsets[level] + 8 * i, 8);
+		return offset64;
+	}
+	memcpy(&offset32, s->offsets[level] + 4 * i, 4);
+	return offset32;
+}
+
+/* Range of items of the list i at a level, checked against the array below */
+static inline int
+geoarrow_range(const LWGEOARROW_ITERATOR *s, int level, int64_t i, int64_t *start, int64_t *end)
+{
+	*start = geoarrow_offset(s, level, i);
+	*end = geoarrow_offset(s, level, i + 1);
+	return *start >= 0 && *start <= *end && *end <= s->nitems[level] && *end - *start <= UINT32_MAX;
+}
+
+static POINTARRAY *
+geoarrow_ptarray(const LWGEOARROW_ITERATOR *s, int64_t start, int64_t end)
+{
+	uint32_t npoints = end - start, i;
+	POINTARRAY *pa = ptarray_construct(s->has_z, s->has_m, npoints);
+	double *pts = (double *)pa->serialized_pointlist;
+	uint8_t d;
+
+	if (s->interleaved)
+	{
+		if (npoints)
+			memcpy(pts, s->coords[0] + start * s->ndims * sizeof(double), (size_t)npoints * s->ndims * sizeof(double));
+		return pa;
+	}
+	for (d = 0; d < s->ndims; d++)
+		for (i = 0; i < npoints; i++)
+			memcpy(pts + (size_t)i * s->ndims + d, s->coords[d] + (start + i) * sizeof(double), sizeof(double));
+	return pa;
+}
+
+/* Empty points are stored as NaN coordinates */
+static LWGEOM *
+geoarrow_point(const LWGEOARROW_ITERATOR *s, int64_t i)
+{
+	POINTARRAY *pa = geoarrow_ptarray(s, i, i + 1);
+	const POINT2D *pt = getPoint2d_cp(pa, 0);
+	if (isnan(pt->x) && isnan(pt->y))
+	{
+		ptarray_free(pa);
+		return lwpoint_as_lwgeom(lwpoint_construct_empty(SRID_UNKNOWN, s->has_z, s->has_m));
+	}
+	return lwpoint_as_lwgeom(lwpoint_construct(SRID_UNKNOWN, NULL, pa));
+}
+
+static LWGEOM *
+geoarrow_line(const LWGEOARROW_ITERATOR *s, int level, int64_t i)
+{
+	int64_t start, end;
+	if (!geoarrow_range(s, level, i, &start, &end))
+		return NULL;
+	return lwline_as_lwgeom(lwline_construct(SRID_UNKNOWN, NULL, geoarrow_ptarray(s, start, end)));
+}
+
+static LWGEOM *
+geoarrow_poly(const LWGEOARROW_ITERATOR *s, int level, int64_t i)
+{
+	int64_t start, end, rstart, rend, r;
+	POINTARRAY **rings;
+
+	if (!geoarrow_range(s, level, i, &start, &end))
+		return NULL;
+	if (start == end)
+		return lwpoly_as_lwgeom(lwpoly_construct_empty(SRID_UNKNOWN, s->has_z, s->has_m));
+
+	rings = lwalloc(sizeof(POINTARRAY *) * (end - start));
+	for (r = start; r < end; r++)
+	{
+		if (!geoarrow_range(s, level + 1, r, &rstart, &rend))
+		{
+			while (r-- > start)
+				ptarray_free(rings[r - start]);
+			lwfree(rings);
+			return NULL;
+		}
+		rings[r - start] = geoarrow_ptarray(s, rstart, rend);
+	}
+	return lwpoly_as_lwgeom(lwpoly_construct(SRID_UNKNOWN, NULL, end - start, rings));
+}
+
+static LWGEOM *
+geoarrow_collection(const LWGEOARROW_ITERATOR *s, int64_t i)
+{
+	int64_t start, end, g;
+	LWCOLLECTION *col;
+	LWGEOM *geom;
+
+	if (!geoarrow_range(s, 0, i, &start, &end))
+		return NULL;
+	col = lwcollection_construct_empty(s->type, SRID_UNKNOWN, s->has_z, s->has_m);
+	for (g = start; g < end; g++)
+	{
+		if (s->type == MULTIPOINTTYPE)
+			geom = geoarrow_point(s, g);
+		else if (s->type == MULTILINETYPE)
+			geom = geoarrow_line(s, 1, g);
+		else
+			geom = geoarrow_poly(s, 1, g);
+		if (!geom)
+		{
+			lwcollection_free(col);
+			return NULL;
+		}
+		lwcollection_add_lwgeom(col, geom);
+	}
+	return lwcollection_as_lwgeom(col);
+}
+
+int
+lwgeoarrow_iterator_next(LWGEOARROW_ITERATOR *s, LWGEOM **geom)
+{
+	fb_reader fb;
+	const uint8_t *body;
+	uint64_t body_length;
+	size_t message;
+	int64_t row, start, end;
+
+	*geom = NULL;
+	while (!s->done && s->row >= s->nrows)
+	{
+		message = geoarrow_message(s, &fb, &body, &body_length);
+		if (!message)
+			s->done = LW_TRUE;
+		else if (fb_scalar(&fb, message, ARROW_MESSAGE_HEADER_TYPE, 1, 0) == ARROW_MESSAGE_RECORD_BATCH &&
+			 !geoarrow_record_batch(s, &fb, fb_table_member(&fb, message, ARROW_MESSAGE_HEADER), body, body_length) &&
+			 !s->done)
+			geoarrow_error(s);
+	}
+	if (s->done)
+		return LW_FALSE;
+
+	row = s->row++;
+	if (s->validity && !(s->validity[row / 8] & (1 << (row % 8))))
+		return LW_TRUE;
+
+	switch (s->type)
+	{
+	case 0:
+		if (geoarrow_range(s, 0, row, &start, &end))
+			*geom = lwgeom_from_wkb(s->coords[0] + start, end - start, LW_PARSER_CHECK_NONE);
+		break;
+	case POINTTYPE:
+		*geom = geoarrow_point(s, row);
+		break;
+	case LINETYPE:
+		*geom = geoarrow_line(s, 0, row);
+		break;
+	case POLYGONTYPE:
+		*geom = geoarrow_poly(s, 0, row);
+		break;
+	default:
+		*geom = geoarrow_collection(s, row);
+	}
+
+	if (!*geom)
+	{
+		s->done = LW_TRUE;
+		lwerror("invalid GeoArrow geometry at row %lld", (long long)row);
+		return LW_FALSE;
+	}
+	return LW_TRUE;
+}
+
+void
+lwgeoarrow_iterator_destroy(LWGEOARROW_ITERATOR *s)
+{
+	lwfree(s);
+}
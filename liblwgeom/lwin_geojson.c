@@ -24,7 +24,7 @@
  *
  **********************************************************************/
 
-#include "liblwgeom.h"
+#include "liblwgeom_internal.h"
 #include "lwgeom_log.h"
 #include "../postgis_config.h"
 
@@ -405,6 +405,804 @@ parse_geojson(json_object *geojson, int *hasz)
 	return NULL; /* Never reach */
 }
 
+/*
+ * Streaming reader
+ *
+ * The json-c path above materialises the whole document as a tree of
+ * json_object before reading a single ordinate, which costs several times
+ * the input size in small allocations. The reader below walks the text once
+ * and appends ordinates straight into the POINTARRAYs. It only accepts strict
+ * JSON in the shapes the tree walker turns into a geometry. On anything else
+ * (syntax errors, json-c extensions, unexpected nesting, repeated members)
+ * it gives up quietly and the json-c path runs instead, so errors and odd
+ * inputs are handled exactly as before.
+ */
+
+/* json-c refuses to nest deeper than 32, give up well before that */
+#define GEOJSON_MAX_DEPTH 24
+
+typedef struct
+{
+	const char *start;
+	const char *ptr;
+	int depth;
+	int hasz;
+} GEOJSON_READER;
+
+static LWGEOM *geojson_read_geometry(GEOJSON_READER *r, char **srs);
+
+static inline void
+geojson_skip_ws(GEOJSON_READER *r)
+{
+	while (*r->ptr == ' ' || *r->ptr == '\t' || *r->ptr == '\n' || *r->ptr == '\r')
+		r->ptr++;
+}
+
+static inline int
+geojson_accept(GEOJSON_READER *r, char c)
+{
+	geojson_skip_ws(r);
+	if (*r->ptr != c)
+		return LW_FALSE;
+	r->ptr++;
+	return LW_TRUE;
+}
+
+static inline int
+geojson_is_null(GEOJSON_READER *r)
+{
+	geojson_skip_ws(r);
+	return strncmp(r->ptr, "null", 4) == 0;
+}
+
+/* Enter an array or an object */
+static inline int
+geojson_open(GEOJSON_READER *r, char c)
+{
+	return geojson_accept(r, c) && ++r->depth <= GEOJSON_MAX_DEPTH;
+}
+
+/*
+ * Step to the next element of the array or object entered with
+ * geojson_open. Returns 1 if there is one, 0 after consuming the closing
+ * bracket and -1 on a missing separator.
+ */
+static inline int
+geojson_next(GEOJSON_READER *r, char close, int *count)
+{
+	geojson_skip_ws(r);
+	if (*r->ptr == close)
+	{
+		r->ptr++;
+		r->depth--;
+		return 0;
+	}
+	if ((*count)++)
+	{
+		if (*r->ptr != ',')
+			return -1;
+		r->ptr++;
+	}
+	return 1;
+}
+
+/* Read a string, handing back its raw contents with escapes left as they are */
+static int
+geojson_string(GEOJSON_READER *r, const char **str, size_t *len, int *escaped)
+{
+	const char *p;
+
+	if (!geojson_accept(r, '"'))
+		return LW_FALSE;
+
+	*escaped = LW_FALSE;
+	for (p = r->ptr; *p != '"'; p++)
+	{
+		/* Control characters, including the terminator */
+		if ((unsigned char)*p < 0x20)
+			return LW_FALSE;
+		if (*p != '\\')
+			continue;
+
+		*escaped = LW_TRUE;
+		p++;
+		if (*p == 'u')
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				char c = *++p;
+				if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+					return LW_FALSE;
+			}
+		}
+		else if (!*p || !strchr("\"\\/bfnrt", *p))
+			return LW_FALSE;
+	}
+
+	*str = r->ptr;
+	*len = p - r->ptr;
+	r->ptr = p + 1;
+	return LW_TRUE;
+}
+
+/* Read a member name and the colon after it */
+static inline int
+geojson_member(GEOJSON_READER *r, const char **key, size_t *len, int *escaped)
+{
+	return geojson_string(r, key, len, escaped) && geojson_accept(r, ':');
+}
+
+static inline int
+geojson_key_is(const char *key, size_t len, const char *name)
+{
+	return strlen(name) == len && strncasecmp(key, name, len) == 0;
+}
+
+/*
+ * Read a number to the value json_object_get_double would give for it.
+ * json-c keeps integers as int64, so those are converted from an integer
+ * rather than parsed as a double (-0 reads as 0). Integers that may not
+ * fit are left to json-c.
+ */
+static int
+geojson_number(GEOJSON_READER *r, double *d)
+{
+	const char *p, *digits;
+	int isint = LW_TRUE;
+
+	geojson_skip_ws(r);
+	p = r->ptr;
+	if (*p == '-')
+		p++;
+	digits = p;
+	if (*p == '0')
+		p++;
+	else if (*p >= '1' && *p <= '9')
+		while (*p >= '0' && *p <= '9')
+			p++;
+	else
+		return LW_FALSE;
+
+	if (*p == '.')
+	{
+		isint = LW_FALSE;
+		if (!(*++p >= '0' && *p <= '9'))
+			return LW_FALSE;
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+	if (*p == 'e' || *p == 'E')
+	{
+		isint = LW_FALSE;
+		p++;
+		if (*p == '+' || *p == '-')
+			p++;
+		if (!(*p >= '0' && *p <= '9'))
+			return LW_FALSE;
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	if (isint)
+	{
+		int64_t v = 0;
+		if (p - digits > 18)
+			return LW_FALSE;
+		for (const char *c = digits; c < p; c++)
+			v = v * 10 + (*c - '0');
+		*d = (double)(*r->ptr == '-' ? -v : v);
+	}
+	else
+	{
+		char *end;
+		*d = strtod(r->ptr, &end);
+		if (end != p)
+			return LW_FALSE;
+	}
+
+	r->ptr = p;
+	return LW_TRUE;
+}
+
+/* Step over any value, checking it is well formed */
+static int
+geojson_skip(GEOJSON_READER *r)
+{
+	const char *str;
+	size_t len;
+	int escaped;
+	double d;
+
+	geojson_skip_ws(r);
+	switch (*r->ptr)
+	{
+	case '"':
+		return geojson_string(r, &str, &len, &escaped);
+	case '[':
+	case '{':
+	{
+		char close = *r->ptr == '[' ? ']' : '}';
+		int n = 0, rv;
+		if (!geojson_open(r, *r->ptr))
+			return LW_FALSE;
+		while ((rv = geojson_next(r, close, &n)) > 0)
+		{
+			if (close == '}' && !geojson_member(r, &str, &len, &escaped))
+				return LW_FALSE;
+			if (!geojson_skip(r))
+				return LW_FALSE;
+		}
+		return rv == 0;
+	}
+	case 't':
+		len = 4;
+		str = "true";
+		break;
+	case 'f':
+		len = 5;
+		str = "false";
+		break;
+	case 'n':
+		len = 4;
+		str = "null";
+		break;
+	default:
+		return geojson_number(r, &d);
+	}
+
+	if (strncmp(r->ptr, str, len))
+		return LW_FALSE;
+	r->ptr += len;
+	return LW_TRUE;
+}
+
+/* Read one position into pa. An empty one adds nothing, like parse_geojson_coord */
+static int
+geojson_read_position(GEOJSON_READER *r, POINTARRAY *pa)
+{
+	POINT4D pt = {0, 0, 0, 0};
+	double d;
+	int n = 0, rv;
+
+	if (!geojson_open(r, '['))
+		return LW_FALSE;
+	while ((rv = geojson_next(r, ']', &n)) > 0)
+	{
+		if (!geojson_number(r, &d))
+			return LW_FALSE;
+		if (n == 1)
+			pt.x = d;
+		else if (n == 2)
+			pt.y = d;
+		else if (n == 3)
+			pt.z = d;
+	}
+	if (rv < 0 || n == 1)
+		return LW_FALSE;
+	if (!n)
+		return LW_TRUE;
+	if (n > 2)
+		r->hasz = LW_TRUE;
+	return ptarray_append_point(pa, &pt, LW_TRUE);
+}
+
+/* Read an array of positions into pa, returning how many there were or -1 */
+static int
+geojson_read_positions(GEOJSON_READER *r, POINTARRAY *pa)
+{
+	int n = 0, rv;
+
+	if (!geojson_open(r, '['))
+		return -1;
+	while ((rv = geojson_next(r, ']', &n)) > 0)
+		if (!geojson_read_position(r, pa))
+			return -1;
+	return rv < 0 ? -1 : n;
+}
+
+/* Same rules as parse_geojson_poly_rings */
+static LWPOLY *
+geojson_read_rings(GEOJSON_READER *r)
+{
+	POINTARRAY **ppa = NULL;
+	uint32_t nrings = 0, maxrings = 0;
+	int n = 0, rv;
+
+	if (!geojson_open(r, '['))
+		return NULL;
+
+	while ((rv = geojson_next(r, ']', &n)) > 0)
+	{
+		POINTARRAY *pa = ptarray_construct_empty(1, 0, 1);
+		int npoints = geojson_read_positions(r, pa);
+
+		if (npoints > 0)
+		{
+			if (nrings == maxrings)
+			{
+				maxrings = maxrings ? maxrings * 2 : 4;
+				ppa = ppa ? lwrealloc(ppa, sizeof(POINTARRAY *) * maxrings)
+					  : lwalloc(sizeof(POINTARRAY *) * maxrings);
+			}
+			ppa[nrings++] = pa;
+			continue;
+		}
+
+		ptarray_free(pa);
+		if (npoints < 0)
+			goto fail;
+
+		/* Empty outer? Don't promote first hole to outer, holes don't matter. */
+		if (n == 1)
+		{
+			while ((rv = geojson_next(r, ']', &n)) > 0)
+				if (!geojson_skip(r))
+					goto fail;
+			break;
+		}
+	}
+	if (rv < 0)
+		goto fail;
+
+	if (!nrings)
+	{
+		if (ppa)
+			lwfree(ppa);
+		return lwpoly_construct_empty(0, 1, 0);
+	}
+	return lwpoly_construct(0, NULL, nrings, ppa);
+
+fail:
+	for (uint32_t i = 0; i < nrings; i++)
+		ptarray_free(ppa[i]);
+	if (ppa)
+		lwfree(ppa);
+	return NULL;
+}
+
+/* Read the 'coordinates' of a geometry of the given type */
+static LWGEOM *
+geojson_read_coordinates(GEOJSON_READER *r, uint8_t type)
+{
+	LWCOLLECTION *col;
+	POINTARRAY *pa;
+	uint8_t subtype;
+	int n = 0, rv;
+
+	switch (type)
+	{
+	case POINTTYPE:
+		pa = ptarray_construct_empty(1, 0, 1);
+		if (!geojson_read_position(r, pa))
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+		return (LWGEOM *)lwpoint_construct(0, NULL, pa);
+
+	case LINETYPE:
+		pa = ptarray_construct_empty(1, 0, 1);
+		if (geojson_read_positions(r, pa) < 0)
+		{
+			ptarray_free(pa);
+			return NULL;
+		}
+		return (LWGEOM *)lwline_construct(0, NULL, pa);
+
+	case POLYGONTYPE:
+		return (LWGEOM *)geojson_read_rings(r);
+
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	case MULTIPOLYGONTYPE:
+		subtype = type == MULTIPOINTTYPE ? POINTTYPE : type == MULTILINETYPE ? LINETYPE : POLYGONTYPE;
+		if (!geojson_open(r, '['))
+			return NULL;
+		col = lwcollection_construct_empty(type, 0, 1, 0);
+		while ((rv = geojson_next(r, ']', &n)) > 0)
+		{
+			LWGEOM *sub = geojson_read_coordinates(r, subtype);
+			if (!sub)
+				break;
+			col = lwcollection_add_lwgeom(col, sub);
+		}
+		if (rv)
+		{
+			lwcollection_free(col);
+			return NULL;
+		}
+		return (LWGEOM *)col;
+	}
+
+	return NULL;
+}
+
+static LWGEOM *
+geojson_read_geometries(GEOJSON_READER *r)
+{
+	LWCOLLECTION *col;
+	int n = 0, rv;
+
+	if (!geojson_open(r, '['))
+		return NULL;
+	col = lwcollection_construct_empty(COLLECTIONTYPE, 0, 1, 0);
+	while ((rv = geojson_next(r, ']', &n)) > 0)
+	{
+		LWGEOM *sub = geojson_read_geometry(r, NULL);
+		if (!sub)
+			break;
+		col = lwcollection_add_lwgeom(col, sub);
+	}
+	if (rv)
+	{
+		lwcollection_free(col);
+		return NULL;
+	}
+	return (LWGEOM *)col;
+}
+
+/* Read the srs out of a 'crs' member following the lookups of lwgeom_from_geojson */
+static int
+geojson_read_crs(GEOJSON_READER *r, char **srs)
+{
+	const char *key, *name = NULL;
+	size_t len, namelen = 0;
+	int escaped, n = 0, rv;
+	int seen_type = LW_FALSE, has_type = LW_FALSE, seen_props = LW_FALSE;
+
+	/* Anything but an object has no members to find */
+	geojson_skip_ws(r);
+	if (*r->ptr != '{')
+		return geojson_skip(r);
+
+	if (!geojson_open(r, '{'))
+		return LW_FALSE;
+	while ((rv = geojson_next(r, '}', &n)) > 0)
+	{
+		if (!geojson_member(r, &key, &len, &escaped) || escaped)
+			return LW_FALSE;
+
+		if (geojson_key_is(key, len, "type"))
+		{
+			if (seen_type)
+				return LW_FALSE;
+			seen_type = LW_TRUE;
+			has_type = !geojson_is_null(r);
+			if (!geojson_skip(r))
+				return LW_FALSE;
+		}
+		else if (geojson_key_is(key, len, "properties"))
+		{
+			int m = 0, seen_name = LW_FALSE;
+			if (seen_props)
+				return LW_FALSE;
+			seen_props = LW_TRUE;
+
+			geojson_skip_ws(r);
+			if (*r->ptr != '{')
+			{
+				if (!geojson_skip(r))
+					return LW_FALSE;
+				continue;
+			}
+
+			if (!geojson_open(r, '{'))
+				return LW_FALSE;
+			while ((rv = geojson_next(r, '}', &m)) > 0)
+			{
+				if (!geojson_member(r, &key, &len, &escaped) || escaped)
+					return LW_FALSE;
+				if (!geojson_key_is(key, len, "name"))
+				{
+					if (!geojson_skip(r))
+						return LW_FALSE;
+					continue;
+				}
+				if (seen_name)
+					return LW_FALSE;
+				seen_name = LW_TRUE;
+				if (geojson_is_null(r))
+				{
+					if (!geojson_skip(r))
+						return LW_FALSE;
+				}
+				else if (!geojson_string(r, &name, &namelen, &escaped) || escaped)
+					return LW_FALSE;
+			}
+			/* json-c complains about searching an empty object */
+			if (rv < 0 || !m)
+				return LW_FALSE;
+		}
+		else if (!geojson_skip(r))
+			return LW_FALSE;
+	}
+	if (rv < 0 || !n)
+		return LW_FALSE;
+
+	if (has_type && name)
+	{
+		*srs = lwalloc(namelen + 1);
+		memcpy(*srs, name, namelen);
+		(*srs)[namelen] = '\0';
+	}
+	return LW_TRUE;
+}
+
+static uint8_t
+geojson_type(const char *name, size_t len)
+{
+	if (geojson_key_is(name, len, "Point"))
+		return POINTTYPE;
+	if (geojson_key_is(name, len, "LineString"))
+		return LINETYPE;
+	if (geojson_key_is(name, len, "Polygon"))
+		return POLYGONTYPE;
+	if (geojson_key_is(name, len, "MultiPoint"))
+		return MULTIPOINTTYPE;
+	if (geojson_key_is(name, len, "MultiLineString"))
+		return MULTILINETYPE;
+	if (geojson_key_is(name, len, "MultiPolygon"))
+		return MULTIPOLYGONTYPE;
+	if (geojson_key_is(name, len, "GeometryCollection"))
+		return COLLECTIONTYPE;
+	return 0;
+}
+
+/*
+ * Read a geometry object. Members can come in any order, so 'coordinates'
+ * or 'geometries' seen before 'type' are stepped over and read again once
+ * the type is known. The 'crs' is only looked at when srs is not NULL.
+ */
+static LWGEOM *
+geojson_read_geometry(GEOJSON_READER *r, char **srs)
+{
+	LWGEOM *geom = NULL;
+	const char *key, *str;
+	const char *coords = NULL, *geoms = NULL;
+	int coords_depth = 0, geoms_depth = 0;
+	int seen_type = LW_FALSE, seen_crs = LW_FALSE;
+	uint8_t type = 0;
+	size_t len;
+	int escaped, n = 0, rv;
+
+	if (!geojson_open(r, '{'))
+		return NULL;
+
+	while ((rv = geojson_next(r, '}', &n)) > 0)
+	{
+		if (!geojson_member(r, &key, &len, &escaped) || escaped)
+			goto fail;
+
+		if (geojson_key_is(key, len, "type"))
+		{
+			if (seen_type)
+				goto fail;
+			seen_type = LW_TRUE;
+			if (!geojson_string(r, &str, &len, &escaped) || escaped)
+				goto fail;
+			type = geojson_type(str, len);
+			if (!type)
+				goto fail;
+		}
+		else if (geojson_key_is(key, len, "coordinates"))
+		{
+			if (coords)
+				goto fail;
+			geojson_skip_ws(r);
+			coords = r->ptr;
+			coords_depth = r->depth;
+			if (type && type != COLLECTIONTYPE)
+			{
+				geom = geojson_read_coordinates(r, type);
+				if (!geom)
+					goto fail;
+			}
+			else if (!geojson_skip(r))
+				goto fail;
+		}
+		else if (geojson_key_is(key, len, "geometries"))
+		{
+			if (geoms)
+				goto fail;
+			geojson_skip_ws(r);
+			geoms = r->ptr;
+			geoms_depth = r->depth;
+			if (type == COLLECTIONTYPE)
+			{
+				geom = geojson_read_geometries(r);
+				if (!geom)
+					goto fail;
+			}
+			else if (!geojson_skip(r))
+				goto fail;
+		}
+		else if (srs && geojson_key_is(key, len, "crs"))
+		{
+			if (seen_crs)
+				goto fail;
+			seen_crs = LW_TRUE;
+			if (!geojson_read_crs(r, srs))
+				goto fail;
+		}
+		else if (!geojson_skip(r))
+			goto fail;
+	}
+	if (rv < 0 || !type)
+		goto fail;
+
+	/* The type came after what it describes, go back for it */
+	if (!geom)
+	{
+		GEOJSON_READER sub = *r;
+		if (type == COLLECTIONTYPE)
+		{
+			if (!geoms)
+				goto fail;
+			sub.ptr = geoms;
+			sub.depth = geoms_depth;
+			geom = geojson_read_geometries(&sub);
+		}
+		else
+		{
+			if (!coords)
+				goto fail;
+			sub.ptr = coords;
+			sub.depth = coords_depth;
+			geom = geojson_read_coordinates(&sub, type);
+		}
+		if (!geom)
+			goto fail;
+		r->hasz = sub.hasz;
+	}
+	return geom;
+
+fail:
+	if (geom)
+		lwgeom_free(geom);
+	return NULL;
+}
+
+/*
+ * Everything is read as 3D, drop the Z in place when no position had one.
+ * Empty polygons and collections lose their parts, as with lwgeom_force_2d.
+ */
+static void
+geojson_force_2d(LWGEOM *geom)
+{
+	POINTARRAY *pa = NULL;
+	uint32_t i;
+
+	FLAGS_SET_Z(geom->flags, 0);
+	switch (geom->type)
+	{
+	case POINTTYPE:
+		pa = ((LWPOINT *)geom)->point;
+		break;
+	case LINETYPE:
+		pa = ((LWLINE *)geom)->points;
+		break;
+	case POLYGONTYPE:
+	{
+		LWPOLY *poly = (LWPOLY *)geom;
+		if (lwpoly_is_empty(poly))
+		{
+			for (i = 0; i < poly->nrings; i++)
+				ptarray_free(poly->rings[i]);
+			poly->nrings = 0;
+		}
+		for (i = 0; i < poly->nrings; i++)
+		{
+			LWLINE ring;
+			ring.type = LINETYPE;
+			ring.points = poly->rings[i];
+			geojson_force_2d((LWGEOM *)&ring);
+		}
+		return;
+	}
+	default:
+	{
+		LWCOLLECTION *col = (LWCOLLECTION *)geom;
+		if (lwcollection_is_empty(col))
+		{
+			for (i = 0; i < col->ngeoms; i++)
+				lwgeom_free(col->geoms[i]);
+			col->ngeoms = 0;
+		}
+		for (i = 0; i < col->ngeoms; i++)
+			geojson_force_2d(col->geoms[i]);
+		return;
+	}
+	}
+
+	double *d = (double *)pa->serialized_pointlist;
+	for (i = 0; i < pa->npoints; i++)
+	{
+		d[2 * i] = d[3 * i];
+		d[2 * i + 1] = d[3 * i + 1];
+	}
+	FLAGS_SET_Z(pa->flags, 0);
+}
+
+/* Try the streaming reader on a whole document, NULL means use json-c */
+static LWGEOM *
+geojson_read(const char *geojson, char **srs)
+{
+	GEOJSON_READER r = {geojson, geojson, 0, LW_FALSE};
+	LWGEOM *geom = geojson_read_geometry(&r, srs);
+
+	geojson_skip_ws(&r);
+	if (geom && *r.ptr)
+	{
+		lwgeom_free(geom);
+		geom = NULL;
+	}
+	if (!geom)
+	{
+		if (*srs)
+			lwfree(*srs);
+		*srs = NULL;
+		return NULL;
+	}
+
+	if (!r.hasz)
+		geojson_force_2d(geom);
+	lwgeom_add_bbox(geom);
+	return geom;
+}
+
+struct LWGEOJSON_ITERATOR
+{
+	GEOJSON_READER r;
+	int nmembers;  /* members of the FeatureCollection read so far */
+	int nfeatures; /* features read so far */
+	int done;
+};
+
+static void
+geojson_iterator_error(LWGEOJSON_ITERATOR *s)
+{
+	s->done = LW_TRUE;
+	lwerror("invalid GeoJSON FeatureCollection (at offset %d)", (int)(s->r.ptr - s->r.start));
+}
+
+/* Read a feature's geometry, handing anything unusual to lwgeom_from_geojson */
+static int
+geojson_iterator_geometry(LWGEOJSON_ITERATOR *s, LWGEOM **geom)
+{
+	GEOJSON_READER *r = &s->r;
+	GEOJSON_READER start;
+	char *json, *srs = NULL;
+	size_t len;
+
+	if (geojson_is_null(r))
+		return geojson_skip(r);
+
+	r->hasz = LW_FALSE;
+	geojson_skip_ws(r);
+	start = *r;
+	*geom = geojson_read_geometry(r, NULL);
+	if (*geom)
+	{
+		if (!r->hasz)
+			geojson_force_2d(*geom);
+		lwgeom_add_bbox(*geom);
+		return LW_TRUE;
+	}
+
+	*r = start;
+	if (!geojson_skip(r))
+		return LW_FALSE;
+	len = r->ptr - start.ptr;
+	json = lwalloc(len + 1);
+	memcpy(json, start.ptr, len);
+	json[len] = '\0';
+	*geom = lwgeom_from_geojson(json, &srs);
+	lwfree(json);
+	if (srs)
+		lwfree(srs);
+	return LW_TRUE;
+}
+
 #endif /* HAVE_LIBJSON */
 
 LWGEOM *
@@ -416,6 +1214,12 @@ lwgeom_from_geojson(const char *geojson, char **srs)
 	return NULL;
 #else  /* HAVE_LIBJSON */
 
+	/* Common shapes don't need the json-c tree */
+	*srs = NULL;
+	LWGEOM *geom = geojson_read(geojson, srs);
+	if (geom)
+		return geom;
+
 	/* Begin to Parse json */
 	json_tokener *jstok = json_tokener_new();
 	json_object *poObj = json_tokener_parse_ex(jstok, geojson, -1);
@@ -470,3 +1274,173 @@ lwgeom_from_geojson(const char *geojson, char **srs)
 	return lwgeom;
 #endif /* HAVE_LIBJSON */
 }
+
+LWGEOJSON_ITERATOR *
+lwgeojson_iterator_create(const char *geojson, char **srs)
+{
+#ifndef HAVE_LIBJSON
+	*srs = NULL;
+	lwerror("You need JSON-C for lwgeojson_iterator_create");
+	return NULL;
+#else  /* HAVE_LIBJSON */
+	LWGEOJSON_ITERATOR *s = lwalloc(sizeof(LWGEOJSON_ITERATOR));
+	GEOJSON_READER *r = &s->r;
+	const char *key, *str;
+	size_t len;
+	int escaped, offset, rv = -1;
+
+	r->start = r->ptr = geojson;
+	r->depth = 0;
+	r->hasz = LW_FALSE;
+	s->nmembers = s->nfeatures = 0;
+	s->done = LW_FALSE;
+	*srs = NULL;
+
+	/* Walk up to the features, picking up the crs on the way */
+	if (geojson_open(r, '{'))
+	{
+		while ((rv = geojson_next(r, '}', &s->nmembers)) > 0)
+		{
+			if (!geojson_member(r, &key, &len, &escaped))
+				break;
+
+			if (escaped)
+			{
+				if (!geojson_skip(r))
+					break;
+			}
+			else if (geojson_key_is(key, len, "features"))
+			{
+				if (geojson_open(r, '['))
+					return s;
+				break;
+			}
+			else if (geojson_key_is(key, len, "type"))
+			{
+				if (!geojson_string(r, &str, &len, &escaped))
+					break;
+				if (!geojson_key_is(str, len, "FeatureCollection"))
+				{
+					rv = -2;
+					break;
+				}
+			}
+			else if (geojson_key_is(key, len, "crs"))
+			{
+				if (*srs)
+				{
+					lwfree(*srs);
+					*srs = NULL;
+				}
+				if (!geojson_read_crs(r, srs))
+					break;
+			}
+			else if (!geojson_skip(r))
+				break;
+		}
+	}
+
+	offset = r->ptr - r->start;
+	lwfree(s);
+	if (*srs)
+	{
+		lwfree(*srs);
+		*srs = NULL;
+	}
+
+	if (rv == 0)
+		lwerror("Unable to find 'features' in GeoJSON string");
+	else if (rv == -2)
+		lwerror("GeoJSON type is not FeatureCollection");
+	else
+		lwerror("invalid GeoJSON FeatureCollection (at offset %d)", offset);
+	return NULL;
+#endif /* HAVE_LIBJSON */
+}
+
+int
+lwgeojson_iterator_next(LWGEOJSON_ITERATOR *s, LWGEOM **geom, const char **properties, size_t *properties_len)
+{
+	*geom = NULL;
+	*properties = NULL;
+	*properties_len = 0;
+#ifndef HAVE_LIBJSON
+	lwerror("You need JSON-C for lwgeojson_iterator_next");
+	return LW_FALSE;
+#else  /* HAVE_LIBJSON */
+	GEOJSON_READER *r = &s->r;
+	const char *key;
+	size_t len;
+	int escaped, rv, n = 0;
+
+	if (s->done)
+		return LW_FALSE;
+
+	rv = geojson_next(r, ']', &s->nfeatures);
+	if (rv == 0)
+	{
+		/* Past the last feature, the rest of the collection still has to be well formed */
+		while ((rv = geojson_next(r, '}', &s->nmembers)) > 0)
+			if (!geojson_member(r, &key, &len, &escaped) || !geojson_skip(r))
+				break;
+		geojson_skip_ws(r);
+		if (rv || *r->ptr)
+			geojson_iterator_error(s);
+		s->done = LW_TRUE;
+		return LW_FALSE;
+	}
+
+	if (rv < 0 || !geojson_open(r, '{'))
+	{
+		geojson_iterator_error(s);
+		return LW_FALSE;
+	}
+
+	while ((rv = geojson_next(r, '}', &n)) > 0)
+	{
+		if (!geojson_member(r, &key, &len, &escaped))
+			break;
+
+		if (!escaped && geojson_key_is(key, len, "geometry"))
+		{
+			if (*geom)
+			{
+				lwgeom_free(*geom);
+				*geom = NULL;
+			}
+			if (!geojson_iterator_geometry(s, geom))
+				break;
+		}
+		else if (!escaped && geojson_key_is(key, len, "properties"))
+		{
+			*properties = NULL;
+			geojson_skip_ws(r);
+			if (!geojson_is_null(r))
+				*properties = r->ptr;
+			if (!geojson_skip(r))
+				break;
+			*properties_len = *properties ? (size_t)(r->ptr - *properties) : 0;
+		}
+		else if (!geojson_skip(r))
+			break;
+	}
+
+	if (rv)
+	{
+		if (*geom)
+			lwgeom_free(*geom);
+		*geom = NULL;
+		*properties = NULL;
+		*properties_len = 0;
+		geojson_iterator_error(s);
+		return LW_FALSE;
+	}
+	return LW_TRUE;
+#endif /* HAVE_LIBJSON */
+}
+
+void
+lwgeojson_iterator_destroy(LWGEOJSON_ITERATOR *s)
+{
+	lwfree(s);
+}
@@ -31,6 +31,8 @@
 #include "varint.h"
 
 #define TWKB_IN_MAXCOORDS 4
+/** Points decoded per block of varints in ptarray_from_twkb_state */
+#define TWKB_IN_BLOCK_POINTS 128
 /** Max depth in a geometry. Matches the WKB parser recursion limit. */
 #define LW_PARSER_MAX_DEPTH 200
 
@@ -191,12 +193,6 @@ safe_add_int64(int64_t *pa, int64_t b)
 	memcpy(pa, &u_a, sizeof(int64_t));
 }
 
-static inline void
-twkb_parse_state_accum_coord(twkb_parse_state *s, int coord_index)
-{
-	safe_add_int64(&s->coords[coord_index], twkb_parse_state_varint(s));
-}
-
 static uint32_t lwtype_from_twkb_type(uint8_t twkb_type)
 {
 	switch (twkb_type)
@@ -254,6 +250,7 @@ static POINTARRAY* ptarray_from_twkb_state(twkb_parse_state *s, uint32_t npoints
 	uint32_t j;
 	double *dlist;
 	double factors[TWKB_IN_MAXCOORDS];
+	int64_t deltas[TWKB_IN_BLOCK_POINTS * TWKB_IN_MAXCOORDS];
 
 	LWDEBUG(2,"Entering ptarray_from_twkb_state");
 	LWDEBUGF(4,"Pointarray has %d points", npoints);
@@ -275,12 +272,31 @@ static POINTARRAY* ptarray_from_twkb_state(twkb_parse_state *s, uint32_t npoints
 
 	pa = ptarray_construct(s->has_z, s->has_m, npoints);
 	dlist = (double*)(pa->serialized_pointlist);
-	for( i = 0; i < npoints; i++ )
+
+	/* Decode the deltas a block at a time, then accumulate them */
+	for( i = 0; i < npoints; i += TWKB_IN_BLOCK_POINTS )
 	{
-		for (j = 0; j < ndims; j++)
+		uint32_t nblock = FP_MIN(npoints - i, TWKB_IN_BLOCK_POINTS);
+		size_t nvals = (size_t)nblock * ndims;
+		size_t size, k;
+
+		size = varint_s64_decode_block(s->pos, s->twkb_end, deltas, nvals);
+		if (size)
+			twkb_parse_state_advance(s, size);
+		else
+		{
+			/* Go value by value to report the bad one */
+			for( k = 0; k < nvals; k++ )
+				deltas[k] = twkb_parse_state_varint(s);
+		}
+
+		for( k = 0; k < nvals; k += ndims )
 		{
-			twkb_parse_state_accum_coord(s, j);
-			dlist[ndims * i + j] = s->coords[j] / factors[j];
+			for( j = 0; j < ndims; j++ )
+			{
+				safe_add_int64(&s->coords[j], deltas[k + j]);
+				dlist[(size_t)ndims * i + k + j] = s->coords[j] / factors[j];
+			}
 		}
 	}
 
@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <ctype.h> /* for isspace */
+#include <float.h> /* for FLT_EVAL_METHOD */
 
 #include "lwin_wkt.h"
 #include "lwin_wkt_parse.h"
@@ -851,6 +852,32 @@ LWGEOM* wkt_parser_collection_add_geom(LWGEOM *col, LWGEOM *geom)
 	return lwcollection_as_lwgeom(lwcollection_add_lwgeom(lwgeom_as_lwcollection(col), geom));
 }
 
+/*
+* Check that the non-empty leaves of a nested collection all have the
+* given number of dimensions, as wkt_parser_set_dims() is about to relabel
+* their point arrays accordingly.
+*/
+static int wkt_parser_components_ndims_match(const LWGEOM *geom, int ndims)
+{
+	const LWCOLLECTION *col = lwgeom_as_lwcollection(geom);
+	uint32_t i;
+
+	if ( ! col )
+		return LW_TRUE;
+
+	for ( i = 0; i < col->ngeoms; i++ )
+	{
+		const LWGEOM *subgeom = col->geoms[i];
+		if ( lwgeom_is_empty(subgeom) )
+			continue;
+		if ( lwtype_is_collection(subgeom->type) ?
+		     ! wkt_parser_components_ndims_match(subgeom, ndims) :
+		     FLAGS_NDIMS(subgeom->flags) != ndims )
+			return LW_FALSE;
+	}
+	return LW_TRUE;
+}
+
 /**
  * Finalize a geometry collection by validating and harmonizing dimensionality, and set its collection type.
  *
@@ -906,6 +933,14 @@ LWGEOM* wkt_parser_collection_finalize(int lwtype, LWGEOM *geom, char *dimension
 				SET_PARSER_ERROR(PARSER_ERROR_MIXDIMS);
 				return NULL;
 			}
+
+			/* A nested collection only carries the flags of its first member */
+			if ( ! wkt_parser_components_ndims_match(subgeom, flagdims) )
+			{
+				lwgeom_free(geom);
+				SET_PARSER_ERROR(PARSER_ERROR_MIXDIMS);
+				return NULL;
+			}
 		}
 
 		/* Harmonize the collection dimensionality */
@@ -1268,6 +1303,554 @@ void lwgeom_parser_result_free(LWGEOM_PARSER_RESULT *parser_result)
 	   it is a const *char */
 }
 
+/*
+* Direct reader for the simple feature types.
+*
+* Bulk loads are dominated by POINT, LINESTRING, POLYGON, their MULTI
+* forms and GEOMETRYCOLLECTION. For those the token by token bison
+* reductions and the growing point arrays cost more than the geometry
+* itself, so this reader walks the same syntax by recursive descent.
+* It counts the coordinates of a point array before reading it, so each
+* array is allocated exactly once, and converts short decimal numbers
+* without strtod. Geometries are still assembled with the wkt_parser_*
+* functions above, so all the validity checks are shared.
+*
+* The reader only ever succeeds: on any other type, on anything it is
+* not sure the lexer would tokenize the same way, and on any error it
+* gives up, and lwgeom_parse_wkt() runs the bison parser on the whole
+* input, which keeps error messages and locations unchanged.
+*/
+
+/* Deeper collections are left to the bison parser */
+#define WKT_FAST_MAX_DEPTH 32
+
+/* Longest decimal mantissa accumulated exactly in a uint64_t */
+#define WKT_FAST_MAX_DIGITS 19
+
+typedef struct
+{
+	const char *ptr;
+	int depth;
+} WKT_FAST_READER;
+
+static LWGEOM* wkt_fast_geometry(WKT_FAST_READER *r);
+
+static inline int
+wkt_fast_is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Characters the lexer accepts right after a number */
+static inline int
+wkt_fast_is_delimiter(char c)
+{
+	return wkt_fast_is_space(c) || c == ',' || c == ')';
+}
+
+static inline int
+wkt_fast_is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline void
+wkt_fast_skip(WKT_FAST_READER *r)
+{
+	while (wkt_fast_is_space(*r->ptr))
+		r->ptr++;
+}
+
+/*
+* Match an upper case keyword, case insensitively like the lexer.
+* None of the keywords read here is a prefix of another lexer token,
+* so a match is the token the lexer would have produced.
+*/
+static int
+wkt_fast_keyword(WKT_FAST_READER *r, const char *keyword)
+{
+	const char *p = r->ptr;
+	for (; *keyword; keyword++, p++)
+	{
+		char c = *p;
+		if (c >= 'a' && c <= 'z')
+			c -= 'a' - 'A';
+		if (c != *keyword)
+			return LW_FALSE;
+	}
+	r->ptr = p;
+	return LW_TRUE;
+}
+
+/*
+* Read a number with the syntax of the lexer DOUBLE_TOK rule, including
+* the delimiter it must be followed by. Decimal mantissas of up to 19
+* digits that fit in 53 bits and exponents up to 22 convert exactly with
+* a single correctly rounded operation (Clinger's fast path), which is
+* what atof() returns as well. Everything else goes through strtod().
+*/
+static int
+wkt_fast_number(WKT_FAST_READER *r, double *d)
+{
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char *p = r->ptr;
+	uint64_t mantissa = 0;
+	int ndigits = 0, nintdigits = 0, nfracdigits = 0;
+	int exact = LW_TRUE;
+	int negative = LW_FALSE;
+	int exponent = 0;
+
+	if (*p == '-')
+	{
+		negative = LW_TRUE;
+		p++;
+	}
+	else if ((p[0] == 'n' || p[0] == 'N') && (p[1] == 'a' || p[1] == 'A') &&
+		 (p[2] == 'n' || p[2] == 'N') && wkt_fast_is_delimiter(p[3]))
+	{
+		*d = NAN;
+		r->ptr = p + 3;
+		return LW_TRUE;
+	}
+
+	for (; wkt_fast_is_digit(*p); p++, nintdigits++)
+	{
+		if (mantissa == 0 && *p == '0')
+			continue;
+		if (ndigits++ < WKT_FAST_MAX_DIGITS)
+			mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+		else
+			exact = LW_FALSE;
+	}
+	if (*p == '.')
+	{
+		for (p++; wkt_fast_is_digit(*p); p++, nfracdigits++)
+		{
+			exponent--;
+			if (mantissa == 0 && *p == '0')
+				continue;
+			if (ndigits++ < WKT_FAST_MAX_DIGITS)
+				mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+			else
+				exact = LW_FALSE;
+		}
+	}
+	if (nintdigits + nfracdigits == 0)
+		return LW_FALSE;
+
+	if (*p == 'e' || *p == 'E')
+	{
+		int e = 0, nexpdigits = 0, expnegative = LW_FALSE;
+
+		/* The lexer takes no exponent after a trailing dot, as in "1.e5" */
+		if (p[-1] == '.')
+			return LW_FALSE;
+		p++;
+		if (*p == '-' || *p == '+')
+			expnegative = (*p++ == '-');
+		for (; wkt_fast_is_digit(*p); p++, nexpdigits++)
+		{
+			if (e < 10000)
+				e = e * 10 + (*p - '0');
+		}
+		if (!nexpdigits)
+			return LW_FALSE;
+		exponent += expnegative ? -e : e;
+	}
+
+	if (!wkt_fast_is_delimiter(*p))
+		return LW_FALSE;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	if (exact && mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double v = (double)mantissa;
+		v = exponent < 0 ? v / pow10[-exponent] : v * pow10[exponent];
+		*d = negative ? -v : v;
+	}
+	else
+		*d = strtod(r->ptr, NULL);
+#else
+	/* Extended precision intermediates would round twice */
+	(void)exact;
+	(void)pow10;
+	*d = strtod(r->ptr, NULL);
+#endif
+
+	r->ptr = p;
+	return LW_TRUE;
+}
+
+/* Read the ordinates of one coordinate, returning how many (2 to 4) or zero */
+static int
+wkt_fast_coordinate(WKT_FAST_READER *r, double *ordinates)
+{
+	int n = 0;
+	for (;;)
+	{
+		wkt_fast_skip(r);
+		if (*r->ptr == ',' || *r->ptr == ')')
+			return n >= 2 ? n : 0;
+		if (n == 4 || !wkt_fast_number(r, ordinates + n))
+			return 0;
+		n++;
+	}
+}
+
+/*
+* Read the coordinates after an opening bracket, and the closing one.
+* The coordinates are counted first, so the array is allocated once.
+* Like wkt_parser_ptarray_new(), three ordinates are stored as XYZ
+* until the dimensionality tag says otherwise.
+*/
+static POINTARRAY*
+wkt_fast_ptarray(WKT_FAST_READER *r)
+{
+	double ordinates[4];
+	uint32_t npoints = 1;
+	uint32_t i;
+	int ndims;
+	const char *p;
+	double *dst;
+	POINTARRAY *pa;
+
+	for (p = r->ptr; *p != ')'; p++)
+	{
+		if (*p == ',')
+			npoints++;
+		else if (*p == '(' || *p == '\0')
+			return NULL;
+	}
+
+	ndims = wkt_fast_coordinate(r, ordinates);
+	if (!ndims)
+		return NULL;
+
+	pa = ptarray_construct(ndims > 2, ndims > 3, npoints);
+	dst = (double*)pa->serialized_pointlist;
+	memcpy(dst, ordinates, ndims * sizeof(double));
+	dst += ndims;
+
+	for (i = 1; i < npoints; i++)
+	{
+		/* The coordinate reader stopped on a comma or a bracket */
+		if (*r->ptr != ',')
+			break;
+		r->ptr++;
+		if (wkt_fast_coordinate(r, ordinates) != ndims)
+			break;
+		memcpy(dst, ordinates, ndims * sizeof(double));
+		dst += ndims;
+	}
+
+	if (i < npoints || *r->ptr != ')')
+	{
+		ptarray_free(pa);
+		return NULL;
+	}
+	r->ptr++;
+	return pa;
+}
+
+/* A geometry built by a wkt_parser_* function, or NULL if it failed */
+static inline LWGEOM*
+wkt_fast_built(LWGEOM *geom)
+{
+	/* On error the constructors have already freed their inputs */
+	return global_parser_result.errcode ? NULL : geom;
+}
+
+/* Read "(" or EMPTY, after optional white space */
+static int
+wkt_fast_open(WKT_FAST_READER *r, int *empty)
+{
+	wkt_fast_skip(r);
+	if (*r->ptr == '(')
+	{
+		r->ptr++;
+		*empty = LW_FALSE;
+		return LW_TRUE;
+	}
+	*empty = LW_TRUE;
+	return wkt_fast_keyword(r, "EMPTY");
+}
+
+/* Read the optional Z, M or ZM tag after a type name, then "(" or EMPTY */
+static int
+wkt_fast_tag(WKT_FAST_READER *r, char **dimensionality, int *empty)
+{
+	wkt_fast_skip(r);
+	*dimensionality = NULL;
+	if (*r->ptr == 'Z' || *r->ptr == 'z')
+	{
+		int zm = r->ptr[1] == 'M' || r->ptr[1] == 'm';
+		*dimensionality = zm ? "ZM" : "Z";
+		r->ptr += zm ? 2 : 1;
+	}
+	else if (*r->ptr == 'M' || *r->ptr == 'm')
+	{
+		*dimensionality = "M";
+		r->ptr++;
+	}
+	return wkt_fast_open(r, empty);
+}
+
+/* Consume a list separator, if that is what comes next */
+static int
+wkt_fast_next(WKT_FAST_READER *r)
+{
+	wkt_fast_skip(r);
+	if (*r->ptr != ',')
+		return LW_FALSE;
+	r->ptr++;
+	return LW_TRUE;
+}
+
+static int
+wkt_fast_close(WKT_FAST_READER *r)
+{
+	wkt_fast_skip(r);
+	if (*r->ptr != ')')
+		return LW_FALSE;
+	r->ptr++;
+	return LW_TRUE;
+}
+
+/* Read the rings of a polygon after its opening bracket, and the closing one */
+static LWGEOM*
+wkt_fast_rings(WKT_FAST_READER *r)
+{
+	LWGEOM *poly = NULL;
+
+	do
+	{
+		POINTARRAY *pa = NULL;
+
+		wkt_fast_skip(r);
+		if (*r->ptr == '(')
+		{
+			r->ptr++;
+			pa = wkt_fast_ptarray(r);
+		}
+		if (!pa)
+		{
+			if (poly)
+				lwgeom_free(poly);
+			return NULL;
+		}
+		poly = poly ? wkt_parser_polygon_add_ring(poly, pa, '2') : wkt_parser_polygon_new(pa, '2');
+		if (global_parser_result.errcode)
+			return NULL;
+	}
+	while (wkt_fast_next(r));
+
+	if (!wkt_fast_close(r))
+	{
+		lwgeom_free(poly);
+		return NULL;
+	}
+	return poly;
+}
+
+/* MULTIPOINT member: a coordinate, a bracketed coordinate or EMPTY */
+static LWGEOM*
+wkt_fast_point_untagged(WKT_FAST_READER *r)
+{
+	double ordinates[4];
+	POINTARRAY *pa;
+	int bracketed;
+	int ndims;
+
+	wkt_fast_skip(r);
+	if (wkt_fast_keyword(r, "EMPTY"))
+		return wkt_fast_built(wkt_parser_point_new(NULL, NULL));
+
+	bracketed = (*r->ptr == '(');
+	if (bracketed)
+		r->ptr++;
+	ndims = wkt_fast_coordinate(r, ordinates);
+	if (!ndims || (bracketed && !wkt_fast_close(r)))
+		return NULL;
+
+	pa = ptarray_construct(ndims > 2, ndims > 3, 1);
+	memcpy(pa->serialized_pointlist, ordinates, ndims * sizeof(double));
+	return wkt_fast_built(wkt_parser_point_new(pa, NULL));
+}
+
+/* MULTILINESTRING member: a bracketed point array or EMPTY */
+static LWGEOM*
+wkt_fast_linestring_untagged(WKT_FAST_READER *r)
+{
+	POINTARRAY *pa;
+	int empty;
+
+	if (!wkt_fast_open(r, &empty))
+		return NULL;
+	if (empty)
+		return wkt_fast_built(wkt_parser_linestring_new(NULL, NULL));
+	pa = wkt_fast_ptarray(r);
+	return pa ? wkt_fast_built(wkt_parser_linestring_new(pa, NULL)) : NULL;
+}
+
+/* MULTIPOLYGON member: a bracketed ring list or EMPTY */
+static LWGEOM*
+wkt_fast_polygon_untagged(WKT_FAST_READER *r)
+{
+	int empty;
+
+	if (!wkt_fast_open(r, &empty))
+		return NULL;
+	if (empty)
+		return wkt_fast_built(wkt_parser_polygon_finalize(NULL, NULL));
+	return wkt_fast_rings(r);
+}
+
+/* GEOMETRYCOLLECTION member */
+static LWGEOM*
+wkt_fast_collection_member(WKT_FAST_READER *r)
+{
+	LWGEOM *geom;
+
+	if (++r->depth > WKT_FAST_MAX_DEPTH)
+		return NULL;
+	geom = wkt_fast_geometry(r);
+	r->depth--;
+	return geom;
+}
+
+static LWGEOM*
+wkt_fast_collection(WKT_FAST_READER *r, int lwtype, LWGEOM* (*read_member)(WKT_FAST_READER *r))
+{
+	LWGEOM *col = NULL;
+	char *dimensionality;
+	int empty;
+
+	if (!wkt_fast_tag(r, &dimensionality, &empty))
+		return NULL;
+	if (empty)
+		return wkt_fast_built(wkt_parser_collection_finalize(lwtype, NULL, dimensionality));
+
+	do
+	{
+		LWGEOM *geom = read_member(r);
+		if (!geom)
+		{
+			if (col)
+				lwgeom_free(col);
+			return NULL;
+		}
+		col = col ? wkt_parser_collection_add_geom(col, geom) : wkt_parser_collection_new(geom);
+	}
+	while (wkt_fast_next(r));
+
+	if (!wkt_fast_close(r))
+	{
+		lwgeom_free(col);
+		return NULL;
+	}
+	return wkt_fast_built(wkt_parser_collection_finalize(lwtype, col, dimensionality));
+}
+
+static LWGEOM*
+wkt_fast_geometry(WKT_FAST_READER *r)
+{
+	POINTARRAY *pa;
+	char *dimensionality;
+	int empty;
+
+	wkt_fast_skip(r);
+	if (wkt_fast_keyword(r, "POINT"))
+	{
+		if (!wkt_fast_tag(r, &dimensionality, &empty))
+			return NULL;
+		if (empty)
+			return wkt_fast_built(wkt_parser_point_new(NULL, dimensionality));
+		pa = wkt_fast_ptarray(r);
+		return pa ? wkt_fast_built(wkt_parser_point_new(pa, dimensionality)) : NULL;
+	}
+	if (wkt_fast_keyword(r, "LINESTRING"))
+	{
+		if (!wkt_fast_tag(r, &dimensionality, &empty))
+			return NULL;
+		if (empty)
+			return wkt_fast_built(wkt_parser_linestring_new(NULL, dimensionality));
+		pa = wkt_fast_ptarray(r);
+		return pa ? wkt_fast_built(wkt_parser_linestring_new(pa, dimensionality)) : NULL;
+	}
+	if (wkt_fast_keyword(r, "POLYGON"))
+	{
+		LWGEOM *poly = NULL;
+		if (!wkt_fast_tag(r, &dimensionality, &empty))
+			return NULL;
+		if (!empty && !(poly = wkt_fast_rings(r)))
+			return NULL;
+		return wkt_fast_built(wkt_parser_polygon_finalize(poly, dimensionality));
+	}
+	if (wkt_fast_keyword(r, "MULTIPOINT"))
+		return wkt_fast_collection(r, MULTIPOINTTYPE, wkt_fast_point_untagged);
+	if (wkt_fast_keyword(r, "MULTILINESTRING"))
+		return wkt_fast_collection(r, MULTILINETYPE, wkt_fast_linestring_untagged);
+	if (wkt_fast_keyword(r, "MULTIPOLYGON"))
+		return wkt_fast_collection(r, MULTIPOLYGONTYPE, wkt_fast_polygon_untagged);
+	if (wkt_fast_keyword(r, "GEOMETRYCOLLECTION"))
+		return wkt_fast_collection(r, COLLECTIONTYPE, wkt_fast_collection_member);
+
+	/* Curves, surfaces and anything else go to the bison parser */
+	return NULL;
+}
+
+/**
+* Parse WKT with the direct reader. Returns LW_SUCCESS with the same
+* result lwgeom_parse_wkt() would produce, or LW_FAILURE when the input
+* must go through the bison parser, either because it uses a type the
+* reader does not handle or because it has an error to report.
+*/
+int wkt_parse_fast(LWGEOM_PARSER_RESULT *parser_result, const char *wktstr, int parser_check_flags)
+{
+	WKT_FAST_READER r;
+	const char *srid = NULL;
+	LWGEOM *geom;
+
+	lwgeom_parser_result_init(&global_parser_result);
+	global_parser_result.wkinput = wktstr;
+	global_parser_result.parser_check_flags = parser_check_flags;
+
+	r.ptr = wktstr;
+	r.depth = 0;
+	wkt_fast_skip(&r);
+	if (wkt_fast_keyword(&r, "SRID="))
+	{
+		srid = r.ptr - 5;
+		if (*r.ptr == '-')
+			r.ptr++;
+		if (!wkt_fast_is_digit(*r.ptr))
+			return LW_FAILURE;
+		while (wkt_fast_is_digit(*r.ptr))
+			r.ptr++;
+		wkt_fast_skip(&r);
+		if (*r.ptr++ != ';')
+			return LW_FAILURE;
+	}
+
+	geom = wkt_fast_geometry(&r);
+	if (!geom)
+		return LW_FAILURE;
+
+	wkt_fast_skip(&r);
+	if (*r.ptr)
+	{
+		lwgeom_free(geom);
+		return LW_FAILURE;
+	}
+
+	/* Read the SRID last, so an input handed over to bison warns only once */
+	wkt_parser_geometry_new(geom, srid ? wkt_lexer_read_srid((char*)srid) : SRID_UNKNOWN);
+	*parser_result = global_parser_result;
+	return LW_SUCCESS;
+}
+
 /*
 * Public function used for easy access to the parser.
 */
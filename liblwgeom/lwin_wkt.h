@@ -80,5 +80,10 @@ LWGEOM* wkt_parser_collection_add_geom(LWGEOM *col, LWGEOM *geom);
 LWGEOM* wkt_parser_collection_finalize(int lwtype, LWGEOM *col, char *dimensionality);
 void wkt_parser_geometry_new(LWGEOM *geom, int32_t srid);
 
+/*
+* Direct reader for the simple feature types, tried before the bison parser.
+*/
+int wkt_parse_fast(LWGEOM_PARSER_RESULT *parser_result, const char *wktstr, int parser_check_flags);
+
 LWGEOM* wkt_parser_nurbscurve_new(double degree, POINTARRAY *points, POINTARRAY *weights, POINTARRAY *knots, char *dimensionality);
 LWGEOM* wkt_parser_nurbscurve_empty(char *dimensionality);
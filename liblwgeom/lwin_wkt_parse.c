@@ -128,6 +128,13 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, const char *wktstr, in
 {
 	int parse_rv = 0;
 
+	/*
+	* Valid simple features are read directly. Everything else, and
+	* every error, goes through the grammar below.
+	*/
+	if ( wktstr && wkt_parse_fast(parser_result, wktstr, parser_check_flags) == LW_SUCCESS )
+		return LW_SUCCESS;
+
 	/* Clean up our global parser result. */
 	lwgeom_parser_result_init(&global_parser_result);
 	/* Work-around possible bug in GNU Bison 3.0.2 resulting in wkt_yylloc
@@ -334,7 +341,7 @@ wkt_parser_knot_list_add_repeated(POINTARRAY *knots, double value, double multip
 }
 
 
-#line 338 "lwin_wkt_parse.c"
+#line 345 "lwin_wkt_parse.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -834,23 +841,23 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   387,   387,   389,   393,   394,   395,   396,   397,   398,
-     399,   400,   401,   402,   403,   404,   405,   406,   407,   408,
-     411,   413,   415,   417,   421,   423,   427,   429,   431,   433,
-     437,   439,   441,   443,   445,   447,   451,   453,   455,   457,
-     461,   463,   465,   467,   471,   473,   475,   477,   481,   483,
-     487,   489,   493,   495,   497,   499,   503,   505,   509,   512,
-     514,   516,   518,   522,   524,   528,   529,   530,   531,   532,
-     535,   537,   541,   543,   547,   550,   553,   555,   557,   559,
-     563,   565,   567,   569,   571,   573,   575,   577,   581,   583,
-     585,   587,   591,   593,   595,   597,   599,   601,   603,   605,
-     607,   609,   613,   615,   617,   619,   623,   625,   629,   631,
-     633,   635,   639,   641,   643,   645,   649,   651,   655,   657,
-     661,   663,   665,   667,   671,   675,   677,   679,   681,   685,
-     687,   691,   693,   695,   699,   701,   703,   705,   709,   711,
-     715,   717,   719,   723,   725,   729,   738,   748,   750,   753,
-     755,   758,   760,   764,   766,   771,   776,   778,   783,   785,
-     790,   795,   803,   808
+       0,   394,   394,   396,   400,   401,   402,   403,   404,   405,
+     406,   407,   408,   409,   410,   411,   412,   413,   414,   415,
+     418,   420,   422,   424,   428,   430,   434,   436,   438,   440,
+     444,   446,   448,   450,   452,   454,   458,   460,   462,   464,
+     468,   470,   472,   474,   478,   480,   482,   484,   488,   490,
+     494,   496,   500,   502,   504,   506,   510,   512,   516,   519,
+     521,   523,   525,   529,   531,   535,   536,   537,   538,   539,
+     542,   544,   548,   550,   554,   557,   560,   562,   564,   566,
+     570,   572,   574,   576,   578,   580,   582,   584,   588,   590,
+     592,   594,   598,   600,   602,   604,   606,   608,   610,   612,
+     614,   616,   620,   622,   624,   626,   630,   632,   636,   638,
+     640,   642,   646,   648,   650,   652,   656,   658,   662,   664,
+     668,   670,   672,   674,   678,   682,   684,   686,   688,   692,
+     694,   698,   700,   702,   706,   708,   710,   712,   716,   718,
+     722,   724,   726,   730,   732,   736,   745,   755,   757,   760,
+     762,   765,   767,   771,   773,   778,   783,   785,   790,   792,
+     797,   802,   810,   815
 };
 #endif
 
@@ -1481,261 +1488,261 @@ yydestruct (const char *yymsg,
   switch (yykind)
     {
     case YYSYMBOL_geometry_no_srid: /* geometry_no_srid  */
-#line 363 "lwin_wkt_parse.y"
+#line 370 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1487 "lwin_wkt_parse.c"
+#line 1494 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_geometrycollection: /* geometrycollection  */
-#line 364 "lwin_wkt_parse.y"
+#line 371 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1493 "lwin_wkt_parse.c"
+#line 1500 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_geometry_list: /* geometry_list  */
-#line 365 "lwin_wkt_parse.y"
+#line 372 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1499 "lwin_wkt_parse.c"
+#line 1506 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multisurface: /* multisurface  */
-#line 372 "lwin_wkt_parse.y"
+#line 379 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1505 "lwin_wkt_parse.c"
+#line 1512 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_surface_list: /* surface_list  */
-#line 350 "lwin_wkt_parse.y"
+#line 357 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1511 "lwin_wkt_parse.c"
+#line 1518 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_tin: /* tin  */
-#line 380 "lwin_wkt_parse.y"
+#line 387 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1517 "lwin_wkt_parse.c"
+#line 1524 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polyhedralsurface: /* polyhedralsurface  */
-#line 378 "lwin_wkt_parse.y"
+#line 385 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1523 "lwin_wkt_parse.c"
+#line 1530 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multipolygon: /* multipolygon  */
-#line 371 "lwin_wkt_parse.y"
+#line 378 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1529 "lwin_wkt_parse.c"
+#line 1536 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon_list: /* polygon_list  */
-#line 351 "lwin_wkt_parse.y"
+#line 358 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1535 "lwin_wkt_parse.c"
+#line 1542 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patch_list: /* patch_list  */
-#line 352 "lwin_wkt_parse.y"
+#line 359 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1541 "lwin_wkt_parse.c"
+#line 1548 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon: /* polygon  */
-#line 375 "lwin_wkt_parse.y"
+#line 382 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1547 "lwin_wkt_parse.c"
+#line 1554 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_polygon_untagged: /* polygon_untagged  */
-#line 377 "lwin_wkt_parse.y"
+#line 384 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1553 "lwin_wkt_parse.c"
+#line 1560 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patch: /* patch  */
-#line 376 "lwin_wkt_parse.y"
+#line 383 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1559 "lwin_wkt_parse.c"
+#line 1566 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvepolygon: /* curvepolygon  */
-#line 361 "lwin_wkt_parse.y"
+#line 368 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1565 "lwin_wkt_parse.c"
+#line 1572 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvering_list: /* curvering_list  */
-#line 348 "lwin_wkt_parse.y"
+#line 355 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1571 "lwin_wkt_parse.c"
+#line 1578 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curvering: /* curvering  */
-#line 362 "lwin_wkt_parse.y"
+#line 369 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1577 "lwin_wkt_parse.c"
+#line 1584 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patchring_list: /* patchring_list  */
-#line 358 "lwin_wkt_parse.y"
+#line 365 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1583 "lwin_wkt_parse.c"
+#line 1590 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ring_list: /* ring_list  */
-#line 357 "lwin_wkt_parse.y"
+#line 364 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1589 "lwin_wkt_parse.c"
+#line 1596 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_patchring: /* patchring  */
-#line 342 "lwin_wkt_parse.y"
+#line 349 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1595 "lwin_wkt_parse.c"
+#line 1602 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ring: /* ring  */
-#line 341 "lwin_wkt_parse.y"
+#line 348 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1601 "lwin_wkt_parse.c"
+#line 1608 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_compoundcurve: /* compoundcurve  */
-#line 360 "lwin_wkt_parse.y"
+#line 367 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1607 "lwin_wkt_parse.c"
+#line 1614 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_compound_list: /* compound_list  */
-#line 356 "lwin_wkt_parse.y"
+#line 363 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1613 "lwin_wkt_parse.c"
+#line 1620 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multicurve: /* multicurve  */
-#line 368 "lwin_wkt_parse.y"
+#line 375 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1619 "lwin_wkt_parse.c"
+#line 1626 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_curve_list: /* curve_list  */
-#line 355 "lwin_wkt_parse.y"
+#line 362 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1625 "lwin_wkt_parse.c"
+#line 1632 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multilinestring: /* multilinestring  */
-#line 369 "lwin_wkt_parse.y"
+#line 376 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1631 "lwin_wkt_parse.c"
+#line 1638 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring_list: /* linestring_list  */
-#line 354 "lwin_wkt_parse.y"
+#line 361 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1637 "lwin_wkt_parse.c"
+#line 1644 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_circularstring: /* circularstring  */
-#line 359 "lwin_wkt_parse.y"
+#line 366 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1643 "lwin_wkt_parse.c"
+#line 1650 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring: /* linestring  */
-#line 366 "lwin_wkt_parse.y"
+#line 373 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1649 "lwin_wkt_parse.c"
+#line 1656 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_linestring_untagged: /* linestring_untagged  */
-#line 367 "lwin_wkt_parse.y"
+#line 374 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1655 "lwin_wkt_parse.c"
+#line 1662 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle_list: /* triangle_list  */
-#line 349 "lwin_wkt_parse.y"
+#line 356 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1661 "lwin_wkt_parse.c"
+#line 1668 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle: /* triangle  */
-#line 381 "lwin_wkt_parse.y"
+#line 388 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1667 "lwin_wkt_parse.c"
+#line 1674 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_triangle_untagged: /* triangle_untagged  */
-#line 382 "lwin_wkt_parse.y"
+#line 389 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1673 "lwin_wkt_parse.c"
+#line 1680 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_multipoint: /* multipoint  */
-#line 370 "lwin_wkt_parse.y"
+#line 377 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1679 "lwin_wkt_parse.c"
+#line 1686 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point_list: /* point_list  */
-#line 353 "lwin_wkt_parse.y"
+#line 360 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1685 "lwin_wkt_parse.c"
+#line 1692 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point_untagged: /* point_untagged  */
-#line 374 "lwin_wkt_parse.y"
+#line 381 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1691 "lwin_wkt_parse.c"
+#line 1698 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_point: /* point  */
-#line 373 "lwin_wkt_parse.y"
+#line 380 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1697 "lwin_wkt_parse.c"
+#line 1704 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_ptarray: /* ptarray  */
-#line 340 "lwin_wkt_parse.y"
+#line 347 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1703 "lwin_wkt_parse.c"
+#line 1710 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_nurbscurve: /* nurbscurve  */
-#line 379 "lwin_wkt_parse.y"
+#line 386 "lwin_wkt_parse.y"
             { lwgeom_free(((*yyvaluep).geometryvalue)); }
-#line 1709 "lwin_wkt_parse.c"
+#line 1716 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_iso_controlpoint: /* iso_controlpoint  */
-#line 346 "lwin_wkt_parse.y"
+#line 353 "lwin_wkt_parse.y"
             { wkt_parser_nurbs_controlpoints_free(((*yyvaluep).nurbscontrolpointsvalue)); }
-#line 1715 "lwin_wkt_parse.c"
+#line 1722 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_iso_controlpoint_list: /* iso_controlpoint_list  */
-#line 347 "lwin_wkt_parse.y"
+#line 354 "lwin_wkt_parse.y"
             { wkt_parser_nurbs_controlpoints_free(((*yyvaluep).nurbscontrolpointsvalue)); }
-#line 1721 "lwin_wkt_parse.c"
+#line 1728 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_iso_knot_list: /* iso_knot_list  */
-#line 345 "lwin_wkt_parse.y"
+#line 352 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1727 "lwin_wkt_parse.c"
+#line 1734 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_weight_list: /* weight_list  */
-#line 343 "lwin_wkt_parse.y"
+#line 350 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1733 "lwin_wkt_parse.c"
+#line 1740 "lwin_wkt_parse.c"
         break;
 
     case YYSYMBOL_knot_list: /* knot_list  */
-#line 344 "lwin_wkt_parse.y"
+#line 351 "lwin_wkt_parse.y"
             { ptarray_free(((*yyvaluep).ptarrayvalue)); }
-#line 1739 "lwin_wkt_parse.c"
+#line 1746 "lwin_wkt_parse.c"
         break;
 
       default:
@@ -2028,865 +2035,865 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* geometry: geometry_no_srid  */
-#line 388 "lwin_wkt_parse.y"
+#line 395 "lwin_wkt_parse.y"
                 { wkt_parser_geometry_new((yyvsp[0].geometryvalue), SRID_UNKNOWN); WKT_ERROR(); }
-#line 2034 "lwin_wkt_parse.c"
+#line 2041 "lwin_wkt_parse.c"
     break;
 
   case 3: /* geometry: SRID_TOK SEMICOLON_TOK geometry_no_srid  */
-#line 390 "lwin_wkt_parse.y"
+#line 397 "lwin_wkt_parse.y"
                 { wkt_parser_geometry_new((yyvsp[0].geometryvalue), (yyvsp[-2].integervalue)); WKT_ERROR(); }
-#line 2040 "lwin_wkt_parse.c"
+#line 2047 "lwin_wkt_parse.c"
     break;
 
   case 4: /* geometry_no_srid: point  */
-#line 393 "lwin_wkt_parse.y"
+#line 400 "lwin_wkt_parse.y"
               { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2046 "lwin_wkt_parse.c"
+#line 2053 "lwin_wkt_parse.c"
     break;
 
   case 5: /* geometry_no_srid: linestring  */
-#line 394 "lwin_wkt_parse.y"
+#line 401 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2052 "lwin_wkt_parse.c"
+#line 2059 "lwin_wkt_parse.c"
     break;
 
   case 6: /* geometry_no_srid: circularstring  */
-#line 395 "lwin_wkt_parse.y"
+#line 402 "lwin_wkt_parse.y"
                        { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2058 "lwin_wkt_parse.c"
+#line 2065 "lwin_wkt_parse.c"
     break;
 
   case 7: /* geometry_no_srid: compoundcurve  */
-#line 396 "lwin_wkt_parse.y"
+#line 403 "lwin_wkt_parse.y"
                       { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2064 "lwin_wkt_parse.c"
+#line 2071 "lwin_wkt_parse.c"
     break;
 
   case 8: /* geometry_no_srid: polygon  */
-#line 397 "lwin_wkt_parse.y"
+#line 404 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2070 "lwin_wkt_parse.c"
+#line 2077 "lwin_wkt_parse.c"
     break;
 
   case 9: /* geometry_no_srid: curvepolygon  */
-#line 398 "lwin_wkt_parse.y"
+#line 405 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2076 "lwin_wkt_parse.c"
+#line 2083 "lwin_wkt_parse.c"
     break;
 
   case 10: /* geometry_no_srid: multipoint  */
-#line 399 "lwin_wkt_parse.y"
+#line 406 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2082 "lwin_wkt_parse.c"
+#line 2089 "lwin_wkt_parse.c"
     break;
 
   case 11: /* geometry_no_srid: multilinestring  */
-#line 400 "lwin_wkt_parse.y"
+#line 407 "lwin_wkt_parse.y"
                         { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2088 "lwin_wkt_parse.c"
+#line 2095 "lwin_wkt_parse.c"
     break;
 
   case 12: /* geometry_no_srid: multipolygon  */
-#line 401 "lwin_wkt_parse.y"
+#line 408 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2094 "lwin_wkt_parse.c"
+#line 2101 "lwin_wkt_parse.c"
     break;
 
   case 13: /* geometry_no_srid: multisurface  */
-#line 402 "lwin_wkt_parse.y"
+#line 409 "lwin_wkt_parse.y"
                      { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2100 "lwin_wkt_parse.c"
+#line 2107 "lwin_wkt_parse.c"
     break;
 
   case 14: /* geometry_no_srid: multicurve  */
-#line 403 "lwin_wkt_parse.y"
+#line 410 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2106 "lwin_wkt_parse.c"
+#line 2113 "lwin_wkt_parse.c"
     break;
 
   case 15: /* geometry_no_srid: tin  */
-#line 404 "lwin_wkt_parse.y"
+#line 411 "lwin_wkt_parse.y"
             { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2112 "lwin_wkt_parse.c"
+#line 2119 "lwin_wkt_parse.c"
     break;
 
   case 16: /* geometry_no_srid: polyhedralsurface  */
-#line 405 "lwin_wkt_parse.y"
+#line 412 "lwin_wkt_parse.y"
                           { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2118 "lwin_wkt_parse.c"
+#line 2125 "lwin_wkt_parse.c"
     break;
 
   case 17: /* geometry_no_srid: triangle  */
-#line 406 "lwin_wkt_parse.y"
+#line 413 "lwin_wkt_parse.y"
                  { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2124 "lwin_wkt_parse.c"
+#line 2131 "lwin_wkt_parse.c"
     break;
 
   case 18: /* geometry_no_srid: nurbscurve  */
-#line 407 "lwin_wkt_parse.y"
+#line 414 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2130 "lwin_wkt_parse.c"
+#line 2137 "lwin_wkt_parse.c"
     break;
 
   case 19: /* geometry_no_srid: geometrycollection  */
-#line 408 "lwin_wkt_parse.y"
+#line 415 "lwin_wkt_parse.y"
                            { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2136 "lwin_wkt_parse.c"
+#line 2143 "lwin_wkt_parse.c"
     break;
 
   case 20: /* geometrycollection: COLLECTION_TOK LBRACKET_TOK geometry_list RBRACKET_TOK  */
-#line 412 "lwin_wkt_parse.y"
+#line 419 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2142 "lwin_wkt_parse.c"
+#line 2149 "lwin_wkt_parse.c"
     break;
 
   case 21: /* geometrycollection: COLLECTION_TOK DIMENSIONALITY_TOK LBRACKET_TOK geometry_list RBRACKET_TOK  */
-#line 414 "lwin_wkt_parse.y"
+#line 421 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2148 "lwin_wkt_parse.c"
+#line 2155 "lwin_wkt_parse.c"
     break;
 
   case 22: /* geometrycollection: COLLECTION_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 416 "lwin_wkt_parse.y"
+#line 423 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2154 "lwin_wkt_parse.c"
+#line 2161 "lwin_wkt_parse.c"
     break;
 
   case 23: /* geometrycollection: COLLECTION_TOK EMPTY_TOK  */
-#line 418 "lwin_wkt_parse.y"
+#line 425 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(COLLECTIONTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2160 "lwin_wkt_parse.c"
+#line 2167 "lwin_wkt_parse.c"
     break;
 
   case 24: /* geometry_list: geometry_list COMMA_TOK geometry_no_srid  */
-#line 422 "lwin_wkt_parse.y"
+#line 429 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2166 "lwin_wkt_parse.c"
+#line 2173 "lwin_wkt_parse.c"
     break;
 
   case 25: /* geometry_list: geometry_no_srid  */
-#line 424 "lwin_wkt_parse.y"
+#line 431 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2172 "lwin_wkt_parse.c"
+#line 2179 "lwin_wkt_parse.c"
     break;
 
   case 26: /* multisurface: MSURFACE_TOK LBRACKET_TOK surface_list RBRACKET_TOK  */
-#line 428 "lwin_wkt_parse.y"
+#line 435 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2178 "lwin_wkt_parse.c"
+#line 2185 "lwin_wkt_parse.c"
     break;
 
   case 27: /* multisurface: MSURFACE_TOK DIMENSIONALITY_TOK LBRACKET_TOK surface_list RBRACKET_TOK  */
-#line 430 "lwin_wkt_parse.y"
+#line 437 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2184 "lwin_wkt_parse.c"
+#line 2191 "lwin_wkt_parse.c"
     break;
 
   case 28: /* multisurface: MSURFACE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 432 "lwin_wkt_parse.y"
+#line 439 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2190 "lwin_wkt_parse.c"
+#line 2197 "lwin_wkt_parse.c"
     break;
 
   case 29: /* multisurface: MSURFACE_TOK EMPTY_TOK  */
-#line 434 "lwin_wkt_parse.y"
+#line 441 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTISURFACETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2196 "lwin_wkt_parse.c"
+#line 2203 "lwin_wkt_parse.c"
     break;
 
   case 30: /* surface_list: surface_list COMMA_TOK polygon  */
-#line 438 "lwin_wkt_parse.y"
+#line 445 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2202 "lwin_wkt_parse.c"
+#line 2209 "lwin_wkt_parse.c"
     break;
 
   case 31: /* surface_list: surface_list COMMA_TOK curvepolygon  */
-#line 440 "lwin_wkt_parse.y"
+#line 447 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2208 "lwin_wkt_parse.c"
+#line 2215 "lwin_wkt_parse.c"
     break;
 
   case 32: /* surface_list: surface_list COMMA_TOK polygon_untagged  */
-#line 442 "lwin_wkt_parse.y"
+#line 449 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2214 "lwin_wkt_parse.c"
+#line 2221 "lwin_wkt_parse.c"
     break;
 
   case 33: /* surface_list: polygon  */
-#line 444 "lwin_wkt_parse.y"
+#line 451 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2220 "lwin_wkt_parse.c"
+#line 2227 "lwin_wkt_parse.c"
     break;
 
   case 34: /* surface_list: curvepolygon  */
-#line 446 "lwin_wkt_parse.y"
+#line 453 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2226 "lwin_wkt_parse.c"
+#line 2233 "lwin_wkt_parse.c"
     break;
 
   case 35: /* surface_list: polygon_untagged  */
-#line 448 "lwin_wkt_parse.y"
+#line 455 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2232 "lwin_wkt_parse.c"
+#line 2239 "lwin_wkt_parse.c"
     break;
 
   case 36: /* tin: TIN_TOK LBRACKET_TOK triangle_list RBRACKET_TOK  */
-#line 452 "lwin_wkt_parse.y"
+#line 459 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2238 "lwin_wkt_parse.c"
+#line 2245 "lwin_wkt_parse.c"
     break;
 
   case 37: /* tin: TIN_TOK DIMENSIONALITY_TOK LBRACKET_TOK triangle_list RBRACKET_TOK  */
-#line 454 "lwin_wkt_parse.y"
+#line 461 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2244 "lwin_wkt_parse.c"
+#line 2251 "lwin_wkt_parse.c"
     break;
 
   case 38: /* tin: TIN_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 456 "lwin_wkt_parse.y"
+#line 463 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2250 "lwin_wkt_parse.c"
+#line 2257 "lwin_wkt_parse.c"
     break;
 
   case 39: /* tin: TIN_TOK EMPTY_TOK  */
-#line 458 "lwin_wkt_parse.y"
+#line 465 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(TINTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2256 "lwin_wkt_parse.c"
+#line 2263 "lwin_wkt_parse.c"
     break;
 
   case 40: /* polyhedralsurface: POLYHEDRALSURFACE_TOK LBRACKET_TOK patch_list RBRACKET_TOK  */
-#line 462 "lwin_wkt_parse.y"
+#line 469 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2262 "lwin_wkt_parse.c"
+#line 2269 "lwin_wkt_parse.c"
     break;
 
   case 41: /* polyhedralsurface: POLYHEDRALSURFACE_TOK DIMENSIONALITY_TOK LBRACKET_TOK patch_list RBRACKET_TOK  */
-#line 464 "lwin_wkt_parse.y"
+#line 471 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2268 "lwin_wkt_parse.c"
+#line 2275 "lwin_wkt_parse.c"
     break;
 
   case 42: /* polyhedralsurface: POLYHEDRALSURFACE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 466 "lwin_wkt_parse.y"
+#line 473 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2274 "lwin_wkt_parse.c"
+#line 2281 "lwin_wkt_parse.c"
     break;
 
   case 43: /* polyhedralsurface: POLYHEDRALSURFACE_TOK EMPTY_TOK  */
-#line 468 "lwin_wkt_parse.y"
+#line 475 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(POLYHEDRALSURFACETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2280 "lwin_wkt_parse.c"
+#line 2287 "lwin_wkt_parse.c"
     break;
 
   case 44: /* multipolygon: MPOLYGON_TOK LBRACKET_TOK polygon_list RBRACKET_TOK  */
-#line 472 "lwin_wkt_parse.y"
+#line 479 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2286 "lwin_wkt_parse.c"
+#line 2293 "lwin_wkt_parse.c"
     break;
 
   case 45: /* multipolygon: MPOLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK polygon_list RBRACKET_TOK  */
-#line 474 "lwin_wkt_parse.y"
+#line 481 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2292 "lwin_wkt_parse.c"
+#line 2299 "lwin_wkt_parse.c"
     break;
 
   case 46: /* multipolygon: MPOLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 476 "lwin_wkt_parse.y"
+#line 483 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2298 "lwin_wkt_parse.c"
+#line 2305 "lwin_wkt_parse.c"
     break;
 
   case 47: /* multipolygon: MPOLYGON_TOK EMPTY_TOK  */
-#line 478 "lwin_wkt_parse.y"
+#line 485 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOLYGONTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2304 "lwin_wkt_parse.c"
+#line 2311 "lwin_wkt_parse.c"
     break;
 
   case 48: /* polygon_list: polygon_list COMMA_TOK polygon_untagged  */
-#line 482 "lwin_wkt_parse.y"
+#line 489 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2310 "lwin_wkt_parse.c"
+#line 2317 "lwin_wkt_parse.c"
     break;
 
   case 49: /* polygon_list: polygon_untagged  */
-#line 484 "lwin_wkt_parse.y"
+#line 491 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2316 "lwin_wkt_parse.c"
+#line 2323 "lwin_wkt_parse.c"
     break;
 
   case 50: /* patch_list: patch_list COMMA_TOK patch  */
-#line 488 "lwin_wkt_parse.y"
+#line 495 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2322 "lwin_wkt_parse.c"
+#line 2329 "lwin_wkt_parse.c"
     break;
 
   case 51: /* patch_list: patch  */
-#line 490 "lwin_wkt_parse.y"
+#line 497 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2328 "lwin_wkt_parse.c"
+#line 2335 "lwin_wkt_parse.c"
     break;
 
   case 52: /* polygon: POLYGON_TOK LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 494 "lwin_wkt_parse.y"
+#line 501 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize((yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2334 "lwin_wkt_parse.c"
+#line 2341 "lwin_wkt_parse.c"
     break;
 
   case 53: /* polygon: POLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 496 "lwin_wkt_parse.y"
+#line 503 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize((yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2340 "lwin_wkt_parse.c"
+#line 2347 "lwin_wkt_parse.c"
     break;
 
   case 54: /* polygon: POLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 498 "lwin_wkt_parse.y"
+#line 505 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2346 "lwin_wkt_parse.c"
+#line 2353 "lwin_wkt_parse.c"
     break;
 
   case 55: /* polygon: POLYGON_TOK EMPTY_TOK  */
-#line 500 "lwin_wkt_parse.y"
+#line 507 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2352 "lwin_wkt_parse.c"
+#line 2359 "lwin_wkt_parse.c"
     break;
 
   case 56: /* polygon_untagged: LBRACKET_TOK ring_list RBRACKET_TOK  */
-#line 504 "lwin_wkt_parse.y"
+#line 511 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = (yyvsp[-1].geometryvalue); }
-#line 2358 "lwin_wkt_parse.c"
+#line 2365 "lwin_wkt_parse.c"
     break;
 
   case 57: /* polygon_untagged: EMPTY_TOK  */
-#line 506 "lwin_wkt_parse.y"
+#line 513 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2364 "lwin_wkt_parse.c"
+#line 2371 "lwin_wkt_parse.c"
     break;
 
   case 58: /* patch: LBRACKET_TOK patchring_list RBRACKET_TOK  */
-#line 509 "lwin_wkt_parse.y"
+#line 516 "lwin_wkt_parse.y"
                                                  { (yyval.geometryvalue) = (yyvsp[-1].geometryvalue); }
-#line 2370 "lwin_wkt_parse.c"
+#line 2377 "lwin_wkt_parse.c"
     break;
 
   case 59: /* curvepolygon: CURVEPOLYGON_TOK LBRACKET_TOK curvering_list RBRACKET_TOK  */
-#line 513 "lwin_wkt_parse.y"
+#line 520 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize((yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2376 "lwin_wkt_parse.c"
+#line 2383 "lwin_wkt_parse.c"
     break;
 
   case 60: /* curvepolygon: CURVEPOLYGON_TOK DIMENSIONALITY_TOK LBRACKET_TOK curvering_list RBRACKET_TOK  */
-#line 515 "lwin_wkt_parse.y"
+#line 522 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize((yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2382 "lwin_wkt_parse.c"
+#line 2389 "lwin_wkt_parse.c"
     break;
 
   case 61: /* curvepolygon: CURVEPOLYGON_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 517 "lwin_wkt_parse.y"
+#line 524 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2388 "lwin_wkt_parse.c"
+#line 2395 "lwin_wkt_parse.c"
     break;
 
   case 62: /* curvepolygon: CURVEPOLYGON_TOK EMPTY_TOK  */
-#line 519 "lwin_wkt_parse.y"
+#line 526 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2394 "lwin_wkt_parse.c"
+#line 2401 "lwin_wkt_parse.c"
     break;
 
   case 63: /* curvering_list: curvering_list COMMA_TOK curvering  */
-#line 523 "lwin_wkt_parse.y"
+#line 530 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2400 "lwin_wkt_parse.c"
+#line 2407 "lwin_wkt_parse.c"
     break;
 
   case 64: /* curvering_list: curvering  */
-#line 525 "lwin_wkt_parse.y"
+#line 532 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_curvepolygon_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2406 "lwin_wkt_parse.c"
+#line 2413 "lwin_wkt_parse.c"
     break;
 
   case 65: /* curvering: linestring_untagged  */
-#line 528 "lwin_wkt_parse.y"
+#line 535 "lwin_wkt_parse.y"
                             { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2412 "lwin_wkt_parse.c"
+#line 2419 "lwin_wkt_parse.c"
     break;
 
   case 66: /* curvering: linestring  */
-#line 529 "lwin_wkt_parse.y"
+#line 536 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2418 "lwin_wkt_parse.c"
+#line 2425 "lwin_wkt_parse.c"
     break;
 
   case 67: /* curvering: compoundcurve  */
-#line 530 "lwin_wkt_parse.y"
+#line 537 "lwin_wkt_parse.y"
                       { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2424 "lwin_wkt_parse.c"
+#line 2431 "lwin_wkt_parse.c"
     break;
 
   case 68: /* curvering: nurbscurve  */
-#line 531 "lwin_wkt_parse.y"
+#line 538 "lwin_wkt_parse.y"
                    { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2430 "lwin_wkt_parse.c"
+#line 2437 "lwin_wkt_parse.c"
     break;
 
   case 69: /* curvering: circularstring  */
-#line 532 "lwin_wkt_parse.y"
+#line 539 "lwin_wkt_parse.y"
                        { (yyval.geometryvalue) = (yyvsp[0].geometryvalue); }
-#line 2436 "lwin_wkt_parse.c"
+#line 2443 "lwin_wkt_parse.c"
     break;
 
   case 70: /* patchring_list: patchring_list COMMA_TOK patchring  */
-#line 536 "lwin_wkt_parse.y"
+#line 543 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].ptarrayvalue),'Z'); WKT_ERROR(); }
-#line 2442 "lwin_wkt_parse.c"
+#line 2449 "lwin_wkt_parse.c"
     break;
 
   case 71: /* patchring_list: patchring  */
-#line 538 "lwin_wkt_parse.y"
+#line 545 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_new((yyvsp[0].ptarrayvalue),'Z'); WKT_ERROR(); }
-#line 2448 "lwin_wkt_parse.c"
+#line 2455 "lwin_wkt_parse.c"
     break;
 
   case 72: /* ring_list: ring_list COMMA_TOK ring  */
-#line 542 "lwin_wkt_parse.y"
+#line 549 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_add_ring((yyvsp[-2].geometryvalue),(yyvsp[0].ptarrayvalue),'2'); WKT_ERROR(); }
-#line 2454 "lwin_wkt_parse.c"
+#line 2461 "lwin_wkt_parse.c"
     break;
 
   case 73: /* ring_list: ring  */
-#line 544 "lwin_wkt_parse.y"
+#line 551 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_polygon_new((yyvsp[0].ptarrayvalue),'2'); WKT_ERROR(); }
-#line 2460 "lwin_wkt_parse.c"
+#line 2467 "lwin_wkt_parse.c"
     break;
 
   case 74: /* patchring: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 547 "lwin_wkt_parse.y"
+#line 554 "lwin_wkt_parse.y"
                                           { (yyval.ptarrayvalue) = (yyvsp[-1].ptarrayvalue); }
-#line 2466 "lwin_wkt_parse.c"
+#line 2473 "lwin_wkt_parse.c"
     break;
 
   case 75: /* ring: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 550 "lwin_wkt_parse.y"
+#line 557 "lwin_wkt_parse.y"
                                           { (yyval.ptarrayvalue) = (yyvsp[-1].ptarrayvalue); }
-#line 2472 "lwin_wkt_parse.c"
+#line 2479 "lwin_wkt_parse.c"
     break;
 
   case 76: /* compoundcurve: COMPOUNDCURVE_TOK LBRACKET_TOK compound_list RBRACKET_TOK  */
-#line 554 "lwin_wkt_parse.y"
+#line 561 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_finalize((yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2478 "lwin_wkt_parse.c"
+#line 2485 "lwin_wkt_parse.c"
     break;
 
   case 77: /* compoundcurve: COMPOUNDCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK compound_list RBRACKET_TOK  */
-#line 556 "lwin_wkt_parse.y"
+#line 563 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_finalize((yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2484 "lwin_wkt_parse.c"
+#line 2491 "lwin_wkt_parse.c"
     break;
 
   case 78: /* compoundcurve: COMPOUNDCURVE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 558 "lwin_wkt_parse.y"
+#line 565 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_finalize(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2490 "lwin_wkt_parse.c"
+#line 2497 "lwin_wkt_parse.c"
     break;
 
   case 79: /* compoundcurve: COMPOUNDCURVE_TOK EMPTY_TOK  */
-#line 560 "lwin_wkt_parse.y"
+#line 567 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_finalize(NULL, NULL); WKT_ERROR(); }
-#line 2496 "lwin_wkt_parse.c"
+#line 2503 "lwin_wkt_parse.c"
     break;
 
   case 80: /* compound_list: compound_list COMMA_TOK circularstring  */
-#line 564 "lwin_wkt_parse.y"
+#line 571 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2502 "lwin_wkt_parse.c"
+#line 2509 "lwin_wkt_parse.c"
     break;
 
   case 81: /* compound_list: compound_list COMMA_TOK nurbscurve  */
-#line 566 "lwin_wkt_parse.y"
+#line 573 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2508 "lwin_wkt_parse.c"
+#line 2515 "lwin_wkt_parse.c"
     break;
 
   case 82: /* compound_list: compound_list COMMA_TOK linestring  */
-#line 568 "lwin_wkt_parse.y"
+#line 575 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2514 "lwin_wkt_parse.c"
+#line 2521 "lwin_wkt_parse.c"
     break;
 
   case 83: /* compound_list: compound_list COMMA_TOK linestring_untagged  */
-#line 570 "lwin_wkt_parse.y"
+#line 577 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2520 "lwin_wkt_parse.c"
+#line 2527 "lwin_wkt_parse.c"
     break;
 
   case 84: /* compound_list: circularstring  */
-#line 572 "lwin_wkt_parse.y"
+#line 579 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2526 "lwin_wkt_parse.c"
+#line 2533 "lwin_wkt_parse.c"
     break;
 
   case 85: /* compound_list: nurbscurve  */
-#line 574 "lwin_wkt_parse.y"
+#line 581 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2532 "lwin_wkt_parse.c"
+#line 2539 "lwin_wkt_parse.c"
     break;
 
   case 86: /* compound_list: linestring  */
-#line 576 "lwin_wkt_parse.y"
+#line 583 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2538 "lwin_wkt_parse.c"
+#line 2545 "lwin_wkt_parse.c"
     break;
 
   case 87: /* compound_list: linestring_untagged  */
-#line 578 "lwin_wkt_parse.y"
+#line 585 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_compound_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2544 "lwin_wkt_parse.c"
+#line 2551 "lwin_wkt_parse.c"
     break;
 
   case 88: /* multicurve: MCURVE_TOK LBRACKET_TOK curve_list RBRACKET_TOK  */
-#line 582 "lwin_wkt_parse.y"
+#line 589 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2550 "lwin_wkt_parse.c"
+#line 2557 "lwin_wkt_parse.c"
     break;
 
   case 89: /* multicurve: MCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK curve_list RBRACKET_TOK  */
-#line 584 "lwin_wkt_parse.y"
+#line 591 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2556 "lwin_wkt_parse.c"
+#line 2563 "lwin_wkt_parse.c"
     break;
 
   case 90: /* multicurve: MCURVE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 586 "lwin_wkt_parse.y"
+#line 593 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2562 "lwin_wkt_parse.c"
+#line 2569 "lwin_wkt_parse.c"
     break;
 
   case 91: /* multicurve: MCURVE_TOK EMPTY_TOK  */
-#line 588 "lwin_wkt_parse.y"
+#line 595 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTICURVETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2568 "lwin_wkt_parse.c"
+#line 2575 "lwin_wkt_parse.c"
     break;
 
   case 92: /* curve_list: curve_list COMMA_TOK circularstring  */
-#line 592 "lwin_wkt_parse.y"
+#line 599 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2574 "lwin_wkt_parse.c"
+#line 2581 "lwin_wkt_parse.c"
     break;
 
   case 93: /* curve_list: curve_list COMMA_TOK compoundcurve  */
-#line 594 "lwin_wkt_parse.y"
+#line 601 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2580 "lwin_wkt_parse.c"
+#line 2587 "lwin_wkt_parse.c"
     break;
 
   case 94: /* curve_list: curve_list COMMA_TOK nurbscurve  */
-#line 596 "lwin_wkt_parse.y"
+#line 603 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2586 "lwin_wkt_parse.c"
+#line 2593 "lwin_wkt_parse.c"
     break;
 
   case 95: /* curve_list: curve_list COMMA_TOK linestring  */
-#line 598 "lwin_wkt_parse.y"
+#line 605 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2592 "lwin_wkt_parse.c"
+#line 2599 "lwin_wkt_parse.c"
     break;
 
   case 96: /* curve_list: curve_list COMMA_TOK linestring_untagged  */
-#line 600 "lwin_wkt_parse.y"
+#line 607 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2598 "lwin_wkt_parse.c"
+#line 2605 "lwin_wkt_parse.c"
     break;
 
   case 97: /* curve_list: circularstring  */
-#line 602 "lwin_wkt_parse.y"
+#line 609 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2604 "lwin_wkt_parse.c"
+#line 2611 "lwin_wkt_parse.c"
     break;
 
   case 98: /* curve_list: compoundcurve  */
-#line 604 "lwin_wkt_parse.y"
+#line 611 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2610 "lwin_wkt_parse.c"
+#line 2617 "lwin_wkt_parse.c"
     break;
 
   case 99: /* curve_list: nurbscurve  */
-#line 606 "lwin_wkt_parse.y"
+#line 613 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2616 "lwin_wkt_parse.c"
+#line 2623 "lwin_wkt_parse.c"
     break;
 
   case 100: /* curve_list: linestring  */
-#line 608 "lwin_wkt_parse.y"
+#line 615 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2622 "lwin_wkt_parse.c"
+#line 2629 "lwin_wkt_parse.c"
     break;
 
   case 101: /* curve_list: linestring_untagged  */
-#line 610 "lwin_wkt_parse.y"
+#line 617 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2628 "lwin_wkt_parse.c"
+#line 2635 "lwin_wkt_parse.c"
     break;
 
   case 102: /* multilinestring: MLINESTRING_TOK LBRACKET_TOK linestring_list RBRACKET_TOK  */
-#line 614 "lwin_wkt_parse.y"
+#line 621 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2634 "lwin_wkt_parse.c"
+#line 2641 "lwin_wkt_parse.c"
     break;
 
   case 103: /* multilinestring: MLINESTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK linestring_list RBRACKET_TOK  */
-#line 616 "lwin_wkt_parse.y"
+#line 623 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2640 "lwin_wkt_parse.c"
+#line 2647 "lwin_wkt_parse.c"
     break;
 
   case 104: /* multilinestring: MLINESTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 618 "lwin_wkt_parse.y"
+#line 625 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2646 "lwin_wkt_parse.c"
+#line 2653 "lwin_wkt_parse.c"
     break;
 
   case 105: /* multilinestring: MLINESTRING_TOK EMPTY_TOK  */
-#line 620 "lwin_wkt_parse.y"
+#line 627 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTILINETYPE, NULL, NULL); WKT_ERROR(); }
-#line 2652 "lwin_wkt_parse.c"
+#line 2659 "lwin_wkt_parse.c"
     break;
 
   case 106: /* linestring_list: linestring_list COMMA_TOK linestring_untagged  */
-#line 624 "lwin_wkt_parse.y"
+#line 631 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2658 "lwin_wkt_parse.c"
+#line 2665 "lwin_wkt_parse.c"
     break;
 
   case 107: /* linestring_list: linestring_untagged  */
-#line 626 "lwin_wkt_parse.y"
+#line 633 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2664 "lwin_wkt_parse.c"
+#line 2671 "lwin_wkt_parse.c"
     break;
 
   case 108: /* circularstring: CIRCULARSTRING_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 630 "lwin_wkt_parse.y"
+#line 637 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2670 "lwin_wkt_parse.c"
+#line 2677 "lwin_wkt_parse.c"
     break;
 
   case 109: /* circularstring: CIRCULARSTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 632 "lwin_wkt_parse.y"
+#line 639 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2676 "lwin_wkt_parse.c"
+#line 2683 "lwin_wkt_parse.c"
     break;
 
   case 110: /* circularstring: CIRCULARSTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 634 "lwin_wkt_parse.y"
+#line 641 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2682 "lwin_wkt_parse.c"
+#line 2689 "lwin_wkt_parse.c"
     break;
 
   case 111: /* circularstring: CIRCULARSTRING_TOK EMPTY_TOK  */
-#line 636 "lwin_wkt_parse.y"
+#line 643 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_circularstring_new(NULL, NULL); WKT_ERROR(); }
-#line 2688 "lwin_wkt_parse.c"
+#line 2695 "lwin_wkt_parse.c"
     break;
 
   case 112: /* linestring: LINESTRING_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 640 "lwin_wkt_parse.y"
+#line 647 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2694 "lwin_wkt_parse.c"
+#line 2701 "lwin_wkt_parse.c"
     break;
 
   case 113: /* linestring: LINESTRING_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 642 "lwin_wkt_parse.y"
+#line 649 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2700 "lwin_wkt_parse.c"
+#line 2707 "lwin_wkt_parse.c"
     break;
 
   case 114: /* linestring: LINESTRING_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 644 "lwin_wkt_parse.y"
+#line 651 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2706 "lwin_wkt_parse.c"
+#line 2713 "lwin_wkt_parse.c"
     break;
 
   case 115: /* linestring: LINESTRING_TOK EMPTY_TOK  */
-#line 646 "lwin_wkt_parse.y"
+#line 653 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, NULL); WKT_ERROR(); }
-#line 2712 "lwin_wkt_parse.c"
+#line 2719 "lwin_wkt_parse.c"
     break;
 
   case 116: /* linestring_untagged: LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 650 "lwin_wkt_parse.y"
+#line 657 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2718 "lwin_wkt_parse.c"
+#line 2725 "lwin_wkt_parse.c"
     break;
 
   case 117: /* linestring_untagged: EMPTY_TOK  */
-#line 652 "lwin_wkt_parse.y"
+#line 659 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_linestring_new(NULL, NULL); WKT_ERROR(); }
-#line 2724 "lwin_wkt_parse.c"
+#line 2731 "lwin_wkt_parse.c"
     break;
 
   case 118: /* triangle_list: triangle_list COMMA_TOK triangle_untagged  */
-#line 656 "lwin_wkt_parse.y"
+#line 663 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2730 "lwin_wkt_parse.c"
+#line 2737 "lwin_wkt_parse.c"
     break;
 
   case 119: /* triangle_list: triangle_untagged  */
-#line 658 "lwin_wkt_parse.y"
+#line 665 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2736 "lwin_wkt_parse.c"
+#line 2743 "lwin_wkt_parse.c"
     break;
 
   case 120: /* triangle: TRIANGLE_TOK LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 662 "lwin_wkt_parse.y"
+#line 669 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2742 "lwin_wkt_parse.c"
+#line 2749 "lwin_wkt_parse.c"
     break;
 
   case 121: /* triangle: TRIANGLE_TOK DIMENSIONALITY_TOK LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 664 "lwin_wkt_parse.y"
+#line 671 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), (yyvsp[-5].stringvalue)); WKT_ERROR(); }
-#line 2748 "lwin_wkt_parse.c"
+#line 2755 "lwin_wkt_parse.c"
     break;
 
   case 122: /* triangle: TRIANGLE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 666 "lwin_wkt_parse.y"
+#line 673 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2754 "lwin_wkt_parse.c"
+#line 2761 "lwin_wkt_parse.c"
     break;
 
   case 123: /* triangle: TRIANGLE_TOK EMPTY_TOK  */
-#line 668 "lwin_wkt_parse.y"
+#line 675 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new(NULL, NULL); WKT_ERROR(); }
-#line 2760 "lwin_wkt_parse.c"
+#line 2767 "lwin_wkt_parse.c"
     break;
 
   case 124: /* triangle_untagged: LBRACKET_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 672 "lwin_wkt_parse.y"
+#line 679 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_triangle_new((yyvsp[-2].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2766 "lwin_wkt_parse.c"
+#line 2773 "lwin_wkt_parse.c"
     break;
 
   case 125: /* multipoint: MPOINT_TOK LBRACKET_TOK point_list RBRACKET_TOK  */
-#line 676 "lwin_wkt_parse.y"
+#line 683 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, (yyvsp[-1].geometryvalue), NULL); WKT_ERROR(); }
-#line 2772 "lwin_wkt_parse.c"
+#line 2779 "lwin_wkt_parse.c"
     break;
 
   case 126: /* multipoint: MPOINT_TOK DIMENSIONALITY_TOK LBRACKET_TOK point_list RBRACKET_TOK  */
-#line 678 "lwin_wkt_parse.y"
+#line 685 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, (yyvsp[-1].geometryvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2778 "lwin_wkt_parse.c"
+#line 2785 "lwin_wkt_parse.c"
     break;
 
   case 127: /* multipoint: MPOINT_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 680 "lwin_wkt_parse.y"
+#line 687 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2784 "lwin_wkt_parse.c"
+#line 2791 "lwin_wkt_parse.c"
     break;
 
   case 128: /* multipoint: MPOINT_TOK EMPTY_TOK  */
-#line 682 "lwin_wkt_parse.y"
+#line 689 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_finalize(MULTIPOINTTYPE, NULL, NULL); WKT_ERROR(); }
-#line 2790 "lwin_wkt_parse.c"
+#line 2797 "lwin_wkt_parse.c"
     break;
 
   case 129: /* point_list: point_list COMMA_TOK point_untagged  */
-#line 686 "lwin_wkt_parse.y"
+#line 693 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_add_geom((yyvsp[-2].geometryvalue),(yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2796 "lwin_wkt_parse.c"
+#line 2803 "lwin_wkt_parse.c"
     break;
 
   case 130: /* point_list: point_untagged  */
-#line 688 "lwin_wkt_parse.y"
+#line 695 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_collection_new((yyvsp[0].geometryvalue)); WKT_ERROR(); }
-#line 2802 "lwin_wkt_parse.c"
+#line 2809 "lwin_wkt_parse.c"
     break;
 
   case 131: /* point_untagged: coordinate  */
-#line 692 "lwin_wkt_parse.y"
+#line 699 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(wkt_parser_ptarray_new((yyvsp[0].coordinatevalue)),NULL); WKT_ERROR(); }
-#line 2808 "lwin_wkt_parse.c"
+#line 2815 "lwin_wkt_parse.c"
     break;
 
   case 132: /* point_untagged: LBRACKET_TOK coordinate RBRACKET_TOK  */
-#line 694 "lwin_wkt_parse.y"
+#line 701 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(wkt_parser_ptarray_new((yyvsp[-1].coordinatevalue)),NULL); WKT_ERROR(); }
-#line 2814 "lwin_wkt_parse.c"
+#line 2821 "lwin_wkt_parse.c"
     break;
 
   case 133: /* point_untagged: EMPTY_TOK  */
-#line 696 "lwin_wkt_parse.y"
+#line 703 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL, NULL); WKT_ERROR(); }
-#line 2820 "lwin_wkt_parse.c"
+#line 2827 "lwin_wkt_parse.c"
     break;
 
   case 134: /* point: POINT_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 700 "lwin_wkt_parse.y"
+#line 707 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new((yyvsp[-1].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2826 "lwin_wkt_parse.c"
+#line 2833 "lwin_wkt_parse.c"
     break;
 
   case 135: /* point: POINT_TOK DIMENSIONALITY_TOK LBRACKET_TOK ptarray RBRACKET_TOK  */
-#line 702 "lwin_wkt_parse.y"
+#line 709 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new((yyvsp[-1].ptarrayvalue), (yyvsp[-3].stringvalue)); WKT_ERROR(); }
-#line 2832 "lwin_wkt_parse.c"
+#line 2839 "lwin_wkt_parse.c"
     break;
 
   case 136: /* point: POINT_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 704 "lwin_wkt_parse.y"
+#line 711 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL, (yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2838 "lwin_wkt_parse.c"
+#line 2845 "lwin_wkt_parse.c"
     break;
 
   case 137: /* point: POINT_TOK EMPTY_TOK  */
-#line 706 "lwin_wkt_parse.y"
+#line 713 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_point_new(NULL,NULL); WKT_ERROR(); }
-#line 2844 "lwin_wkt_parse.c"
+#line 2851 "lwin_wkt_parse.c"
     break;
 
   case 138: /* ptarray: ptarray COMMA_TOK coordinate  */
-#line 710 "lwin_wkt_parse.y"
+#line 717 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_ptarray_add_coord((yyvsp[-2].ptarrayvalue), (yyvsp[0].coordinatevalue)); WKT_ERROR(); }
-#line 2850 "lwin_wkt_parse.c"
+#line 2857 "lwin_wkt_parse.c"
     break;
 
   case 139: /* ptarray: coordinate  */
-#line 712 "lwin_wkt_parse.y"
+#line 719 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_ptarray_new((yyvsp[0].coordinatevalue)); WKT_ERROR(); }
-#line 2856 "lwin_wkt_parse.c"
+#line 2863 "lwin_wkt_parse.c"
     break;
 
   case 140: /* coordinate: DOUBLE_TOK DOUBLE_TOK  */
-#line 716 "lwin_wkt_parse.y"
+#line 723 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_2((yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2862 "lwin_wkt_parse.c"
+#line 2869 "lwin_wkt_parse.c"
     break;
 
   case 141: /* coordinate: DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK  */
-#line 718 "lwin_wkt_parse.y"
+#line 725 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_3((yyvsp[-2].doublevalue), (yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2868 "lwin_wkt_parse.c"
+#line 2875 "lwin_wkt_parse.c"
     break;
 
   case 142: /* coordinate: DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK DOUBLE_TOK  */
-#line 720 "lwin_wkt_parse.y"
+#line 727 "lwin_wkt_parse.y"
                 { (yyval.coordinatevalue) = wkt_parser_coord_4((yyvsp[-3].doublevalue), (yyvsp[-2].doublevalue), (yyvsp[-1].doublevalue), (yyvsp[0].doublevalue)); WKT_ERROR(); }
-#line 2874 "lwin_wkt_parse.c"
+#line 2881 "lwin_wkt_parse.c"
     break;
 
   case 143: /* opt_dimensionality: DIMENSIONALITY_TOK  */
-#line 724 "lwin_wkt_parse.y"
+#line 731 "lwin_wkt_parse.y"
                 { (yyval.stringvalue) = (yyvsp[0].stringvalue); }
-#line 2880 "lwin_wkt_parse.c"
+#line 2887 "lwin_wkt_parse.c"
     break;
 
   case 144: /* opt_dimensionality: %empty  */
-#line 725 "lwin_wkt_parse.y"
+#line 732 "lwin_wkt_parse.y"
                 { (yyval.stringvalue) = NULL; }
-#line 2886 "lwin_wkt_parse.c"
+#line 2893 "lwin_wkt_parse.c"
     break;
 
   case 145: /* nurbscurve: NURBSCURVE_TOK LBRACKET_TOK DEGREE_TOK DOUBLE_TOK COMMA_TOK CONTROLPOINTS_TOK opt_dimensionality LBRACKET_TOK iso_controlpoint_list RBRACKET_TOK COMMA_TOK KNOTS_TOK LBRACKET_TOK iso_knot_list RBRACKET_TOK RBRACKET_TOK  */
-#line 730 "lwin_wkt_parse.y"
+#line 737 "lwin_wkt_parse.y"
                         {
 				(yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-12].doublevalue), (yyvsp[-7].nurbscontrolpointsvalue)->points, (yyvsp[-7].nurbscontrolpointsvalue)->weights, (yyvsp[-2].ptarrayvalue),
 					wkt_parser_nurbscurve_iso_dimensionality(NULL, (yyvsp[-9].stringvalue)));
@@ -2895,11 +2902,11 @@ yyreduce:
 				wkt_parser_nurbs_controlpoints_free((yyvsp[-7].nurbscontrolpointsvalue));
 			WKT_ERROR();
 		}
-#line 2899 "lwin_wkt_parse.c"
+#line 2906 "lwin_wkt_parse.c"
     break;
 
   case 146: /* nurbscurve: NURBSCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK DEGREE_TOK DOUBLE_TOK COMMA_TOK CONTROLPOINTS_TOK opt_dimensionality LBRACKET_TOK iso_controlpoint_list RBRACKET_TOK COMMA_TOK KNOTS_TOK LBRACKET_TOK iso_knot_list RBRACKET_TOK RBRACKET_TOK  */
-#line 739 "lwin_wkt_parse.y"
+#line 746 "lwin_wkt_parse.y"
                         {
 				(yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-12].doublevalue), (yyvsp[-7].nurbscontrolpointsvalue)->points, (yyvsp[-7].nurbscontrolpointsvalue)->weights, (yyvsp[-2].ptarrayvalue),
 					wkt_parser_nurbscurve_iso_dimensionality((yyvsp[-15].stringvalue), (yyvsp[-9].stringvalue)));
@@ -2908,125 +2915,125 @@ yyreduce:
 				wkt_parser_nurbs_controlpoints_free((yyvsp[-7].nurbscontrolpointsvalue));
 			WKT_ERROR();
 		}
-#line 2912 "lwin_wkt_parse.c"
+#line 2919 "lwin_wkt_parse.c"
     break;
 
   case 147: /* nurbscurve: NURBSCURVE_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK COMMA_TOK LBRACKET_TOK weight_list RBRACKET_TOK COMMA_TOK LBRACKET_TOK knot_list RBRACKET_TOK RBRACKET_TOK  */
-#line 749 "lwin_wkt_parse.y"
+#line 756 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-13].doublevalue), (yyvsp[-10].ptarrayvalue), (yyvsp[-6].ptarrayvalue), (yyvsp[-2].ptarrayvalue), NULL); WKT_ERROR(); }
-#line 2918 "lwin_wkt_parse.c"
+#line 2925 "lwin_wkt_parse.c"
     break;
 
   case 148: /* nurbscurve: NURBSCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK COMMA_TOK LBRACKET_TOK weight_list RBRACKET_TOK COMMA_TOK LBRACKET_TOK knot_list RBRACKET_TOK RBRACKET_TOK  */
-#line 751 "lwin_wkt_parse.y"
+#line 758 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-13].doublevalue), (yyvsp[-10].ptarrayvalue), (yyvsp[-6].ptarrayvalue), (yyvsp[-2].ptarrayvalue), (yyvsp[-15].stringvalue)); WKT_ERROR(); }
-#line 2924 "lwin_wkt_parse.c"
+#line 2931 "lwin_wkt_parse.c"
     break;
 
   case 149: /* nurbscurve: NURBSCURVE_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK COMMA_TOK LBRACKET_TOK weight_list RBRACKET_TOK RBRACKET_TOK  */
-#line 754 "lwin_wkt_parse.y"
+#line 761 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-9].doublevalue), (yyvsp[-6].ptarrayvalue), (yyvsp[-2].ptarrayvalue), NULL, NULL); WKT_ERROR(); }
-#line 2930 "lwin_wkt_parse.c"
+#line 2937 "lwin_wkt_parse.c"
     break;
 
   case 150: /* nurbscurve: NURBSCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK COMMA_TOK LBRACKET_TOK weight_list RBRACKET_TOK RBRACKET_TOK  */
-#line 756 "lwin_wkt_parse.y"
+#line 763 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-9].doublevalue), (yyvsp[-6].ptarrayvalue), (yyvsp[-2].ptarrayvalue), NULL, (yyvsp[-11].stringvalue)); WKT_ERROR(); }
-#line 2936 "lwin_wkt_parse.c"
+#line 2943 "lwin_wkt_parse.c"
     break;
 
   case 151: /* nurbscurve: NURBSCURVE_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 759 "lwin_wkt_parse.y"
+#line 766 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-5].doublevalue), (yyvsp[-2].ptarrayvalue), NULL, NULL, NULL); WKT_ERROR(); }
-#line 2942 "lwin_wkt_parse.c"
+#line 2949 "lwin_wkt_parse.c"
     break;
 
   case 152: /* nurbscurve: NURBSCURVE_TOK DIMENSIONALITY_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK LBRACKET_TOK ptarray RBRACKET_TOK RBRACKET_TOK  */
-#line 761 "lwin_wkt_parse.y"
+#line 768 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_new((yyvsp[-5].doublevalue), (yyvsp[-2].ptarrayvalue), NULL, NULL, (yyvsp[-7].stringvalue)); WKT_ERROR(); }
-#line 2948 "lwin_wkt_parse.c"
+#line 2955 "lwin_wkt_parse.c"
     break;
 
   case 153: /* nurbscurve: NURBSCURVE_TOK DIMENSIONALITY_TOK EMPTY_TOK  */
-#line 765 "lwin_wkt_parse.y"
+#line 772 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_empty((yyvsp[-1].stringvalue)); WKT_ERROR(); }
-#line 2954 "lwin_wkt_parse.c"
+#line 2961 "lwin_wkt_parse.c"
     break;
 
   case 154: /* nurbscurve: NURBSCURVE_TOK EMPTY_TOK  */
-#line 767 "lwin_wkt_parse.y"
+#line 774 "lwin_wkt_parse.y"
                 { (yyval.geometryvalue) = wkt_parser_nurbscurve_empty(NULL); WKT_ERROR(); }
-#line 2960 "lwin_wkt_parse.c"
+#line 2967 "lwin_wkt_parse.c"
     break;
 
   case 155: /* iso_controlpoint: NURBSPOINT_TOK LBRACKET_TOK WEIGHTEDPOINT_TOK opt_dimensionality LBRACKET_TOK coordinate RBRACKET_TOK COMMA_TOK WEIGHT_TOK DOUBLE_TOK RBRACKET_TOK  */
-#line 772 "lwin_wkt_parse.y"
+#line 779 "lwin_wkt_parse.y"
                 { (yyval.nurbscontrolpointsvalue) = wkt_parser_nurbs_controlpoints_new((yyvsp[-5].coordinatevalue), (yyvsp[-1].doublevalue), (yyvsp[-7].stringvalue)); WKT_ERROR(); }
-#line 2966 "lwin_wkt_parse.c"
+#line 2973 "lwin_wkt_parse.c"
     break;
 
   case 156: /* iso_controlpoint_list: iso_controlpoint_list COMMA_TOK iso_controlpoint  */
-#line 777 "lwin_wkt_parse.y"
+#line 784 "lwin_wkt_parse.y"
                 { (yyval.nurbscontrolpointsvalue) = wkt_parser_nurbs_controlpoints_add((yyvsp[-2].nurbscontrolpointsvalue), (yyvsp[0].nurbscontrolpointsvalue)); WKT_ERROR(); }
-#line 2972 "lwin_wkt_parse.c"
+#line 2979 "lwin_wkt_parse.c"
     break;
 
   case 157: /* iso_controlpoint_list: iso_controlpoint  */
-#line 779 "lwin_wkt_parse.y"
+#line 786 "lwin_wkt_parse.y"
                 { (yyval.nurbscontrolpointsvalue) = (yyvsp[0].nurbscontrolpointsvalue); }
-#line 2978 "lwin_wkt_parse.c"
+#line 2985 "lwin_wkt_parse.c"
     break;
 
   case 158: /* iso_knot_list: iso_knot_list COMMA_TOK KNOT_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK DOUBLE_TOK RBRACKET_TOK  */
-#line 784 "lwin_wkt_parse.y"
+#line 791 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_knot_list_add_repeated((yyvsp[-7].ptarrayvalue), (yyvsp[-3].doublevalue), (yyvsp[-1].doublevalue)); WKT_ERROR(); }
-#line 2984 "lwin_wkt_parse.c"
+#line 2991 "lwin_wkt_parse.c"
     break;
 
   case 159: /* iso_knot_list: KNOT_TOK LBRACKET_TOK DOUBLE_TOK COMMA_TOK DOUBLE_TOK RBRACKET_TOK  */
-#line 786 "lwin_wkt_parse.y"
+#line 793 "lwin_wkt_parse.y"
                 { (yyval.ptarrayvalue) = wkt_parser_knot_list_add_repeated(NULL, (yyvsp[-3].doublevalue), (yyvsp[-1].doublevalue)); WKT_ERROR(); }
-#line 2990 "lwin_wkt_parse.c"
+#line 2997 "lwin_wkt_parse.c"
     break;
 
   case 160: /* weight_list: weight_list COMMA_TOK DOUBLE_TOK  */
-#line 791 "lwin_wkt_parse.y"
+#line 798 "lwin_wkt_parse.y"
                 {
 			(yyval.ptarrayvalue) = wkt_parser_ptarray_add_coord((yyvsp[-2].ptarrayvalue), wkt_parser_coord_2((yyvsp[0].doublevalue), 0));
 			WKT_ERROR();
 		}
-#line 2999 "lwin_wkt_parse.c"
+#line 3006 "lwin_wkt_parse.c"
     break;
 
   case 161: /* weight_list: DOUBLE_TOK  */
-#line 796 "lwin_wkt_parse.y"
+#line 803 "lwin_wkt_parse.y"
                 {
 			(yyval.ptarrayvalue) = wkt_parser_ptarray_new(wkt_parser_coord_2((yyvsp[0].doublevalue), 0));
 			WKT_ERROR();
 		}
-#line 3008 "lwin_wkt_parse.c"
+#line 3015 "lwin_wkt_parse.c"
     break;
 
   case 162: /* knot_list: knot_list COMMA_TOK DOUBLE_TOK  */
-#line 804 "lwin_wkt_parse.y"
+#line 811 "lwin_wkt_parse.y"
                 {
 			(yyval.ptarrayvalue) = wkt_parser_ptarray_add_coord((yyvsp[-2].ptarrayvalue), wkt_parser_coord_2((yyvsp[0].doublevalue), 0));
 			WKT_ERROR();
 		}
-#line 3017 "lwin_wkt_parse.c"
+#line 3024 "lwin_wkt_parse.c"
     break;
 
   case 163: /* knot_list: DOUBLE_TOK  */
-#line 809 "lwin_wkt_parse.y"
+#line 816 "lwin_wkt_parse.y"
                 {
 			(yyval.ptarrayvalue) = wkt_parser_ptarray_new(wkt_parser_coord_2((yyvsp[0].doublevalue), 0));
 			WKT_ERROR();
 		}
-#line 3026 "lwin_wkt_parse.c"
+#line 3033 "lwin_wkt_parse.c"
     break;
 
 
-#line 3030 "lwin_wkt_parse.c"
+#line 3037 "lwin_wkt_parse.c"
 
       default: break;
     }
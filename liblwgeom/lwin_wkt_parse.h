@@ -45,7 +45,7 @@
 extern int wkt_yydebug;
 #endif
 /* "%code requires" blocks.  */
-#line 260 "lwin_wkt_parse.y"
+#line 267 "lwin_wkt_parse.y"
 
 typedef struct WKT_NURBS_CONTROLPOINTS WKT_NURBS_CONTROLPOINTS;
 
@@ -99,7 +99,7 @@ typedef struct WKT_NURBS_CONTROLPOINTS WKT_NURBS_CONTROLPOINTS;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 266 "lwin_wkt_parse.y"
+#line 273 "lwin_wkt_parse.y"
 
 	int integervalue;
 	double doublevalue;
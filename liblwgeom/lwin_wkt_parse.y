@@ -50,6 +50,13 @@ int lwgeom_parse_wkt(LWGEOM_PARSER_RESULT *parser_result, const char *wktstr, in
 {
 	int parse_rv = 0;
 
+	/*
+	* Valid simple features are read directly. Everything else, and
+	* every error, goes through the grammar below.
+	*/
+	if ( wktstr && wkt_parse_fast(parser_result, wktstr, parser_check_flags) == LW_SUCCESS )
+		return LW_SUCCESS;
+
 	/* Clean up our global parser result. */
 	lwgeom_parser_result_init(&global_parser_result);
 	/* Work-around possible bug in GNU Bison 3.0.2 resulting in wkt_yylloc
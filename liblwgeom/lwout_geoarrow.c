@@ -0,0 +1,737 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "liblwgeom_internal.h"
+#include "lwgeom_log.h"
+#include "bytebuffer.h"
+#include "lwgeoarrow.h"
+
+/*
+ * Rows are appended to one growing buffer per Arrow buffer: the
+ * validity bitmap, one offsets array per list level and one array per
+ * ordinate. The schema and the record batch header, both flatbuffers,
+ * are only written out once all rows are in.
+ */
+struct LWGEOARROW_WRITER
+{
+	LWGEOARROW_LAYOUT layout;
+	char *srs;
+	uint8_t depth;      /* list levels above the coordinates */
+	uint8_t ndims;      /* ordinates per coordinate */
+	uint32_t nrows;
+	uint32_t nnulls;
+	uint32_t nitems[3]; /* last offset written at each list level */
+	bytebuffer_t validity;
+	bytebuffer_t offsets[3];
+	bytebuffer_t coords[4]; /* x, y, z, m, or the WKB data */
+};
+
+/* Names of the list levels and the coordinates below the column */
+static const char *geoarrow_child_names[][3] = {
+	{NULL, NULL, NULL},
+	{NULL, NULL, NULL},                      /* POINTTYPE */
+	{"vertices", NULL, NULL},                /* LINETYPE */
+	{"rings", "vertices", NULL},             /* POLYGONTYPE */
+	{"points", NULL, NULL},                  /* MULTIPOINTTYPE */
+	{"linestrings", "vertices", NULL},       /* MULTILINETYPE */
+	{"polygons", "rings", "vertices"}        /* MULTIPOLYGONTYPE */
+};
+
+static const char *geoarrow_extension_names[] = {
+	"geoarrow.wkb",
+	"geoarrow.point",
+	"geoarrow.linestring",
+	"geoarrow.polygon",
+	"geoarrow.multipoint",
+	"geoarrow.multilinestring",
+	"geoarrow.multipolygon"
+};
+
+static const uint8_t geoarrow_depths[] = {1, 0, 1, 2, 1, 2, 3};
+
+void
+lwgeoarrow_layout_add(LWGEOARROW_LAYOUT *layout, uint8_t type, int has_z, int has_m)
+{
+	if (layout->wkb)
+		return;
+
+	switch (type)
+	{
+	case POINTTYPE:
+	case LINETYPE:
+	case POLYGONTYPE:
+	case MULTIPOINTTYPE:
+	case MULTILINETYPE:
+	case MULTIPOLYGONTYPE:
+		break;
+	default:
+		layout->wkb = LW_TRUE;
+		return;
+	}
+
+	if (!layout->type)
+	{
+		layout->type = type;
+		layout->has_z = has_z ? 1 : 0;
+		layout->has_m = has_m ? 1 : 0;
+		return;
+	}
+
+	/* Coordinates of a native column all have the same ordinates */
+	if (layout->has_z != (has_z ? 1 : 0) || layout->has_m != (has_m ? 1 : 0))
+	{
+		layout->wkb = LW_TRUE;
+		return;
+	}
+
+	if (layout->type == type || lwtype_get_collectiontype(type) == layout->type)
+		return;
+	if (lwtype_get_collectiontype(layout->type) == type)
+		layout->type = type;
+	else
+		layout->wkb = LW_TRUE;
+}
+
+void
+lwgeoarrow_layout_merge(LWGEOARROW_LAYOUT *layout, const LWGEOARROW_LAYOUT *other)
+{
+	if (other->wkb)
+		layout->wkb = LW_TRUE;
+	else if (other->type)
+		lwgeoarrow_layout_add(layout, other->type, other->has_z, other->has_m);
+}
+
+static inline void
+geoarrow_put(bytebuffer_t *b, const void *data, size_t size)
+{
+	memcpy(bytebuffer_reserve(b, size), data, size);
+	b->writecursor += size;
+}
+
+static inline size_t
+geoarrow_length(const bytebuffer_t *b)
+{
+	return b->writecursor - b->buf_start;
+}
+
+static inline void
+geoarrow_add_offset(LWGEOARROW_WRITER *w, int level, uint32_t n)
+{
+	int32_t offset;
+	if (n > (uint32_t)INT32_MAX - w->nitems[level])
+		lwerror("%s: too many coordinates for one GeoArrow column", __func__);
+	w->nitems[level] += n;
+	offset = w->nitems[level];
+	geoarrow_put(&w->offsets[level], &offset, sizeof(int32_t));
+}
+
+static void
+geoarrow_add_point4d(LWGEOARROW_WRITER *w, const POINT4D *pt)
+{
+	int d = 2;
+	geoarrow_put(&w->coords[0], &pt->x, sizeof(double));
+	geoarrow_put(&w->coords[1], &pt->y, sizeof(double));
+	if (w->layout.has_z)
+		geoarrow_put(&w->coords[d++], &pt->z, sizeof(double));
+	if (w->layout.has_m)
+		geoarrow_put(&w->coords[d], &pt->m, sizeof(double));
+}
+
+static void
+geoarrow_add_empty_point(LWGEOARROW_WRITER *w)
+{
+	POINT4D pt = {NAN, NAN, NAN, NAN};
+	geoarrow_add_point4d(w, &pt);
+}
+
+/* Spread the interleaved ordinates of a point array over the ordinate buffers */
+static void
+geoarrow_add_ptarray(LWGEOARROW_WRITER *w, const POINTARRAY *pa)
+{
+	uint32_t i;
+	uint8_t d;
+	const double *pts = (const double *)pa->serialized_pointlist;
+
+	for (d = 0; d < w->ndims; d++)
+	{
+		double *dst = (double *)bytebuffer_reserve(&w->coords[d], pa->npoints * sizeof(double));
+		for (i = 0; i < pa->npoints; i++)
+			memcpy(dst + i, pts + (size_t)i * w->ndims + d, sizeof(double));
+		w->coords[d].writecursor += pa->npoints * sizeof(double);
+	}
+}
+
+static void
+geoarrow_add_line(LWGEOARROW_WRITER *w, const LWLINE *line, int level)
+{
+	geoarrow_add_offset(w, level, line->points->npoints);
+	geoarrow_add_ptarray(w, line->points);
+}
+
+static void
+geoarrow_add_poly(LWGEOARROW_WRITER *w, const LWPOLY *poly, int level)
+{
+	uint32_t i;
+	geoarrow_add_offset(w, level, poly->nrings);
+	for (i = 0; i < poly->nrings; i++)
+	{
+		geoarrow_add_offset(w, level + 1, poly->rings[i]->npoints);
+		geoarrow_add_ptarray(w, poly->rings[i]);
+	}
+}
+
+static void
+geoarrow_add_native(LWGEOARROW_WRITER *w, const LWGEOM *geom)
+{
+	const LWCOLLECTION *col = (const LWCOLLECTION *)geom;
+	uint32_t i;
+
+	switch (geom->type)
+	{
+	case POINTTYPE:
+		/* Only reached for a point in a multipoint column */
+		geoarrow_add_offset(w, 0, lwgeom_is_empty(geom) ? 0 : 1);
+		if (!lwgeom_is_empty(geom))
+			geoarrow_add_ptarray(w, ((const LWPOINT *)geom)->point);
+		return;
+	case LINETYPE:
+		if (w->layout.type == MULTILINETYPE)
+		{
+			geoarrow_add_offset(w, 0, lwgeom_is_empty(geom) ? 0 : 1);
+			if (!lwgeom_is_empty(geom))
+				geoarrow_add_line(w, (const LWLINE *)geom, 1);
+		}
+		else
+			geoarrow_add_line(w, (const LWLINE *)geom, 0);
+		return;
+	case POLYGONTYPE:
+		if (w->layout.type == MULTIPOLYGONTYPE)
+		{
+			geoarrow_add_offset(w, 0, lwgeom_is_empty(geom) ? 0 : 1);
+			if (!lwgeom_is_empty(geom))
+				geoarrow_add_poly(w, (const LWPOLY *)geom, 1);
+		}
+		else
+			geoarrow_add_poly(w, (const LWPOLY *)geom, 0);
+		return;
+	case MULTIPOINTTYPE:
+		geoarrow_add_offset(w, 0, col->ngeoms);
+		for (i = 0; i < col->ngeoms; i++)
+		{
+			if (lwgeom_is_empty(col->geoms[i]))
+				geoarrow_add_empty_point(w);
+			else
+				geoarrow_add_ptarray(w, ((const LWPOINT *)col->geoms[i])->point);
+		}
+		return;
+	case MULTILINETYPE:
+		geoarrow_add_offset(w, 0, col->ngeoms);
+		for (i = 0; i < col->ngeoms; i++)
+			geoarrow_add_line(w, (const LWLINE *)col->geoms[i], 1);
+		return;
+	case MULTIPOLYGONTYPE:
+		geoarrow_add_offset(w, 0, col->ngeoms);
+		for (i = 0; i < col->ngeoms; i++)
+			geoarrow_add_poly(w, (const LWPOLY *)col->geoms[i], 1);
+		return;
+	default:
+		lwerror("%s: unexpected geometry type %s", __func__, lwtype_name(geom->type));
+	}
+}
+
+LWGEOARROW_WRITER *
+lwgeoarrow_writer_create(const LWGEOARROW_LAYOUT *layout, const char *srs)
+{
+	LWGEOARROW_WRITER *w = lwalloc(sizeof(LWGEOARROW_WRITER));
+	int32_t zero = 0;
+	int i;
+
+	memset(w, 0, sizeof(LWGEOARROW_WRITER));
+	w->layout = *layout;
+	/* A column of null geometries only, has to get some type */
+	if (!w->layout.type)
+		w->layout.wkb = LW_TRUE;
+	if (w->layout.wkb)
+		w->layout.type = w->layout.has_z = w->layout.has_m = 0;
+	w->srs = srs ? lwstrdup(srs) : NULL;
+	w->depth = geoarrow_depths[w->layout.type];
+	w->ndims = w->layout.wkb ? 1 : 2 + w->layout.has_z + w->layout.has_m;
+
+	bytebuffer_init_with_size(&w->validity, 0);
+	for (i = 0; i < 3; i++)
+	{
+		bytebuffer_init_with_size(&w->offsets[i], 0);
+		if (i < w->depth)
+			geoarrow_put(&w->offsets[i], &zero, sizeof(int32_t));
+	}
+	for (i = 0; i < 4; i++)
+		bytebuffer_init_with_size(&w->coords[i], 0);
+	return w;
+}
+
+void
+lwgeoarrow_writer_add(LWGEOARROW_WRITER *w, const GSERIALIZED *g)
+{
+	POINT4D pt;
+	LWGEOM *geom;
+
+	if (w->nrows == INT32_MAX)
+		lwerror("%s: too many rows for one GeoArrow column", __func__);
+
+	if (w->nrows % 8 == 0)
+		bytebuffer_append_byte(&w->validity, 0);
+	if (g)
+		w->validity.writecursor[-1] |= 1 << (w->nrows % 8);
+	w->nrows++;
+
+	/* Null rows take a point slot or an empty list */
+	if (!g)
+	{
+		w->nnulls++;
+		if (w->depth)
+			geoarrow_add_offset(w, 0, 0);
+		else
+			geoarrow_add_empty_point(w);
+		return;
+	}
+
+	if (w->layout.wkb)
+	{
+		lwvarlena_t *wkb = gserialized_to_wkb_varlena(g, WKB_ISO | WKB_NDR);
+		uint32_t size = LWSIZE_GET(wkb->size) - LWVARHDRSZ;
+		geoarrow_add_offset(w, 0, size);
+		geoarrow_put(&w->coords[0], wkb->data, size);
+		lwfree(wkb);
+		return;
+	}
+
+	/* Points are read straight off the serialization */
+	if (gserialized_get_type(g) == POINTTYPE && w->layout.type == POINTTYPE)
+	{
+		if (gserialized_peek_first_point(g, &pt) == LW_SUCCESS)
+			geoarrow_add_point4d(w, &pt);
+		else
+			geoarrow_add_empty_point(w);
+		return;
+	}
+
+	geom = lwgeom_from_gserialized(g);
+	geoarrow_add_native(w, geom);
+	lwgeom_free(geom);
+}
+
+/*
+ * Flatbuffers are written front to back: a table comes before the
+ * strings, vectors and tables it refers to, and its offset members get
+ * patched when these are written. Scalars are little-endian.
+ */
+
+typedef struct
+{
+	uint8_t size;   /* inline size, 0 for an absent member */
+	uint64_t value; /* scalar value, offsets get patched later */
+	size_t pos;     /* set to where the member got written */
+} fb_member;
+
+static inline void
+fb_set(bytebuffer_t *b, size_t pos, uint64_t value, uint8_t size)
+{
+	uint8_t i;
+	for (i = 0; i < size; i++)
+		b->buf_start[pos + i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline void
+fb_add(bytebuffer_t *b, uint64_t value, uint8_t size)
+{
+	size_t pos = geoarrow_length(b);
+	bytebuffer_reserve(b, size);
+	b->writecursor += size;
+	fb_set(b, pos, value, size);
+}
+
+static inline void
+fb_align(bytebuffer_t *b, size_t align, size_t shift)
+{
+	while ((geoarrow_length(b) + shift) % align)
+		bytebuffer_append_byte(b, 0);
+}
+
+/* Point an offset member or vector element at pos */
+static inline void
+fb_patch(bytebuffer_t *b, size_t at, size_t pos)
+{
+	fb_set(b, at, pos - at, 4);
+}
+
+static size_t
+fb_table(bytebuffer_t *b, fb_member *members, uint16_t nmembers)
+{
+	uint16_t slots[8] = {0};
+	uint16_t size = 4;
+	uint8_t msize;
+	size_t vtable, table;
+	uint16_t i;
+
+	/* Largest members first, each at its natural alignment */
+	for (msize = 8; msize; msize >>= 1)
+		for (i = 0; i < nmembers; i++)
+			if (members[i].size == msize)
+			{
+				size = (size + msize - 1) & ~(msize - 1);
+				slots[i] = size;
+				size += msize;
+			}
+
+	fb_align(b, 2, 0);
+	vtable = geoarrow_length(b);
+	fb_add(b, 4 + 2 * nmembers, 2);
+	fb_add(b, size, 2);
+	for (i = 0; i < nmembers; i++)
+		fb_add(b, slots[i], 2);
+
+	fb_align(b, 8, 0);
+	table = geoarrow_length(b);
+	fb_add(b, table - vtable, 4);
+	memset(bytebuffer_reserve(b, size - 4), 0, size - 4);
+	b->writecursor += size - 4;
+	for (i = 0; i < nmembers; i++)
+	{
+		members[i].pos = table + slots[i];
+		if (members[i].size)
+			fb_set(b, members[i].pos, members[i].value, members[i].size);
+	}
+	return table;
+}
+
+/* Returns where the first element goes */
+static size_t
+fb_vector(bytebuffer_t *b, uint32_t n, size_t elemsize)
+{
+	size_t pos;
+	fb_align(b, elemsize > 4 ? 8 : 4, 4);
+	fb_add(b, n, 4);
+	pos = geoarrow_length(b);
+	memset(bytebuffer_reserve(b, n * elemsize), 0, n * elemsize);
+	b->writecursor += n * elemsize;
+	return pos;
+}
+
+static size_t
+fb_string(bytebuffer_t *b, const char *str)
+{
+	size_t pos, len = strlen(str);
+	fb_align(b, 4, 0);
+	pos = geoarrow_length(b);
+	fb_add(b, len, 4);
+	geoarrow_put(b, str, len + 1);
+	return pos;
+}
+
+static size_t
+fb_keyvalue(bytebuffer_t *b, const char *key, const char *value)
+{
+	fb_member m[2] = {{4, 0, 0}, {4, 0, 0}};
+	size_t table = fb_table(b, m, 2);
+	fb_patch(b, m[ARROW_KEYVALUE_KEY].pos, fb_string(b, key));
+	fb_patch(b, m[ARROW_KEYVALUE_VALUE].pos, fb_string(b, value));
+	return table;
+}
+
+static size_t
+geoarrow_write_field(bytebuffer_t *b, const LWGEOARROW_WRITER *w, int level, const char *name);
+
+static size_t
+geoarrow_write_children(bytebuffer_t *b, const LWGEOARROW_WRITER *w, int level)
+{
+	const char *names[4] = {"x", "y", NULL, NULL};
+	size_t vector;
+	uint8_t i, n = 0;
+
+	if (w->layout.wkb || level > w->depth)
+		n = 0;
+	else if (level < w->depth)
+		names[n++] = geoarrow_child_names[w->layout.type][level];
+	else
+	{
+		n = 2;
+		if (w->layout.has_z)
+			names[n++] = "z";
+		if (w->layout.has_m)
+			names[n++] = "m";
+	}
+
+	vector = fb_vector(b, n, 4);
+	for (i = 0; i < n; i++)
+		fb_patch(b, vector + 4 * i, geoarrow_write_field(b, w, level + 1, names[i]));
+	return vector - 4;
+}
+
+/*
+ * Levels run from the column itself (0) down to its coordinates
+ * (depth), whose ordinates are one level further down.
+ */
+static size_t
+geoarrow_write_field(bytebuffer_t *b, const LWGEOARROW_WRITER *w, int level, const char *name)
+{
+	fb_member m[7] = {{4, 0, 0}, {1, level == 0, 0}, {1, 0, 0}, {4, 0, 0}, {0, 0, 0}, {4, 0, 0}, {0, 0, 0}};
+	fb_member precision = {2, ARROW_PRECISION_DOUBLE, 0};
+	size_t table, vector;
+	char *metadata, *ptr;
+	const char *srs;
+
+	if (level > w->depth)
+		m[ARROW_FIELD_TYPE_TYPE].value = ARROW_TYPE_FLOATING_POINT;
+	else if (level < w->depth && !w->layout.wkb)
+		m[ARROW_FIELD_TYPE_TYPE].value = ARROW_TYPE_LIST;
+	else if (w->layout.wkb)
+		m[ARROW_FIELD_TYPE_TYPE].value = ARROW_TYPE_BINARY;
+	else
+		m[ARROW_FIELD_TYPE_TYPE].value = ARROW_TYPE_STRUCT;
+	if (level == 0)
+		m[ARROW_FIELD_CUSTOM_METADATA].size = 4;
+
+	table = fb_table(b, m, 7);
+	fb_patch(b, m[ARROW_FIELD_NAME].pos, fb_string(b, name));
+	if (m[ARROW_FIELD_TYPE_TYPE].value == ARROW_TYPE_FLOATING_POINT)
+		fb_patch(b, m[ARROW_FIELD_TYPE].pos, fb_table(b, &precision, 1));
+	else
+		fb_patch(b, m[ARROW_FIELD_TYPE].pos, fb_table(b, NULL, 0));
+	fb_patch(b, m[ARROW_FIELD_CHILDREN].pos, geoarrow_write_children(b, w, level));
+
+	if (level == 0)
+	{
+		if (w->srs)
+		{
+			ptr = metadata = lwalloc(2 * strlen(w->srs) + 64);
+			ptr += sprintf(ptr, "{\"crs\":\"");
+			for (srs = w->srs; *srs; srs++)
+			{
+				if (*srs == '"' || *srs == '\\')
+					*ptr++ = '\\';
+				*ptr++ = *srs;
+			}
+			sprintf(ptr, "\",\"crs_type\":\"authority_code\"}");
+		}
+		else
+			metadata = lwstrdup("{}");
+		vector = fb_vector(b, 2, 4);
+		fb_patch(b, m[ARROW_FIELD_CUSTOM_METADATA].pos, vector - 4);
+		fb_patch(b, vector, fb_keyvalue(b, GEOARROW_EXTENSION_NAME, geoarrow_extension_names[w->layout.type]));
+		fb_patch(b, vector + 4, fb_keyvalue(b, GEOARROW_EXTENSION_METADATA, metadata));
+		lwfree(metadata);
+	}
+	return table;
+}
+
+/* Message header shared by the schema and the record batch */
+static size_t
+geoarrow_write_message(bytebuffer_t *b, uint8_t header_type, uint64_t body_length, size_t *header)
+{
+	fb_member m[4] = {{2, ARROW_METADATA_V5, 0}, {1, header_type, 0}, {4, 0, 0}, {8, body_length, 0}};
+	size_t table;
+	fb_add(b, 0, 4);
+	table = fb_table(b, m, 4);
+	fb_patch(b, 0, table);
+	*header = m[ARROW_MESSAGE_HEADER].pos;
+	return table;
+}
+
+static void
+geoarrow_write_schema(bytebuffer_t *b, const LWGEOARROW_WRITER *w)
+{
+	fb_member m[2] = {{IS_BIG_ENDIAN ? 2 : 0, 1, 0}, {4, 0, 0}};
+	size_t header, vector;
+
+	geoarrow_write_message(b, ARROW_MESSAGE_SCHEMA, 0, &header);
+	fb_patch(b, header, fb_table(b, m, 2));
+	vector = fb_vector(b, 1, 4);
+	fb_patch(b, m[ARROW_SCHEMA_FIELDS].pos, vector - 4);
+	fb_patch(b, vector, geoarrow_write_field(b, w, 0, "geometry"));
+}
+
+typedef struct
+{
+	const uint8_t *data;
+	size_t size;
+} geoarrow_buffer;
+
+static inline void
+geoarrow_add_node(int64_t *nodes, int *nnodes, int64_t length, int64_t nulls)
+{
+	nodes[2 * *nnodes] = length;
+	nodes[2 * *nnodes + 1] = nulls;
+	(*nnodes)++;
+}
+
+static inline void
+geoarrow_add_buffer(geoarrow_buffer *buffers, int *nbuffers, const uint8_t *data, size_t size)
+{
+	buffers[*nbuffers].data = data;
+	buffers[*nbuffers].size = size;
+	(*nbuffers)++;
+}
+
+/*
+ * Lay out the Arrow nodes and buffers in schema order, those of a
+ * column before those of its children. Only the column itself can
+ * have nulls, so only its validity bitmap gets written.
+ * Returns the body length.
+ */
+static uint64_t
+geoarrow_buffers(const LWGEOARROW_WRITER *w, int64_t *nodes, geoarrow_buffer *buffers, int *nnodes, int *nbuffers)
+{
+	uint64_t body = 0;
+	int64_t length = w->nrows;
+	size_t validity = w->nnulls ? (w->nrows + 7) / 8 : 0;
+	int level, d;
+
+	*nnodes = *nbuffers = 0;
+	if (w->layout.wkb)
+	{
+		geoarrow_add_node(nodes, nnodes, length, w->nnulls);
+		geoarrow_add_buffer(buffers, nbuffers, w->validity.buf_start, validity);
+		geoarrow_add_buffer(buffers, nbuffers, w->offsets[0].buf_start, geoarrow_length(&w->offsets[0]));
+		geoarrow_add_buffer(buffers, nbuffers, w->coords[0].buf_start, geoarrow_length(&w->coords[0]));
+	}
+	else
+	{
+		/* Lists, then the struct of coordinates and its ordinates */
+		for (level = 0; level <= w->depth; level++)
+		{
+			geoarrow_add_node(nodes, nnodes, length, level ? 0 : w->nnulls);
+			geoarrow_add_buffer(buffers, nbuffers, w->validity.buf_start, level ? 0 : validity);
+			if (level < w->depth)
+			{
+				geoarrow_add_buffer(buffers, nbuffers, w->offsets[level].buf_start, geoarrow_length(&w->offsets[level]));
+				length = w->nitems[level];
+			}
+		}
+		for (d = 0; d < w->ndims; d++)
+		{
+			geoarrow_add_node(nodes, nnodes, length, 0);
+			geoarrow_add_buffer(buffers, nbuffers, NULL, 0);
+			geoarrow_add_buffer(buffers, nbuffers, w->coords[d].buf_start, geoarrow_length(&w->coords[d]));
+		}
+	}
+
+	for (d = 0; d < *nbuffers; d++)
+		body += (buffers[d].size + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1);
+	return body;
+}
+
+static void
+geoarrow_write_record_batch(bytebuffer_t *b, const LWGEOARROW_WRITER *w, const int64_t *nodes, int nnodes, const geoarrow_buffer *buffers, int nbuffers, uint64_t body)
+{
+	fb_member m[3] = {{8, w->nrows, 0}, {4, 0, 0}, {4, 0, 0}};
+	size_t header, vector;
+	uint64_t offset = 0;
+	int i;
+
+	geoarrow_write_message(b, ARROW_MESSAGE_RECORD_BATCH, body, &header);
+	fb_patch(b, header, fb_table(b, m, 3));
+
+	vector = fb_vector(b, nnodes, ARROW_STRUCT_SIZE);
+	fb_patch(b, m[ARROW_RECORD_BATCH_NODES].pos, vector - 4);
+	for (i = 0; i < nnodes; i++)
+	{
+		fb_set(b, vector + ARROW_STRUCT_SIZE * i, nodes[2 * i], 8);
+		fb_set(b, vector + ARROW_STRUCT_SIZE * i + 8, nodes[2 * i + 1], 8);
+	}
+
+	vector = fb_vector(b, nbuffers, ARROW_STRUCT_SIZE);
+	fb_patch(b, m[ARROW_RECORD_BATCH_BUFFERS].pos, vector - 4);
+	for (i = 0; i < nbuffers; i++)
+	{
+		fb_set(b, vector + ARROW_STRUCT_SIZE * i, offset, 8);
+		fb_set(b, vector + ARROW_STRUCT_SIZE * i + 8, buffers[i].size, 8);
+		offset += (buffers[i].size + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1);
+	}
+}
+
+/* Continuation marker, metadata size and the metadata, padded to the alignment */
+static uint8_t *
+geoarrow_put_message(uint8_t *out, const bytebuffer_t *b)
+{
+	size_t size = geoarrow_length(b);
+	size_t padded = (size + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1);
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		out[i] = 0xFF;
+		out[4 + i] = (uint8_t)(padded >> (8 * i));
+	}
+	memcpy(out + 8, b->buf_start, size);
+	memset(out + 8 + size, 0, padded - size);
+	return out + 8 + padded;
+}
+
+lwvarlena_t *
+lwgeoarrow_writer_finish(LWGEOARROW_WRITER *w)
+{
+	int64_t nodes[2 * 8];
+	geoarrow_buffer buffers[16];
+	int nnodes, nbuffers, i;
+	uint64_t body;
+	bytebuffer_t schema, batch;
+	size_t size;
+	lwvarlena_t *v;
+	uint8_t *out;
+	const uint8_t eos[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+
+	bytebuffer_init_with_size(&schema, 0);
+	bytebuffer_init_with_size(&batch, 0);
+	geoarrow_write_schema(&schema, w);
+	body = geoarrow_buffers(w, nodes, buffers, &nnodes, &nbuffers);
+	geoarrow_write_record_batch(&batch, w, nodes, nnodes, buffers, nbuffers, body);
+
+	size = 8 + ((geoarrow_length(&schema) + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1)) +
+	       8 + ((geoarrow_length(&batch) + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1)) +
+	       body + sizeof(eos);
+	v = lwalloc(LWVARHDRSZ + size);
+	LWSIZE_SET(v->size, LWVARHDRSZ + size);
+
+	out = geoarrow_put_message((uint8_t *)v->data, &schema);
+	out = geoarrow_put_message(out, &batch);
+	for (i = 0; i < nbuffers; i++)
+	{
+		size_t padded = (buffers[i].size + ARROW_ALIGNMENT - 1) & ~(ARROW_ALIGNMENT - 1);
+		if (buffers[i].size)
+			memcpy(out, buffers[i].data, buffers[i].size);
+		memset(out + buffers[i].size, 0, padded - buffers[i].size);
+		out += padded;
+	}
+	memcpy(out, eos, sizeof(eos));
+
+	bytebuffer_destroy_buffer(&schema);
+	bytebuffer_destroy_buffer(&batch);
+	bytebuffer_destroy_buffer(&w->validity);
+	for (i = 0; i < 3; i++)
+		bytebuffer_destroy_buffer(&w->offsets[i]);
+	for (i = 0; i < 4; i++)
+		bytebuffer_destroy_buffer(&w->coords[i]);
+	if (w->srs)
+		lwfree(w->srs);
+	lwfree(w);
+	return v;
+}
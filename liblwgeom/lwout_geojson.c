@@ -47,29 +47,29 @@ static void asgeojson_geometry(stringbuffer_t *sb, const LWGEOM *geom, const geo
 
 
 
-static void
+/*
+ * Write one position. Room for the whole position is reserved up
+ * front, and the ordinates are printed straight into the buffer.
+ */
+static inline void
 coordinate_to_geojson(stringbuffer_t *sb, const POINTARRAY *pa, uint32_t i, const geojson_opts *opts)
 {
-	if (!FLAGS_GET_Z(pa->flags))
+	const double *d = (const double *)getPoint_internal(pa, i);
+	char *p;
+
+	stringbuffer_makeroom(sb, 5 + 3 * OUT_MAX_BYTES_DOUBLE);
+	p = sb->str_end;
+	*p++ = '[';
+	p += lwprint_double(d[0], opts->precision, p);
+	*p++ = ',';
+	p += lwprint_double(d[1], opts->precision, p);
+	if (FLAGS_GET_Z(pa->flags))
 	{
-		const POINT2D *pt = getPoint2d_cp(pa, i);
-		stringbuffer_append_char(sb, '[');
-		stringbuffer_append_double(sb, pt->x, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->y, opts->precision);
-		stringbuffer_append_char(sb, ']');
-	}
-	else
-	{
-		const POINT3D *pt = getPoint3d_cp(pa, i);
-		stringbuffer_append_char(sb, '[');
-		stringbuffer_append_double(sb, pt->x, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->y, opts->precision);
-		stringbuffer_append_char(sb, ',');
-		stringbuffer_append_double(sb, pt->z, opts->precision);
-		stringbuffer_append_char(sb, ']');
+		*p++ = ',';
+		p += lwprint_double(d[2], opts->precision, p);
 	}
+	*p++ = ']';
+	sb->str_end = p;
 }
 
 static void
@@ -371,6 +371,27 @@ asgeojson_geometry(stringbuffer_t *sb, const LWGEOM *geom, const geojson_opts *o
 	}
 }
 
+/*
+ * Estimate the size of the output from the vertex count, so the
+ * buffer is allocated once instead of doubled as positions arrive.
+ * Trailing zeroes are trimmed, so this usually errs on the high side.
+ */
+static size_t
+asgeojson_size_hint(const LWGEOM *geom, const geojson_opts *opts)
+{
+	size_t ordinate = opts->precision + 6;
+	size_t size = 128;
+
+	if (ordinate > OUT_MAX_BYTES_DOUBLE)
+		ordinate = OUT_MAX_BYTES_DOUBLE;
+	if (opts->srs)
+		size += strlen(opts->srs) + 64;
+	if (opts->bbox)
+		size += 6 * (ordinate + 1) + 16;
+
+	return size + (size_t)lwgeom_count_vertices(geom) * (3 + (opts->hasz ? 3 : 2) * (ordinate + 1));
+}
+
 /**
  * Takes a GEOMETRY and returns a GeoJson representation
  */
@@ -397,7 +418,7 @@ lwgeom_to_geojson(const LWGEOM *geom, const char *srs, int precision, int has_bb
 	/* To avoid taking a copy of the output, we make */
 	/* space for the VARLENA header before starting to */
 	/* serialize the geom */
-	stringbuffer_init_varlena(&sb);
+	stringbuffer_init_varlena_with_size(&sb, asgeojson_size_hint(geom, &opts));
 	/* Now serialize the geometry */
 	asgeojson_geometry(&sb, geom, &opts);
 	/* Leave the initially allocated buffer in place */
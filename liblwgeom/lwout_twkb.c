@@ -99,6 +99,9 @@ static void write_bbox(TWKB_STATE *ts, int ndims)
 }
 
 
+/* Points quantised and delta encoded before a block is varint packed */
+#define TWKB_BLOCK_POINTS 128
+
 /**
 * Stores a pointarray as varints in the buffer
 * @register_npoints, controls whether an npoints entry is added to the buffer (used to skip npoints for point types)
@@ -107,12 +110,13 @@ static void write_bbox(TWKB_STATE *ts, int ndims)
 static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB_STATE *ts, int register_npoints, uint32_t minpoints)
 {
 	uint32_t ndims = FLAGS_NDIMS(pa->flags);
-	uint32_t i, j;
-	bytebuffer_t b;
-	bytebuffer_t *b_p;
-	int64_t nextdelta[MAX_N_DIMS];
-	int npoints = 0;
+	uint32_t i, j, k;
+	bytebuffer_t *b = ts->geom_buf;
+	int64_t deltas[TWKB_BLOCK_POINTS * MAX_N_DIMS];
+	uint8_t npoints_buf[16];
+	uint32_t npoints = 0;
 	size_t npoints_offset = 0;
+	size_t npoints_size = 0;
 	uint32_t max_points_left = pa->npoints;
 
 	LWDEBUGF(2, "Entered %s", __func__);
@@ -125,105 +129,85 @@ static int ptarray_to_twkb_buf(const POINTARRAY *pa, TWKB_GLOBALS *globals, TWKB
 		return 0;
 	}
 
-	/* If npoints is more than 127 it is unpredictable how many bytes npoints will need */
-	/* Then we have to store the deltas in a temp buffer to later add them after npoints */
-	/* If noints is below 128 we know 1 byte will be needed */
-	/* Then we can make room for that 1 byte at once and write to */
-	/* ordinary buffer */
-	if( pa->npoints > 127 )
+	/* Duplicate points are dropped, so we only know npoints at the end. */
+	/* Make room for the input count, which is never smaller, and close */
+	/* the gap once the real count is known. We keep the offset rather */
+	/* than a pointer, as the buffer may be reallocated meanwhile. */
+	if ( register_npoints )
 	{
-		/* Independent buffer to hold the coordinates, so we can put the npoints */
-		/* into the stream once we know how many points we actually have */
-		bytebuffer_init_with_size(&b, (size_t)3 * ndims * pa->npoints);
-		b_p = &b;
-	}
-	else
-	{
-		/* We give an alias to our ordinary buffer */
-		b_p = ts->geom_buf;
-		if ( register_npoints )
-		{
-			/* We do not store a pointer to the place where we want the npoints value */
-			/* Instead we store how far from the beginning of the buffer we want the value */
-			/* That is because we otherwise will get in trouble if the buffer is reallocated */
-			npoints_offset = b_p->writecursor - b_p->buf_start;
-
-			/* We just move the cursor 1 step to make room for npoints byte */
-			/* We use the function append_byte even if we have no value yet, */
-			/* since that gives us the check for big enough buffer and moves the cursor */
-			bytebuffer_append_byte(b_p, 0);
-		}
+		npoints_offset = b->writecursor - b->buf_start;
+		npoints_size = varint_u32_encode_buf(pa->npoints, npoints_buf);
+		b->writecursor = bytebuffer_reserve(b, npoints_size) + npoints_size;
 	}
 
-	for ( i = 0; i < pa->npoints; i++ )
+	for ( i = 0; i < pa->npoints; i += TWKB_BLOCK_POINTS )
 	{
-		double *dbl_ptr = (double*)getPoint_internal(pa, i);
-		int64_t diff = 0;
+		uint32_t block_end = FP_MIN(pa->npoints, i + TWKB_BLOCK_POINTS);
+		size_t nvals = 0;
 
-		/* Write this coordinate to the buffer as a varint */
-		for ( j = 0; j < ndims; j++ )
+		for ( k = i; k < block_end; k++ )
 		{
+			const double *dbl_ptr = (const double*)getPoint_internal(pa, k);
+			int64_t *nextdelta = deltas + nvals;
+			int64_t diff = 0;
+
 			/* To get the relative coordinate we don't get the distance */
 			/* from the last point but instead the distance from our */
 			/* last accumulated point. This is important to not build up an */
 			/* accumulated error when rounding the coordinates */
-			nextdelta[j] = (int64_t) llround(globals->factor[j] * dbl_ptr[j]) - ts->accum_rels[j];
-			LWDEBUGF(4, "deltavalue: %lld, ", nextdelta[j]);
-			diff += llabs(nextdelta[j]);
-		}
-
-		/* Skipping the first point is not allowed */
-		/* If the sum(abs()) of all the deltas was zero, */
-		/* then this was a duplicate point, so we can ignore it */
-		if ( i > 0 && diff == 0 &&  max_points_left > minpoints )
-		{
-			max_points_left--;
-			continue;
-		}
+			for ( j = 0; j < ndims; j++ )
+			{
+				nextdelta[j] = (int64_t) llround(globals->factor[j] * dbl_ptr[j]) - ts->accum_rels[j];
+				diff += llabs(nextdelta[j]);
+			}
 
-		/* We really added a point, so... */
-		npoints++;
+			/* Skipping the first point is not allowed */
+			/* If the sum(abs()) of all the deltas was zero, */
+			/* then this was a duplicate point, so we can ignore it */
+			if ( k > 0 && diff == 0 &&  max_points_left > minpoints )
+			{
+				max_points_left--;
+				continue;
+			}
 
-		/* Write this vertex to the temporary buffer as varints */
-		for ( j = 0; j < ndims; j++ )
-		{
-			ts->accum_rels[j] += nextdelta[j];
-			bytebuffer_append_varint(b_p, nextdelta[j]);
-		}
+			/* We really added a point, so... */
+			npoints++;
+			nvals += ndims;
 
-		/* See if this coordinate expands the bounding box */
-		if( globals->variant & TWKB_BBOX )
-		{
 			for ( j = 0; j < ndims; j++ )
-			{
-				if( ts->accum_rels[j] > ts->bbox_max[j] )
-					ts->bbox_max[j] = ts->accum_rels[j];
+				ts->accum_rels[j] += nextdelta[j];
 
-				if( ts->accum_rels[j] < ts->bbox_min[j] )
-					ts->bbox_min[j] = ts->accum_rels[j];
+			/* See if this coordinate expands the bounding box */
+			if( globals->variant & TWKB_BBOX )
+			{
+				for ( j = 0; j < ndims; j++ )
+				{
+					if( ts->accum_rels[j] > ts->bbox_max[j] )
+						ts->bbox_max[j] = ts->accum_rels[j];
+
+					if( ts->accum_rels[j] < ts->bbox_min[j] )
+						ts->bbox_min[j] = ts->accum_rels[j];
+				}
 			}
 		}
 
+		/* Write the deltas of the block as varints, at most 10 bytes each */
+		b->writecursor = bytebuffer_reserve(b, nvals * 10);
+		b->writecursor += varint_s64_encode_block(deltas, nvals, b->writecursor);
 	}
 
-	if ( pa->npoints > 127 )
-	{
-		/* Now write the temporary results into the main buffer */
-		/* First the npoints */
-		if ( register_npoints )
-			bytebuffer_append_uvarint(ts->geom_buf, npoints);
-		/* Now the coordinates */
-		bytebuffer_append_bytebuffer(ts->geom_buf, b_p);
-
-		/* Clear our temporary buffer */
-		bytebuffer_destroy_buffer(&b);
-	}
-	else
+	if ( register_npoints )
 	{
-		/* If we didn't use a temp buffer, we just write that npoints value */
-		/* to where it belongs*/
-		if ( register_npoints )
-			varint_u64_encode_buf(npoints, b_p->buf_start + npoints_offset);
+		uint8_t *npoints_ptr = b->buf_start + npoints_offset;
+		size_t size = varint_u32_encode_buf(npoints, npoints_buf);
+
+		LWDEBUGF(4, "Register npoints:%d", npoints);
+		if ( size < npoints_size )
+		{
+			memmove(npoints_ptr + size, npoints_ptr + npoints_size, b->writecursor - npoints_ptr - npoints_size);
+			b->writecursor -= npoints_size - size;
+		}
+		memcpy(npoints_ptr, npoints_buf, size);
 	}
 
 	return 0;
@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "ryu/ryu.h"
+#include "ryu/digit_table.h"
 
 /* Ensures the given lat and lon are in the "normal" range:
  * -90 to +90 for lat, -180 to +180 for lon. */
@@ -449,6 +450,106 @@ char* lwpoint_to_latlon(const LWPOINT * pt, const char *format)
 	return lwdoubles_to_latlon(p->y, p->x, format);
 }
 
+/* Bound of the scaled values printed by lwprint_double_fixed, 2^49 */
+#define FP_FIXED_MAX 562949953421312.0
+#define FP_FIXED_MAX_PRECISION 15
+
+static const double lwprint_pow10[FP_FIXED_MAX_PRECISION + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+/*
+ * Print the absolute value ad with at most precision decimals straight
+ * from its value scaled to an integer, when that gives the same digits
+ * as the shortest representation rounded by ryu. Returns 0 when it
+ * cannot tell, leaving it to ryu.
+ *
+ * Below 2^49, the scaling is off by less than 1/32 and the shortest
+ * representation is less than 1/16 away from ad once scaled, so they
+ * round the same unless close to a half. With fewer decimals than
+ * asked for, there is at most one integer in that range, and it is
+ * the shortest representation when it scales back to ad exactly.
+ */
+static inline int
+lwprint_double_fixed(double ad, int negative, int precision, char *buf)
+{
+	int decimals = precision;
+	int length = 0, ndigits;
+	char digits[20];
+	char *p = digits + sizeof(digits);
+	double scaled, fraction;
+	uint64_t n;
+
+	while (decimals > 0 && !(ad * lwprint_pow10[decimals] < FP_FIXED_MAX))
+		decimals--;
+	scaled = ad * lwprint_pow10[decimals];
+	if (!(scaled < FP_FIXED_MAX))
+		return 0;
+
+	n = (uint64_t)scaled;
+	fraction = scaled - (double)n;
+	if (decimals == precision)
+	{
+		if (fraction > 0.375 && fraction < 0.625)
+			return 0;
+		n += fraction > 0.5;
+	}
+	else
+	{
+		n += fraction > 0.5;
+		if ((double)n / lwprint_pow10[decimals] != ad)
+			return 0;
+	}
+
+	if (negative && n)
+		buf[length++] = '-';
+
+	/* Trailing zeroes are not printed */
+	while (decimals > 0 && n % 10 == 0)
+	{
+		n /= 10;
+		decimals--;
+	}
+
+	/* Digits from the last one, two at a time */
+	while (n >= 100)
+	{
+		p -= 2;
+		memcpy(p, DIGIT_TABLE + 2 * (n % 100), 2);
+		n /= 100;
+	}
+	if (n >= 10)
+	{
+		p -= 2;
+		memcpy(p, DIGIT_TABLE + 2 * n, 2);
+	}
+	else
+		*--p = '0' + n;
+	ndigits = digits + sizeof(digits) - p;
+
+	if (ndigits <= decimals)
+	{
+		buf[length++] = '0';
+		buf[length++] = '.';
+		memset(buf + length, '0', decimals - ndigits);
+		length += decimals - ndigits;
+		memcpy(buf + length, p, ndigits);
+		length += ndigits;
+	}
+	else
+	{
+		memcpy(buf + length, p, ndigits - decimals);
+		length += ndigits - decimals;
+		if (decimals)
+		{
+			buf[length++] = '.';
+			memcpy(buf + length, p + ndigits - decimals, decimals);
+			length += decimals;
+		}
+	}
+	buf[length] = '\0';
+	return length;
+}
+
 /*
  * Print an ordinate value using at most **maxdd** number of decimal digits
  * The actual number of printed decimal digits may be less than the
@@ -472,6 +573,12 @@ lwprint_double(double d, int maxdd, char *buf)
 	}
 	else
 	{
+		if (precision <= FP_FIXED_MAX_PRECISION)
+		{
+			length = lwprint_double_fixed(ad, d < 0, precision, buf);
+			if (length)
+				return length;
+		}
 		length = d2sfixed_buffered_n(d, precision, buf);
 	}
 	buf[length] = '\0';
@@ -59,7 +59,17 @@ stringbuffer_init(stringbuffer_t *s)
 void
 stringbuffer_init_varlena(stringbuffer_t *s)
 {
-	stringbuffer_init_with_size(s, STRINGBUFFER_STARTSIZE + LWVARHDRSZ);
+	stringbuffer_init_varlena_with_size(s, STRINGBUFFER_STARTSIZE);
+}
+
+/**
+* Initialize a stringbuffer_t for varlena output with room for
+* size bytes of payload, for writers that can estimate their output.
+*/
+void
+stringbuffer_init_varlena_with_size(stringbuffer_t *s, size_t size)
+{
+	stringbuffer_init_with_size(s, size + LWVARHDRSZ);
 	/* Zero out LWVARHDRSZ bytes at the front of the buffer */
 	stringbuffer_append_len(s, "\0\0\0\0\0\0\0\0", LWVARHDRSZ);
 }
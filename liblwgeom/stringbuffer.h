@@ -48,6 +48,7 @@ extern stringbuffer_t *stringbuffer_create_with_size(size_t size);
 extern stringbuffer_t *stringbuffer_create(void);
 extern void stringbuffer_init(stringbuffer_t *s);
 extern void stringbuffer_init_varlena(stringbuffer_t *s);
+extern void stringbuffer_init_varlena_with_size(stringbuffer_t *s, size_t size);
 extern void stringbuffer_release(stringbuffer_t *s);
 extern void stringbuffer_destroy(stringbuffer_t *sb);
 extern void stringbuffer_clear(stringbuffer_t *sb);
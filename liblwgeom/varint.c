@@ -97,6 +97,35 @@ varint_s32_encode_buf(int32_t val, uint8_t *buf)
 	return _varint_u64_encode_buf((uint64_t)zigzag32(val), buf);
 }
 
+size_t
+varint_s64_encode_block(const int64_t *vals, size_t nvals, uint8_t *buf)
+{
+	uint8_t *ptr = buf;
+	size_t i;
+
+	for (i = 0; i < nvals; i++)
+	{
+		uint64_t q = zigzag64(vals[i]);
+
+		/* Coordinate deltas are mostly small, one and two byte values skip the loop */
+		if (q < 0x80)
+		{
+			*ptr++ = (uint8_t)q;
+		}
+		else if (q < 0x4000)
+		{
+			ptr[0] = 0x80 | (uint8_t)(q & 0x7f);
+			ptr[1] = (uint8_t)(q >> 7);
+			ptr += 2;
+		}
+		else
+		{
+			ptr += _varint_u64_encode_buf(q, ptr);
+		}
+	}
+	return ptr - buf;
+}
+
 /* Read from signed 64bit varint */
 int64_t
 varint_s64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size)
@@ -156,6 +185,43 @@ varint_u64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size
 	return 0;
 }
 
+/* Read a run of signed 64bit varints, without reporting errors */
+size_t
+varint_s64_decode_block(const uint8_t *the_start, const uint8_t *the_end, int64_t *vals, size_t nvals)
+{
+	const uint8_t *ptr = the_start;
+	size_t i;
+
+	for (i = 0; i < nvals; i++)
+	{
+		uint64_t val;
+
+		/* One and two byte values, with the bytes known to be there */
+		if (ptr < the_end && !(ptr[0] & 0x80))
+		{
+			val = ptr[0];
+			ptr += 1;
+		}
+		else if (the_end - ptr >= 2 && !(ptr[1] & 0x80))
+		{
+			val = (uint64_t)(ptr[0] & 0x7f) | ((uint64_t)ptr[1] << 7);
+			ptr += 2;
+		}
+		else
+		{
+			/* Longer values and the buffer tail. Bad varints are */
+			/* left for varint_u64_decode to report. */
+			size_t size = varint_size(ptr, the_end);
+			if (!size || size > 10 || (size == 10 && ptr[9] > 1))
+				return 0;
+			val = varint_u64_decode(ptr, the_end, &size);
+			ptr += size;
+		}
+		vals[i] = unzigzag64(val);
+	}
+	return ptr - the_start;
+}
+
 size_t
 varint_size(const uint8_t *the_start, const uint8_t *the_end)
 {
@@ -40,6 +40,13 @@ size_t varint_s64_encode_buf(int64_t val, uint8_t *buf);
 int64_t varint_s64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size);
 uint64_t varint_u64_decode(const uint8_t *the_start, const uint8_t *the_end, size_t *size);
 
+/* Runs of signed varints, as in TWKB coordinates. The encoder needs
+ * room for 10 bytes per value and returns the bytes written. The
+ * decoder returns the bytes read, or 0 without reporting anything if
+ * a value is malformed or runs past the end. */
+size_t varint_s64_encode_block(const int64_t *vals, size_t nvals, uint8_t *buf);
+size_t varint_s64_decode_block(const uint8_t *the_start, const uint8_t *the_end, int64_t *vals, size_t nvals);
+
 size_t varint_size(const uint8_t *the_start, const uint8_t *the_end);
 
 /* Support from -INT{8,32,64}_MAX to INT{8,32,64}_MAX),
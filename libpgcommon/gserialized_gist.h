@@ -39,6 +39,22 @@ typedef struct
 	float xmin, xmax, ymin, ymax;
 } BOX2DF;
 
+/*
+** Map a float onto an unsigned integer that sorts in the same order,
+** for the space filling curve keys of the sortsupport functions.
+*/
+static inline uint32_t
+float_get_sortable_bits(float f)
+{
+	union floatuint {
+		uint32_t u;
+		float f;
+	} v;
+
+	v.f = f;
+	return (v.u & 0x80000000) ? ~v.u : (v.u | 0x80000000);
+}
+
 /*********************************************************************************
 ** GIDX support functions.
 **
@@ -120,3 +136,4 @@ void gidx_set_unknown(GIDX *a);
 bool gidx_overlaps(GIDX *a, GIDX *b);
 bool gidx_equals(GIDX *a, GIDX *b);
 bool gidx_contains(GIDX *a, GIDX *b);
+double gidx_distance(const GIDX *a, const GIDX *b, int m_is_time);
@@ -366,7 +366,7 @@ GetSRSCacheBySRID(FunctionCallInfo fcinfo, int32_t srid, bool short_crs)
  * Require valid spatial_ref_sys table entry
  *
  */
-static int32_t
+int32_t
 getSRIDbySRS(FunctionCallInfo fcinfo, const char *srs)
 {
 	static const int16_t max_query_size = 512;
@@ -136,3 +136,9 @@ typedef struct {
 
 int32_t GetSRIDCacheBySRS(FunctionCallInfo fcinfo, const char *srs);
 
+/*
+ * Uncached lookup, for set returning functions that already
+ * keep their FuncCallContext in fn_extra
+ */
+int32_t getSRIDbySRS(FunctionCallInfo fcinfo, const char *srs);
+
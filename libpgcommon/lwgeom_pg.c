@@ -465,6 +465,22 @@ GSERIALIZED* geometry_serialize(LWGEOM *lwgeom)
 	return g;
 }
 
+/**
+* Serialize WKB without building an LWGEOM where possible, the
+* same as geometry_serialize on the lwgeom_from_wkb result.
+*/
+GSERIALIZED* geometry_serialize_wkb(const uint8_t *wkb, size_t wkb_size, char check)
+{
+	size_t ret_size;
+	GSERIALIZED *g;
+
+	g = gserialized_from_wkb(wkb, wkb_size, check, &ret_size);
+	if (!g)
+		return NULL;
+	SET_VARSIZE(g, ret_size);
+	return g;
+}
+
 void
 lwpgnotice(const char *fmt, ...)
 {
@@ -175,6 +175,12 @@ extern void pg_unparser_errhint(LWGEOM_UNPARSER_RESULT *lwg_unparser_result);
 */
 GSERIALIZED *geometry_serialize(LWGEOM *lwgeom);
 
+/**
+* Serialize WKB the same way as geometry_serialize on the
+* lwgeom_from_wkb result, or return NULL if it cannot be parsed.
+*/
+GSERIALIZED *geometry_serialize_wkb(const uint8_t *wkb, size_t wkb_size, char check);
+
 /**
 * Utility method to call the serialization and then set the
 * PgSQL varsize header appropriately with the serialized size.
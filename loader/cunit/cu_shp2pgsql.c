@@ -23,6 +23,7 @@ void test_ShpLoaderGetSQLFooter_if_not_exists_index_modifier(void);
 void test_ShpLoaderFIDColumnSQL(void);
 void test_ShpLoaderRejectsInvalidFIDColumn(void);
 void test_ShpLoaderOpenShapeRejectsZip(void);
+void test_ShpLoaderEncodeRecordBinaryCopy(void);
 
 SHPLOADERCONFIG *loader_config;
 SHPLOADERSTATE *loader_state;
@@ -54,7 +55,9 @@ CU_pSuite register_shp2pgsql_suite(void)
 	    (NULL == CU_add_test(pSuite, "test_ShpLoaderFIDColumnSQL()", test_ShpLoaderFIDColumnSQL)) ||
 	    (NULL ==
 	     CU_add_test(pSuite, "test_ShpLoaderRejectsInvalidFIDColumn()", test_ShpLoaderRejectsInvalidFIDColumn)) ||
-	    (NULL == CU_add_test(pSuite, "test_ShpLoaderOpenShapeRejectsZip()", test_ShpLoaderOpenShapeRejectsZip)))
+	    (NULL == CU_add_test(pSuite, "test_ShpLoaderOpenShapeRejectsZip()", test_ShpLoaderOpenShapeRejectsZip)) ||
+	    (NULL ==
+	     CU_add_test(pSuite, "test_ShpLoaderEncodeRecordBinaryCopy()", test_ShpLoaderEncodeRecordBinaryCopy)))
 	{
 		CU_cleanup_registry();
 		return NULL;
@@ -267,3 +270,60 @@ test_ShpLoaderOpenShapeRejectsZip(void)
 	CU_ASSERT_PTR_NULL(strstr(loader_state->message, "does not read .zip archives"));
 	ShpLoaderDestroy(loader_state);
 }
+
+void
+test_ShpLoaderEncodeRecordBinaryCopy(void)
+{
+	static const char *pgfieldtypes[] = {"int4", "numeric", "date", "boolean", "varchar"};
+	static const DBFFieldType types[] = {FTInteger, FTDouble, FTDate, FTLogical, FTString};
+	static const unsigned char expected[] = {
+	    0x00, 0x05,					      /* field count */
+	    0x00, 0x00, 0x00, 0x04, 0xFF, 0xFF, 0xFF, 0xD6, /* int4 -42 */
+	    0x00, 0x00, 0x00, 0x0C, 0x00, 0x02, 0x00, 0x00, /* numeric: 2 digits, weight 0 */
+	    0x40, 0x00, 0x00, 0x04, 0x04, 0xD2, 0x15, 0xE0, /* negative, dscale 4, 1234 5600 */
+	    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, /* date 2000-01-02 */
+	    0x00, 0x00, 0x00, 0x01, 0x01,		      /* boolean true */
+	    0xFF, 0xFF, 0xFF, 0xFF};			      /* NULL varchar */
+	char *values[] = {"-42", "-1234.5600", "20000102", "T", NULL};
+	SHPLOADERCONFIG config;
+	SHPLOADERSTATE *state;
+	SHPLOADERRECORD record;
+	char *data = NULL;
+	size_t size = 0;
+	int i;
+
+	set_loader_config_defaults(&config);
+	config.table = "loadedshp";
+	config.readshape = 0;
+	config.dump_format = DUMP_FORMAT_BINARY;
+
+	state = ShpLoaderCreate(&config);
+	state->num_fields = 5;
+	state->types = malloc(sizeof(types));
+	memcpy(state->types, types, sizeof(types));
+	state->pgfieldtypes = malloc(sizeof(char *) * 5);
+	for (i = 0; i < 5; i++)
+		state->pgfieldtypes[i] = strdup(pgfieldtypes[i]);
+
+	record.obj = NULL;
+	record.values = values;
+	record.num_values = 5;
+
+	CU_ASSERT_EQUAL_FATAL(ShpLoaderEncodeRecord(state, &record, &data, &size), SHPLOADEROK);
+	CU_ASSERT_EQUAL(size, sizeof(expected));
+	CU_ASSERT(memcmp(data, expected, sizeof(expected)) == 0);
+	free(data);
+
+	/* Values the server would reject are reported rather than sent */
+	values[0] = "12x";
+	CU_ASSERT_EQUAL(ShpLoaderEncodeRecord(state, &record, &data, &size), SHPLOADERERR);
+	CU_ASSERT_PTR_NOT_NULL(strstr(state->message, "as binary int4"));
+
+	values[0] = "0";
+	values[2] = "20010229";
+	CU_ASSERT_EQUAL(ShpLoaderEncodeRecord(state, &record, &data, &size), SHPLOADERERR);
+	CU_ASSERT_PTR_NOT_NULL(strstr(state->message, "as binary date"));
+
+	ShpLoaderDestroy(state);
+	free(config.encoding);
+}
@@ -21,6 +21,9 @@
 
 #include <ctype.h>
 #include <strings.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #define xstr(s) str(s)
 #define str(s) #s
@@ -44,6 +47,8 @@ usage(int status)
 	printf(_("  -u <user>  Connect to the database as the specified user.\n" ));
 	printf(_("  -g <geometry_column> Specify the geometry column to be exported.\n" ));
 	printf(_("  -b Use a binary cursor.\n" ));
+	printf(_("  -j <n>  Read the table over <n> connections, each fetching and decoding\n"
+	         "     a range of its gid column, while one thread writes the shapefile in order.\n" ));
 	printf(_("  -r Raw mode. Do not assume table has been created by the loader. This would\n"
 	         "     not unescape attribute names and will not skip the 'gid' attribute.\n" ));
 	printf(_("  -k Keep PostgreSQL identifiers case.\n" ));
@@ -58,6 +63,240 @@ usage(int status)
 	exit(status);
 }
 
+static int
+write_rows_serial(SHPDUMPERSTATE *state)
+{
+	int i, ret;
+
+	for (i = 0; i < ShpDumperGetRecordCount(state); i++)
+	{
+		/* Mimic existing behaviour */
+		if (!state->config->quiet && !(state->currow % state->config->fetchsize))
+		{
+			fprintf(stdout, "X");
+			fflush(stdout);
+		}
+
+		ret = ShpLoaderGenerateShapeRow(state);
+		if (ret != SHPDUMPEROK)
+		{
+			fprintf(stderr, "%s\n", state->message);
+			fflush(stderr);
+
+			if (ret == SHPDUMPERERR)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+#ifdef HAVE_PTHREAD
+
+/*
+ * A key range on its way from a reader connection to the writer.  Range i
+ * lives in slot i % num_slots; readers only claim a range once the writer
+ * has emitted the one its slot held before.
+ */
+typedef struct
+{
+	SHPDUMPERRANGE range;
+	int ret;
+	char message[SHPDUMPERMSGLEN];
+	int done;
+} ShpDumperSlot;
+
+typedef struct
+{
+	SHPDUMPERSTATE *state;
+	ShpDumperSlot *slots;
+	int num_slots;
+	int num_ranges;
+
+	/* Next range to fetch and to write; all guarded by lock */
+	int next_fetch;
+	int next_write;
+	int stop;
+
+	pthread_mutex_t lock;
+	pthread_cond_t can_fetch;
+	pthread_cond_t can_write;
+} ShpDumperPipeline;
+
+typedef struct
+{
+	ShpDumperPipeline *pipeline;
+	SHPDUMPERREADER reader;
+} ShpDumperJob;
+
+/* Ranges each connection may fetch ahead of the writer */
+#define PIPELINE_SLOTS_PER_JOB 2
+
+static void *
+pipeline_reader(void *arg)
+{
+	ShpDumperJob *job = arg;
+	ShpDumperPipeline *p = job->pipeline;
+
+	pthread_mutex_lock(&p->lock);
+	for (;;)
+	{
+		ShpDumperSlot *slot;
+		int range;
+
+		while (!p->stop && p->next_fetch < p->num_ranges && p->next_fetch >= p->next_write + p->num_slots)
+			pthread_cond_wait(&p->can_fetch, &p->lock);
+
+		if (p->stop || p->next_fetch == p->num_ranges)
+			break;
+
+		range = p->next_fetch++;
+		slot = &p->slots[range % p->num_slots];
+		pthread_mutex_unlock(&p->lock);
+
+		slot->ret = ShpDumperFetchRange(&job->reader, range, &slot->range);
+		if (slot->ret != SHPDUMPEROK)
+			memcpy(slot->message, job->reader.message, SHPDUMPERMSGLEN);
+
+		pthread_mutex_lock(&p->lock);
+		slot->done = 1;
+		pthread_cond_signal(&p->can_write);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+/*
+ * Fetch and decode key ranges on jobs connections and write them from this
+ * thread in range order, so the shapefile matches a single cursor dump.
+ */
+static int
+write_ranges_parallel(SHPDUMPERSTATE *state, int jobs)
+{
+	ShpDumperPipeline p;
+	ShpDumperJob *job;
+	pthread_t *readers;
+	int i, j, started = 0, ok = 1;
+
+	memset(&p, 0, sizeof(p));
+	p.state = state;
+	p.num_ranges = ShpDumperGetRangeCount(state);
+	p.num_slots = jobs * PIPELINE_SLOTS_PER_JOB;
+	p.slots = calloc(p.num_slots, sizeof(ShpDumperSlot));
+	job = calloc(jobs, sizeof(ShpDumperJob));
+	readers = calloc(jobs, sizeof(pthread_t));
+	if (!p.slots || !job || !readers)
+	{
+		fprintf(stderr, "%s\n", _("Out of memory allocating the dump pipeline"));
+		free(readers);
+		free(job);
+		free(p.slots);
+		return 0;
+	}
+
+	for (i = 0; i < jobs; i++)
+	{
+		job[i].pipeline = &p;
+		if (ShpDumperConnectReader(state, &job[i].reader) != SHPDUMPEROK)
+		{
+			fprintf(stderr, "%s\n", job[i].reader.message);
+			ok = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.can_fetch, NULL);
+	pthread_cond_init(&p.can_write, NULL);
+
+	for (; started < jobs && ok; started++)
+	{
+		if (pthread_create(&readers[started], NULL, pipeline_reader, &job[started]) != 0)
+		{
+			fprintf(stderr, _("Unable to start reader thread %d\n"), started + 1);
+			ok = 0;
+			break;
+		}
+	}
+
+	for (i = 0; i < p.num_ranges && ok; i++)
+	{
+		ShpDumperSlot *slot = &p.slots[i % p.num_slots];
+
+		pthread_mutex_lock(&p.lock);
+		while (!slot->done)
+			pthread_cond_wait(&p.can_write, &p.lock);
+		pthread_mutex_unlock(&p.lock);
+
+		if (slot->ret != SHPDUMPEROK)
+		{
+			fprintf(stderr, "%s\n", slot->message);
+			ok = 0;
+		}
+
+		for (j = 0; j < slot->range.num_rows && ok; j++)
+		{
+			/* Mimic existing behaviour */
+			if (!state->config->quiet && !(state->currow % state->config->fetchsize))
+			{
+				fprintf(stdout, "X");
+				fflush(stdout);
+			}
+
+			if (ShpDumperWriteRangeRow(state, &slot->range, j) != SHPDUMPEROK)
+			{
+				fprintf(stderr, "%s\n", state->message);
+				ok = 0;
+			}
+		}
+		ShpDumperFreeRange(&slot->range);
+
+		pthread_mutex_lock(&p.lock);
+		slot->done = 0;
+		p.next_write = i + 1;
+		pthread_cond_broadcast(&p.can_fetch);
+		pthread_mutex_unlock(&p.lock);
+	}
+
+	/* On error, wake everybody up and let them drain */
+	pthread_mutex_lock(&p.lock);
+	p.stop = 1;
+	pthread_cond_broadcast(&p.can_fetch);
+	pthread_mutex_unlock(&p.lock);
+
+	for (i = 0; i < started; i++)
+		pthread_join(readers[i], NULL);
+
+	for (i = 0; i < p.num_slots; i++)
+		ShpDumperFreeRange(&p.slots[i].range);
+
+	for (i = 0; i < jobs; i++)
+		ShpDumperCloseReader(&job[i].reader);
+
+	pthread_cond_destroy(&p.can_write);
+	pthread_cond_destroy(&p.can_fetch);
+	pthread_mutex_destroy(&p.lock);
+	free(readers);
+	free(job);
+	free(p.slots);
+
+	return ok;
+}
+
+#endif /* HAVE_PTHREAD */
+
+static int
+write_rows(SHPDUMPERSTATE *state)
+{
+#ifdef HAVE_PTHREAD
+	if (ShpDumperGetRangeCount(state))
+		return write_ranges_parallel(state, state->config->jobs);
+#endif
+
+	return write_rows_serial(state);
+}
+
 static int
 is_user_query_argument(const char *argument)
 {
@@ -74,7 +313,7 @@ main(int argc, char **argv)
 	SHPDUMPERCONFIG *config;
 	SHPDUMPERSTATE *state;
 
-	int ret, c, i;
+	int ret, c;
 
 	/* If no options are specified, display usage */
 	if (argc == 1)
@@ -86,7 +325,7 @@ main(int argc, char **argv)
 	config = malloc(sizeof(SHPDUMPERCONFIG));
 	set_dumper_config_defaults(config);
 
-	while ((c = pgis_getopt(argc, argv, "bf:h:du:p:P:g:rkm:q")) != EOF)
+	while ((c = pgis_getopt(argc, argv, "bf:h:du:j:p:P:g:rkm:q")) != EOF)
 	{
 		switch (c)
 		{
@@ -127,6 +366,13 @@ main(int argc, char **argv)
 		case 'q':
 			config->quiet = 1;
 			break;
+		case 'j':
+			if (sscanf(pgis_optarg, "%d", &config->jobs) != 1 || config->jobs < 1)
+			{
+				fprintf(stderr, _("The -j parameter must be a positive number of connections\n"));
+				exit(1);
+			}
+			break;
 		default:
 			usage(pgis_optopt == '?' ? 0 : 1);
 		}
@@ -186,6 +432,14 @@ main(int argc, char **argv)
 		usage(1);
 	}
 
+#ifndef HAVE_PTHREAD
+	if (config->jobs > 1)
+	{
+		fprintf(stderr, _("Built without thread support, ignoring -j and dumping on one connection\n"));
+		config->jobs = 1;
+	}
+#endif
+
 	state = ShpDumperCreate(config);
 	if (!state)
 	{
@@ -234,25 +488,8 @@ main(int argc, char **argv)
 		fflush(stdout);
 	}
 
-	for (i = 0; i < ShpDumperGetRecordCount(state); i++)
-	{
-		/* Mimic existing behaviour */
-		if (!state->config->quiet && !(state->currow % state->config->fetchsize))
-		{
-			fprintf(stdout, "X");
-			fflush(stdout);
-		}
-
-		ret = ShpLoaderGenerateShapeRow(state);
-		if (ret != SHPDUMPEROK)
-		{
-			fprintf(stderr, "%s\n", state->message);
-			fflush(stderr);
-
-			if (ret == SHPDUMPERERR)
-				exit(1);
-		}
-	}
+	if (!write_rows(state))
+		exit(1);
 
 	if (!state->config->quiet)
 	{
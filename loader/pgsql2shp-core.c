@@ -69,9 +69,6 @@ static int numeric_typmod_scale(int typmod);
  */
 static char * goodDBFValue(char *in, char fieldType);
 
-/** @brief Binary to hexewkb conversion function */
-char *convert_bytes_to_hex(uint8_t *ewkb, size_t size);
-
 static char*
 core_asprintf(const char* format, ...) __attribute__ ((format (printf, 1, 2)));
 
@@ -769,19 +766,6 @@ goodDBFValue(char *in, char fieldType)
 	}
 }
 
-char *convert_bytes_to_hex(uint8_t *ewkb, size_t size)
-{
-	size_t i;
-	char *hexewkb;
-
-	/* Convert the byte stream to a hex string using liblwgeom's deparse_hex function */
-	hexewkb = malloc(size * 2 + 1);
-	for (i=0; i<size; ++i) deparse_hex(ewkb[i], &hexewkb[i * 2]);
-	hexewkb[size * 2] = '\0';
-
-	return hexewkb;
-}
-
 /**
  * @brief Creates ESRI .prj file for this shp output
  * 		It looks in the spatial_ref_sys table and outputs the srtext field for this data
@@ -1278,6 +1262,7 @@ set_dumper_config_defaults(SHPDUMPERCONFIG *config)
 	config->fetchsize = 100;
 	config->column_map_filename = NULL;
 	config->quiet = 0;
+	config->jobs = 1;
 }
 
 /* Create a new shapefile state object */
@@ -1310,6 +1295,10 @@ ShpDumperCreate(SHPDUMPERCONFIG *config)
 	state->pgfieldlens = NULL;
 	state->pgfieldtypmods = NULL;
 	state->generate_dbf_id = LW_FALSE;
+	state->snapshot = NULL;
+	state->range_query = NULL;
+	state->range_bounds = NULL;
+	state->num_ranges = 0;
 	state->message[0] = '\0';
 	colmap_init(&state->column_map);
 
@@ -1441,6 +1430,163 @@ ShpDumperConnectDatabase(SHPDUMPERSTATE *state)
 }
 
 
+/* Append the exported columns, geo* column last as _geoX, to a SELECT list */
+static void
+ShpDumperAppendSelectList(SHPDUMPERSTATE *state, stringbuffer_t *sb)
+{
+	char *quoted;
+	int i;
+
+	for (i = 0; i < state->fieldcount; i++)
+	{
+		/* Comma-separated column names */
+		if (i > 0) {
+			stringbuffer_append(sb, ",");
+		}
+
+		quoted = quote_identifier(state->pgfieldnames[i]);
+		if (state->config->binary)
+		{
+			stringbuffer_aprintf(sb, "%s::text", quoted);
+		}
+		else
+		{
+			stringbuffer_append(sb, quoted);
+		}
+		free(quoted);
+	}
+
+	/* If we found a valid geometry/geography column then use it */
+	if (state->geo_col_name)
+	{
+		/* If this is the (only) column, no need for the initial comma */
+		if (state->fieldcount > 0) {
+			stringbuffer_append(sb, ",");
+		}
+
+		/* Ask for WKB in the client byte order, so the coordinate arrays
+		   can be copied as-is rather than swapped value by value */
+		quoted = quote_identifier(state->geo_col_name);
+#ifndef WORDS_BIGENDIAN
+		if (state->pgis_major_version > 0) {
+			stringbuffer_aprintf(sb, "ST_asEWKB(ST_SetSRID(%s::geometry, 0), 'NDR') AS _geoX", quoted);
+		}
+		else
+		{
+			stringbuffer_aprintf(sb, "asbinary(%s::geometry, 'NDR') AS _geoX", quoted);
+		}
+#else
+		if (state->pgis_major_version > 0)
+		{
+			stringbuffer_aprintf(sb, "ST_AsEWKB(ST_SetSRID(%s::geometry, 0), 'XDR') AS _geoX", quoted);
+		}
+		else
+		{
+			stringbuffer_aprintf(sb, "asbinary(%s::geometry, 'XDR') AS _geoX", quoted);
+		}
+#endif
+		free(quoted);
+	}
+}
+
+/* Open a repeatable read transaction on the main connection and export its
+   snapshot, so the key range connections all see the rows it counts */
+static int
+ShpDumperExportSnapshot(SHPDUMPERSTATE *state)
+{
+	PGresult *res;
+
+	res = PQexec(state->conn, "BEGIN ISOLATION LEVEL REPEATABLE READ");
+	if (!res || PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		snprintf(state->message,
+		         SHPDUMPERMSGLEN,
+		         _("Error starting transaction: %s"),
+		         res ? PQresultErrorMessage(res) : PQerrorMessage(state->conn));
+		if (res)
+			PQclear(res);
+		return SHPDUMPERERR;
+	}
+	PQclear(res);
+
+	res = PQexec(state->conn, "SELECT pg_export_snapshot()");
+	if (!res || PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1)
+	{
+		snprintf(state->message,
+		         SHPDUMPERMSGLEN,
+		         _("Error exporting snapshot: %s"),
+		         res ? PQresultErrorMessage(res) : PQerrorMessage(state->conn));
+		if (res)
+			PQclear(res);
+		return SHPDUMPERERR;
+	}
+
+	state->snapshot = strdup(PQgetvalue(res, 0, 0));
+	PQclear(res);
+
+	return SHPDUMPEROK;
+}
+
+/*
+ * Split the "gid" values into key ranges of about the same number of rows.
+ * Range k holds the keys above bound k-1 up to bound k; the last range is
+ * open ended and also takes the NULL keys, which ORDER BY puts last.
+ */
+static int
+ShpDumperGetRangeBounds(SHPDUMPERSTATE *state)
+{
+	PGresult *res;
+	char *source, *query;
+	int num_ranges, range_rows, i;
+
+	num_ranges = state->config->jobs * SHPDUMPERRANGESPERJOB;
+	range_rows = state->rowcount / num_ranges + (state->rowcount % num_ranges ? 1 : 0);
+	if (range_rows < 1)
+		range_rows = 1;
+	if (range_rows > SHPDUMPERMAXRANGEROWS)
+		range_rows = SHPDUMPERMAXRANGEROWS;
+
+	source = ShpDumperGetDataSource(state, NULL);
+	if (!source)
+	{
+		snprintf(state->message, SHPDUMPERMSGLEN, _("Out of memory building key range query"));
+		return SHPDUMPERERR;
+	}
+
+	query = core_asprintf(
+	    "SELECT \"gid\"::text FROM (SELECT \"gid\", row_number() OVER (ORDER BY \"gid\") AS n "
+	    "FROM %s WHERE \"gid\" IS NOT NULL) AS r WHERE n %% %d = 0 ORDER BY n",
+	    source,
+	    range_rows);
+	free(source);
+
+	LWDEBUGF(3, "Key range query: %s\n", query);
+
+	res = PQexec(state->conn, query);
+	free(query);
+
+	if (!res || PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		snprintf(state->message,
+		         SHPDUMPERMSGLEN,
+		         _("Error splitting table into key ranges: %s"),
+		         res ? PQresultErrorMessage(res) : PQerrorMessage(state->conn));
+		if (res)
+			PQclear(res);
+		return SHPDUMPERERR;
+	}
+
+	state->range_bounds = malloc(sizeof(char *) * (PQntuples(res) + 1));
+	for (i = 0; i < PQntuples(res); i++)
+		state->range_bounds[i] = strdup(PQgetvalue(res, i, 0));
+	state->num_ranges = PQntuples(res) + 1;
+
+	PQclear(res);
+
+	return SHPDUMPEROK;
+}
+
+
 /* Open the specified table in preparation for extracting rows */
 int
 ShpDumperOpenTable(SHPDUMPERSTATE *state)
@@ -1452,7 +1598,6 @@ ShpDumperOpenTable(SHPDUMPERSTATE *state)
 	int ret = SHPDUMPEROK;
 	int fieldtuples;
 	stringbuffer_t sb;
-	char *quoted = NULL;
 
 	/* Open the column map if one was specified */
 	if (state->config->column_map_filename)
@@ -2003,6 +2148,25 @@ ShpDumperOpenTable(SHPDUMPERSTATE *state)
 		ret = SHPDUMPERWARN;
 	}
 
+	/* Several connections each read a key range of "gid". They share one
+	   snapshot, taken before counting, so the ranges add up to the count */
+	if (state->config->jobs > 1)
+	{
+		if (state->config->usrquery || !gidfound)
+		{
+			snprintf(buf, sizeof(buf), _("Warning: only tables with a gid column can be dumped over several connections, using one.\n"));
+			if (SHPDUMPERMSGLEN > (strlen(state->message) + 1))
+				strncat(state->message, buf, SHPDUMPERMSGLEN - (strlen(state->message) + 1));
+
+			ret = SHPDUMPERWARN;
+		}
+		else if (ShpDumperExportSnapshot(state) != SHPDUMPEROK)
+		{
+			PQclear(res);
+			return SHPDUMPERERR;
+		}
+	}
+
 	/* Now we have generated the field lists, grab some info about the table */
 	status = getTableInfo(state);
 	if (status == SHPDUMPERERR)
@@ -2057,71 +2221,32 @@ ShpDumperOpenTable(SHPDUMPERSTATE *state)
 
 	stringbuffer_init(&sb);
 
-	stringbuffer_append(&sb, "DECLARE cur ");
-	if (state->config->binary)
-		stringbuffer_append(&sb, "BINARY ");
-
-	if (state->config->usrquery)
+	if (state->snapshot)
 	{
-		/* A holdable cursor materializes the export rows at COMMIT, letting
-		 * us count and rewind the cursor without requiring CREATE TEMP
-		 * privileges or re-running the final user query. */
-		stringbuffer_append(&sb, "SCROLL CURSOR WITH HOLD FOR SELECT ");
+		/* Key ranges add their own WHERE clause, see ShpDumperFetchRange() */
+		stringbuffer_append(&sb, "SELECT ");
 	}
 	else
 	{
-		stringbuffer_append(&sb, "CURSOR FOR SELECT ");
-	}
-
-	for (i = 0; i < state->fieldcount; i++)
-	{
-		/* Comma-separated column names */
-		if (i > 0) {
-			stringbuffer_append(&sb, ",");
-		}
-
-		quoted = quote_identifier(state->pgfieldnames[i]);
+		stringbuffer_append(&sb, "DECLARE cur ");
 		if (state->config->binary)
-		{
-			stringbuffer_aprintf(&sb, "%s::text", quoted);
-		}
-		else
-		{
-			stringbuffer_append(&sb, quoted);
-		}
-		free(quoted);
-	}
-
-	/* If we found a valid geometry/geography column then use it */
-	if (state->geo_col_name)
-	{
-		/* If this is the (only) column, no need for the initial comma */
-		if (state->fieldcount > 0) {
-			stringbuffer_append(&sb, ",");
-		}
+			stringbuffer_append(&sb, "BINARY ");
 
-		quoted = quote_identifier(state->geo_col_name);
-#ifndef WORDS_BIGENDIAN
-		if (state->pgis_major_version > 0) {
-			stringbuffer_aprintf(&sb, "ST_asEWKB(ST_SetSRID(%s::geometry, 0), 'XDR') AS _geoX", quoted);
-		}
-		else
-		{
-			stringbuffer_aprintf(&sb, "asbinary(%s::geometry, 'XDR') AS _geoX", quoted);
-		}
-#else
-		if (state->pgis_major_version > 0)
+		if (state->config->usrquery)
 		{
-			stringbuffer_aprintf(&sb, "ST_AsEWKB(ST_SetSRID(%s::geometry, 0), 'NDR') AS _geoX", quoted);
+			/* A holdable cursor materializes the export rows at COMMIT, letting
+			 * us count and rewind the cursor without requiring CREATE TEMP
+			 * privileges or re-running the final user query. */
+			stringbuffer_append(&sb, "SCROLL CURSOR WITH HOLD FOR SELECT ");
 		}
 		else
 		{
-			stringbuffer_aprintf(&sb, "asbinary(%s::geometry, 'NDR') AS _geoX", quoted);
+			stringbuffer_append(&sb, "CURSOR FOR SELECT ");
 		}
-#endif
-		free(quoted);
 	}
 
+	ShpDumperAppendSelectList(state, &sb);
+
 	{
 		char *source = ShpDumperGetDataSource(state, NULL);
 		if (!source)
@@ -2135,6 +2260,26 @@ ShpDumperOpenTable(SHPDUMPERSTATE *state)
 		free(source);
 	}
 
+	/* The key ranges read the rows, there is no cursor to open */
+	if (state->snapshot)
+	{
+		PQclear(res);
+		state->range_query = stringbuffer_getstringcopy(&sb);
+		stringbuffer_release(&sb);
+
+		LWDEBUGF(3, "RANGE QUERY: %s\n", state->range_query);
+
+		if (ShpDumperGetRangeBounds(state) != SHPDUMPEROK)
+			return SHPDUMPERERR;
+
+		state->currow = 0;
+		state->curresrow = 0;
+		state->currescount = 0;
+		state->fetchres = NULL;
+
+		return ret;
+	}
+
 	/* Order by 'gid' (if found) */
 	if (gidfound)
 	{
@@ -2237,56 +2382,126 @@ ShpDumperOpenTable(SHPDUMPERSTATE *state)
 }
 
 
-/* Append the next row to the output shapefile */
-int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state)
+/*
+ * Decode the geo* value of a fetched row into the shape to write for it.
+ * Only reads the dumper state and reports through message, so it may run
+ * on several rows at once.
+ */
+static int
+ShpDumperDecodeShape(SHPDUMPERSTATE *state, PGresult *res, int row, int geocolnum, int recno, SHPObject **obj, char *message)
 {
-	char *hexewkb = NULL;
-	unsigned char *hexewkb_binary = NULL;
-	size_t hexewkb_len;
+	unsigned char *wkb_unescaped = NULL;
+	size_t wkb_len;
 	char *val;
-	SHPObject *obj = NULL;
 	LWGEOM *lwgeom;
 
-	int i, geocolnum = 0;
+	*obj = NULL;
 
-	/* If we try to go pass the end of the table, fail immediately */
-	if (state->currow > state->rowcount)
+	/* Handle NULL shapes */
+	if (PQgetisnull(res, row, geocolnum))
 	{
-		snprintf(state->message, SHPDUMPERMSGLEN, _("Tried to read past end of table!"));
-		PQclear(state->fetchres);
-		return SHPDUMPERERR;
+		*obj = SHPCreateSimpleObject(SHPT_NULL, 0, NULL, NULL, NULL);
+		return SHPDUMPEROK;
 	}
 
-	/* If we have reached the end of the current batch, fetch a new one */
-	if (state->curresrow == state->currescount && state->currow < state->rowcount)
+	/* Get the value from the result set */
+	val = PQgetvalue(res, row, geocolnum);
+
+	if (!state->config->binary)
 	{
-		/* Clear the previous batch results */
-		if (state->fetchres)
-			PQclear(state->fetchres);
+		if (state->pgis_major_version > 0)
+		{
+			LWDEBUG(4, "PostGIS >= 1.0, non-binary cursor");
 
-		state->fetchres = PQexec(state->conn, state->fetch_query);
-		if (!state->fetchres || PQresultStatus(state->fetchres) != PGRES_TUPLES_OK)
+			/* Input is bytea encoded text field, so it must be unescaped
+			into the raw WKB bytes */
+			wkb_unescaped = PQunescapeBytea((unsigned char *)val, &wkb_len);
+			lwgeom = wkb_unescaped ? lwgeom_from_wkb(wkb_unescaped, wkb_len, LW_PARSER_CHECK_NONE) : NULL;
+		}
+		else
 		{
-			snprintf(state->message,
-			         SHPDUMPERMSGLEN,
-			         _("Error executing fetch query: %s"),
-			         state->fetchres ? PQresultErrorMessage(state->fetchres) : PQerrorMessage(state->conn));
-			if (state->fetchres)
-				PQclear(state->fetchres);
-			state->fetchres = NULL;
-			return SHPDUMPERERR;
+			LWDEBUG(4, "PostGIS < 1.0, non-binary cursor");
+
+			/* Input is already hexewkb string */
+			lwgeom = lwgeom_from_hexwkb(val, LW_PARSER_CHECK_NONE);
 		}
+	}
+	else /* binary */
+	{
+		LWDEBUG(4, "PostGIS (any version) using binary cursor");
 
-		state->curresrow = 0;
-		state->currescount = PQntuples(state->fetchres);
+		/* Input is the raw WKB, parse it in place */
+		wkb_len = PQgetlength(res, row, geocolnum);
+		lwgeom = lwgeom_from_wkb((uint8_t *)val, wkb_len, LW_PARSER_CHECK_NONE);
 	}
 
-	/* Grab the id of the geo column if we have one */
-	if (state->geo_col_name)
-		geocolnum = PQfnumber(state->fetchres, "_geoX");
+	if (!lwgeom)
+	{
+		snprintf(message, SHPDUMPERMSGLEN, _("Error parsing WKB for record %d"), recno);
+		if (wkb_unescaped) PQfreemem(wkb_unescaped);
+		return SHPDUMPERERR;
+	}
+
+	/* Call the relevant method depending upon the geometry type */
+	LWDEBUGF(4, "geomtype: %s\n", lwtype_name(lwgeom->type));
+
+	switch (lwgeom->type)
+	{
+	case POINTTYPE:
+		if (lwgeom_is_empty(lwgeom))
+		{
+			*obj = create_point_empty(state, lwgeom_as_lwpoint(lwgeom));
+		}
+		else
+		{
+			*obj = create_point(state, lwgeom_as_lwpoint(lwgeom));
+		}
+		break;
+
+	case MULTIPOINTTYPE:
+		*obj = create_multipoint(state, lwgeom_as_lwmpoint(lwgeom));
+		break;
+
+	case POLYGONTYPE:
+		*obj = create_polygon(state, lwgeom_as_lwpoly(lwgeom));
+		break;
+
+	case MULTIPOLYGONTYPE:
+		*obj = create_multipolygon(state, lwgeom_as_lwmpoly(lwgeom));
+		break;
+
+	case LINETYPE:
+		*obj = create_linestring(state, lwgeom_as_lwline(lwgeom));
+		break;
+
+	case MULTILINETYPE:
+		*obj = create_multilinestring(state, lwgeom_as_lwmline(lwgeom));
+		break;
+
+	default:
+		snprintf(message, SHPDUMPERMSGLEN, _("Unknown WKB type (%d) for record %d"), lwgeom->type, recno);
+		lwgeom_free(lwgeom);
+		if (wkb_unescaped) PQfreemem(wkb_unescaped);
+		return SHPDUMPERERR;
+	}
 
-	/* Process the next record within the batch. First write out all of
-	the non-geo fields */
+	/* Free both the original and geometries */
+	lwgeom_free(lwgeom);
+
+	/* Free the temporary bytea unescaped string if used */
+	if (wkb_unescaped) PQfreemem(wkb_unescaped);
+
+	return SHPDUMPEROK;
+}
+
+/* Write a fetched row, with its decoded shape, as record state->currow */
+static int
+ShpDumperWriteRow(SHPDUMPERSTATE *state, PGresult *res, int row, SHPObject *obj)
+{
+	char *val;
+	int i;
+
+	/* First write out all of the non-geo fields */
 	for (i = 0; i < state->fieldcount; i++)
 	{
 		/*
@@ -2296,13 +2511,13 @@ int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state)
 		* nulls unless paying the acquisition
 		* of a bug in long integer values
 		*/
-		if (PQgetisnull(state->fetchres, state->curresrow, i))
+		if (PQgetisnull(res, row, i))
 		{
 			val = nullDBFValue(state->dbffieldtypes[i]);
 		}
 		else
 		{
-			val = PQgetvalue(state->fetchres, state->curresrow, i);
+			val = PQgetvalue(res, row, i);
 			val = goodDBFValue(val, state->dbffieldtypes[i]);
 		}
 
@@ -2310,7 +2525,6 @@ int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state)
 		if (!DBFWriteAttributeDirectly(state->dbf, state->currow, i, val))
 		{
 			snprintf(state->message, SHPDUMPERMSGLEN, _("Error: record %d could not be created"), state->currow);
-			PQclear(state->fetchres);
 			return SHPDUMPERERR;
 		}
 	}
@@ -2323,151 +2537,286 @@ int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state)
 				 SHPDUMPERMSGLEN,
 				 _("Error: generated GID for record %d could not be created"),
 				 state->currow);
-			PQclear(state->fetchres);
 			return SHPDUMPERERR;
 		}
 	}
 
-	/* Now process the geo field, if present */
-	if (state->geo_col_name)
+	/* Now write the shape out to the file, if there is a geo field */
+	if (state->geo_col_name && SHPWriteObject(state->shp, -1, obj) == -1)
+	{
+		if (obj->nSHPType == SHPT_NULL)
+			snprintf(state->message, SHPDUMPERMSGLEN, _("Error writing NULL shape for record %d"), state->currow);
+		else
+			snprintf(state->message, SHPDUMPERMSGLEN, _("Error writing shape %d"), state->currow);
+		return SHPDUMPERERR;
+	}
+
+	return SHPDUMPEROK;
+}
+
+/* Append the next row to the output shapefile */
+int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state)
+{
+	SHPObject *obj = NULL;
+	int ret;
+
+	/* If we try to go pass the end of the table, fail immediately */
+	if (state->currow > state->rowcount)
 	{
-		/* Handle NULL shapes */
-		if (PQgetisnull(state->fetchres, state->curresrow, geocolnum))
+		snprintf(state->message, SHPDUMPERMSGLEN, _("Tried to read past end of table!"));
+		PQclear(state->fetchres);
+		return SHPDUMPERERR;
+	}
+
+	/* If we have reached the end of the current batch, fetch a new one */
+	if (state->curresrow == state->currescount && state->currow < state->rowcount)
+	{
+		/* Clear the previous batch results */
+		if (state->fetchres)
+			PQclear(state->fetchres);
+
+		state->fetchres = PQexec(state->conn, state->fetch_query);
+		if (!state->fetchres || PQresultStatus(state->fetchres) != PGRES_TUPLES_OK)
 		{
-			obj = SHPCreateSimpleObject(SHPT_NULL, 0, NULL, NULL, NULL);
-			if (SHPWriteObject(state->shp, -1, obj) == -1)
-			{
-				snprintf(state->message, SHPDUMPERMSGLEN, _("Error writing NULL shape for record %d"), state->currow);
+			snprintf(state->message,
+			         SHPDUMPERMSGLEN,
+			         _("Error executing fetch query: %s"),
+			         state->fetchres ? PQresultErrorMessage(state->fetchres) : PQerrorMessage(state->conn));
+			if (state->fetchres)
 				PQclear(state->fetchres);
-				SHPDestroyObject(obj);
-				return SHPDUMPERERR;
-			}
-			SHPDestroyObject(obj);
+			state->fetchres = NULL;
+			return SHPDUMPERERR;
 		}
-		else
+
+		state->curresrow = 0;
+		state->currescount = PQntuples(state->fetchres);
+	}
+
+	/* Decode the geo field of the next record within the batch, if present */
+	if (state->geo_col_name)
+	{
+		int geocolnum = PQfnumber(state->fetchres, "_geoX");
+
+		if (ShpDumperDecodeShape(state, state->fetchres, state->curresrow, geocolnum, state->currow, &obj, state->message) != SHPDUMPEROK)
 		{
-			/* Get the value from the result set */
-			val = PQgetvalue(state->fetchres, state->curresrow, geocolnum);
+			PQclear(state->fetchres);
+			return SHPDUMPERERR;
+		}
+	}
 
-			if (!state->config->binary)
-			{
-				if (state->pgis_major_version > 0)
-				{
-					LWDEBUG(4, "PostGIS >= 1.0, non-binary cursor");
+	ret = ShpDumperWriteRow(state, state->fetchres, state->curresrow, obj);
+	if (obj)
+		SHPDestroyObject(obj);
 
-					/* Input is bytea encoded text field, so it must be unescaped and
-					then converted to hexewkb string */
-					hexewkb_binary = PQunescapeBytea((unsigned char *)val, &hexewkb_len);
-					hexewkb = convert_bytes_to_hex(hexewkb_binary, hexewkb_len);
-				}
-				else
-				{
-					LWDEBUG(4, "PostGIS < 1.0, non-binary cursor");
+	if (ret != SHPDUMPEROK)
+	{
+		PQclear(state->fetchres);
+		return SHPDUMPERERR;
+	}
 
-					/* Input is already hexewkb string, so we can just
-					copy directly to hexewkb */
-					hexewkb_len = PQgetlength(state->fetchres, state->curresrow, geocolnum);
-					hexewkb = malloc(hexewkb_len + 1);
-					strncpy(hexewkb, val, hexewkb_len + 1);
-				}
-			}
-			else /* binary */
-			{
-				LWDEBUG(4, "PostGIS (any version) using binary cursor");
+	/* Increment ready for next time */
+	state->curresrow++;
+	state->currow++;
 
-				/* Input is binary field - must convert to hexewkb string */
-				hexewkb_len = PQgetlength(state->fetchres, state->curresrow, geocolnum);
-				hexewkb = convert_bytes_to_hex((unsigned char *)val, hexewkb_len);
-			}
+	return SHPDUMPEROK;
+}
 
-			LWDEBUGF(4, "HexEWKB - length: %lu  value: %s", strlen(hexewkb), hexewkb);
 
-			/* Deserialize the LWGEOM */
-			lwgeom = lwgeom_from_hexwkb(hexewkb, LW_PARSER_CHECK_NONE);
-			if (!lwgeom)
-			{
-				snprintf(state->message, SHPDUMPERMSGLEN, _("Error parsing HEXEWKB for record %d"), state->currow);
-				PQclear(state->fetchres);
-				free(hexewkb);
-				return SHPDUMPERERR;
-			}
+/* Return a count of the number of rows in the table being dumped */
+int
+ShpDumperGetRecordCount(SHPDUMPERSTATE *state)
+{
+	return state->rowcount;
+}
 
-			/* Call the relevant method depending upon the geometry type */
-			LWDEBUGF(4, "geomtype: %s\n", lwtype_name(lwgeom->type));
 
-			switch (lwgeom->type)
-			{
-			case POINTTYPE:
-				if (lwgeom_is_empty(lwgeom))
-				{
-					obj = create_point_empty(state, lwgeom_as_lwpoint(lwgeom));
-				}
-				else
-				{
-					obj = create_point(state, lwgeom_as_lwpoint(lwgeom));
-				}
-				break;
+/* Return the number of key ranges to fetch, 0 when dumping through a single cursor */
+int
+ShpDumperGetRangeCount(SHPDUMPERSTATE *state)
+{
+	return state->num_ranges;
+}
 
-			case MULTIPOINTTYPE:
-				obj = create_multipoint(state, lwgeom_as_lwmpoint(lwgeom));
-				break;
 
-			case POLYGONTYPE:
-				obj = create_polygon(state, lwgeom_as_lwpoly(lwgeom));
-				break;
+/* Open a connection reading key ranges from the snapshot of the dumper */
+int
+ShpDumperConnectReader(SHPDUMPERSTATE *state, SHPDUMPERREADER *reader)
+{
+	PGresult *res;
+	char *connstring, *snapshot, *query;
 
-			case MULTIPOLYGONTYPE:
-				obj = create_multipolygon(state, lwgeom_as_lwmpoly(lwgeom));
-				break;
+	reader->state = state;
+	reader->message[0] = '\0';
 
-			case LINETYPE:
-				obj = create_linestring(state, lwgeom_as_lwline(lwgeom));
-				break;
+	connstring = ShpDumperGetConnectionStringFromConn(state->config->conn);
+	reader->conn = PQconnectdb(connstring);
+	free(connstring);
+	if (PQstatus(reader->conn) == CONNECTION_BAD)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, "%s", PQerrorMessage(reader->conn));
+		return SHPDUMPERERR;
+	}
 
-			case MULTILINETYPE:
-				obj = create_multilinestring(state, lwgeom_as_lwmline(lwgeom));
-				break;
+	/* Same settings as the main connection, then join its snapshot */
+	res = PQexec(reader->conn, "SET DATESTYLE='ISO'");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, "%s", PQresultErrorMessage(res));
+		PQclear(res);
+		return SHPDUMPERERR;
+	}
+	PQclear(res);
 
-			default:
-				snprintf(state->message, SHPDUMPERMSGLEN, _("Unknown WKB type (%d) for record %d"), lwgeom->type, state->currow);
-				PQclear(state->fetchres);
-				SHPDestroyObject(obj);
-				return SHPDUMPERERR;
-			}
+	res = PQexec(reader->conn, "BEGIN ISOLATION LEVEL REPEATABLE READ");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, _("Error starting transaction: %s"), PQresultErrorMessage(res));
+		PQclear(res);
+		return SHPDUMPERERR;
+	}
+	PQclear(res);
 
-			/* Free both the original and geometries */
-			lwgeom_free(lwgeom);
+	snapshot = PQescapeLiteral(reader->conn, state->snapshot, strlen(state->snapshot));
+	if (!snapshot)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, "%s", PQerrorMessage(reader->conn));
+		return SHPDUMPERERR;
+	}
+	query = core_asprintf("SET TRANSACTION SNAPSHOT %s", snapshot);
+	PQfreemem(snapshot);
 
-			/* Write the shape out to the file */
-			if (SHPWriteObject(state->shp, -1, obj) == -1)
-			{
-				snprintf(state->message, SHPDUMPERMSGLEN, _("Error writing shape %d"), state->currow);
-				PQclear(state->fetchres);
-				SHPDestroyObject(obj);
-				return SHPDUMPERERR;
-			}
+	res = PQexec(reader->conn, query);
+	free(query);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, _("Error importing snapshot: %s"), PQresultErrorMessage(res));
+		PQclear(res);
+		return SHPDUMPERERR;
+	}
+	PQclear(res);
 
-			SHPDestroyObject(obj);
+	return SHPDUMPEROK;
+}
 
-			/* Free the hexewkb (and temporary bytea unescaped string if used) */
-			if (hexewkb) free(hexewkb);
-			if (hexewkb_binary) PQfreemem(hexewkb_binary);
-		}
+
+/* Fetch the rows of a key range, in "gid" order, and decode their shapes */
+int
+ShpDumperFetchRange(SHPDUMPERREADER *reader, int range, SHPDUMPERRANGE *out)
+{
+	SHPDUMPERSTATE *state = reader->state;
+	const char *params[2];
+	int nparams = 0;
+	const char *where;
+	char *query;
+	int i, geocolnum;
+
+	out->res = NULL;
+	out->shapes = NULL;
+	out->num_rows = 0;
+
+	if (state->num_ranges == 1)
+		where = "";
+	else if (range == 0)
+		where = " WHERE \"gid\" <= $1";
+	else if (range == state->num_ranges - 1)
+		where = " WHERE \"gid\" > $1 OR \"gid\" IS NULL";
+	else
+		where = " WHERE \"gid\" > $1 AND \"gid\" <= $2";
+
+	if (range > 0)
+		params[nparams++] = state->range_bounds[range - 1];
+	if (range < state->num_ranges - 1)
+		params[nparams++] = state->range_bounds[range];
+
+	/* The bounds are sent as text and take the type of "gid" */
+	query = core_asprintf("%s%s ORDER BY \"gid\"", state->range_query, where);
+	out->res = PQexecParams(reader->conn, query, nparams, NULL, params, NULL, NULL, state->config->binary);
+	free(query);
+
+	if (!out->res || PQresultStatus(out->res) != PGRES_TUPLES_OK)
+	{
+		snprintf(reader->message,
+		         SHPDUMPERMSGLEN,
+		         _("Error fetching key range %d: %s"),
+		         range,
+		         out->res ? PQresultErrorMessage(out->res) : PQerrorMessage(reader->conn));
+		ShpDumperFreeRange(out);
+		return SHPDUMPERERR;
 	}
 
-	/* Increment ready for next time */
-	state->curresrow++;
-	state->currow++;
+	out->num_rows = PQntuples(out->res);
+
+	if (!state->geo_col_name || !out->num_rows)
+		return SHPDUMPEROK;
+
+	out->shapes = calloc(out->num_rows, sizeof(SHPObject *));
+	if (!out->shapes)
+	{
+		snprintf(reader->message, SHPDUMPERMSGLEN, _("Out of memory decoding key range %d"), range);
+		ShpDumperFreeRange(out);
+		return SHPDUMPERERR;
+	}
+
+	geocolnum = PQfnumber(out->res, "_geoX");
+	for (i = 0; i < out->num_rows; i++)
+	{
+		if (ShpDumperDecodeShape(state, out->res, i, geocolnum, i, &out->shapes[i], reader->message) != SHPDUMPEROK)
+		{
+			size_t len = strlen(reader->message);
+			snprintf(reader->message + len, SHPDUMPERMSGLEN - len, _(" of key range %d"), range);
+			ShpDumperFreeRange(out);
+			return SHPDUMPERERR;
+		}
+	}
 
 	return SHPDUMPEROK;
 }
 
 
-/* Return a count of the number of rows in the table being dumped */
+/* Append a row of a fetched key range to the output shapefile */
 int
-ShpDumperGetRecordCount(SHPDUMPERSTATE *state)
+ShpDumperWriteRangeRow(SHPDUMPERSTATE *state, SHPDUMPERRANGE *range, int row)
 {
-	return state->rowcount;
+	int ret = ShpDumperWriteRow(state, range->res, row, range->shapes ? range->shapes[row] : NULL);
+
+	if (ret == SHPDUMPEROK)
+		state->currow++;
+
+	return ret;
+}
+
+
+void
+ShpDumperFreeRange(SHPDUMPERRANGE *range)
+{
+	int i;
+
+	if (range->shapes)
+	{
+		for (i = 0; i < range->num_rows; i++)
+		{
+			if (range->shapes[i])
+				SHPDestroyObject(range->shapes[i]);
+		}
+		free(range->shapes);
+	}
+
+	if (range->res)
+		PQclear(range->res);
+
+	range->res = NULL;
+	range->shapes = NULL;
+	range->num_rows = 0;
+}
+
+
+void
+ShpDumperCloseReader(SHPDUMPERREADER *reader)
+{
+	if (reader->conn)
+		PQfinish(reader->conn);
+
+	reader->conn = NULL;
 }
 
 
@@ -2509,6 +2858,16 @@ ShpDumperDestroy(SHPDUMPERSTATE *state)
 		/* Free the query strings */
 		free(state->fetch_query);
 		free(state->main_scan_query);
+		free(state->range_query);
+		free(state->snapshot);
+
+		/* Free the key range bounds */
+		if (state->range_bounds)
+		{
+			for (i = 0; i < state->num_ranges - 1; i++)
+				free(state->range_bounds[i]);
+			free(state->range_bounds);
+		}
 
 		/* Free the DBF information fields */
 		if (state->dbffieldnames)
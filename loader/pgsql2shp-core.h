@@ -42,6 +42,14 @@
 #define SHPDUMPERERR		0
 #define SHPDUMPERWARN		1
 
+/*
+ * Splitting a dump into key ranges: aim for this many ranges per connection,
+ * so a slow range does not hold up the others, but keep each range small
+ * enough to be held in memory while it waits for the writer
+ */
+#define SHPDUMPERRANGESPERJOB	4
+#define SHPDUMPERMAXRANGEROWS	10000
+
 
 /*
  * Structure to hold the dumper configuration options
@@ -91,6 +99,9 @@ typedef struct shp_dumper_config
 	/* 0=normal output to stdout, 1=no output to stdout */
 	int quiet;
 
+	/* Number of connections reading key ranges of the table, 1=single cursor */
+	int jobs;
+
 } SHPDUMPERCONFIG;
 
 
@@ -190,9 +201,59 @@ typedef struct shp_dumper_state
 	/* Column map */
 	colmap column_map;
 
+	/* Snapshot exported to the key range connections, NULL for a single cursor */
+	char *snapshot;
+
+	/* Query selecting the rows of a key range, without its WHERE clause */
+	char *range_query;
+
+	/* Upper "gid" bound (as text) of every key range but the last */
+	char **range_bounds;
+
+	/* Number of key ranges, 0 when dumping through a single cursor */
+	int num_ranges;
+
 } SHPDUMPERSTATE;
 
 
+/*
+ * A key range fetched on its own connection, with its shapes already
+ * decoded, waiting to be appended to the shapefile in order
+ */
+
+typedef struct shp_dumper_range
+{
+	/* Rows of the range as returned by the server */
+	PGresult *res;
+
+	/* Decoded shape of every row, NULL if there is no geo* column */
+	SHPObject **shapes;
+
+	/* Number of rows in the range */
+	int num_rows;
+
+} SHPDUMPERRANGE;
+
+
+/*
+ * A connection fetching key ranges for a dumper. Readers only read the
+ * dumper state, so several of them can fetch and decode at once.
+ */
+
+typedef struct shp_dumper_reader
+{
+	/* Dumper this reader fetches rows for */
+	SHPDUMPERSTATE *state;
+
+	/* Database connection used by this reader */
+	PGconn *conn;
+
+	/* Last (error) message */
+	char message[SHPDUMPERMSGLEN];
+
+} SHPDUMPERREADER;
+
+
 /* Externally accessible functions */
 void set_dumper_config_defaults(SHPDUMPERCONFIG *config);
 char *shapetypename(int num);
@@ -203,6 +264,12 @@ int ShpDumperConnectDatabase(SHPDUMPERSTATE *state);
 int ShpDumperOpenTable(SHPDUMPERSTATE *state);
 int ShpDumperGetRecordCount(SHPDUMPERSTATE *state);
 int ShpLoaderGenerateShapeRow(SHPDUMPERSTATE *state);
+int ShpDumperGetRangeCount(SHPDUMPERSTATE *state);
+int ShpDumperConnectReader(SHPDUMPERSTATE *state, SHPDUMPERREADER *reader);
+int ShpDumperFetchRange(SHPDUMPERREADER *reader, int range, SHPDUMPERRANGE *out);
+int ShpDumperWriteRangeRow(SHPDUMPERSTATE *state, SHPDUMPERRANGE *range, int row);
+void ShpDumperFreeRange(SHPDUMPERRANGE *range);
+void ShpDumperCloseReader(SHPDUMPERREADER *reader);
 int ShpDumperCloseTable(SHPDUMPERSTATE *state);
 void ShpDumperDestroy(SHPDUMPERSTATE *state);
 char *quote_identifier(const char *s);
@@ -76,6 +76,15 @@
 
 SHP_CVSID("$Id$");
 
+#ifdef SHPAPI_MMAP_HOOKS
+#   include <stdint.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#endif
+
 #ifdef SHPAPI_UTF8_HOOKS
 #   ifdef SHPAPI_WINDOWS
 #       define WIN32_LEAN_AND_MEAN
@@ -303,3 +312,250 @@ void SASetupUtf8Hooks( SAHooks *psHooks )
 }
 
 #endif
+
+#ifdef SHPAPI_MMAP_HOOKS
+
+/************************************************************************/
+/*                             SAMmapFile                               */
+/*                                                                      */
+/*      Read-only files are mapped into memory in one go, so that the   */
+/*      per-record seek and read calls issued by shpopen.c and          */
+/*      dbfopen.c become plain memcpy()s instead of system calls.       */
+/*      Files opened for writing, or that cannot be mapped, fall back   */
+/*      to stdio.                                                       */
+/************************************************************************/
+
+typedef struct
+{
+    unsigned char *pabyData;
+    size_t         nSize;
+    size_t         nPos;
+    FILE          *fp;
+} SAMmapFile;
+
+/************************************************************************/
+/*                            SAMmapFOpen()                             */
+/************************************************************************/
+
+static
+SAFile SAMmapFOpen( const char *pszFilename, const char *pszAccess )
+
+{
+    SAMmapFile *psFile;
+    struct stat sStat;
+    int fd;
+
+    psFile = (SAMmapFile *) calloc( 1, sizeof(SAMmapFile) );
+    if( psFile == NULL )
+        return NULL;
+
+    if( strchr( pszAccess, 'w' ) || strchr( pszAccess, '+' )
+        || strchr( pszAccess, 'a' ) )
+    {
+        psFile->fp = fopen( pszFilename, pszAccess );
+        if( psFile->fp == NULL )
+        {
+            free( psFile );
+            return NULL;
+        }
+        return (SAFile) psFile;
+    }
+
+    fd = open( pszFilename, O_RDONLY );
+    if( fd < 0 )
+    {
+        free( psFile );
+        return NULL;
+    }
+
+    if( fstat( fd, &sStat ) == 0 && S_ISREG( sStat.st_mode )
+        && sStat.st_size > 0 && (uint64_t) sStat.st_size <= SIZE_MAX )
+    {
+        void *pData = mmap( NULL, (size_t) sStat.st_size, PROT_READ,
+                            MAP_PRIVATE, fd, 0 );
+        if( pData != MAP_FAILED )
+        {
+            psFile->pabyData = (unsigned char *) pData;
+            psFile->nSize = (size_t) sStat.st_size;
+#ifdef MADV_WILLNEED
+            madvise( pData, psFile->nSize, MADV_WILLNEED );
+#endif
+        }
+    }
+
+    /* Empty, special or unmappable file: read it through stdio */
+    if( psFile->pabyData == NULL )
+    {
+        psFile->fp = fdopen( fd, "rb" );
+        if( psFile->fp == NULL )
+        {
+            close( fd );
+            free( psFile );
+            return NULL;
+        }
+        return (SAFile) psFile;
+    }
+
+    /* The mapping stays valid after the descriptor is closed */
+    close( fd );
+    return (SAFile) psFile;
+}
+
+/************************************************************************/
+/*                            SAMmapFRead()                             */
+/************************************************************************/
+
+static
+SAOffset SAMmapFRead( void *p, SAOffset size, SAOffset nmemb, SAFile file )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+    size_t nAvail, nItems;
+
+    if( psFile->fp )
+        return (SAOffset) fread( p, (size_t) size, (size_t) nmemb,
+                                 psFile->fp );
+
+    if( size == 0 || nmemb == 0 || psFile->nPos >= psFile->nSize )
+        return 0;
+
+    nAvail = psFile->nSize - psFile->nPos;
+    nItems = (size_t) nmemb;
+    if( nItems > nAvail / (size_t) size )
+        nItems = nAvail / (size_t) size;
+
+    memcpy( p, psFile->pabyData + psFile->nPos, nItems * (size_t) size );
+    psFile->nPos += nItems * (size_t) size;
+
+    return (SAOffset) nItems;
+}
+
+/************************************************************************/
+/*                            SAMmapFWrite()                            */
+/************************************************************************/
+
+static
+SAOffset SAMmapFWrite( void *p, SAOffset size, SAOffset nmemb, SAFile file )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+
+    /* Mapped files are always read-only */
+    if( psFile->fp == NULL || !nmemb || !p )
+        return 0;
+
+    return (SAOffset) fwrite( p, (size_t) size, (size_t) nmemb,
+                              psFile->fp );
+}
+
+/************************************************************************/
+/*                            SAMmapFSeek()                             */
+/************************************************************************/
+
+static
+SAOffset SAMmapFSeek( SAFile file, SAOffset offset, int whence )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+    long nOffset = (long) offset;
+    long nBase;
+
+    if( psFile->fp )
+        return (SAOffset) fseek( psFile->fp, nOffset, whence );
+
+    switch( whence )
+    {
+        case SEEK_SET:
+            nBase = 0;
+            break;
+        case SEEK_CUR:
+            nBase = (long) psFile->nPos;
+            break;
+        case SEEK_END:
+            nBase = (long) psFile->nSize;
+            break;
+        default:
+            return (SAOffset) -1;
+    }
+
+    /* Like fseek(), positioning past the end is allowed */
+    if( nOffset < -nBase )
+        return (SAOffset) -1;
+
+    psFile->nPos = (size_t) (nBase + nOffset);
+    return 0;
+}
+
+/************************************************************************/
+/*                            SAMmapFTell()                             */
+/************************************************************************/
+
+static
+SAOffset SAMmapFTell( SAFile file )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+
+    if( psFile->fp )
+        return (SAOffset) ftell( psFile->fp );
+
+    return (SAOffset) psFile->nPos;
+}
+
+/************************************************************************/
+/*                            SAMmapFFlush()                            */
+/************************************************************************/
+
+static
+int SAMmapFFlush( SAFile file )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+
+    if( psFile->fp )
+        return fflush( psFile->fp );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                            SAMmapFClose()                            */
+/************************************************************************/
+
+static
+int SAMmapFClose( SAFile file )
+
+{
+    SAMmapFile *psFile = (SAMmapFile *) file;
+    int nRet = 0;
+
+    if( psFile->fp )
+        nRet = fclose( psFile->fp );
+    else if( psFile->pabyData )
+        nRet = munmap( psFile->pabyData, psFile->nSize );
+
+    free( psFile );
+    return nRet;
+}
+
+/************************************************************************/
+/*                          SASetupMmapHooks()                          */
+/************************************************************************/
+
+void SASetupMmapHooks( SAHooks *psHooks )
+
+{
+    psHooks->FOpen   = SAMmapFOpen;
+    psHooks->FRead   = SAMmapFRead;
+    psHooks->FWrite  = SAMmapFWrite;
+    psHooks->FSeek   = SAMmapFSeek;
+    psHooks->FTell   = SAMmapFTell;
+    psHooks->FFlush  = SAMmapFFlush;
+    psHooks->FClose  = SAMmapFClose;
+    psHooks->Remove  = SADRemove;
+
+    psHooks->Error   = SADError;
+    psHooks->Atof    = atof;
+}
+
+#endif
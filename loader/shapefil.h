@@ -275,6 +275,8 @@ static const char *cvsid_aw() { return( cvsid_aw() ? NULL : cpl_cvsid ); }
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #  define SHPAPI_WINDOWS
 #  define SHPAPI_UTF8_HOOKS
+#else
+#  define SHPAPI_MMAP_HOOKS
 #endif
 
 /* -------------------------------------------------------------------- */
@@ -304,6 +306,9 @@ void SHPAPI_CALL SASetupDefaultHooks( SAHooks *psHooks );
 #ifdef SHPAPI_UTF8_HOOKS
 void SHPAPI_CALL SASetupUtf8Hooks( SAHooks *psHooks );
 #endif
+#ifdef SHPAPI_MMAP_HOOKS
+void SHPAPI_CALL SASetupMmapHooks( SAHooks *psHooks );
+#endif
 
 /************************************************************************/
 /*                             SHP Support.                             */
@@ -17,6 +17,15 @@
 #include "shp2pgsql-core.h"
 #include "../liblwgeom/liblwgeom.h" /* for SRID_UNKNOWN */
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 #define xstr(s) str(s)
 #define str(s) #s
 
@@ -27,6 +36,7 @@ typedef struct {
 } ShpLoaderLongOption;
 
 static const ShpLoaderLongOption long_option_aliases[] = {
+    {"binary-copy", 'B', 0},
     {"column-map", 'm', 1},
     {"create-index", 'I', 0},
     {"dbf-only", 'n', 0},
@@ -39,6 +49,7 @@ static const ShpLoaderLongOption long_option_aliases[] = {
     {"geometry-column", 'g', 1},
     {"help", '?', 0},
     {"index-tablespace", 'X', 1},
+    {"jobs", 'j', 1},
     {"keep-case", 'k', 0},
     {"no-analyze", 'Z', 0},
     {"no-transaction", 'e', 0},
@@ -103,6 +114,309 @@ consume_long_option(int argc, char **argv, int *option)
 	return 0;
 }
 
+/*
+ * Write one encoded record to stdout, reporting any warning or error.
+ * Returns 0 if the load must stop.
+ */
+static int
+write_record(SHPLOADERSTATE *state, int ret, const char *data, size_t size, const char *message)
+{
+	switch (ret)
+	{
+	case SHPLOADEROK:
+		break;
+
+	case SHPLOADERWARN:
+		/* Display the warning, but continue */
+		fprintf(stderr, "%s\n", message);
+		break;
+
+	case SHPLOADERERR:
+		/* Display the error message then stop */
+		fprintf(stderr, "%s\n", message);
+		return 0;
+
+	case SHPLOADERRECDELETED:
+		/* Record is marked as deleted - ignore */
+	case SHPLOADERRECISNULL:
+		/* Record is NULL and should be ignored according to NULL policy */
+	default:
+		return 1;
+	}
+
+	fwrite(data, 1, size, stdout);
+	if (state->config->dump_format != DUMP_FORMAT_BINARY)
+		putchar('\n');
+
+	return 1;
+}
+
+/* Read, encode and write every record in turn */
+static int
+write_records_serial(SHPLOADERSTATE *state)
+{
+	SHPLOADERRECORD record;
+	char *data = NULL;
+	size_t size = 0;
+	int ret, i;
+
+	for (i = 0; i < ShpLoaderGetRecordCount(state); i++)
+	{
+		ret = ShpLoaderReadRecord(state, i, &record);
+		if (ret == SHPLOADEROK)
+		{
+			ret = ShpLoaderEncodeRecord(state, &record, &data, &size);
+			ShpLoaderFreeRecord(&record);
+		}
+
+		if (!write_record(state, ret, data, size, state->message))
+			return 0;
+
+		free(data);
+		data = NULL;
+	}
+
+	return 1;
+}
+
+#ifdef HAVE_PTHREAD
+
+/*
+ * A record on its way from the reader through an encoding worker to the
+ * writer.  Record i lives in slot i % num_slots; the reader only reuses a
+ * slot once the writer has emitted the record it held before.
+ */
+typedef struct
+{
+	SHPLOADERRECORD record;
+	int ret;
+	char *data;
+	size_t size;
+	char message[SHPLOADERMSGLEN];
+	int done;
+} ShpLoaderSlot;
+
+typedef struct
+{
+	SHPLOADERSTATE *state;
+	ShpLoaderSlot *slots;
+	int num_slots;
+	int num_records;
+
+	/* Next record to read, to encode and to write; all guarded by lock */
+	int next_read;
+	int next_encode;
+	int next_write;
+	int stop;
+
+	pthread_mutex_t lock;
+	pthread_cond_t can_read;
+	pthread_cond_t can_encode;
+	pthread_cond_t can_write;
+} ShpLoaderPipeline;
+
+/* Encoding reports through state->message, so every worker needs its own */
+typedef struct
+{
+	ShpLoaderPipeline *pipeline;
+	SHPLOADERSTATE state;
+} ShpLoaderJob;
+
+/* Slots handed to each worker; enough to keep them busy past a slow record */
+#define PIPELINE_SLOTS_PER_JOB 16
+
+/* Only this thread touches the shapefile handles and state->message */
+static void *
+pipeline_reader(void *arg)
+{
+	ShpLoaderPipeline *p = arg;
+	int i, stop;
+
+	for (i = 0; i < p->num_records; i++)
+	{
+		ShpLoaderSlot *slot = &p->slots[i % p->num_slots];
+
+		pthread_mutex_lock(&p->lock);
+		while (!p->stop && i >= p->next_write + p->num_slots)
+			pthread_cond_wait(&p->can_read, &p->lock);
+		stop = p->stop;
+		pthread_mutex_unlock(&p->lock);
+
+		if (stop)
+			break;
+
+		/* Records that failed or were skipped still pass through a worker, in order */
+		slot->ret = ShpLoaderReadRecord(p->state, i, &slot->record);
+		if (slot->ret == SHPLOADERERR)
+			memcpy(slot->message, p->state->message, SHPLOADERMSGLEN);
+
+		pthread_mutex_lock(&p->lock);
+		p->next_read = i + 1;
+		pthread_cond_signal(&p->can_encode);
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	return NULL;
+}
+
+static void *
+pipeline_worker(void *arg)
+{
+	ShpLoaderJob *job = arg;
+	ShpLoaderPipeline *p = job->pipeline;
+
+	pthread_mutex_lock(&p->lock);
+	for (;;)
+	{
+		ShpLoaderSlot *slot;
+
+		while (!p->stop && p->next_encode == p->next_read && p->next_encode < p->num_records)
+			pthread_cond_wait(&p->can_encode, &p->lock);
+
+		if (p->stop || p->next_encode == p->num_records)
+			break;
+
+		slot = &p->slots[p->next_encode++ % p->num_slots];
+		pthread_mutex_unlock(&p->lock);
+
+		if (slot->ret == SHPLOADEROK)
+		{
+			slot->ret = ShpLoaderEncodeRecord(&job->state, &slot->record, &slot->data, &slot->size);
+			if (slot->ret == SHPLOADERERR || slot->ret == SHPLOADERWARN)
+				memcpy(slot->message, job->state.message, SHPLOADERMSGLEN);
+		}
+		ShpLoaderFreeRecord(&slot->record);
+
+		pthread_mutex_lock(&p->lock);
+		slot->done = 1;
+		pthread_cond_signal(&p->can_write);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+/*
+ * Read on one thread, encode on jobs threads and write from this one in
+ * record order, so the output matches write_records_serial() exactly.
+ */
+static int
+write_records_parallel(SHPLOADERSTATE *state, int jobs)
+{
+	ShpLoaderPipeline p;
+	ShpLoaderJob *job;
+	pthread_t reader;
+	pthread_t *workers;
+	int i, started = 0, reader_started = 0, ok = 1;
+
+	memset(&p, 0, sizeof(p));
+	p.state = state;
+	p.num_records = ShpLoaderGetRecordCount(state);
+	p.num_slots = jobs * PIPELINE_SLOTS_PER_JOB;
+	p.slots = calloc(p.num_slots, sizeof(ShpLoaderSlot));
+	job = calloc(jobs, sizeof(ShpLoaderJob));
+	workers = calloc(jobs, sizeof(pthread_t));
+	if (!p.slots || !job || !workers)
+	{
+		fprintf(stderr, "Unable to allocate memory for the encoding pipeline\n");
+		free(workers);
+		free(job);
+		free(p.slots);
+		return 0;
+	}
+
+	/* Copy the state before the reader starts writing state->message */
+	for (i = 0; i < jobs; i++)
+	{
+		job[i].pipeline = &p;
+		memcpy(&job[i].state, state, sizeof(SHPLOADERSTATE));
+	}
+
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.can_read, NULL);
+	pthread_cond_init(&p.can_encode, NULL);
+	pthread_cond_init(&p.can_write, NULL);
+
+	if (pthread_create(&reader, NULL, pipeline_reader, &p) != 0)
+	{
+		fprintf(stderr, "Unable to start the shapefile reader thread\n");
+		ok = 0;
+	}
+	else
+		reader_started = 1;
+
+	for (; started < jobs && ok; started++)
+	{
+		if (pthread_create(&workers[started], NULL, pipeline_worker, &job[started]) != 0)
+		{
+			fprintf(stderr, "Unable to start encoding thread %d\n", started + 1);
+			ok = 0;
+			break;
+		}
+	}
+
+	for (i = 0; i < p.num_records && ok; i++)
+	{
+		ShpLoaderSlot *slot = &p.slots[i % p.num_slots];
+
+		pthread_mutex_lock(&p.lock);
+		while (!slot->done)
+			pthread_cond_wait(&p.can_write, &p.lock);
+		pthread_mutex_unlock(&p.lock);
+
+		ok = write_record(state, slot->ret, slot->data, slot->size, slot->message);
+		free(slot->data);
+
+		pthread_mutex_lock(&p.lock);
+		slot->data = NULL;
+		slot->done = 0;
+		p.next_write = i + 1;
+		pthread_cond_signal(&p.can_read);
+		pthread_mutex_unlock(&p.lock);
+	}
+
+	/* On error, wake everybody up and let them drain */
+	pthread_mutex_lock(&p.lock);
+	p.stop = 1;
+	pthread_cond_broadcast(&p.can_read);
+	pthread_cond_broadcast(&p.can_encode);
+	pthread_mutex_unlock(&p.lock);
+
+	if (reader_started)
+		pthread_join(reader, NULL);
+	for (i = 0; i < started; i++)
+		pthread_join(workers[i], NULL);
+
+	for (i = 0; i < p.num_slots; i++)
+	{
+		free(p.slots[i].data);
+		ShpLoaderFreeRecord(&p.slots[i].record);
+	}
+
+	pthread_cond_destroy(&p.can_write);
+	pthread_cond_destroy(&p.can_encode);
+	pthread_cond_destroy(&p.can_read);
+	pthread_mutex_destroy(&p.lock);
+	free(workers);
+	free(job);
+	free(p.slots);
+
+	return ok;
+}
+
+#endif /* HAVE_PTHREAD */
+
+static int
+write_records(SHPLOADERSTATE *state, int jobs)
+{
+#ifdef HAVE_PTHREAD
+	if (jobs > 1)
+		return write_records_parallel(state, jobs);
+#endif
+
+	return write_records_serial(state);
+}
+
 static void
 usage()
 {
@@ -130,6 +444,12 @@ usage()
 	    _("  -f, --feature-id-column <fidcolumn> Specify the name of the feature id column\n"
 	      "      (default: \"" FID_DEFAULT "\").\n"));
 	printf(_("  -D, --dump-format  Use postgresql dump format (defaults to SQL insert statements).\n"));
+	printf(
+	    _("  -B, --binary-copy  Only write the rows, as PostgreSQL binary COPY data. Create the\n"
+	      "      table separately (e.g. with -p) and load with the COPY command printed on stderr.\n"));
+	printf(
+	    _("  -j, --jobs <n>  Encode rows on <n> threads while one thread reads the shapefile.\n"
+	      "      Output order is unchanged.\n"));
 	printf(_( "  -e  Execute each statement individually, do not use a transaction.\n"
 	          "      Not compatible with -D.\n" ));
 	printf(_("  -G, --geography  Use geography type (requires lon/lat data or -s to reproject).\n"));
@@ -183,9 +503,12 @@ main (int argc, char **argv)
 {
 	SHPLOADERCONFIG *config;
 	SHPLOADERSTATE *state;
-	char *header, *footer, *record;
+	char *header, *footer;
 	int c;
-	int ret, i;
+	int ret;
+	int jobs = 1;
+	int dump_copy = 0;
+	int dump_binary = 0;
 
 #ifdef ENABLE_NLS
 #ifdef PGSQL_LOCALEDIR
@@ -287,7 +610,7 @@ main (int argc, char **argv)
 		}
 		else
 		{
-			c = pgis_getopt(argc, argv, "-?acdef:g:ikm:nps:t:uwDGIN:ST:W:X:Z");
+			c = pgis_getopt(argc, argv, "-?acdef:g:ij:km:nps:t:uwBDGIN:ST:W:X:Z");
 			if (c == EOF)
 				break;
 
@@ -306,8 +629,12 @@ main (int argc, char **argv)
 			config->actions.mode_set = 1;
 			break;
 
+		case 'B':
+			dump_binary = 1;
+			break;
+
 		case 'D':
-			config->dump_format = 1;
+			dump_copy = 1;
 			break;
 
 		case 'G':
@@ -355,6 +682,14 @@ main (int argc, char **argv)
 			config->column_map_filename = pgis_optarg;
 			break;
 
+		case 'j':
+			if (sscanf(pgis_optarg, "%d", &jobs) != 1 || jobs < 1)
+			{
+				fprintf(stderr, "The -j parameter must be a positive number of jobs\n");
+				exit(1);
+			}
+			break;
+
 		case 'k':
 			config->quoteidentifiers = 1;
 			break;
@@ -455,7 +790,43 @@ main (int argc, char **argv)
 	}
 
 	/* Once we have parsed the arguments, make sure certain combinations are valid */
-	if (config->dump_format && !config->usetransaction)
+	if (dump_copy && dump_binary)
+	{
+		fprintf(stderr, "Invalid argument combination - cannot use both -D and -B\n");
+		exit(1);
+	}
+	if (dump_copy)
+		config->dump_format = DUMP_FORMAT_COPY;
+	if (dump_binary)
+		config->dump_format = DUMP_FORMAT_BINARY;
+
+	if (dump_binary)
+	{
+		/* Binary COPY data cannot carry SQL, so table actions have no place to go */
+		if (config->actions.drop_table || config->actions.create_table_set || config->actions.create_index_set ||
+		    config->actions.if_not_exists || (config->actions.mode_set && config->actions.mode != 'a') ||
+		    (config->actions.load_data_set && !config->actions.load_data))
+		{
+			fprintf(stderr, "Invalid argument combination - -B only writes rows, create the table separately\n");
+			exit(1);
+		}
+		if (config->use_wkt)
+		{
+			fprintf(stderr, "Invalid argument combination - cannot use both -B and -w\n");
+			exit(1);
+		}
+		config->actions.mode = 'a';
+	}
+
+#ifndef HAVE_PTHREAD
+	if (jobs > 1)
+	{
+		fprintf(stderr, "Built without thread support, ignoring -j and encoding on one thread\n");
+		jobs = 1;
+	}
+#endif
+
+	if (config->dump_format == DUMP_FORMAT_COPY && !config->usetransaction)
 	{
 		fprintf(stderr, "Invalid argument combination - cannot use both -D and -e\n");
 		exit(1);
@@ -594,94 +965,90 @@ main (int argc, char **argv)
 		fprintf(stderr, "Postgis type: %s[%d]\n", state->pgtype, state->pgdims);
 	}
 
-	/* Print the header to stdout */
-	ret = ShpLoaderGetSQLHeader(state, &header);
-	if (ret != SHPLOADEROK)
-	{
-		fprintf(stderr, "%s\n", state->message);
+	/* Numbers are only formatted by the WKT writer and parsed for binary COPY */
+	setlocale(LC_NUMERIC, "C");
 
-		if (ret == SHPLOADERERR)
+	/* Binary COPY is only the data stream, with the matching COPY command on stderr */
+	if (state->config->dump_format == DUMP_FORMAT_BINARY)
+	{
+		ret = ShpLoaderGetSQLCopyStatement(state, &header);
+		if (ret != SHPLOADEROK)
+		{
+			fprintf(stderr, "%s\n", state->message);
 			exit(1);
-	}
+		}
 
-	printf("%s", header);
-	free(header);
+		fprintf(stderr, "%s", header);
+		free(header);
 
-	/* If we are not in "prepare" mode, go ahead and write out the data. */
-	if (state->config->plan.load_data)
-	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
 
-		/* If in COPY mode, output the COPY statement */
-		if (state->config->dump_format)
+		fwrite(BINARY_COPY_HEADER, 1, BINARY_COPY_HEADER_LEN, stdout);
+		if (!write_records(state, jobs))
+			exit(1);
+		fwrite(BINARY_COPY_TRAILER, 1, BINARY_COPY_TRAILER_LEN, stdout);
+	}
+	else
+	{
+		/* Print the header to stdout */
+		ret = ShpLoaderGetSQLHeader(state, &header);
+		if (ret != SHPLOADEROK)
 		{
-			ret = ShpLoaderGetSQLCopyStatement(state, &header);
-			if (ret != SHPLOADEROK)
-			{
-				fprintf(stderr, "%s\n", state->message);
-
-				if (ret == SHPLOADERERR)
-					exit(1);
-			}
+			fprintf(stderr, "%s\n", state->message);
 
-			printf("%s", header);
-			free(header);
+			if (ret == SHPLOADERERR)
+				exit(1);
 		}
 
-		/* Main loop: iterate through all of the records and send them to stdout */
-		for (i = 0; i < ShpLoaderGetRecordCount(state); i++)
+		printf("%s", header);
+		free(header);
+
+		/* If we are not in "prepare" mode, go ahead and write out the data. */
+		if (state->config->plan.load_data)
 		{
-			ret = ShpLoaderGenerateSQLRowStatement(state, i, &record);
 
-			switch (ret)
+			/* If in COPY mode, output the COPY statement */
+			if (state->config->dump_format)
 			{
-			case SHPLOADEROK:
-				/* Simply display the geometry */
-				printf("%s\n", record);
-				free(record);
-				break;
+				ret = ShpLoaderGetSQLCopyStatement(state, &header);
+				if (ret != SHPLOADEROK)
+				{
+					fprintf(stderr, "%s\n", state->message);
 
-			case SHPLOADERERR:
-				/* Display the error message then stop */
-				fprintf(stderr, "%s\n", state->message);
-				exit(1);
-				break;
+					if (ret == SHPLOADERERR)
+						exit(1);
+				}
 
-			case SHPLOADERWARN:
-				/* Display the warning, but continue */
-				fprintf(stderr, "%s\n", state->message);
-				printf("%s\n", record);
-				free(record);
-				break;
+				printf("%s", header);
+				free(header);
+			}
 
-			case SHPLOADERRECDELETED:
-				/* Record is marked as deleted - ignore */
-				break;
+			/* Main loop: iterate through all of the records and send them to stdout */
+			if (!write_records(state, jobs))
+				exit(1);
 
-			case SHPLOADERRECISNULL:
-				/* Record is NULL and should be ignored according to NULL policy */
-				break;
-			}
-		}
+			/* If in COPY mode, terminate the COPY statement */
+			if (state->config->dump_format)
+				printf("\\.\n");
 
-		/* If in COPY mode, terminate the COPY statement */
-		if (state->config->dump_format)
-			printf("\\.\n");
+		}
 
-	}
+		/* Print the footer to stdout */
+		ret = ShpLoaderGetSQLFooter(state, &footer);
+		if (ret != SHPLOADEROK)
+		{
+			fprintf(stderr, "%s\n", state->message);
 
-	/* Print the footer to stdout */
-	ret = ShpLoaderGetSQLFooter(state, &footer);
-	if (ret != SHPLOADEROK)
-	{
-		fprintf(stderr, "%s\n", state->message);
+			if (ret == SHPLOADERERR)
+				exit(1);
+		}
 
-		if (ret == SHPLOADERERR)
-			exit(1);
+		printf("%s", footer);
+		free(footer);
 	}
 
-	printf("%s", footer);
-	free(footer);
-
 
 	/* Free the state object */
 	ShpLoaderDestroy(state);
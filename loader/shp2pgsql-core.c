@@ -22,6 +22,7 @@
 #include "shp2pgsql-core.h"
 #include "../liblwgeom/liblwgeom.h"
 #include "../liblwgeom/lwgeom_log.h" /* for LWDEBUG macros */
+#include "../liblwgeom/bytebuffer.h"
 
 
 
@@ -51,12 +52,12 @@ typedef struct struct_ring
 char *escape_copy_string(char *str);
 char *escape_insert_string(char *str);
 
-int GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, int force_multi);
-int GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry);
+int GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry, int force_multi);
+int GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry);
 int PIP(Point P, Point *V, int n);
 int FindPolygons(SHPObject *obj, Ring ***Out);
 void ReleasePolygons(Ring **polys, int npolys);
-int GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry);
+int GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry);
 static int shp_loader_is_zip_archive(const char *filename);
 
 static int
@@ -246,11 +247,11 @@ escape_insert_string(char *str)
 
 
 /**
- * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * @brief Generate an allocated geometry for shapefile object obj using the state parameters
  * if "force_multi" is true, single points will instead be created as multipoints with a single vertice.
  */
 int
-GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, int force_multi)
+GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry, int force_multi)
 {
 	LWGEOM **lwmultipoints;
 	LWGEOM *lwgeom = NULL;
@@ -260,9 +261,6 @@ GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, in
 	int dims = 0;
 	int u;
 
-	char *mem;
-	size_t mem_length;
-
 	FLAGS_SET_Z(dims, state->has_z);
 	FLAGS_SET_M(dims, state->has_m);
 
@@ -317,37 +315,18 @@ GeneratePointGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry, in
 		}
 	}
 
-	if (state->config->use_wkt)
-	{
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
-	}
-	else
-	{
-		mem = lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED);
-	}
-
-	if ( !mem )
-	{
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		lwgeom_free(lwgeom);
-		return SHPLOADERERR;
-	}
-
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
-
-	/* Return the string - everything ok */
-	*geometry = mem;
+	/* Return the geometry - everything ok */
+	*geometry = lwgeom;
 
 	return SHPLOADEROK;
 }
 
 
 /**
- * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * @brief Generate an allocated geometry for shapefile object obj using the state parameters
  */
 int
-GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry)
 {
 
 	LWGEOM **lwmultilinestrings;
@@ -355,8 +334,6 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 	POINT4D point4d;
 	int dims = 0;
 	int u, v, start_vertex, end_vertex;
-	char *mem;
-	size_t mem_length;
 
 
 	FLAGS_SET_Z(dims, state->has_z);
@@ -380,8 +357,7 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 	/* We need an array of pointers to each of our sub-geometries */
 	for (u = 0; u < obj->nParts; u++)
 	{
-		/* Create a ptarray containing the line points */
-		POINTARRAY *pa = ptarray_construct_empty(state->has_z, state->has_m, obj->nParts);
+		POINTARRAY *pa;
 
 		/* Set the start/end vertices depending upon whether this is
 		a MULTILINESTRING or not */
@@ -392,6 +368,10 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 
 		start_vertex = obj->panPartStart[u];
 
+		/* Create a ptarray sized to hold all the line points up front */
+		pa = ptarray_construct_empty(state->has_z, state->has_m,
+		                             end_vertex > start_vertex ? end_vertex - start_vertex : 0);
+
 		for (v = start_vertex; v < end_vertex; v++)
 		{
 			/* Generate the point */
@@ -421,22 +401,8 @@ GenerateLineStringGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometr
 		lwfree(lwmultilinestrings);
 	}
 
-	if (!state->config->use_wkt)
-		mem = lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED);
-	else
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
-
-	if ( !mem )
-	{
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		return SHPLOADERERR;
-	}
-
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
-
-	/* Return the string - everything ok */
-	*geometry = mem;
+	/* Return the geometry - everything ok */
+	*geometry = lwgeom;
 
 	return SHPLOADEROK;
 }
@@ -738,14 +704,14 @@ ReleasePolygons(Ring **polys, int npolys)
 
 
 /**
- * @brief Generate an allocated geometry string for shapefile object obj using the state parameters
+ * @brief Generate an allocated geometry for shapefile object obj using the state parameters
  *
  * This function basically deals with the polygon case. It sorts the polys in order of outer,
  * inner,inner, so that inners always come after outers they are within.
  *
  */
 int
-GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
+GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry)
 {
 	Ring **Outer;
 	int polygon_total, ring_total;
@@ -758,9 +724,6 @@ GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
 
 	int dims = 0;
 
-	char *mem;
-	size_t mem_length;
-
 	FLAGS_SET_Z(dims, state->has_z);
 	FLAGS_SET_M(dims, state->has_m);
 
@@ -849,28 +812,11 @@ GeneratePolygonGeometry(SHPLOADERSTATE *state, SHPObject *obj, char **geometry)
 		lwfree(lwpolygons);
 	}
 
-	if (!state->config->use_wkt)
-		mem = lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED);
-	else
-		mem = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
-
-	if ( !mem )
-	{
-		/* Free the linked list of rings */
-		ReleasePolygons(Outer, polygon_total);
-
-		snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
-		return SHPLOADERERR;
-	}
-
-	/* Free all of the allocated items */
-	lwgeom_free(lwgeom);
-
 	/* Free the linked list of rings */
 	ReleasePolygons(Outer, polygon_total);
 
-	/* Return the string - everything ok */
-	*geometry = mem;
+	/* Return the geometry - everything ok */
+	*geometry = lwgeom;
 
 	return SHPLOADEROK;
 }
@@ -1179,6 +1125,7 @@ ShpLoaderOpenShape(SHPLOADERSTATE *state)
 	char name[MAXFIELDNAMELEN];
 	DBFFieldType type = FTInvalid;
 	char *utf8str;
+	SAHooks hooks;
 
 	if (ShpLoaderValidateFIDColumn(state) != SHPLOADEROK)
 		return SHPLOADERERR;
@@ -1192,10 +1139,18 @@ ShpLoaderOpenShape(SHPLOADERSTATE *state)
 		return SHPLOADERERR;
 	}
 
+	/* Map the input files into memory where possible, so that per-record reads
+	   don't each cost a seek and a read system call */
+#ifdef SHPAPI_MMAP_HOOKS
+	SASetupMmapHooks(&hooks);
+#else
+	SASetupDefaultHooks(&hooks);
+#endif
+
 	/* If we are reading the entire shapefile, open it */
 	if (state->config->readshape == 1)
 	{
-		state->hSHPHandle = SHPOpen(state->config->shp_file, "rb");
+		state->hSHPHandle = SHPOpenLL(state->config->shp_file, "rb", &hooks);
 
 		if (state->hSHPHandle == NULL)
 		{
@@ -1207,7 +1162,7 @@ ShpLoaderOpenShape(SHPLOADERSTATE *state)
 	}
 
 	/* Open the DBF (attributes) file */
-	state->hDBFHandle = DBFOpen(state->config->shp_file, "rb");
+	state->hDBFHandle = DBFOpenLL(state->config->shp_file, "rb", &hooks);
 	if ((state->hSHPHandle == NULL && state->config->readshape == 1) || state->hDBFHandle == NULL)
 	{
 		snprintf(state->message, SHPLOADERMSGLEN, _("%s: dbf file (.dbf) can not be opened."), state->config->shp_file);
@@ -1784,8 +1739,36 @@ ShpLoaderGetSQLCopyStatement(SHPLOADERSTATE *state, char **strheader)
 	stringbuffer_clear(sb);
 
 
+	/* Binary COPY data goes straight into the target table, so there is no
+	   temporary table to reproject from */
+	if (state->config->dump_format == DUMP_FORMAT_BINARY && state->to_srid != state->from_srid)
+	{
+		snprintf(state->message, SHPLOADERMSGLEN, _("Binary COPY output cannot reproject; load in the source SRID and use ST_Transform afterwards"));
+		stringbuffer_destroy(sb);
+
+		return SHPLOADERERR;
+	}
+
 	/* Allocate the string for the COPY statement */
-	if (state->config->dump_format)
+	if (state->config->dump_format == DUMP_FORMAT_BINARY)
+	{
+		stringbuffer_aprintf(sb, "COPY ");
+
+		if (state->config->schema)
+		{
+			stringbuffer_aprintf(sb, "\"%s\".", state->config->schema);
+		}
+
+		stringbuffer_aprintf(sb, "\"%s\" (%s) FROM stdin (FORMAT binary);\n", state->config->table, state->col_names);
+
+		/* Copy the string buffer into a new string, destroying the string buffer */
+		ret = strdup(stringbuffer_getstring(sb));
+		stringbuffer_destroy(sb);
+
+		*strheader = ret;
+		return SHPLOADEROK;
+	}
+	else if (state->config->dump_format)
 	{
 		stringbuffer_aprintf(sb, "COPY ");
 
@@ -1827,53 +1810,418 @@ ShpLoaderGetRecordCount(SHPLOADERSTATE *state)
 }
 
 
-/* Return an allocated string representation of a specified record item */
+/*
+ * PostgreSQL binary COPY encoding.  Each field is an int32 byte count (-1 for
+ * NULL) followed by the value in the receive format of the column type; all
+ * integers are in network byte order.
+ */
+
+/* Append an integer of nbytes bytes in network byte order */
+static void
+copy_binary_append_uint(bytebuffer_t *bb, uint64_t val, int nbytes)
+{
+	while (nbytes-- > 0)
+		bytebuffer_append_byte(bb, (uint8_t)(val >> (8 * nbytes)));
+}
+
+static void
+copy_binary_append_bytes(bytebuffer_t *bb, const void *data, size_t size)
+{
+	memcpy(bytebuffer_reserve(bb, size), data, size);
+	bb->writecursor += size;
+}
+
+/* Skip trailing blanks, returning LW_TRUE if nothing else is left */
+static int
+copy_binary_at_end(const char *ptr)
+{
+	while (isspace((unsigned char)*ptr))
+		ptr++;
+
+	return *ptr == '\0';
+}
+
+static int
+copy_binary_append_int(bytebuffer_t *bb, const char *str, int nbytes)
+{
+	long long val;
+	char *end;
+
+	errno = 0;
+	val = strtoll(str, &end, 10);
+	if (end == str || errno == ERANGE || !copy_binary_at_end(end))
+		return LW_FAILURE;
+
+	if ((nbytes == 2 && (val < INT16_MIN || val > INT16_MAX)) ||
+	    (nbytes == 4 && (val < INT32_MIN || val > INT32_MAX)))
+		return LW_FAILURE;
+
+	copy_binary_append_uint(bb, nbytes, 4);
+	copy_binary_append_uint(bb, (uint64_t)val, nbytes);
+
+	return LW_SUCCESS;
+}
+
+static int
+copy_binary_append_float8(bytebuffer_t *bb, const char *str)
+{
+	double val;
+	uint64_t bits;
+	char *end;
+
+	errno = 0;
+	val = strtod(str, &end);
+	if (end == str || !copy_binary_at_end(end))
+		return LW_FAILURE;
+
+	/* Out of range for a double, as float8in would report */
+	if (errno == ERANGE && (isinf(val) || val == 0.0))
+		return LW_FAILURE;
+
+	memcpy(&bits, &val, sizeof(bits));
+	copy_binary_append_uint(bb, 8, 4);
+	copy_binary_append_uint(bb, bits, 8);
+
+	return LW_SUCCESS;
+}
+
+/*
+ * Numeric values go out as a digit count, the weight of the first digit, a
+ * sign word and the display scale, followed by the base 10000 digits.
+ */
+static int
+copy_binary_append_numeric(bytebuffer_t *bb, const char *str)
+{
+	static const int pow10[] = {1, 10, 100, 1000};
+	uint8_t digits[MAXVALUELEN];
+	int groups[MAXVALUELEN / 4 + 2];
+	const char *ptr = str;
+	int ndigits = 0, nfrac = 0, exponent = 0, negative = 0, seen_point = 0;
+	int dscale, lowpow, gmin, gmax, first, last, i;
+
+	while (isspace((unsigned char)*ptr))
+		ptr++;
+
+	if (*ptr == '+' || *ptr == '-')
+		negative = (*ptr++ == '-');
+
+	for (; isdigit((unsigned char)*ptr) || (*ptr == '.' && !seen_point); ptr++)
+	{
+		if (*ptr == '.')
+		{
+			seen_point = 1;
+			continue;
+		}
+
+		if (ndigits == MAXVALUELEN)
+			return LW_FAILURE;
+
+		digits[ndigits++] = *ptr - '0';
+		if (seen_point)
+			nfrac++;
+	}
+
+	if (ndigits == 0)
+		return LW_FAILURE;
+
+	if (*ptr == 'e' || *ptr == 'E')
+	{
+		char *end;
+		long val = strtol(ptr + 1, &end, 10);
+
+		if (end == ptr + 1 || val > 1000 || val < -1000)
+			return LW_FAILURE;
+
+		exponent = val;
+		ptr = end;
+	}
+
+	if (!copy_binary_at_end(ptr))
+		return LW_FAILURE;
+
+	/* Decimal power of the last digit, and the base 10000 groups covered */
+	lowpow = exponent - nfrac;
+	dscale = lowpow < 0 ? -lowpow : 0;
+	gmin = lowpow >= 0 ? lowpow / 4 : -((3 - lowpow) / 4);
+	gmax = (lowpow + ndigits - 1) >= 0 ? (lowpow + ndigits - 1) / 4 : -((4 - lowpow - ndigits) / 4);
+
+	memset(groups, 0, sizeof(int) * (gmax - gmin + 1));
+	for (i = 0; i < ndigits; i++)
+	{
+		int power = lowpow + ndigits - 1 - i;
+		int group = power >= 0 ? power / 4 : -((3 - power) / 4);
+
+		groups[gmax - group] += digits[i] * pow10[power - 4 * group];
+	}
+
+	/* Leading and trailing zero groups are not sent */
+	for (first = 0; first <= gmax - gmin && groups[first] == 0; first++)
+		;
+	for (last = gmax - gmin; last >= first && groups[last] == 0; last--)
+		;
+
+	copy_binary_append_uint(bb, 8 + 2 * (last - first + 1), 4);
+	copy_binary_append_uint(bb, last - first + 1, 2);
+	copy_binary_append_uint(bb, (uint16_t)(first > last ? 0 : gmax - first), 2);
+	copy_binary_append_uint(bb, (negative && first <= last) ? 0x4000 : 0x0000, 2);
+	copy_binary_append_uint(bb, dscale, 2);
+	for (i = first; i <= last; i++)
+		copy_binary_append_uint(bb, groups[i], 2);
+
+	return LW_SUCCESS;
+}
+
+/* Julian day number, as computed by the backend's date2j() */
+static int
+copy_binary_date2j(int year, int month, int day)
+{
+	int julian;
+	int century;
+
+	if (month > 2)
+	{
+		month += 1;
+		year += 4800;
+	}
+	else
+	{
+		month += 13;
+		year += 4799;
+	}
+
+	century = year / 100;
+	julian = year * 365 - 32167;
+	julian += year / 4 - century + century / 4;
+	julian += 7834 * month / 256 + day;
+
+	return julian;
+}
+
+/* Dates are sent as the number of days since 2000-01-01 */
+static int
+copy_binary_append_date(bytebuffer_t *bb, const char *str)
+{
+	static const int mdays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	char buf[9];
+	int year, month, day, leap, i, j;
+
+	/* DBF dates are YYYYMMDD; also accept the ISO YYYY-MM-DD spelling */
+	for (i = 0, j = 0; str[i] && j < 8; i++)
+	{
+		if (isdigit((unsigned char)str[i]))
+			buf[j++] = str[i];
+		else if (!(str[i] == '-' && (i == 4 || i == 7)))
+			return LW_FAILURE;
+	}
+	buf[j] = '\0';
+
+	if (j != 8 || !copy_binary_at_end(str + i))
+		return LW_FAILURE;
+
+	day = atoi(buf + 6);
+	buf[6] = '\0';
+	month = atoi(buf + 4);
+	buf[4] = '\0';
+	year = atoi(buf);
+
+	leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+	if (year < 1 || month < 1 || month > 12 || day < 1 || day > mdays[month - 1] + (month == 2 && leap))
+		return LW_FAILURE;
+
+	copy_binary_append_uint(bb, 4, 4);
+	copy_binary_append_uint(bb, (uint32_t)(copy_binary_date2j(year, month, day) - copy_binary_date2j(2000, 1, 1)), 4);
+
+	return LW_SUCCESS;
+}
+
+static int
+copy_binary_append_bool(bytebuffer_t *bb, const char *str)
+{
+	while (isspace((unsigned char)*str))
+		str++;
+
+	copy_binary_append_uint(bb, 1, 4);
+
+	switch (*str)
+	{
+	case 't':
+	case 'T':
+	case 'y':
+	case 'Y':
+	case '1':
+		bytebuffer_append_byte(bb, 1);
+		return LW_SUCCESS;
+
+	case 'f':
+	case 'F':
+	case 'n':
+	case 'N':
+	case '0':
+		bytebuffer_append_byte(bb, 0);
+		return LW_SUCCESS;
+	}
+
+	return LW_FAILURE;
+}
+
+/* Append an attribute value in the binary form of its PostgreSQL field type */
+static int
+copy_binary_append_value(bytebuffer_t *bb, const char *pgfieldtype, const char *val)
+{
+	if (strcmp(pgfieldtype, "int2") == 0)
+		return copy_binary_append_int(bb, val, 2);
+	if (strcmp(pgfieldtype, "int4") == 0)
+		return copy_binary_append_int(bb, val, 4);
+	if (strcmp(pgfieldtype, "int8") == 0)
+		return copy_binary_append_int(bb, val, 8);
+	if (strcmp(pgfieldtype, "float8") == 0)
+		return copy_binary_append_float8(bb, val);
+	if (strcmp(pgfieldtype, "numeric") == 0)
+		return copy_binary_append_numeric(bb, val);
+	if (strcmp(pgfieldtype, "date") == 0)
+		return copy_binary_append_date(bb, val);
+	if (strcmp(pgfieldtype, "boolean") == 0)
+		return copy_binary_append_bool(bb, val);
+
+	/* varchar is sent as the raw (already UTF-8) bytes */
+	copy_binary_append_uint(bb, strlen(val), 4);
+	copy_binary_append_bytes(bb, val, strlen(val));
+
+	return LW_SUCCESS;
+}
+
+/* Append a NULL attribute in the current dump format */
+static void
+ShpLoaderAppendNull(SHPLOADERSTATE *state, stringbuffer_t *sb, bytebuffer_t *bb)
+{
+	if (state->config->dump_format == DUMP_FORMAT_BINARY)
+		copy_binary_append_uint(bb, UINT32_MAX, 4);
+	else if (state->config->dump_format)
+		stringbuffer_append_len(sb, "\\N", 2);
+	else
+		stringbuffer_append_len(sb, "NULL", 4);
+}
+
+/* Build the geometry for a non-NULL shape according to its shapefile type */
+static int
+ShpLoaderGenerateGeometry(SHPLOADERSTATE *state, SHPObject *obj, LWGEOM **geometry)
+{
+	switch (obj->nSHPType)
+	{
+	case SHPT_POLYGON:
+	case SHPT_POLYGONM:
+	case SHPT_POLYGONZ:
+		return GeneratePolygonGeometry(state, obj, geometry);
+
+	case SHPT_POINT:
+	case SHPT_POINTM:
+	case SHPT_POINTZ:
+		return GeneratePointGeometry(state, obj, geometry, 0);
+
+	case SHPT_MULTIPOINT:
+	case SHPT_MULTIPOINTM:
+	case SHPT_MULTIPOINTZ:
+		/* Force it to multi unless using -S */
+		return GeneratePointGeometry(state, obj, geometry, state->config->simple_geometries ? 0 : 1);
+
+	case SHPT_ARC:
+	case SHPT_ARCM:
+	case SHPT_ARCZ:
+		return GenerateLineStringGeometry(state, obj, geometry);
+
+	default:
+		snprintf(state->message, SHPLOADERMSGLEN, _("Shape type is not supported, type id = %d"), obj->nSHPType);
+		return SHPLOADERERR;
+	}
+}
+
+
+/* Read the shape and attributes of a specified record item */
 int
-ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strrecord)
+ShpLoaderReadRecord(SHPLOADERSTATE *state, int item, SHPLOADERRECORD *record)
 {
-	SHPObject *obj = NULL;
-	stringbuffer_t *sb;
-	stringbuffer_t *sbwarn;
-	char val[MAXVALUELEN];
-	char *escval;
-	char *geometry=NULL, *ret;
-	char *utf8str;
-	int res, i;
-	int rv;
+	int i;
 
-	/* Clear the stringbuffers */
-	sbwarn = stringbuffer_create();
-	stringbuffer_clear(sbwarn);
-	sb = stringbuffer_create();
-	stringbuffer_clear(sb);
+	record->obj = NULL;
+	record->values = NULL;
+	record->num_values = 0;
 
 	/* Skip deleted records */
 	if (state->hDBFHandle && DBFIsRecordDeleted(state->hDBFHandle, item))
-	{
-		*strrecord = NULL;
 		return SHPLOADERRECDELETED;
-	}
 
 	/* If we are reading the shapefile, open the specified record */
 	if (state->config->readshape == 1)
 	{
-		obj = SHPReadObject(state->hSHPHandle, item);
-		if (!obj)
+		record->obj = SHPReadObject(state->hSHPHandle, item);
+		if (!record->obj)
 		{
 			snprintf(state->message, SHPLOADERMSGLEN, _("Error reading shape object %d"), item);
 			return SHPLOADERERR;
 		}
 
 		/* If we are set to skip NULLs, return a NULL record status */
-		if (state->config->null_policy == POLICY_NULL_SKIP && obj->nVertices == 0 )
+		if (state->config->null_policy == POLICY_NULL_SKIP && record->obj->nVertices == 0)
 		{
-			SHPDestroyObject(obj);
-
-			*strrecord = NULL;
+			ShpLoaderFreeRecord(record);
 			return SHPLOADERRECISNULL;
 		}
 	}
 
+	/* Copy out the attributes; the DBF handle reuses its value buffer */
+	record->num_values = DBFGetFieldCount(state->hDBFHandle);
+	record->values = calloc(record->num_values ? record->num_values : 1, sizeof(char *));
+	if (!record->values)
+	{
+		snprintf(state->message, SHPLOADERMSGLEN, "unable to allocate memory for record attributes");
+		ShpLoaderFreeRecord(record);
+		return SHPLOADERERR;
+	}
+
+	for (i = 0; i < record->num_values; i++)
+	{
+		if (DBFIsAttributeNULL(state->hDBFHandle, item, i))
+			continue;
+
+		record->values[i] = strdup(DBFReadStringAttribute(state->hDBFHandle, item, i));
+		if (!record->values[i])
+		{
+			snprintf(state->message, SHPLOADERMSGLEN, "unable to allocate memory for record attributes");
+			ShpLoaderFreeRecord(record);
+			return SHPLOADERERR;
+		}
+	}
+
+	return SHPLOADEROK;
+}
+
+
+/* Return an allocated representation of a record read with ShpLoaderReadRecord */
+int
+ShpLoaderEncodeRecord(SHPLOADERSTATE *state, SHPLOADERRECORD *record, char **data, size_t *size)
+{
+	SHPObject *obj = record->obj;
+	const int binary = state->config->dump_format == DUMP_FORMAT_BINARY;
+	stringbuffer_t *sb;
+	stringbuffer_t *sbwarn;
+	bytebuffer_t bb;
+	char val[MAXVALUELEN];
+	char *escval;
+	char *utf8str;
+	int res, i;
+	int rv;
+
+	/* Clear the stringbuffers */
+	sbwarn = stringbuffer_create();
+	stringbuffer_clear(sbwarn);
+	sb = stringbuffer_create();
+	stringbuffer_clear(sb);
+	bytebuffer_init_with_size(&bb, BYTEBUFFER_STARTSIZE);
+
+	/* Binary tuples start with their field count */
+	if (binary)
+		copy_binary_append_uint(&bb, record->num_values + (state->config->readshape == 1), 2);
+
 	/* If not in dump format, generate the INSERT string */
 	if (!state->config->dump_format)
 	{
@@ -1890,16 +2238,13 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 	}
 
 
-	/* Read all of the attributes from the DBF file for this item */
-	for (i = 0; i < DBFGetFieldCount(state->hDBFHandle); i++)
+	/* Write out all of the attributes read from the DBF file for this item */
+	for (i = 0; i < record->num_values; i++)
 	{
 		/* Special case for NULL attributes */
-		if (DBFIsAttributeNULL(state->hDBFHandle, item, i))
+		if (!record->values[i])
 		{
-			if (state->config->dump_format)
-				stringbuffer_aprintf(sb, "\\N");
-			else
-				stringbuffer_aprintf(sb, "NULL");
+			ShpLoaderAppendNull(state, sb, &bb);
 		}
 		else
 		{
@@ -1908,7 +2253,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 			{
 			case FTInteger:
 			case FTDouble:
-				rv = snprintf(val, MAXVALUELEN, "%s", DBFReadStringAttribute(state->hDBFHandle, item, i));
+				rv = snprintf(val, MAXVALUELEN, "%s", record->values[i]);
 				if (rv >= MAXVALUELEN || rv == -1)
 				{
 					stringbuffer_aprintf(sbwarn, "Warning: field %d name truncated\n", i);
@@ -1929,7 +2274,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 
 			case FTString:
 			case FTLogical:
-				rv = snprintf(val, MAXVALUELEN, "%s", DBFReadStringAttribute(state->hDBFHandle, item, i));
+				rv = snprintf(val, MAXVALUELEN, "%s", record->values[i]);
 				if (rv >= MAXVALUELEN || rv == -1)
 				{
 					stringbuffer_aprintf(sbwarn, "Warning: field %d name truncated\n", i);
@@ -1938,7 +2283,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 				break;
 
 			case FTDate:
-				rv = snprintf(val, MAXVALUELEN, "%s", DBFReadStringAttribute(state->hDBFHandle, item, i));
+				rv = snprintf(val, MAXVALUELEN, "%s", record->values[i]);
 				if (rv >= MAXVALUELEN || rv == -1)
 				{
 					stringbuffer_aprintf(sbwarn, "Warning: field %d name truncated\n", i);
@@ -1946,10 +2291,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 				}
 				if (strlen(val) == 0)
 				{
-					if (state->config->dump_format)
-						stringbuffer_aprintf(sb, "\\N");
-					else
-						stringbuffer_aprintf(sb, "NULL");
+					ShpLoaderAppendNull(state, sb, &bb);
 					goto done_cell;
 				}
 				break;
@@ -1958,7 +2300,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 				snprintf(state->message, SHPLOADERMSGLEN, _("Error: field %d has invalid or unknown field type (%d)"), i, state->types[i]);
 
 				/* clean up and return err */
-				SHPDestroyObject(obj);
+				bytebuffer_destroy_buffer(&bb);
 				stringbuffer_destroy(sbwarn);
 				stringbuffer_destroy(sb);
 				return SHPLOADERERR;
@@ -1983,7 +2325,7 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 						free(utf8str);
 
 					/* clean up and return err */
-					SHPDestroyObject(obj);
+					bytebuffer_destroy_buffer(&bb);
 					stringbuffer_destroy(sbwarn);
 					stringbuffer_destroy(sb);
 					return SHPLOADERERR;
@@ -1994,6 +2336,20 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 
 			}
 
+			/* Binary COPY sends the value itself, with no escaping */
+			if (binary)
+			{
+				if (!copy_binary_append_value(&bb, state->pgfieldtypes[i], val))
+				{
+					snprintf(state->message, SHPLOADERMSGLEN, _("Unable to write value \"%s\" of field %d as binary %s"), val, i, state->pgfieldtypes[i]);
+					bytebuffer_destroy_buffer(&bb);
+					stringbuffer_destroy(sbwarn);
+					stringbuffer_destroy(sb);
+					return SHPLOADERERR;
+				}
+				goto done_cell;
+			}
+
 			/* Escape attribute correctly according to dump format */
 			if (state->config->dump_format)
 			{
@@ -2009,16 +2365,20 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 				snprintf(state->message,
 					 SHPLOADERMSGLEN,
 					 "unable to allocate memory for escaped attribute value");
-				SHPDestroyObject(obj);
+				bytebuffer_destroy_buffer(&bb);
 				stringbuffer_destroy(sbwarn);
 				stringbuffer_destroy(sb);
 				return SHPLOADERERR;
 			}
 
 			if (state->config->dump_format)
-				stringbuffer_aprintf(sb, "%s", escval);
+				stringbuffer_append(sb, escval);
 			else
-				stringbuffer_aprintf(sb, "'%s'", escval);
+			{
+				stringbuffer_append_char(sb, '\'');
+				stringbuffer_append(sb, escval);
+				stringbuffer_append_char(sb, '\'');
+			}
 
 			/* Free the escaped version if required */
 			if (val != escval)
@@ -2028,12 +2388,12 @@ ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strreco
 done_cell:
 
 		/* Only put in delimiter if not last field or a shape will follow */
-		if (state->config->readshape == 1 || i < DBFGetFieldCount(state->hDBFHandle) - 1)
+		if (!binary && (state->config->readshape == 1 || i < record->num_values - 1))
 		{
 			if (state->config->dump_format)
-				stringbuffer_aprintf(sb, "\t");
+				stringbuffer_append_char(sb, '\t');
 			else
-				stringbuffer_aprintf(sb, ",");
+				stringbuffer_append_char(sb, ',');
 		}
 
 		/* End of DBF attribute loop */
@@ -2043,61 +2403,65 @@ done_cell:
 	/* Add the shape attribute if we are reading it */
 	if (state->config->readshape == 1)
 	{
-		/* Force the locale to C */
-		char *oldlocale = setlocale(LC_NUMERIC, "C");
-
 		/* Handle the case of a NULL shape */
 		if (obj->nVertices == 0)
 		{
-			if (state->config->dump_format)
-				stringbuffer_aprintf(sb, "\\N");
-			else
-				stringbuffer_aprintf(sb, "NULL");
+			ShpLoaderAppendNull(state, sb, &bb);
 		}
 		else
 		{
-			/* Handle all other shape attributes */
-			switch (obj->nSHPType)
+			LWGEOM *lwgeom = NULL;
+			char *geometry;
+			size_t mem_length;
+
+			res = ShpLoaderGenerateGeometry(state, obj, &lwgeom);
+			if (res != SHPLOADEROK)
 			{
-			case SHPT_POLYGON:
-			case SHPT_POLYGONM:
-			case SHPT_POLYGONZ:
-				res = GeneratePolygonGeometry(state, obj, &geometry);
-				break;
+				/* Error message has already been set */
+				bytebuffer_destroy_buffer(&bb);
+				stringbuffer_destroy(sbwarn);
+				stringbuffer_destroy(sb);
 
-			case SHPT_POINT:
-			case SHPT_POINTM:
-			case SHPT_POINTZ:
-				res = GeneratePointGeometry(state, obj, &geometry, 0);
-				break;
+				return SHPLOADERERR;
+			}
 
-			case SHPT_MULTIPOINT:
-			case SHPT_MULTIPOINTM:
-			case SHPT_MULTIPOINTZ:
-				/* Force it to multi unless using -S */
-				res = GeneratePointGeometry(state, obj, &geometry,
-					state->config->simple_geometries ? 0 : 1);
-				break;
+			/* Binary COPY takes the extended WKB that geometry_recv and geography_recv read */
+			if (binary)
+			{
+				lwvarlena_t *wkb = lwgeom_to_wkb_varlena(lwgeom, WKB_EXTENDED);
+				size_t wkb_size;
 
-			case SHPT_ARC:
-			case SHPT_ARCM:
-			case SHPT_ARCZ:
-				res = GenerateLineStringGeometry(state, obj, &geometry);
-				break;
+				lwgeom_free(lwgeom);
 
-			default:
-				snprintf(state->message, SHPLOADERMSGLEN, _("Shape type is not supported, type id = %d"), obj->nSHPType);
-				SHPDestroyObject(obj);
-				stringbuffer_destroy(sbwarn);
-				stringbuffer_destroy(sb);
+				if (!wkb)
+				{
+					snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
+					bytebuffer_destroy_buffer(&bb);
+					stringbuffer_destroy(sbwarn);
+					stringbuffer_destroy(sb);
 
-				return SHPLOADERERR;
+					return SHPLOADERERR;
+				}
+
+				wkb_size = LWSIZE_GET(wkb->size) - LWVARHDRSZ;
+				copy_binary_append_uint(&bb, wkb_size, 4);
+				copy_binary_append_bytes(&bb, wkb->data, wkb_size);
+
+				lwfree(wkb);
+				goto done_shape;
 			}
-			/* The default returns out of the function, so res will always have been set. */
-			if (res != SHPLOADEROK)
+
+			if (state->config->use_wkt)
+				geometry = lwgeom_to_wkt(lwgeom, WKT_EXTENDED, WKT_PRECISION, &mem_length);
+			else
+				geometry = lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED);
+
+			lwgeom_free(lwgeom);
+
+			if (!geometry)
 			{
-				/* Error message has already been set */
-				SHPDestroyObject(obj);
+				snprintf(state->message, SHPLOADERMSGLEN, "unable to write geometry");
+				bytebuffer_destroy_buffer(&bb);
 				stringbuffer_destroy(sbwarn);
 				stringbuffer_destroy(sb);
 
@@ -2109,16 +2473,17 @@ done_cell:
 			{
 				if (state->to_srid != state->from_srid)
 				{
-					stringbuffer_aprintf(sb, "ST_Transform(");
+					stringbuffer_append(sb, "ST_Transform(");
 				}
-				stringbuffer_aprintf(sb, "'");
+				stringbuffer_append_char(sb, '\'');
 			}
 
-			stringbuffer_aprintf(sb, "%s", geometry);
+			/* Geometries can be many megabytes of hex, so skip the printf machinery */
+			stringbuffer_append(sb, geometry);
 
 			if (!state->config->dump_format)
 			{
-				stringbuffer_aprintf(sb, "'");
+				stringbuffer_append_char(sb, '\'');
 
 				/* Close the ST_Transform if reprojecting. */
 				if (state->to_srid != state->from_srid)
@@ -2135,24 +2500,30 @@ done_cell:
 
 			lwfree(geometry);
 		}
-
-		/* Tidy up everything */
-		SHPDestroyObject(obj);
-
-		setlocale(LC_NUMERIC, oldlocale);
 	}
 
+done_shape:
+
 	/* Close the line correctly for dump/insert format */
 	if (!state->config->dump_format)
-		stringbuffer_aprintf(sb, ");");
+		stringbuffer_append_len(sb, ");", 2);
 
 
-	/* Copy the string buffer into a new string, destroying the string buffer */
-	ret = strdup(stringbuffer_getstring(sb));
+	/* Copy the tuple or string buffer out, destroying the buffers */
+	if (binary)
+	{
+		*size = bytebuffer_getlength(&bb);
+		*data = malloc(*size);
+		memcpy(*data, bb.buf_start, *size);
+	}
+	else
+	{
+		*data = strdup(stringbuffer_getstring(sb));
+		*size = stringbuffer_getlength(sb);
+	}
+	bytebuffer_destroy_buffer(&bb);
 	stringbuffer_destroy(sb);
 
-	*strrecord = ret;
-
 	/* If any warnings occurred, set the returned message string and warning status */
 	if (stringbuffer_getlength(sbwarn) > 0)
 	{
@@ -2171,6 +2542,66 @@ done_cell:
 }
 
 
+/* Release the shape and attributes held by a record */
+void
+ShpLoaderFreeRecord(SHPLOADERRECORD *record)
+{
+	int i;
+
+	if (record->obj)
+		SHPDestroyObject(record->obj);
+
+	if (record->values)
+	{
+		for (i = 0; i < record->num_values; i++)
+			free(record->values[i]);
+		free(record->values);
+	}
+
+	record->obj = NULL;
+	record->values = NULL;
+	record->num_values = 0;
+}
+
+
+/* Return an allocated string representation of a specified record item */
+int
+ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strrecord)
+{
+	SHPLOADERRECORD record;
+	char *oldlocale = NULL;
+	size_t size;
+	int ret;
+
+	/* Binary rows can contain NUL bytes and do not fit a string */
+	if (state->config->dump_format == DUMP_FORMAT_BINARY)
+	{
+		snprintf(state->message, SHPLOADERMSGLEN, _("Internal error: binary COPY rows must be generated with ShpLoaderEncodeRecord"));
+		return SHPLOADERERR;
+	}
+
+	ret = ShpLoaderReadRecord(state, item, &record);
+	if (ret != SHPLOADEROK)
+	{
+		*strrecord = NULL;
+		return ret;
+	}
+
+	/* Force the locale to C; only the WKT writer formats numbers */
+	if (state->config->readshape == 1 && state->config->use_wkt)
+		oldlocale = setlocale(LC_NUMERIC, "C");
+
+	ret = ShpLoaderEncodeRecord(state, &record, strrecord, &size);
+
+	if (oldlocale)
+		setlocale(LC_NUMERIC, oldlocale);
+
+	ShpLoaderFreeRecord(&record);
+
+	return ret;
+}
+
+
 /* Return a pointer to an allocated string containing the header for the specified loader state */
 int
 ShpLoaderGetSQLFooter(SHPLOADERSTATE *state, char **strfooter)
@@ -40,6 +40,20 @@
 #define POLICY_NULL_INSERT 	0x1
 #define POLICY_NULL_SKIP	0x2
 
+/* Dump format constants */
+#define DUMP_FORMAT_INSERT	0
+#define DUMP_FORMAT_COPY	1
+#define DUMP_FORMAT_BINARY	2
+
+/*
+ * PostgreSQL binary COPY framing: the signature, a zero flags field and an
+ * empty header extension, then a field count of -1 after the last tuple.
+ */
+#define BINARY_COPY_HEADER	"PGCOPY\n\377\r\n\0\0\0\0\0\0\0\0\0"
+#define BINARY_COPY_HEADER_LEN	19
+#define BINARY_COPY_TRAILER	"\377\377"
+#define BINARY_COPY_TRAILER_LEN	2
+
 /* Forced dimensionality constants */
 #define FORCE_OUTPUT_DISABLE	0x0
 #define FORCE_OUTPUT_2D		0x1
@@ -101,7 +115,7 @@ typedef struct shp_loader_config
 	/* the shape file (without the .shp extension) */
 	char *shp_file;
 
-	/* 0 = SQL inserts, 1 = dump */
+	/* 0 = SQL inserts, 1 = dump, 2 = binary COPY data only (a DUMP_FORMAT_* constant) */
 	int dump_format;
 
 	/* 0 = MULTIPOLYGON/MULTILINESTRING, 1 = force to POLYGON/LINESTRING */
@@ -238,6 +252,27 @@ typedef struct shp_loader_state
 } SHPLOADERSTATE;
 
 
+/*
+ * A record read from the shapefile but not yet encoded.  ShpLoaderReadRecord
+ * uses the shapefile handles and must be called from one thread at a time;
+ * ShpLoaderEncodeRecord only reads the state set up by ShpLoaderOpenShape and
+ * writes state->message, so records can be encoded concurrently as long as
+ * each thread passes its own copy of the state.
+ */
+typedef struct shp_loader_record
+{
+	/* Shape object, NULL if only loading the DBF file */
+	SHPObject *obj;
+
+	/* DBF attribute values, NULL for NULL attributes */
+	char **values;
+
+	/* Number of entries in values */
+	int num_values;
+
+} SHPLOADERRECORD;
+
+
 /* Externally accessible functions */
 void strtolower(char *s);
 void set_loader_config_defaults(SHPLOADERCONFIG *config);
@@ -248,5 +283,8 @@ int ShpLoaderGetSQLHeader(SHPLOADERSTATE *state, char **strheader);
 int ShpLoaderGetSQLCopyStatement(SHPLOADERSTATE *state, char **strheader);
 int ShpLoaderGetRecordCount(SHPLOADERSTATE *state);
 int ShpLoaderGenerateSQLRowStatement(SHPLOADERSTATE *state, int item, char **strrecord);
+int ShpLoaderReadRecord(SHPLOADERSTATE *state, int item, SHPLOADERRECORD *record);
+int ShpLoaderEncodeRecord(SHPLOADERSTATE *state, SHPLOADERRECORD *record, char **data, size_t *size);
+void ShpLoaderFreeRecord(SHPLOADERRECORD *record);
 int ShpLoaderGetSQLFooter(SHPLOADERSTATE *state, char **strfooter);
 void ShpLoaderDestroy(SHPLOADERSTATE *state);
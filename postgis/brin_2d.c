@@ -1,5 +1,11 @@
 #include "postgis_brin.h"
 
+#include "access/reloptions.h"
+#include "access/skey.h"
+#include "access/stratnum.h"
+#include "catalog/pg_type.h"
+#include "utils/typcache.h"
+
 /*
  * As we index geometries but store either a BOX2DF or GIDX according to the
  * operator class, we need to overload the original brin_inclusion_add_value()
@@ -116,3 +122,316 @@ geom2d_brin_inclusion_merge(PG_FUNCTION_ARGS)
 }
 
 
+
+
+/*
+ * Multi-box summaries
+ *
+ * Instead of a single union box, each block range keeps up to
+ * boxes_per_range boxes (stored in a bytea), in the spirit of the
+ * minmax-multi opclasses of PostgreSQL.  When a new box does not fit in
+ * any of the stored ones and the summary is full, the pair of boxes whose
+ * union grows the least is merged, so that a few outliers only inflate
+ * their own box instead of the whole range.
+ */
+
+#define BRIN_MULTI_BOXES_DEFAULT 8
+#define BRIN_MULTI_BOXES_MIN 2
+#define BRIN_MULTI_BOXES_MAX 256
+
+#define BRIN_MULTI_CONTAINS_EMPTY 0x01
+
+typedef struct
+{
+	int32 vl_len_;		/* varlena header (do not touch directly!) */
+	uint16 nboxes;		/* number of boxes in the summary */
+	uint16 flags;		/* BRIN_MULTI_CONTAINS_EMPTY */
+	BOX2DF boxes[FLEXIBLE_ARRAY_MEMBER];
+} BrinMultiBox2D;
+
+#define BRIN_MULTI_SIZE(nboxes) (offsetof(BrinMultiBox2D, boxes) + (nboxes) * sizeof(BOX2DF))
+
+typedef struct
+{
+	int32 vl_len_;		/* varlena header (do not touch directly!) */
+	int boxes_per_range;	/* maximum number of boxes per range */
+} BrinMultiBoxOptions;
+
+#define BrinMultiBoxesPerRange(opts) \
+	((opts) && (((BrinMultiBoxOptions *) (opts))->boxes_per_range != 0) ? \
+	 ((BrinMultiBoxOptions *) (opts))->boxes_per_range : BRIN_MULTI_BOXES_DEFAULT)
+
+static BrinMultiBox2D *
+brin_multi_new(int nboxes)
+{
+	BrinMultiBox2D *summary = palloc0(BRIN_MULTI_SIZE(nboxes));
+	SET_VARSIZE(summary, BRIN_MULTI_SIZE(nboxes));
+	return summary;
+}
+
+/* Half perimeter of a box, used as the merge cost so points still count */
+static inline double
+box2df_margin(const BOX2DF *a)
+{
+	return ((double)a->xmax - a->xmin) + ((double)a->ymax - a->ymin);
+}
+
+static inline void
+box2df_expand(BOX2DF *a, const BOX2DF *b)
+{
+	a->xmin = Min(a->xmin, b->xmin);
+	a->xmax = Max(a->xmax, b->xmax);
+	a->ymin = Min(a->ymin, b->ymin);
+	a->ymax = Max(a->ymax, b->ymax);
+}
+
+/*
+ * Merge the two boxes whose union has the smallest margin growth, and fold
+ * into the result any other box it now covers.
+ */
+static void
+brin_multi_compact(BrinMultiBox2D *summary)
+{
+	int i, j, best_i = 0, best_j = 1;
+	double best_cost = DBL_MAX;
+
+	for (i = 0; i < summary->nboxes; i++)
+	{
+		double margin_i = box2df_margin(&summary->boxes[i]);
+		for (j = i + 1; j < summary->nboxes; j++)
+		{
+			BOX2DF u = summary->boxes[i];
+			double cost;
+
+			box2df_expand(&u, &summary->boxes[j]);
+			cost = box2df_margin(&u) - margin_i - box2df_margin(&summary->boxes[j]);
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_i = i;
+				best_j = j;
+			}
+		}
+	}
+
+	box2df_expand(&summary->boxes[best_i], &summary->boxes[best_j]);
+	summary->boxes[best_j] = summary->boxes[--summary->nboxes];
+
+	for (i = 0; i < summary->nboxes; i++)
+	{
+		if (i != best_i && box2df_contains(&summary->boxes[best_i], &summary->boxes[i]))
+		{
+			summary->boxes[i] = summary->boxes[--summary->nboxes];
+			if (best_i == summary->nboxes)
+				best_i = i;
+			i--;
+		}
+	}
+}
+
+/*
+ * Add a box to the summary, returning the (possibly reallocated) summary,
+ * or NULL when it already covers the box.
+ */
+static BrinMultiBox2D *
+brin_multi_add_box(BrinMultiBox2D *summary, const BOX2DF *box, int max_boxes)
+{
+	BrinMultiBox2D *result;
+	int i;
+
+	for (i = 0; i < summary->nboxes; i++)
+	{
+		if (box2df_contains(&summary->boxes[i], box))
+			return NULL;
+	}
+
+	result = brin_multi_new(summary->nboxes + 1);
+	memcpy(result->boxes, summary->boxes, summary->nboxes * sizeof(BOX2DF));
+	result->nboxes = summary->nboxes;
+	result->flags = summary->flags;
+	result->boxes[result->nboxes++] = *box;
+
+	while (result->nboxes > max_boxes)
+		brin_multi_compact(result);
+
+	SET_VARSIZE(result, BRIN_MULTI_SIZE(result->nboxes));
+	return result;
+}
+
+/* Replace the stored summary of a range */
+static void
+brin_multi_store(BrinValues *column, BrinMultiBox2D *summary)
+{
+	if (!column->bv_allnulls)
+		pfree(DatumGetPointer(column->bv_values[0]));
+	column->bv_values[0] = PointerGetDatum(summary);
+	column->bv_allnulls = false;
+}
+
+static BrinMultiBox2D *
+brin_multi_fetch(BrinValues *column)
+{
+	BrinMultiBox2D *summary = (BrinMultiBox2D *) PG_DETOAST_DATUM(column->bv_values[0]);
+
+	/* Keep the expanded copy, we are going to modify it */
+	if (summary != (BrinMultiBox2D *) DatumGetPointer(column->bv_values[0]))
+	{
+		pfree(DatumGetPointer(column->bv_values[0]));
+		column->bv_values[0] = PointerGetDatum(summary);
+	}
+	return summary;
+}
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multi_opcinfo);
+Datum
+geom2d_brin_multi_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)));
+
+	/* The summary is a bytea, nulls are handled by the BRIN core */
+	result->oi_nstored = 1;
+	result->oi_regular_nulls = true;
+	result->oi_opaque = NULL;
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multi_add_value);
+Datum
+geom2d_brin_multi_add_value(PG_FUNCTION_ARGS)
+{
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum newval = PG_GETARG_DATUM(2);
+	int max_boxes = BrinMultiBoxesPerRange(PG_GET_OPCLASS_OPTIONS());
+	BrinMultiBox2D *summary, *result;
+	BOX2DF box_geom;
+
+	Assert(!PG_GETARG_BOOL(3));
+
+	if (gserialized_datum_get_box2df_p(newval, &box_geom) == LW_FAILURE)
+	{
+		if (!is_gserialized_from_datum_empty(newval))
+			elog(ERROR, "Error while extracting the box2df from the geom");
+
+		/* Record that the range holds empty geometries */
+		if (column->bv_allnulls)
+		{
+			summary = brin_multi_new(0);
+			summary->flags = BRIN_MULTI_CONTAINS_EMPTY;
+			brin_multi_store(column, summary);
+			PG_RETURN_BOOL(true);
+		}
+
+		summary = brin_multi_fetch(column);
+		if (summary->flags & BRIN_MULTI_CONTAINS_EMPTY)
+			PG_RETURN_BOOL(false);
+		summary->flags |= BRIN_MULTI_CONTAINS_EMPTY;
+		PG_RETURN_BOOL(true);
+	}
+
+	if (column->bv_allnulls)
+	{
+		summary = brin_multi_new(1);
+		summary->nboxes = 1;
+		summary->boxes[0] = box_geom;
+		brin_multi_store(column, summary);
+		PG_RETURN_BOOL(true);
+	}
+
+	summary = brin_multi_fetch(column);
+	result = brin_multi_add_box(summary, &box_geom, max_boxes);
+	if (!result)
+		PG_RETURN_BOOL(false);
+
+	brin_multi_store(column, result);
+	PG_RETURN_BOOL(true);
+}
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multi_consistent);
+Datum
+geom2d_brin_multi_consistent(PG_FUNCTION_ARGS)
+{
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey key = (ScanKey) PG_GETARG_POINTER(2);
+	BrinMultiBox2D *summary = (BrinMultiBox2D *) PG_DETOAST_DATUM(column->bv_values[0]);
+	BOX2DF query;
+	int i;
+
+	/* Nulls are handled by the BRIN core */
+	Assert(!(key->sk_flags & SK_ISNULL));
+
+	/* Empty geometries never interact, but are contained by anything */
+	if (gserialized_datum_get_box2df_p(key->sk_argument, &query) == LW_FAILURE)
+		PG_RETURN_BOOL(false);
+
+	for (i = 0; i < summary->nboxes; i++)
+	{
+		BOX2DF *box = &summary->boxes[i];
+
+		switch (key->sk_strategy)
+		{
+		case RTOverlapStrategyNumber:
+		case RTContainedByStrategyNumber:
+			if (box2df_overlaps(box, &query))
+				PG_RETURN_BOOL(true);
+			break;
+
+		case RTContainsStrategyNumber:
+			if (box2df_contains(box, &query))
+				PG_RETURN_BOOL(true);
+			break;
+
+		default:
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+		}
+	}
+
+	PG_RETURN_BOOL(key->sk_strategy == RTContainedByStrategyNumber &&
+		       (summary->flags & BRIN_MULTI_CONTAINS_EMPTY));
+}
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multi_union);
+Datum
+geom2d_brin_multi_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	int max_boxes = BrinMultiBoxesPerRange(PG_GET_OPCLASS_OPTIONS());
+	BrinMultiBox2D *summary_a, *summary_b;
+	int i;
+
+	/* Nulls are handled by the BRIN core */
+	Assert(!col_a->bv_allnulls && !col_b->bv_allnulls);
+
+	summary_a = brin_multi_fetch(col_a);
+	summary_b = (BrinMultiBox2D *) PG_DETOAST_DATUM(col_b->bv_values[0]);
+
+	summary_a->flags |= summary_b->flags;
+	for (i = 0; i < summary_b->nboxes; i++)
+	{
+		BrinMultiBox2D *result = brin_multi_add_box(summary_a, &summary_b->boxes[i], max_boxes);
+		if (result)
+		{
+			brin_multi_store(col_a, result);
+			summary_a = result;
+		}
+	}
+
+	PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(geom2d_brin_multi_options);
+Datum
+geom2d_brin_multi_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(BrinMultiBoxOptions));
+	add_local_int_reloption(relopts, "boxes_per_range",
+				"number of boxes kept in the summary of a block range",
+				BRIN_MULTI_BOXES_DEFAULT, BRIN_MULTI_BOXES_MIN, BRIN_MULTI_BOXES_MAX,
+				offsetof(BrinMultiBoxOptions, boxes_per_range));
+
+	PG_RETURN_VOID();
+}
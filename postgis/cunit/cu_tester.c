@@ -204,6 +204,30 @@ nd_box_ratio_cases(void)
 	CU_ASSERT_DOUBLE_EQUAL(nd_box_ratio(&covering, &touch, 3), 0.0, 1e-12);
 }
 
+static void
+nd_axis_ratio_product(void)
+{
+	ND_BOX cover = make_box(0.5f, -1.0f, 0.25f, 0.0f, 1.5f, 0.5f, 3.0f, 0.0f);
+	ND_BOX target = make_box(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f);
+	ND_BOX flat = make_box(0.0f, 0.25f, 0.0f, 0.0f, 1.0f, 0.25f, 1.0f, 0.0f);
+	ND_BOX covering = make_box(-1.0f, 0.0f, -1.0f, 0.0f, 2.0f, 1.0f, 2.0f, 0.0f);
+	double product = 1.0;
+	int d;
+
+	/* Per-axis shares multiply back to the volume ratio. */
+	for (d = 0; d < 3; d++)
+		product *= nd_axis_ratio(cover.min[d], cover.max[d], target.min[d], target.max[d], false);
+	CU_ASSERT_DOUBLE_EQUAL(product, nd_box_ratio(&cover, &target, 3), 1e-12);
+
+	/* Zero-width targets only count full coverage. */
+	CU_ASSERT_DOUBLE_EQUAL(nd_axis_ratio(cover.min[1], cover.max[1], flat.min[1], flat.max[1], true), 1.0, 1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(nd_axis_ratio(cover.min[0], cover.max[0], flat.min[0], flat.max[0], true), 0.0, 1e-12);
+	product = 1.0;
+	for (d = 0; d < 3; d++)
+		product *= nd_axis_ratio(covering.min[d], covering.max[d], flat.min[d], flat.max[d], true);
+	CU_ASSERT_DOUBLE_EQUAL(product, nd_box_ratio(&covering, &flat, 3), 1e-12);
+}
+
 int
 main(void)
 {
@@ -220,7 +244,8 @@ main(void)
 	    !CU_add_test(suite, "histogram budget clamps", histogram_budget_clamps) ||
 	    !CU_add_test(suite, "histogram axis guards", histogram_axis_allocation_guards) ||
 	    !CU_add_test(suite, "nd_stats value index guards", nd_stats_indexing_behaviour) ||
-	    !CU_add_test(suite, "nd_box ratio edge cases", nd_box_ratio_cases))
+	    !CU_add_test(suite, "nd_box ratio edge cases", nd_box_ratio_cases) ||
+	    !CU_add_test(suite, "nd_axis ratio products", nd_axis_ratio_product))
 	{
 		goto cleanup;
 	}
@@ -620,24 +620,83 @@ decode_properties(struct flatgeobuf_decode_ctx *ctx, Datum *values, bool *isnull
 	}
 }
 
-void
+/**
+ * Advance past the current feature, flagging the end of input.
+ */
+static void
+flatgeobuf_decode_advance(struct flatgeobuf_decode_ctx *ctx)
+{
+	flatgeobuf_ctx *fctx = ctx->ctx;
+
+	ctx->fid++;
+
+	POSTGIS_DEBUGF(3, "fid now %d", ctx->fid);
+
+	if (fctx->offset > fctx->size)
+		elog(ERROR, "flatgeobuf_decode_row: read past end of input");
+
+	if (fctx->search_results)
+	{
+		if (fctx->search_results_pos == fctx->search_results_len)
+			ctx->done = true;
+	}
+	else if (fctx->offset == fctx->size)
+	{
+		POSTGIS_DEBUGF(3, "reached end at %lld", fctx->offset);
+		ctx->done = true;
+	}
+}
+
+/**
+ * Decode the next feature into ctx->result.
+ *
+ * When a bbox filter is set, returns false for a feature that
+ * does not intersect it, leaving ctx->result untouched.
+ */
+bool
 flatgeobuf_decode_row(struct flatgeobuf_decode_ctx *ctx)
 {
 	HeapTuple heapTuple;
 	uint32_t natts = ctx->tupdesc->natts;
+	flatgeobuf_ctx *fctx = ctx->ctx;
+	Datum *values;
+	bool *isnull;
+
+	/* Jump straight to the next feature found by the index search */
+	if (fctx->search_results)
+	{
+		flatgeobuf_search_result *item = &fctx->search_results[fctx->search_results_pos++];
+		if (item->offset > fctx->size - fctx->features_offset)
+			elog(ERROR, "flatgeobuf: index entry points past end of input");
+		fctx->offset = fctx->features_offset + item->offset;
+		ctx->fid = item->index;
+	}
+
+	flatgeobuf_check_sizeprefix(fctx);
+	if (flatgeobuf_decode_feature(fctx))
+		elog(ERROR, "flatgeobuf_decode_feature: unsuccessful");
+
+	if (ctx->has_bbox)
+	{
+		const GBOX *gbox = fctx->lwgeom ? lwgeom_get_bbox(fctx->lwgeom) : NULL;
+		if (!gbox || !gbox_overlaps_2d(gbox, &ctx->bbox))
+		{
+			if (fctx->lwgeom)
+				lwgeom_free(fctx->lwgeom);
+			fctx->lwgeom = NULL;
+			flatgeobuf_decode_advance(ctx);
+			return false;
+		}
+	}
 
-	Datum *values = palloc0(natts * sizeof(Datum));
-	bool *isnull = palloc(natts * sizeof(bool));
+	values = palloc0(natts * sizeof(Datum));
+	isnull = palloc(natts * sizeof(bool));
 	for (uint32_t j = 0; j < natts; j++)
 		isnull[j] = true;
 	isnull[0] = false;
 
 	values[0] = Int32GetDatum(ctx->fid);
 
-	flatgeobuf_check_sizeprefix(ctx->ctx);
-	if (flatgeobuf_decode_feature(ctx->ctx))
-		elog(ERROR, "flatgeobuf_decode_feature: unsuccessful");
-
 	if (ctx->ctx->lwgeom != NULL)
 	{
 		values[1] = PointerGetDatum(geometry_serialize(ctx->ctx->lwgeom));
@@ -654,18 +713,9 @@ flatgeobuf_decode_row(struct flatgeobuf_decode_ctx *ctx)
 
 	heapTuple = heap_form_tuple(ctx->tupdesc, values, isnull);
 	ctx->result = HeapTupleGetDatum(heapTuple);
-	ctx->fid++;
-
-	POSTGIS_DEBUGF(3, "fid now %d", ctx->fid);
 
-	if (ctx->ctx->offset > ctx->ctx->size)
-		elog(ERROR, "flatgeobuf_decode_row: read past end of input");
-
-	if (ctx->ctx->offset == ctx->ctx->size)
-	{
-		POSTGIS_DEBUGF(3, "reached end at %lld", ctx->ctx->offset);
-		ctx->done = true;
-	}
+	flatgeobuf_decode_advance(ctx);
+	return true;
 }
 
 /**
@@ -716,7 +766,10 @@ flatgeobuf_agg_transfn(struct flatgeobuf_agg_ctx *ctx)
 	ctx->ctx->lwgeom = lwgeom;
 
 	if (ctx->ctx->features_count == 0)
+	{
 		flatgeobuf_encode_header(ctx->ctx);
+		ctx->ctx->features_offset = ctx->ctx->offset;
+	}
 
 	encode_properties(ctx);
 	if (ctx->ctx->create_index)
@@ -724,6 +777,230 @@ flatgeobuf_agg_transfn(struct flatgeobuf_agg_ctx *ctx)
 	flatgeobuf_encode_feature(ctx->ctx);
 }
 
+/**
+ * Fixed part of a serialized aggregation state, followed by the
+ * encoded buffer and, when an index is requested, the feature items.
+ */
+typedef struct flatgeobuf_agg_state
+{
+	uint64_t features_count;
+	uint64_t features_offset;
+	uint64_t offset;
+	int32_t srid;
+	uint32_t geom_index;
+	uint8_t geometry_type;
+	uint8_t lwgeom_type;
+	bool has_z;
+	bool has_m;
+	bool create_index;
+} flatgeobuf_agg_state;
+
+/**
+ * Serialize aggregation state so it can be passed between
+ * parallel workers.
+ */
+bytea *
+flatgeobuf_agg_serialize(struct flatgeobuf_agg_ctx *ctx)
+{
+	flatgeobuf_ctx *fctx = ctx->ctx;
+	flatgeobuf_agg_state state;
+	size_t items_size = fctx->create_index ? fctx->features_count * sizeof(flatgeobuf_item) : 0;
+	size_t size = VARHDRSZ + sizeof(state) + fctx->offset + items_size;
+	bytea *result = palloc(size);
+	uint8_t *p = (uint8_t *)VARDATA(result);
+
+	memset(&state, 0, sizeof(state));
+	state.features_count = fctx->features_count;
+	state.features_offset = fctx->features_offset;
+	state.offset = fctx->offset;
+	state.srid = fctx->srid;
+	state.geom_index = ctx->geom_index;
+	state.geometry_type = fctx->geometry_type;
+	state.lwgeom_type = fctx->lwgeom_type;
+	state.has_z = fctx->has_z;
+	state.has_m = fctx->has_m;
+	state.create_index = fctx->create_index;
+
+	memcpy(p, &state, sizeof(state));
+	p += sizeof(state);
+	memcpy(p, fctx->buf, fctx->offset);
+	p += fctx->offset;
+	if (fctx->create_index)
+	{
+		for (uint64_t i = 0; i < fctx->features_count; i++)
+		{
+			memcpy(p, fctx->items[i], sizeof(flatgeobuf_item));
+			p += sizeof(flatgeobuf_item);
+		}
+	}
+
+	SET_VARSIZE(result, size);
+	return result;
+}
+
+/**
+ * Restore aggregation state serialized by flatgeobuf_agg_serialize.
+ *
+ * The column definitions are recovered from the already encoded
+ * header, so no tuple descriptor is needed afterwards.
+ */
+struct flatgeobuf_agg_ctx *
+flatgeobuf_agg_deserialize(bytea *ba)
+{
+	struct flatgeobuf_agg_ctx *ctx;
+	flatgeobuf_ctx *fctx;
+	flatgeobuf_ctx hctx;
+	flatgeobuf_agg_state state;
+	const uint8_t *p = (const uint8_t *)VARDATA(ba);
+	size_t size = VARSIZE(ba) - VARHDRSZ;
+
+	if (size < sizeof(state))
+		elog(ERROR, "%s: invalid serialized state", __func__);
+	memcpy(&state, p, sizeof(state));
+	p += sizeof(state);
+	if (size - sizeof(state) < state.offset +
+		(state.create_index ? state.features_count * sizeof(flatgeobuf_item) : 0))
+		elog(ERROR, "%s: invalid serialized state", __func__);
+
+	ctx = flatgeobuf_agg_ctx_init(NULL, state.create_index);
+	fctx = ctx->ctx;
+	ctx->geom_index = state.geom_index;
+	fctx->features_count = state.features_count;
+	fctx->features_offset = state.features_offset;
+	fctx->srid = state.srid;
+	fctx->geometry_type = state.geometry_type;
+	fctx->lwgeom_type = state.lwgeom_type;
+	fctx->has_z = state.has_z;
+	fctx->has_m = state.has_m;
+
+	fctx->buf = lwrealloc(fctx->buf, state.offset);
+	memcpy(fctx->buf, p, state.offset);
+	p += state.offset;
+	fctx->offset = state.offset;
+
+	if (state.create_index && state.features_count > 0)
+	{
+		fctx->items_len = state.features_count;
+		fctx->items = palloc(sizeof(flatgeobuf_item *) * fctx->items_len);
+		for (uint64_t i = 0; i < state.features_count; i++)
+		{
+			fctx->items[i] = palloc(sizeof(flatgeobuf_item));
+			memcpy(fctx->items[i], p, sizeof(flatgeobuf_item));
+			p += sizeof(flatgeobuf_item);
+		}
+	}
+
+	if (state.features_count > 0)
+	{
+		memset(&hctx, 0, sizeof(hctx));
+		hctx.buf = fctx->buf;
+		hctx.size = fctx->features_offset;
+		hctx.offset = VARHDRSZ + FLATGEOBUF_MAGICBYTES_SIZE;
+		flatgeobuf_check_sizeprefix(&hctx);
+		if (flatgeobuf_decode_header(&hctx))
+			elog(ERROR, "%s: failed to decode header", __func__);
+		fctx->columns = hctx.columns;
+		fctx->columns_size = hctx.columns_size;
+		for (uint16_t i = 0; i < fctx->columns_size; i++)
+			fctx->columns[i]->name = pstrdup(fctx->columns[i]->name);
+	}
+
+	return ctx;
+}
+
+/**
+ * Append the features of ctx2 to ctx1 by decoding and encoding them
+ * again, used when the two states disagree on dimensionality.
+ */
+static void
+flatgeobuf_agg_reencode(struct flatgeobuf_agg_ctx *ctx1, struct flatgeobuf_agg_ctx *ctx2)
+{
+	flatgeobuf_ctx *dst = ctx1->ctx;
+	flatgeobuf_ctx *src = ctx2->ctx;
+	uint8_t *properties = dst->properties;
+	uint32_t properties_len = dst->properties_len;
+
+	src->size = src->offset;
+	src->offset = src->features_offset;
+	while (src->offset < src->size)
+	{
+		flatgeobuf_check_sizeprefix(src);
+		if (flatgeobuf_decode_feature(src))
+			elog(ERROR, "flatgeobuf_decode_feature: unsuccessful");
+		dst->lwgeom = src->lwgeom;
+		dst->properties = src->properties;
+		dst->properties_len = src->properties_len;
+		if (dst->create_index)
+			ensure_items_len(ctx1);
+		flatgeobuf_encode_feature(dst);
+		if (dst->lwgeom)
+			lwgeom_free(dst->lwgeom);
+	}
+	dst->lwgeom = NULL;
+	dst->properties = properties;
+	dst->properties_len = properties_len;
+}
+
+/**
+ * Combine two aggregation states, appending the features of ctx2
+ * to ctx1.
+ *
+ * Features encoded with the same dimensionality are copied as is,
+ * only shifting their index items to the new buffer offsets.
+ */
+struct flatgeobuf_agg_ctx *
+flatgeobuf_agg_combine(struct flatgeobuf_agg_ctx *ctx1, struct flatgeobuf_agg_ctx *ctx2)
+{
+	flatgeobuf_ctx *dst, *src;
+	uint64_t len;
+
+	if (ctx1 == NULL || ctx1->ctx->features_count == 0)
+		return ctx2;
+	if (ctx2 == NULL || ctx2->ctx->features_count == 0)
+		return ctx1;
+
+	/* A state holding only null geometries takes the type of the other */
+	if (ctx1->ctx->lwgeom_type == 0 && ctx2->ctx->lwgeom_type != 0)
+	{
+		struct flatgeobuf_agg_ctx *tmp = ctx1;
+		ctx1 = ctx2;
+		ctx2 = tmp;
+	}
+	dst = ctx1->ctx;
+	src = ctx2->ctx;
+
+	if (src->lwgeom_type != 0 && src->lwgeom_type != dst->lwgeom_type)
+		elog(ERROR, "flatgeobuf: mixed geometry type is not supported");
+
+	if (src->lwgeom_type != 0 && (src->has_z != dst->has_z || src->has_m != dst->has_m))
+	{
+		flatgeobuf_agg_reencode(ctx1, ctx2);
+		return ctx1;
+	}
+
+	len = src->offset - src->features_offset;
+	dst->buf = lwrealloc(dst->buf, dst->offset + len);
+	memcpy(dst->buf + dst->offset, src->buf + src->features_offset, len);
+
+	if (dst->create_index)
+	{
+		for (uint64_t i = 0; i < src->features_count; i++)
+		{
+			flatgeobuf_item *item = src->items[i];
+			ensure_items_len(ctx1);
+			item->offset = item->offset - src->features_offset + dst->offset;
+			dst->items[dst->features_count++] = item;
+		}
+	}
+	else
+	{
+		dst->features_count += src->features_count;
+	}
+	dst->offset += len;
+
+	return ctx1;
+}
+
 /**
  * Finalize aggregation.
  *
@@ -54,6 +54,9 @@ typedef struct flatgeobuf_agg_ctx {
 flatgeobuf_agg_ctx *flatgeobuf_agg_ctx_init(const char *geom_name, const bool create_index);
 void flatgeobuf_agg_transfn(flatgeobuf_agg_ctx *ctx);
 uint8_t *flatgeobuf_agg_finalfn(flatgeobuf_agg_ctx *ctx);
+bytea *flatgeobuf_agg_serialize(flatgeobuf_agg_ctx *ctx);
+flatgeobuf_agg_ctx *flatgeobuf_agg_deserialize(bytea *ba);
+flatgeobuf_agg_ctx *flatgeobuf_agg_combine(flatgeobuf_agg_ctx *ctx1, flatgeobuf_agg_ctx *ctx2);
 
 typedef struct flatgeobuf_decode_ctx {
 	flatgeobuf_ctx *ctx;
@@ -62,10 +65,12 @@ typedef struct flatgeobuf_decode_ctx {
 	Datum geom;
 	int fid;
 	bool done;
+	bool has_bbox;
+	GBOX bbox;
 } flatgeobuf_decode_ctx;
 
 void flatgeobuf_check_magicbytes(struct flatgeobuf_decode_ctx *ctx);
 void flatgeobuf_check_sizeprefix(flatgeobuf_ctx *ctx);
-void flatgeobuf_decode_row(struct flatgeobuf_decode_ctx *ctx);
+bool flatgeobuf_decode_row(struct flatgeobuf_decode_ctx *ctx);
 
 #endif
@@ -158,32 +158,34 @@ static void encode_properties(struct geobuf_agg_context *ctx,
 	feature->properties = properties;
 }
 
+/**
+ * Delta encode len points of pa into coords, which the caller has
+ * sized for the whole geometry. Returns the position after them.
+ */
 static int64_t *encode_coords(struct geobuf_agg_context *ctx, POINTARRAY *pa,
-	int64_t *coords, int len, int offset)
+	int64_t *coords, int len)
 {
-	int i, c;
+	int i;
 	POINT4D pt;
 	int64_t sum[] = { 0, 0, 0, 0 };
 
-	if (offset == 0)
-		coords = palloc(sizeof (int64_t) * len * ctx->dimensions);
-	else
-		coords = repalloc(coords, sizeof (int64_t) *
-			((len * ctx->dimensions) + offset));
-
-	c = offset;
 	for (i = 0; i < len; i++) {
 		getPoint4d_p(pa, i, &pt);
-		sum[0] += coords[c++] = (int64_t) (ceil(pt.x * ctx->e) - sum[0]);
-		sum[1] += coords[c++] = (int64_t) (ceil(pt.y * ctx->e) - sum[1]);
+		sum[0] += *coords++ = (int64_t) (ceil(pt.x * ctx->e) - sum[0]);
+		sum[1] += *coords++ = (int64_t) (ceil(pt.y * ctx->e) - sum[1]);
 		if (ctx->dimensions == 3)
-			sum[2] += coords[c++] = (int64_t) (ceil(pt.z * ctx->e) - sum[2]);
+			sum[2] += *coords++ = (int64_t) (ceil(pt.z * ctx->e) - sum[2]);
 		else if (ctx->dimensions == 4)
-			sum[3] += coords[c++] = (int64_t) (ceil(pt.m * ctx->e) - sum[3]);
+			sum[3] += *coords++ = (int64_t) (ceil(pt.m * ctx->e) - sum[3]);
 	}
 	return coords;
 }
 
+static int64_t *alloc_coords(struct geobuf_agg_context *ctx, size_t npoints)
+{
+	return palloc(sizeof (int64_t) * npoints * ctx->dimensions);
+}
+
 static Data__Geometry *encode_point(struct geobuf_agg_context *ctx,
 	LWPOINT *lwpoint)
 {
@@ -200,7 +202,8 @@ static Data__Geometry *encode_point(struct geobuf_agg_context *ctx,
 		return geometry;
 
 	geometry->n_coords = (size_t)npoints * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, 1, 0);
+	geometry->coords = alloc_coords(ctx, 1);
+	encode_coords(ctx, pa, geometry->coords, 1);
 
 	return geometry;
 }
@@ -228,7 +231,8 @@ static Data__Geometry *encode_mpoint(struct geobuf_agg_context *ctx,
 	}
 
 	geometry->n_coords = (size_t)ngeoms * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, ngeoms, 0);
+	geometry->coords = alloc_coords(ctx, ngeoms);
+	encode_coords(ctx, pa, geometry->coords, ngeoms);
 
 	return geometry;
 }
@@ -247,7 +251,8 @@ static Data__Geometry *encode_line(struct geobuf_agg_context *ctx,
 		return geometry;
 
 	geometry->n_coords = (size_t)pa->npoints * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, pa->npoints, 0);
+	geometry->coords = alloc_coords(ctx, pa->npoints);
+	encode_coords(ctx, pa, geometry->coords, pa->npoints);
 
 	return geometry;
 }
@@ -264,7 +269,8 @@ encode_triangle(struct geobuf_agg_context *ctx, LWTRIANGLE *lwtri)
 
 	len = pa->npoints - 1;
 	geometry->n_coords = (size_t)len * ctx->dimensions;
-	geometry->coords = encode_coords(ctx, pa, NULL, len, 0);
+	geometry->coords = alloc_coords(ctx, len);
+	encode_coords(ctx, pa, geometry->coords, len);
 
 	return geometry;
 }
@@ -272,11 +278,12 @@ encode_triangle(struct geobuf_agg_context *ctx, LWTRIANGLE *lwtri)
 static Data__Geometry *encode_mline(struct geobuf_agg_context *ctx,
 	LWMLINE *lwmline)
 {
-	int i, offset, ngeoms;
+	int i, ngeoms;
+	size_t npoints = 0;
 	POINTARRAY *pa;
 	Data__Geometry *geometry;
 	uint32_t *lengths;
-	int64_t *coords = NULL;
+	int64_t *coords, *c;
 
 	geometry = galloc(DATA__GEOMETRY__TYPE__MULTILINESTRING);
 
@@ -287,11 +294,13 @@ static Data__Geometry *encode_mline(struct geobuf_agg_context *ctx,
 
 	lengths = palloc (sizeof (uint32_t) * ngeoms);
 
-	offset = 0;
+	for (i = 0; i < ngeoms; i++)
+		npoints += lwmline->geoms[i]->points->npoints;
+	c = coords = alloc_coords(ctx, npoints);
+
 	for (i = 0; i < ngeoms; i++) {
 		pa = lwmline->geoms[i]->points;
-		coords = encode_coords(ctx, pa, coords, pa->npoints, offset);
-		offset += pa->npoints * ctx->dimensions;
+		c = encode_coords(ctx, pa, c, pa->npoints);
 		lengths[i] = pa->npoints;
 	}
 
@@ -300,7 +309,7 @@ static Data__Geometry *encode_mline(struct geobuf_agg_context *ctx,
 		geometry->lengths = lengths;
 	}
 
-	geometry->n_coords = offset;
+	geometry->n_coords = c - coords;
 	geometry->coords = coords;
 
 	return geometry;
@@ -309,11 +318,12 @@ static Data__Geometry *encode_mline(struct geobuf_agg_context *ctx,
 static Data__Geometry *encode_poly(struct geobuf_agg_context *ctx,
 	LWPOLY *lwpoly)
 {
-	int i, len, nrings, offset;
+	int i, len, nrings;
+	size_t npoints = 0;
 	POINTARRAY *pa;
 	Data__Geometry *geometry;
 	uint32_t *lengths;
-	int64_t *coords = NULL;
+	int64_t *coords, *c;
 
 	geometry = galloc(DATA__GEOMETRY__TYPE__POLYGON);
 
@@ -324,12 +334,15 @@ static Data__Geometry *encode_poly(struct geobuf_agg_context *ctx,
 
 	lengths = palloc (sizeof (uint32_t) * nrings);
 
-	offset = 0;
+	/* Closing points are implied */
+	for (i = 0; i < nrings; i++)
+		npoints += lwpoly->rings[i]->npoints - 1;
+	c = coords = alloc_coords(ctx, npoints);
+
 	for (i = 0; i < nrings; i++) {
 		pa = lwpoly->rings[i];
 		len = pa->npoints - 1;
-		coords = encode_coords(ctx, pa, coords, len, offset);
-		offset += len * ctx->dimensions;
+		c = encode_coords(ctx, pa, c, len);
 		lengths[i] = len;
 	}
 
@@ -338,7 +351,7 @@ static Data__Geometry *encode_poly(struct geobuf_agg_context *ctx,
 		geometry->lengths = lengths;
 	}
 
-	geometry->n_coords = offset;
+	geometry->n_coords = c - coords;
 	geometry->coords = coords;
 
 	return geometry;
@@ -347,11 +360,12 @@ static Data__Geometry *encode_poly(struct geobuf_agg_context *ctx,
 static Data__Geometry *encode_mpoly(struct geobuf_agg_context *ctx,
 	LWMPOLY* lwmpoly)
 {
-	int i, j, c, len, offset, n_lengths, ngeoms, nrings;
+	int i, j, c, len, n_lengths, ngeoms, nrings;
+	size_t npoints = 0;
 	POINTARRAY *pa;
 	Data__Geometry *geometry;
 	uint32_t *lengths;
-	int64_t *coords = NULL;
+	int64_t *coords, *cp;
 
 	geometry = galloc(DATA__GEOMETRY__TYPE__MULTIPOLYGON);
 
@@ -363,14 +377,16 @@ static Data__Geometry *encode_mpoly(struct geobuf_agg_context *ctx,
 	for (i = 0; i < ngeoms; i++) {
 		nrings = lwmpoly->geoms[i]->nrings;
 		n_lengths++;
-		for (j = 0; j < nrings; j++)
+		for (j = 0; j < nrings; j++) {
 			n_lengths++;
+			npoints += lwmpoly->geoms[i]->rings[j]->npoints - 1;
+		}
 	}
 
 	lengths = palloc (sizeof (uint32_t) * n_lengths);
+	cp = coords = alloc_coords(ctx, npoints);
 
 	c = 0;
-	offset = 0;
 	lengths[c++] = ngeoms;
 	for (i = 0; i < ngeoms; i++) {
 		nrings = lwmpoly->geoms[i]->nrings;
@@ -378,8 +394,7 @@ static Data__Geometry *encode_mpoly(struct geobuf_agg_context *ctx,
 		for (j = 0; j < nrings; j++) {
 			pa = lwmpoly->geoms[i]->rings[j];
 			len = pa->npoints - 1;
-			coords = encode_coords(ctx, pa, coords, len, offset);
-			offset += len * ctx->dimensions;
+			cp = encode_coords(ctx, pa, cp, len);
 			lengths[c++] = len;
 		}
 	}
@@ -389,7 +404,7 @@ static Data__Geometry *encode_mpoly(struct geobuf_agg_context *ctx,
 		geometry->lengths = lengths;
 	}
 
-	geometry->n_coords = offset;
+	geometry->n_coords = cp - coords;
 	geometry->coords = coords;
 
 	return geometry;
@@ -451,9 +466,14 @@ static Data__Geometry *encode_geometry(struct geobuf_agg_context *ctx,
 	return NULL;
 }
 
+/**
+ * Raise the scale until val is represented, so the scale ends up as
+ * the largest one needed by any value, whatever the order they come
+ * in. This lets partial aggregates simply keep the larger scale.
+ */
 static void analyze_val(struct geobuf_agg_context *ctx, double val)
 {
-	if (fabs((round(val * ctx->e) / ctx->e) - val) >= EPSILON &&
+	while (fabs((round(val * ctx->e) / ctx->e) - val) >= EPSILON &&
 		ctx->e < MAX_PRECISION)
 		ctx->e *= 10;
 }
@@ -548,6 +568,9 @@ void geobuf_agg_init_context(struct geobuf_agg_context *ctx)
 	ctx->precision = MAX_PRECISION;
 	ctx->e = 1;
 	ctx->features_capacity = FEATURES_CAPACITY_INITIAL;
+	ctx->geoms = NULL;
+	ctx->geoms_size = 0;
+	ctx->geoms_capacity = 0;
 
 	data = palloc(sizeof(*data));
 	data__init(data);
@@ -558,37 +581,62 @@ void geobuf_agg_init_context(struct geobuf_agg_context *ctx)
 	fc->features = palloc (ctx->features_capacity *
 		sizeof(*fc->features));
 
-	ctx->lwgeoms = palloc (ctx->features_capacity *
-		sizeof(*ctx->lwgeoms));
-
 	data->data_type_case = DATA__DATA_TYPE_FEATURE_COLLECTION;
 	data->feature_collection = fc;
 
 	ctx->data = data;
 }
 
+/**
+ * Copy a serialized geometry at the end of the geometry arena of
+ * the context. Every geometry starts on a MAXALIGN boundary, so it
+ * can be read in place, and the arena can be moved as a whole.
+ */
+static GSERIALIZED *geobuf_agg_append_geom(struct geobuf_agg_context *ctx,
+	const GSERIALIZED *gs)
+{
+	size_t size = VARSIZE(gs);
+	size_t padded_size = MAXALIGN(size);
+	uint8_t *ptr;
+
+	if (ctx->geoms_size + padded_size > ctx->geoms_capacity) {
+		size_t new_capacity = ctx->geoms_capacity ? ctx->geoms_capacity : 1024;
+		while (new_capacity < ctx->geoms_size + padded_size)
+			new_capacity *= 2;
+		if (ctx->geoms)
+			ctx->geoms = repalloc(ctx->geoms, new_capacity);
+		else
+			ctx->geoms = palloc(new_capacity);
+		ctx->geoms_capacity = new_capacity;
+	}
+
+	ptr = ctx->geoms + ctx->geoms_size;
+	memcpy(ptr, gs, size);
+	memset(ptr + size, 0, padded_size - size);
+	ctx->geoms_size += padded_size;
+	return (GSERIALIZED *) ptr;
+}
+
 /**
  * Aggregation step.
  *
  * Expands features array if needed by a factor of 2.
  * Allocates a new feature, increment feature counter and
- * encode properties into it.
- */
+ * encode properties into it. The geometry is kept serialized
+ * in the context until the precision is known.
+ */
 void geobuf_agg_transfn(struct geobuf_agg_context *ctx)
 {
 	LWGEOM *lwgeom;
 	bool isnull = false;
 	Datum datum;
 	Data__FeatureCollection *fc = ctx->data->feature_collection;
-/*	Data__Feature **features = fc->features; */
 	Data__Feature *feature;
 	GSERIALIZED *gs;
 	if (fc->n_features >= ctx->features_capacity) {
 		size_t new_capacity = ctx->features_capacity * 2;
 		fc->features = repalloc(fc->features, new_capacity *
 			sizeof(*fc->features));
-		ctx->lwgeoms = repalloc(ctx->lwgeoms, new_capacity *
-			sizeof(*ctx->lwgeoms));
 		ctx->features_capacity = new_capacity;
 	}
 
@@ -600,8 +648,10 @@ void geobuf_agg_transfn(struct geobuf_agg_context *ctx)
 	if (isnull)
 		return;
 
-	gs = (GSERIALIZED *) PG_DETOAST_DATUM_COPY(datum);
-	lwgeom = lwgeom_from_gserialized(gs);
+	gs = (GSERIALIZED *) PG_DETOAST_DATUM(datum);
+	lwgeom = lwgeom_from_gserialized(geobuf_agg_append_geom(ctx, gs));
+	if ((Pointer) gs != DatumGetPointer(datum))
+		pfree(gs);
 
 	feature = encode_feature(ctx);
 
@@ -610,8 +660,8 @@ void geobuf_agg_transfn(struct geobuf_agg_context *ctx)
 		analyze_geometry_flags(ctx, lwgeom);
 
 	analyze_geometry(ctx, lwgeom);
+	lwgeom_free(lwgeom);
 
-	ctx->lwgeoms[fc->n_features] = lwgeom;
 	fc->features[fc->n_features++] = feature;
 }
 
@@ -626,6 +676,7 @@ uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx)
 	Data *data;
 	Data__FeatureCollection *fc;
 	uint8_t *buf;
+	const uint8_t *geoms;
 
 	data = ctx->data;
 	fc = data->feature_collection;
@@ -645,8 +696,13 @@ uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx)
 		data->precision = ctx->precision;
 	}
 
-	for (i = 0; i < fc->n_features; i++)
-		fc->features[i]->geometry = encode_geometry(ctx, ctx->lwgeoms[i]);
+	for (i = 0, geoms = ctx->geoms; i < fc->n_features; i++) {
+		GSERIALIZED *gs = (GSERIALIZED *) geoms;
+		LWGEOM *lwgeom = lwgeom_from_gserialized(gs);
+		fc->features[i]->geometry = encode_geometry(ctx, lwgeom);
+		lwgeom_free(lwgeom);
+		geoms += MAXALIGN(VARSIZE(gs));
+	}
 
 	len = data__get_packed_size(data);
 	buf = palloc(sizeof(*buf) * (len + VARHDRSZ));
@@ -657,4 +713,163 @@ uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx)
 	return buf;
 }
 
+/**
+ * Fixed part of a serialized aggregation state, followed by the
+ * packed Data message holding keys and properties, then by the
+ * geometry arena.
+ */
+typedef struct geobuf_agg_state
+{
+	uint64_t data_size;
+	uint64_t geoms_size;
+	uint32_t geom_index;
+	uint32_t e;
+	uint32_t dimensions;
+	bool has_dimensions;
+} geobuf_agg_state;
+
+/* Geometry is a required field of a feature, stands in until finalfn */
+static Data__Geometry geobuf_geometry_placeholder = DATA__GEOMETRY__INIT;
+
+static void *geobuf_allocator(__attribute__((__unused__)) void *data, size_t size)
+{
+	return palloc(size);
+}
+
+static void geobuf_deallocator(__attribute__((__unused__)) void *data, void *ptr)
+{
+	pfree(ptr);
+}
+
+/**
+ * Serialize aggregation state so it can be passed between
+ * parallel workers.
+ */
+bytea *geobuf_agg_serialize(struct geobuf_agg_context *ctx)
+{
+	Data__FeatureCollection *fc = ctx->data->feature_collection;
+	geobuf_agg_state state;
+	size_t i, size;
+	bytea *result;
+	uint8_t *p;
+
+	for (i = 0; i < fc->n_features; i++)
+		if (!fc->features[i]->geometry)
+			fc->features[i]->geometry = &geobuf_geometry_placeholder;
+
+	memset(&state, 0, sizeof(state));
+	state.data_size = data__get_packed_size(ctx->data);
+	state.geoms_size = ctx->geoms_size;
+	state.geom_index = ctx->geom_index;
+	state.e = ctx->e;
+	state.dimensions = ctx->dimensions;
+	state.has_dimensions = ctx->has_dimensions;
+
+	size = VARHDRSZ + sizeof(state) + state.data_size + state.geoms_size;
+	result = palloc(size);
+	p = (uint8_t *) VARDATA(result);
+	memcpy(p, &state, sizeof(state));
+	p += sizeof(state);
+	p += data__pack(ctx->data, p);
+	if (ctx->geoms_size)
+		memcpy(p, ctx->geoms, ctx->geoms_size);
+
+	SET_VARSIZE(result, size);
+	return result;
+}
+
+/**
+ * Restore aggregation state serialized by geobuf_agg_serialize.
+ */
+struct geobuf_agg_context *geobuf_agg_deserialize(bytea *ba)
+{
+	ProtobufCAllocator allocator =
+	{
+		geobuf_allocator,
+		geobuf_deallocator,
+		NULL
+	};
+	struct geobuf_agg_context *ctx;
+	geobuf_agg_state state;
+	const uint8_t *p = (const uint8_t *) VARDATA(ba);
+	size_t size = VARSIZE(ba) - VARHDRSZ;
+
+	if (size < sizeof(state))
+		elog(ERROR, "%s: invalid serialized state", __func__);
+	memcpy(&state, p, sizeof(state));
+	p += sizeof(state);
+	if (size - sizeof(state) != state.data_size + state.geoms_size)
+		elog(ERROR, "%s: invalid serialized state", __func__);
+
+	ctx = palloc0(sizeof(*ctx));
+	ctx->data = data__unpack(&allocator, state.data_size, p);
+	if (!ctx->data || !ctx->data->feature_collection)
+		elog(ERROR, "%s: invalid serialized state", __func__);
+	p += state.data_size;
+
+	ctx->geom_index = state.geom_index;
+	ctx->e = state.e;
+	ctx->dimensions = state.dimensions;
+	ctx->has_dimensions = state.has_dimensions;
+	ctx->precision = MAX_PRECISION;
+	ctx->features_capacity = ctx->data->feature_collection->n_features;
+
+	/* palloc is MAXALIGNed, keeping the geometries aligned */
+	if (state.geoms_size) {
+		ctx->geoms = palloc(state.geoms_size);
+		memcpy(ctx->geoms, p, state.geoms_size);
+	}
+	ctx->geoms_size = ctx->geoms_capacity = state.geoms_size;
+
+	return ctx;
+}
+
+/**
+ * Combine two aggregation states by appending the features
+ * and geometries of the second one to the first one.
+ */
+struct geobuf_agg_context *geobuf_agg_combine(struct geobuf_agg_context *ctx1,
+	struct geobuf_agg_context *ctx2)
+{
+	Data__FeatureCollection *fc1, *fc2;
+	size_t n_features;
+
+	if (ctx1 == NULL)
+		return ctx2;
+	if (ctx2 == NULL)
+		return ctx1;
+
+	fc1 = ctx1->data->feature_collection;
+	fc2 = ctx2->data->feature_collection;
+	if (fc2->n_features == 0)
+		return ctx1;
+	if (fc1->n_features == 0)
+		return ctx2;
+
+	/* Feature properties refer to keys of the same row type, */
+	/* so the features move over as they are */
+	n_features = fc1->n_features + fc2->n_features;
+	if (n_features > ctx1->features_capacity) {
+		fc1->features = repalloc(fc1->features, n_features *
+			sizeof(*fc1->features));
+		ctx1->features_capacity = n_features;
+	}
+	memcpy(fc1->features + fc1->n_features, fc2->features,
+		fc2->n_features * sizeof(*fc2->features));
+	fc1->n_features = n_features;
+
+	if (ctx1->geoms_size + ctx2->geoms_size > ctx1->geoms_capacity) {
+		ctx1->geoms = repalloc(ctx1->geoms, ctx1->geoms_size + ctx2->geoms_size);
+		ctx1->geoms_capacity = ctx1->geoms_size + ctx2->geoms_size;
+	}
+	memcpy(ctx1->geoms + ctx1->geoms_size, ctx2->geoms, ctx2->geoms_size);
+	ctx1->geoms_size += ctx2->geoms_size;
+
+	/* The first feature sets the dimensions, the scale covers all values */
+	if (ctx2->e > ctx1->e)
+		ctx1->e = ctx2->e;
+
+	return ctx1;
+}
+
 #endif
@@ -50,7 +50,10 @@ struct geobuf_agg_context {
 	char *geom_name;
 	uint32_t geom_index;
 	HeapTupleHeader row;
-	LWGEOM **lwgeoms;
+	/* Serialized geometries of the features, one after the other */
+	uint8_t *geoms;
+	size_t geoms_size;
+	size_t geoms_capacity;
         Data *data;
         Data__Feature *feature;
 	size_t features_capacity;
@@ -64,6 +67,9 @@ struct geobuf_agg_context {
 void geobuf_agg_init_context(struct geobuf_agg_context *ctx);
 void geobuf_agg_transfn(struct geobuf_agg_context *ctx);
 uint8_t *geobuf_agg_finalfn(struct geobuf_agg_context *ctx);
+bytea *geobuf_agg_serialize(struct geobuf_agg_context *ctx);
+struct geobuf_agg_context *geobuf_agg_deserialize(bytea *ba);
+struct geobuf_agg_context *geobuf_agg_combine(struct geobuf_agg_context *ctx1, struct geobuf_agg_context *ctx2);
 
 #endif  /* HAVE_LIBPROTOBUF */
 
@@ -192,8 +192,7 @@ Datum geography_out(PG_FUNCTION_ARGS)
 {
 
 	GSERIALIZED *g = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom = lwgeom_from_gserialized(g);
-	PG_RETURN_CSTRING(lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED));
+	PG_RETURN_CSTRING((char *)gserialized_to_wkb_buffer(g, WKB_EXTENDED | WKB_HEX));
 }
 
 
@@ -588,6 +587,5 @@ PG_FUNCTION_INFO_V1(geography_send);
 Datum geography_send(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *g = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom = lwgeom_from_gserialized(g);
-	PG_RETURN_POINTER(lwgeom_to_wkb_varlena(lwgeom, WKB_EXTENDED));
+	PG_RETURN_POINTER(gserialized_to_wkb_varlena(g, WKB_EXTENDED));
 }
@@ -35,6 +35,7 @@
 
 #include "liblwgeom.h"                  /* For standard geometry types. */
 #include "liblwgeom_internal.h"         /* For FP comparators. */
+#include "lwgeodetic.h"                 /* For sphere_distance. */
 #include "lwgeom_pg.h"                  /* For debugging macros. */
 #include "geography.h"                  /* For utility functions. */
 #include "geography_measurement_trees.h" /* For circ_tree caching */
@@ -76,19 +77,17 @@ Datum geography_shortestline(PG_FUNCTION_ARGS);
 PG_FUNCTION_INFO_V1(geography_distance_knn);
 Datum geography_distance_knn(PG_FUNCTION_ARGS)
 {
+	SHARED_GSERIALIZED *shared_geom1 = ToastCacheGetGeometry(fcinfo, 0);
+	SHARED_GSERIALIZED *shared_geom2 = ToastCacheGetGeometry(fcinfo, 1);
+	const GSERIALIZED *g1 = shared_gserialized_get(shared_geom1);
+	const GSERIALIZED *g2 = shared_gserialized_get(shared_geom2);
 	LWGEOM *lwgeom1 = NULL;
 	LWGEOM *lwgeom2 = NULL;
-	GSERIALIZED *g1 = NULL;
-	GSERIALIZED *g2 = NULL;
 	double distance;
 	double tolerance = FP_TOLERANCE;
 	bool use_spheroid = false; /* must use sphere, can't get index to harmonize with spheroid */
 	SPHEROID s;
 
-	/* Get our geometry objects loaded into memory. */
-	g1 = PG_GETARG_GSERIALIZED_P(0);
-	g2 = PG_GETARG_GSERIALIZED_P(1);
-
 	gserialized_error_if_srid_mismatch(g1, g2, __func__);
 
 	/* Initialize spheroid */
@@ -98,17 +97,42 @@ Datum geography_distance_knn(PG_FUNCTION_ARGS)
 	if ( ! use_spheroid )
 		s.a = s.b = s.radius;
 
-	lwgeom1 = lwgeom_from_gserialized(g1);
-	lwgeom2 = lwgeom_from_gserialized(g2);
-
 	/* Return NULL on empty arguments. */
-	if ( lwgeom_is_empty(lwgeom1) || lwgeom_is_empty(lwgeom2) )
-	{
-		PG_FREE_IF_COPY(g1, 0);
-		PG_FREE_IF_COPY(g2, 1);
+	if ( gserialized_is_empty(g1) || gserialized_is_empty(g2) )
 		PG_RETURN_NULL();
+
+	/*
+	 * Point to point, the common case of index rechecks: the great circle
+	 * distance straight from the serialized coordinates, as computed by
+	 * lwgeom_distance_spheroid() on the sphere.
+	 */
+	if ( gserialized_get_type(g1) == POINTTYPE && gserialized_get_type(g2) == POINTTYPE )
+	{
+		POINT4D p1, p2;
+		GEOGRAPHIC_POINT gp1, gp2;
+
+		gserialized_peek_first_point(g1, &p1);
+		gserialized_peek_first_point(g2, &p2);
+		geographic_point_init(p1.x, p1.y, &gp1);
+		geographic_point_init(p2.x, p2.y, &gp2);
+		PG_RETURN_FLOAT8(s.radius * sphere_distance(&gp1, &gp2));
+	}
+
+	/*
+	 * The query argument is the same for all the rechecks of a scan, so
+	 * its circle tree is built once and cached across the calls.
+	 */
+	if ( LW_SUCCESS == geography_distance_cache(fcinfo, shared_geom1, shared_geom2, &s, &distance) )
+	{
+		POSTGIS_DEBUGF(2, "[GIST] '%s' got cached distance %g", __func__, distance);
+		if ( distance < 0.0 )
+			PG_RETURN_NULL();
+		PG_RETURN_FLOAT8(distance);
 	}
 
+	lwgeom1 = lwgeom_from_gserialized(g1);
+	lwgeom2 = lwgeom_from_gserialized(g2);
+
 	/* Make sure we have boxes attached */
 	lwgeom_add_bbox_deep(lwgeom1, NULL);
 	lwgeom_add_bbox_deep(lwgeom2, NULL);
@@ -120,8 +144,6 @@ Datum geography_distance_knn(PG_FUNCTION_ARGS)
 	/* Clean up */
 	lwgeom_free(lwgeom1);
 	lwgeom_free(lwgeom2);
-	PG_FREE_IF_COPY(g1, 0);
-	PG_FREE_IF_COPY(g2, 1);
 
 	/* Something went wrong, negative return... should already be eloged, return NULL */
 	if ( distance < 0.0 )
@@ -456,6 +478,7 @@ Datum geography_expand(PG_FUNCTION_ARGS)
 	GSERIALIZED *g = NULL;
 	GSERIALIZED *g_out = NULL;
 	double unit_distance, distance;
+	GBOX gbox;
 
 	/* Get a wholly-owned pointer to the geography */
 	g = PG_GETARG_GSERIALIZED_P_COPY(0);
@@ -467,8 +490,14 @@ Datum geography_expand(PG_FUNCTION_ARGS)
 	/* calculated on sphere */
 	unit_distance = 1.01 * distance / WGS84_RADIUS;
 
-	/* Try the expansion */
-	g_out = gserialized_expand(g, unit_distance);
+	/* Empty geographies have no box to expand */
+	gbox_init(&gbox);
+	if (gserialized_get_gbox_p(g, &gbox) == LW_FAILURE)
+		PG_RETURN_POINTER(g);
+
+	/* Try the expansion, growing each geocentric axis only as far as the angle can reach */
+	gbox_geocentric_expand(&gbox, unit_distance);
+	g_out = gserialized_set_gbox(g, &gbox);
 
 	/* If the expansion fails, the return our input */
 	if ( g_out == NULL )
@@ -143,6 +143,7 @@ static GBOX *spatial_index_read_extent(Oid idx_oid, int idx_att_num, int key_typ
 /* Other prototypes */
 float8 gserialized_joinsel_internal(PlannerInfo *root, List *args, JoinType jointype, int mode);
 float8 gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode);
+float8 gserialized_sel_within_distance(PlannerInfo *root, List *args, int varRelid, int mode, double distance);
 
 /* Old Prototype */
 Datum geometry_estimated_extent(PG_FUNCTION_ARGS);
@@ -1235,6 +1236,7 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 
 	double total_width = 0;            /* # of bytes used by sample */
 	double total_cell_count = 0;       /* # of cells in histogram affected by sample */
+	double *cell_diff;                 /* Difference grid of the histogram values */
 
 	ND_BOX sum;                        /* Sum of extents of sample boxes */
 	ND_BOX avg;                        /* Avg of extents of sample boxes */
@@ -1558,16 +1560,26 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 	 * up the values in the histogram, we could get the
 	 * histogram feature count.
 	 *
+	 * The portion is the product of per-axis portions, and along
+	 * each axis all the cells strictly inside the feature get the
+	 * same one. A feature thus adds at most 3^ndims blocks of
+	 * constant value, which we record as corner updates in a
+	 * difference grid integrated once at the end, so large
+	 * features cost no more than small ones.
 	 */
+	cell_diff = palloc0(sizeof(double) * histo_cells);
+
 	for ( i = 0; i < notnull_cnt; i++ )
 	{
 		const ND_BOX *nd_box;
 		ND_IBOX nd_ibox;
 		int at[ND_DIMS];
-		double num_cells = 0;
-		double min[ND_DIMS] = {0.0, 0.0, 0.0, 0.0};
-		double max[ND_DIMS] = {0.0, 0.0, 0.0, 0.0};
-		double cellsize[ND_DIMS] = {0.0, 0.0, 0.0, 0.0};
+		int piece[ND_DIMS];
+		int npieces[ND_DIMS];
+		int piece_min[ND_DIMS][3], piece_max[ND_DIMS][3];
+		double piece_ratio[ND_DIMS][3];
+		double num_cells = 1.0;
+		bool degenerate = false;
 
 		nd_box = sample_boxes[i];
 		if ( ! nd_box ) continue; /* Skip Null'ed out hard deviants */
@@ -1581,48 +1593,94 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 
 		/* Find the cells that overlap with this box and put them into the ND_IBOX */
 		nd_box_overlap(nd_stats, nd_box, &nd_ibox);
-		memset(at, 0, sizeof(int)*ND_DIMS);
 
 		POSTGIS_DEBUGF(3, " feature %d: ibox (%d, %d, %d, %d) (%d, %d, %d, %d)", i,
 		  nd_ibox.min[0], nd_ibox.min[1], nd_ibox.min[2], nd_ibox.min[3],
 		  nd_ibox.max[0], nd_ibox.max[1], nd_ibox.max[2], nd_ibox.max[3]);
 
+		/* Zero-volume boxes only count in the cells that fully contain them */
 		for ( d = 0; d < nd_stats->ndims; d++ )
-		{
-			/* Initialize the starting values */
-			at[d] = nd_ibox.min[d];
-			min[d] = nd_stats->extent.min[d];
-			max[d] = nd_stats->extent.max[d];
-			cellsize[d] = (max[d] - min[d])/(nd_stats->size[d]);
-		}
+			if ( nd_box->max[d] - nd_box->min[d] == 0.0 )
+				degenerate = true;
 
 		/*
-		 * Move through all the overlapped histogram cells values and
-		 * add the box overlap proportion to them.
+		 * Split the overlapped cells of every axis into the first cell,
+		 * the interior cells and the last cell, with their portions.
 		 */
+		for ( d = 0; d < nd_stats->ndims; d++ )
+		{
+			double min = nd_stats->extent.min[d];
+			double cellsize = (nd_stats->extent.max[d] - min) / nd_stats->size[d];
+			int lo = nd_ibox.min[d], hi = Max(nd_ibox.max[d], nd_ibox.min[d]);
+			double axis_cells;
+			int k;
+
+			npieces[d] = 0;
+			for ( k = 0; k < 3; k++ )
+			{
+				int c = (k == 0) ? lo : (k == 1) ? hi : lo + 1;
+				float4 cmin = min + (c+0) * cellsize;
+				float4 cmax = min + (c+1) * cellsize;
+
+				if ( (k == 1 && hi == lo) || (k == 2 && hi - lo < 2) )
+					continue;
+
+				piece_min[d][npieces[d]] = (k == 2) ? lo + 1 : c;
+				piece_max[d][npieces[d]] = (k == 2) ? hi - 1 : c;
+				piece_ratio[d][npieces[d]] = nd_axis_ratio(cmin, cmax, nd_box->min[d], nd_box->max[d], degenerate);
+				npieces[d]++;
+			}
+
+			axis_cells = 0.0;
+			for ( k = 0; k < npieces[d]; k++ )
+				axis_cells += piece_ratio[d][k] * (piece_max[d][k] - piece_min[d][k] + 1);
+			num_cells *= axis_cells;
+			piece[d] = 0;
+		}
+
+		/* Add every block of constant portion to the difference grid */
 		do
 		{
-			ND_BOX nd_cell = { {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0} };
-			double ratio;
-			/* Create a box for this histogram cell */
+			double ratio = 1.0;
+			int corner;
+
 			for ( d = 0; d < nd_stats->ndims; d++ )
+				ratio *= piece_ratio[d][piece[d]];
+
+			if ( ratio > 0.0 )
 			{
-				nd_cell.min[d] = min[d] + (at[d]+0) * cellsize[d];
-				nd_cell.max[d] = min[d] + (at[d]+1) * cellsize[d];
+				for ( corner = 0; corner < (1 << (int)nd_stats->ndims); corner++ )
+				{
+					double sign = 1.0;
+					int idx;
+					for ( d = 0; d < nd_stats->ndims; d++ )
+					{
+						if ( corner & (1 << d) )
+						{
+							at[d] = piece_max[d][piece[d]] + 1;
+							sign = -sign;
+						}
+						else
+							at[d] = piece_min[d][piece[d]];
+					}
+					/* Corners past the end of the grid have nothing to cancel */
+					idx = nd_stats_value_index(nd_stats, at);
+					if ( idx >= 0 )
+						cell_diff[idx] += sign * ratio;
+				}
 			}
 
-			/*
-			 * If a feature box is completely inside one cell the ratio will be
-			 * 1.0. If a feature box is 50% in two cells, each cell will get
-			 * 0.5 added on.
-			 */
-			ratio = nd_box_ratio(&nd_cell, nd_box, nd_stats->ndims);
-			nd_stats->value[nd_stats_value_index(nd_stats, at)] += ratio;
-			num_cells += ratio;
-			POSTGIS_DEBUGF(3, "               ratio (%.8g)  num_cells (%.8g)", ratio, num_cells);
-			POSTGIS_DEBUGF(3, "               at (%d, %d, %d, %d)", at[0], at[1], at[2], at[3]);
+			/* Next combination of pieces */
+			for ( d = 0; d < nd_stats->ndims; d++ )
+			{
+				if ( ++piece[d] < npieces[d] )
+					break;
+				piece[d] = 0;
+			}
 		}
-		while ( nd_increment(&nd_ibox, nd_stats->ndims, at) );
+		while ( d < nd_stats->ndims );
+
+		POSTGIS_DEBUGF(3, "               num_cells (%.8g)", num_cells);
 
 		/* Keep track of overall number of overlaps counted */
 		total_cell_count += num_cells;
@@ -1630,6 +1688,27 @@ compute_gserialized_stats_mode(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfu
 		histogram_features++;
 	}
 
+	/* Integrate the difference grid along each axis into the histogram */
+	{
+		int stride = 1;
+		for ( d = 0; d < nd_stats->ndims; d++ )
+		{
+			int size = (int)(nd_stats->size[d]);
+			for ( i = 0; i < histo_cells; i++ )
+			{
+				if ( (i / stride) % size )
+					cell_diff[i] += cell_diff[i - stride];
+			}
+			stride *= size;
+		}
+		for ( i = 0; i < histo_cells; i++ )
+		{
+			/* Cancellation can leave tiny negative residues in empty cells */
+			nd_stats->value[i] = cell_diff[i] > 0.0 ? cell_diff[i] : 0.0;
+		}
+		pfree(cell_diff);
+	}
+
 	POSTGIS_DEBUGF(3, " histogram_features: %d", histogram_features);
 	POSTGIS_DEBUGF(3, " sample_rows: %d", sample_rows);
 	POSTGIS_DEBUGF(3, " table_rows: %.6g", total_rows);
@@ -1790,8 +1869,11 @@ estimate_selectivity(const GBOX *box, const ND_STATS *nd_stats, int mode)
 	double cell_size[ND_DIMS];
 	double min[ND_DIMS];
 	double max[ND_DIMS];
+	double *axis_ratio[ND_DIMS];
 	double total_count = 0.0;
+	bool degenerate = false;
 	int ndims_max;
+	int k;
 
 	/* Calculate the overlap of the box on the histogram */
 	if ( ! nd_stats )
@@ -1849,7 +1931,11 @@ estimate_selectivity(const GBOX *box, const ND_STATS *nd_stats, int mode)
 		return FALLBACK_ND_SEL;
 	}
 
-	/* Work out some measurements of the histogram */
+	/*
+	 * Work out the share of each overlapped cell covered by the search
+	 * box, one axis at a time: the share of a cell is the product of
+	 * the shares of its row along every axis.
+	 */
 	for ( d = 0; d < nd_stats->ndims; d++ )
 	{
 		/* Cell size in each dim */
@@ -1858,32 +1944,54 @@ estimate_selectivity(const GBOX *box, const ND_STATS *nd_stats, int mode)
 		cell_size[d] = (max[d] - min[d]) / nd_stats->size[d];
 		POSTGIS_DEBUGF(3, " cell_size[%d] : %.9g", d, cell_size[d]);
 
+		/* Zero-volume cells only count when fully covered */
+		for ( k = nd_ibox.min[d]; k <= nd_ibox.max[d]; k++ )
+		{
+			float4 cmin = min[d] + (k+0) * cell_size[d];
+			float4 cmax = min[d] + (k+1) * cell_size[d];
+			if ( cmax - cmin == 0.0 )
+				degenerate = true;
+		}
+
 		/* Initialize the counter */
 		at[d] = nd_ibox.min[d];
 	}
 
+	for ( d = 0; d < nd_stats->ndims; d++ )
+	{
+		axis_ratio[d] = palloc(sizeof(double) * (Max(nd_ibox.max[d] - nd_ibox.min[d], 0) + 1));
+		for ( k = nd_ibox.min[d]; k <= Max(nd_ibox.max[d], nd_ibox.min[d]); k++ )
+		{
+			float4 cmin = min[d] + (k+0) * cell_size[d];
+			float4 cmax = min[d] + (k+1) * cell_size[d];
+			axis_ratio[d][k - nd_ibox.min[d]] = nd_axis_ratio(nd_box.min[d], nd_box.max[d], cmin, cmax, degenerate);
+		}
+	}
+
 	/* Move through all the overlap values and sum them */
 	do
 	{
-		float cell_count, ratio;
-		ND_BOX nd_cell = { {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0} };
+		double ratio = 1.0;
+		int idx;
 
 		/* We have to pro-rate partially overlapped cells. */
 		for ( d = 0; d < nd_stats->ndims; d++ )
-		{
-			nd_cell.min[d] = min[d] + (at[d]+0) * cell_size[d];
-			nd_cell.max[d] = min[d] + (at[d]+1) * cell_size[d];
-		}
+			ratio *= axis_ratio[d][at[d] - nd_ibox.min[d]];
 
-		ratio = nd_box_ratio(&nd_box, &nd_cell, nd_stats->ndims);
-		cell_count = nd_stats->value[nd_stats_value_index(nd_stats, at)];
+		if ( ratio == 0.0 )
+			continue;
 
 		/* Add the pro-rated count for this cell to the overall total */
-		total_count += (double)cell_count * ratio;
-		POSTGIS_DEBUGF(4, " cell (%d,%d), cell value %.6f, ratio %.6f", at[0], at[1], cell_count, ratio);
+		idx = nd_stats_value_index(nd_stats, at);
+		if ( idx >= 0 )
+			total_count += (double)nd_stats->value[idx] * ratio;
+		POSTGIS_DEBUGF(4, " cell (%d,%d), ratio %.6f", at[0], at[1], ratio);
 	}
 	while ( nd_increment(&nd_ibox, nd_stats->ndims, at) );
 
+	for ( d = 0; d < nd_stats->ndims; d++ )
+		pfree(axis_ratio[d]);
+
 	/* Scale by the number of features in our histogram to get the proportion */
 	selectivity = total_count / nd_stats->histogram_features;
 
@@ -2032,8 +2140,8 @@ Datum _postgis_gserialized_joinsel(PG_FUNCTION_ARGS)
  *
  */
 
-float8
-gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode)
+static float8
+gserialized_sel_box(PlannerInfo *root, List *args, int varRelid, int mode, double distance)
 {
 	VariableStatData vardata;
 	Node *other = NULL;
@@ -2074,6 +2182,19 @@ gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode)
 		return 0.0;
 	}
 
+	/* Within-distance searches look at the box grown by the radius */
+	if (distance > 0)
+	{
+		if (FLAGS_GET_GEODETIC(search_box.flags))
+		{
+			/* Same spheroid allowance as geography_expand, on the N-D stats geography uses */
+			gbox_geocentric_expand(&search_box, 1.01 * distance / WGS84_RADIUS);
+			mode = 0;
+		}
+		else
+			gbox_expand(&search_box, distance);
+	}
+
 	if (!vardata.statsTuple)
 	{
 		POSTGIS_DEBUGF(1, "%s: no statistics available on table. Empty? Need to ANALYZE?", __func__);
@@ -2089,6 +2210,24 @@ gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode)
 	return selectivity;
 }
 
+float8
+gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode)
+{
+	return gserialized_sel_box(root, args, varRelid, mode, 0.0);
+}
+
+/**
+ * Restriction selectivity of a "within distance" function, such as
+ * ST_DWithin(col, const, radius): the overlap estimate of the column
+ * against the constant's box grown by the radius. The args are the
+ * two geometry arguments only.
+ */
+float8
+gserialized_sel_within_distance(PlannerInfo *root, List *args, int varRelid, int mode, double distance)
+{
+	return gserialized_sel_box(root, args, varRelid, mode, distance);
+}
+
 PG_FUNCTION_INFO_V1(gserialized_gist_sel);
 Datum gserialized_gist_sel(PG_FUNCTION_ARGS)
 {
@@ -234,4 +234,23 @@ nd_box_ratio(const ND_BOX *cover, const ND_BOX *target, int ndims)
 	return ivol / refvol;
 }
 
+/*
+ * Share of the 'target' extent covered by 'cover' along one axis.
+ * nd_box_ratio() is the product of these shares over the axes, which lets
+ * the callers weight a whole row of cells at once.  When the target has a
+ * zero-width axis nd_box_ratio() only counts full coverage, so the callers
+ * pass 'degenerate' to get the matching 0/1 shares.
+ */
+static inline double
+nd_axis_ratio(double cover_min, double cover_max, double target_min, double target_max, bool degenerate)
+{
+	if (cover_max <= target_min || cover_min >= target_max)
+		return 0.0; /* Disjoint */
+
+	if (degenerate)
+		return (cover_min <= target_min && cover_max >= target_max) ? 1.0 : 0.0;
+
+	return (Min(cover_max, target_max) - Max(cover_min, target_min)) / (target_max - target_min);
+}
+
 #endif /* POSTGIS_GSERIALIZED_ESTIMATE_SUPPORT_H */
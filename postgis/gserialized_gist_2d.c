@@ -86,6 +86,10 @@ Datum gserialized_gist_union_2d(PG_FUNCTION_ARGS);
 Datum gserialized_gist_same_2d(PG_FUNCTION_ARGS);
 Datum gserialized_gist_distance_2d(PG_FUNCTION_ARGS);
 Datum gserialized_gist_sortsupport_2d(PG_FUNCTION_ARGS);
+Datum gserialized_gist_consistent_2d_compact(PG_FUNCTION_ARGS);
+Datum gserialized_gist_compress_2d_compact(PG_FUNCTION_ARGS);
+Datum gserialized_gist_decompress_2d_compact(PG_FUNCTION_ARGS);
+Datum gserialized_gist_distance_2d_compact(PG_FUNCTION_ARGS);
 
 /*
 ** GiST 2D operator prototypes
@@ -455,15 +459,10 @@ static double box2df_distance(const BOX2DF *a, const BOX2DF *b)
 static inline uint64_t
 box2df_get_sortable_hash(const BOX2DF *b)
 {
-	union floatuint {
-		uint32_t u;
-		float f;
-	} x, y;
+	uint32_t x = float_get_sortable_bits((b->xmax + b->xmin) / 2);
+	uint32_t y = float_get_sortable_bits((b->ymax + b->ymin) / 2);
 
-	x.f = (b->xmax + b->xmin) / 2;
-	y.f = (b->ymax + b->ymin) / 2;
-
-	return uint32_hilbert(y.u, x.u);
+	return uint32_hilbert(y, x);
 }
 
 /**
@@ -1197,6 +1196,279 @@ Datum gserialized_gist_distance_2d(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8(distance);
 }
 
+/***********************************************************************
+** Compact 2D keys.
+**
+** The gist_geometry_ops_2d_compact opclass stores its keys as bytea,
+** rounding every float of the BOX2DF outward on a coarser grid so the
+** key shrinks below the size of a BOX2DF. Once stored with a short
+** varlena header, a key holding a single grid cell takes 8 bytes and a
+** box takes 16, against 16 for every uncompressed BOX2DF, so point
+** columns get index tuples a third smaller.
+**
+** Keys are expanded back to BOX2DF by the decompress function, so the
+** union, penalty, picksplit and same functions of the 2D opclass are
+** shared. Since leaf keys are now larger than the real boxes, leaf
+** entries are tested like internal ones and rechecked.
+*/
+
+/* Bits kept of each float for single cell and for box keys */
+#define COMPACT_CELL_BITS 28
+#define COMPACT_BOX_BITS 30
+#define COMPACT_CELL_SIZE 7
+#define COMPACT_BOX_SIZE 15
+
+/* Inverse of float_get_sortable_bits */
+static inline float
+float_from_sortable_bits(uint32_t u)
+{
+	union floatuint {
+		uint32_t u;
+		float f;
+	} v;
+
+	v.u = (u & 0x80000000) ? (u & 0x7FFFFFFF) : ~u;
+	return v.f;
+}
+
+/* Lower and upper float bounds of a grid cell keeping nbits bits */
+static inline void
+compact_cell_bounds(uint32_t cell, uint32_t nbits, float *lo, float *hi)
+{
+	uint32_t shift = 32 - nbits;
+	uint32_t mask = (1U << shift) - 1;
+
+	*lo = float_from_sortable_bits(cell << shift);
+	*hi = float_from_sortable_bits((cell << shift) | mask);
+	/* Cells past the largest finite float decode as NaN */
+	if (isnan(*lo))
+		*lo = -1 * FLT_MAX;
+	if (isnan(*hi))
+		*hi = FLT_MAX;
+}
+
+static inline void
+uint64_put_be(uint8_t *buf, uint64_t v, int nbytes)
+{
+	int i;
+	for (i = nbytes - 1; i >= 0; i--)
+	{
+		buf[i] = v & 0xFF;
+		v >>= 8;
+	}
+}
+
+static inline uint64_t
+uint64_get_be(const uint8_t *buf, int nbytes)
+{
+	uint64_t v = 0;
+	int i;
+	for (i = 0; i < nbytes; i++)
+		v = (v << 8) | buf[i];
+	return v;
+}
+
+static bytea *
+box2df_compact_encode(const BOX2DF *b)
+{
+	bytea *key;
+	uint8_t *buf;
+	uint32_t xmin, xmax, ymin, ymax;
+	uint32_t cell_shift = 32 - COMPACT_CELL_BITS;
+	uint32_t box_shift = 32 - COMPACT_BOX_BITS;
+	size_t size;
+
+	/* Empty boxes are stored as an empty key */
+	if (box2df_is_empty(b))
+	{
+		key = palloc(VARHDRSZ);
+		SET_VARSIZE(key, VARHDRSZ);
+		return key;
+	}
+
+	xmin = float_get_sortable_bits(b->xmin);
+	xmax = float_get_sortable_bits(b->xmax);
+	ymin = float_get_sortable_bits(b->ymin);
+	ymax = float_get_sortable_bits(b->ymax);
+
+	if ((xmin >> cell_shift) == (xmax >> cell_shift) && (ymin >> cell_shift) == (ymax >> cell_shift))
+		size = COMPACT_CELL_SIZE;
+	else
+		size = COMPACT_BOX_SIZE;
+
+	key = palloc(VARHDRSZ + size);
+	SET_VARSIZE(key, VARHDRSZ + size);
+	buf = (uint8_t *)VARDATA(key);
+
+	if (size == COMPACT_CELL_SIZE)
+	{
+		uint64_t v = ((uint64_t)(xmin >> cell_shift) << COMPACT_CELL_BITS) | (ymin >> cell_shift);
+		uint64_put_be(buf, v, COMPACT_CELL_SIZE);
+	}
+	else
+	{
+		uint64_t hi = ((uint64_t)(xmin >> box_shift) << COMPACT_BOX_BITS) | (xmax >> box_shift);
+		uint64_t lo = ((uint64_t)(ymin >> box_shift) << COMPACT_BOX_BITS) | (ymax >> box_shift);
+		/* Two 60 bit halves, sharing the middle byte */
+		uint64_put_be(buf, (hi << 4) | (lo >> 56), 8);
+		uint64_put_be(buf + 8, lo & 0x00FFFFFFFFFFFFFFULL, 7);
+	}
+
+	return key;
+}
+
+static void
+box2df_compact_decode(bytea *key, BOX2DF *b)
+{
+	const uint8_t *buf = (const uint8_t *)VARDATA_ANY(key);
+	uint32_t cell_mask = (1U << COMPACT_CELL_BITS) - 1;
+	uint32_t box_mask = (1U << COMPACT_BOX_BITS) - 1;
+
+	switch (VARSIZE_ANY_EXHDR(key))
+	{
+	case 0:
+		box2df_set_empty(b);
+		break;
+	case COMPACT_CELL_SIZE:
+	{
+		uint64_t v = uint64_get_be(buf, COMPACT_CELL_SIZE);
+		compact_cell_bounds((v >> COMPACT_CELL_BITS) & cell_mask, COMPACT_CELL_BITS, &b->xmin, &b->xmax);
+		compact_cell_bounds(v & cell_mask, COMPACT_CELL_BITS, &b->ymin, &b->ymax);
+		break;
+	}
+	case COMPACT_BOX_SIZE:
+	{
+		uint64_t a = uint64_get_be(buf, 8);
+		uint64_t hi = a >> 4;
+		uint64_t lo = ((a & 0xF) << 56) | uint64_get_be(buf + 8, 7);
+		float unused;
+		compact_cell_bounds((hi >> COMPACT_BOX_BITS) & box_mask, COMPACT_BOX_BITS, &b->xmin, &unused);
+		compact_cell_bounds(hi & box_mask, COMPACT_BOX_BITS, &unused, &b->xmax);
+		compact_cell_bounds((lo >> COMPACT_BOX_BITS) & box_mask, COMPACT_BOX_BITS, &b->ymin, &unused);
+		compact_cell_bounds(lo & box_mask, COMPACT_BOX_BITS, &unused, &b->ymax);
+		break;
+	}
+	default:
+		elog(ERROR, "%s: invalid compact key size %d", __func__, (int)VARSIZE_ANY_EXHDR(key));
+	}
+}
+
+/*
+** GiST support function. Take in a query and an entry and see what the
+** relationship is, based on the query strategy. Compact leaf keys are
+** rounded outward, so they are tested like internal keys and rechecked.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_consistent_2d_compact);
+Datum gserialized_gist_consistent_2d_compact(PG_FUNCTION_ARGS)
+{
+	GISTENTRY *entry = (GISTENTRY*) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+	bool *recheck = (bool *) PG_GETARG_POINTER(4);
+	BOX2DF query_gbox_index;
+
+	*recheck = GIST_LEAF(entry);
+
+	if ( DatumGetPointer(PG_GETARG_DATUM(1)) == NULL )
+		PG_RETURN_BOOL(false);
+
+	if ( DatumGetPointer(entry->key) == NULL )
+		PG_RETURN_BOOL(false);
+
+	if ( gserialized_datum_get_box2df_p(PG_GETARG_DATUM(1), &query_gbox_index) == LW_FAILURE )
+		PG_RETURN_BOOL(false);
+
+	PG_RETURN_BOOL(gserialized_gist_consistent_internal_2d(
+	                   (BOX2DF*)DatumGetPointer(entry->key),
+	                   &query_gbox_index, strategy));
+}
+
+/*
+** GiST support function. Given a geometry or an internal BOX2DF key,
+** return a compact key.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_compress_2d_compact);
+Datum gserialized_gist_compress_2d_compact(PG_FUNCTION_ARGS)
+{
+	GISTENTRY *entry_in = (GISTENTRY*)PG_GETARG_POINTER(0);
+	GISTENTRY *entry_out = palloc(sizeof(GISTENTRY));
+	BOX2DF bbox_out;
+
+	POSTGIS_DEBUG(4, "[GIST] 'compress' function called");
+
+	/* Null key? Make a copy of the input entry and return. */
+	if ( DatumGetPointer(entry_in->key) == NULL )
+	{
+		gistentryinit(*entry_out, (Datum) 0, entry_in->rel,
+		              entry_in->page, entry_in->offset, entry_in->leafkey);
+		PG_RETURN_POINTER(entry_out);
+	}
+
+	if ( ! entry_in->leafkey )
+	{
+		/* Union and picksplit results are plain boxes */
+		bbox_out = *((BOX2DF*)DatumGetPointer(entry_in->key));
+	}
+	else if ( gserialized_datum_get_box2df_p(entry_in->key, &bbox_out) == LW_FAILURE )
+	{
+		/* Treat failure like NULL */
+		gistentryinit(*entry_out, (Datum) 0, entry_in->rel,
+		              entry_in->page, entry_in->offset, false);
+		PG_RETURN_POINTER(entry_out);
+	}
+	else if ( ! box2df_is_empty(&bbox_out) )
+	{
+		if ( ! isfinite(bbox_out.xmax) || ! isfinite(bbox_out.xmin) ||
+		     ! isfinite(bbox_out.ymax) || ! isfinite(bbox_out.ymin) )
+			box2df_set_finite(&bbox_out);
+		box2df_validate(&bbox_out);
+	}
+
+	gistentryinit(*entry_out, PointerGetDatum(box2df_compact_encode(&bbox_out)),
+	              entry_in->rel, entry_in->page, entry_in->offset, false);
+	PG_RETURN_POINTER(entry_out);
+}
+
+/*
+** GiST support function. Expand a compact key into a BOX2DF.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_decompress_2d_compact);
+Datum gserialized_gist_decompress_2d_compact(PG_FUNCTION_ARGS)
+{
+	GISTENTRY *entry_in = (GISTENTRY*)PG_GETARG_POINTER(0);
+	GISTENTRY *entry_out;
+	BOX2DF *box;
+
+	POSTGIS_DEBUG(5, "[GIST] 'decompress' function called");
+
+	if ( DatumGetPointer(entry_in->key) == NULL )
+		PG_RETURN_POINTER(entry_in);
+
+	box = palloc(sizeof(BOX2DF));
+	box2df_compact_decode((bytea*)DatumGetPointer(entry_in->key), box);
+
+	entry_out = palloc(sizeof(GISTENTRY));
+	gistentryinit(*entry_out, PointerGetDatum(box),
+	              entry_in->rel, entry_in->page, entry_in->offset, entry_in->leafkey);
+	PG_RETURN_POINTER(entry_out);
+}
+
+/*
+** GiST support function. Distance for compact keys, rechecking
+** leaves for both strategies since their boxes are rounded outward.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_distance_2d_compact);
+Datum gserialized_gist_distance_2d_compact(PG_FUNCTION_ARGS)
+{
+	GISTENTRY *entry = (GISTENTRY*) PG_GETARG_POINTER(0);
+	bool *recheck = (bool *) PG_GETARG_POINTER(4);
+	Datum distance = gserialized_gist_distance_2d(fcinfo);
+
+	if (GIST_LEAF(entry))
+		*recheck = true;
+
+	return distance;
+}
+
 /*
 ** Function to pack floats of different realms.
 ** This function serves to pack bit flags inside float type.
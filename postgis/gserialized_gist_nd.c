@@ -40,6 +40,7 @@
 #include "access/gist.h" /* For GiST */
 #include "access/itup.h"
 #include "access/skey.h"
+#include "utils/sortsupport.h" /* For index building sort support */
 
 #include "../postgis_config.h"
 
@@ -81,6 +82,8 @@ Datum gserialized_gist_penalty(PG_FUNCTION_ARGS);
 Datum gserialized_gist_picksplit(PG_FUNCTION_ARGS);
 Datum gserialized_gist_union(PG_FUNCTION_ARGS);
 Datum gserialized_gist_same(PG_FUNCTION_ARGS);
+Datum gserialized_gist_sortsupport(PG_FUNCTION_ARGS);
+Datum gserialized_gist_geog_sortsupport(PG_FUNCTION_ARGS);
 Datum gserialized_gist_distance(PG_FUNCTION_ARGS);
 Datum gserialized_gist_geog_distance(PG_FUNCTION_ARGS);
 
@@ -565,7 +568,7 @@ gserialized_datum_predicate_geom_gidx(Datum gs1, GIDX *gidx2, gidx_predicate pre
 /**
  * Calculate the box->box distance.
  */
-static double
+double
 gidx_distance(const GIDX *a, const GIDX *b, int m_is_time)
 {
 	int ndims, i;
@@ -1264,6 +1267,165 @@ Datum gserialized_gist_same(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+/* Spread the low 21 bits of x apart, leaving two zero bits between each */
+static inline uint64_t
+uint64_spread_3(uint64_t x)
+{
+	x &= 0x1FFFFFULL;
+	x = (x | (x << 32)) & 0x001F00000000FFFFULL;
+	x = (x | (x << 16)) & 0x001F0000FF0000FFULL;
+	x = (x | (x << 8)) & 0x100F00F00F00F00FULL;
+	x = (x | (x << 4)) & 0x10C30C30C30C30C3ULL;
+	x = (x | (x << 2)) & 0x1249249249249249ULL;
+	return x;
+}
+
+/*
+** Space filling curve key of the box center, used to sort keys for
+** bulk index builds. Two dimensional boxes use the same Hilbert curve
+** as the 2D opclass, higher dimensions a Morton curve over X, Y and Z.
+** Geography boxes are geocentric, within [-1, 1] on every axis, so
+** they are quantized linearly rather than by their float bits.
+*/
+static uint64_t
+gidx_get_sortable_hash(const GIDX *g, bool geocentric)
+{
+	uint32_t c[3] = {0, 0, 0};
+	uint32_t ndims, i;
+
+	if (gidx_is_unknown(g))
+		return 0;
+
+	ndims = Min(GIDX_NDIMS(g), 3);
+	for (i = 0; i < ndims; i++)
+	{
+		double center = ((double)GIDX_GET_MIN(g, i) + (double)GIDX_GET_MAX(g, i)) / 2;
+		if (geocentric)
+		{
+			center = Max(-1.0, Min(1.0, center));
+			c[i] = (uint32_t)((center + 1.0) / 2.0 * UINT32_MAX);
+		}
+		else
+			c[i] = float_get_sortable_bits((float)center);
+	}
+
+	if (ndims < 3)
+		return uint32_hilbert(c[1], c[0]);
+
+	return uint64_spread_3(c[0] >> 11) |
+	       (uint64_spread_3(c[1] >> 11) << 1) |
+	       (uint64_spread_3(c[2] >> 11) << 2);
+}
+
+static int
+gidx_cmp_sortable(const GIDX *a, const GIDX *b, bool geocentric)
+{
+	uint64_t hash1, hash2;
+	uint32_t size1 = VARSIZE(a);
+	uint32_t size2 = VARSIZE(b);
+	int cmp;
+
+	hash1 = gidx_get_sortable_hash(a, geocentric);
+	hash2 = gidx_get_sortable_hash(b, geocentric);
+	if (hash1 > hash2)
+		return 1;
+	else if (hash1 < hash2)
+		return -1;
+
+	/* Same curve position, fall back to a stable byte order */
+	if (size1 != size2)
+		return size1 > size2 ? 1 : -1;
+	cmp = memcmp(a, b, size1);
+	if (cmp == 0)
+		return 0;
+	return cmp > 0 ? 1 : -1;
+}
+
+static int
+gserialized_gist_cmp_full(Datum a, Datum b, SortSupport ssup)
+{
+	return gidx_cmp_sortable((GIDX *)DatumGetPointer(a), (GIDX *)DatumGetPointer(b), false);
+}
+
+static int
+gserialized_gist_geog_cmp_full(Datum a, Datum b, SortSupport ssup)
+{
+	return gidx_cmp_sortable((GIDX *)DatumGetPointer(a), (GIDX *)DatumGetPointer(b), true);
+}
+
+static int
+gserialized_gist_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	if (x == y)
+		return 0; /* 0 means "ask bigger comparator" and not equality */
+	else if (x > y)
+		return 1;
+	else
+		return -1;
+}
+
+static bool
+gserialized_gist_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return LW_FALSE;
+}
+
+static Datum
+gserialized_gist_abbrev_convert(Datum original, SortSupport ssup)
+{
+	return (Datum)gidx_get_sortable_hash((GIDX *)DatumGetPointer(original), false);
+}
+
+static Datum
+gserialized_gist_geog_abbrev_convert(Datum original, SortSupport ssup)
+{
+	return (Datum)gidx_get_sortable_hash((GIDX *)DatumGetPointer(original), true);
+}
+
+/*
+** GiST support function. Sort keys for sorted index builds.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_sortsupport);
+Datum gserialized_gist_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport)PG_GETARG_POINTER(0);
+
+	ssup->comparator = gserialized_gist_cmp_full;
+	ssup->ssup_extra = NULL;
+	/* Enable sortsupport only on 64 bit Datum */
+	if (ssup->abbreviate && sizeof(Datum) == 8)
+	{
+		ssup->comparator = gserialized_gist_cmp_abbrev;
+		ssup->abbrev_converter = gserialized_gist_abbrev_convert;
+		ssup->abbrev_abort = gserialized_gist_abbrev_abort;
+		ssup->abbrev_full_comparator = gserialized_gist_cmp_full;
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+** GiST support function. Sort geocentric keys for sorted index builds.
+*/
+PG_FUNCTION_INFO_V1(gserialized_gist_geog_sortsupport);
+Datum gserialized_gist_geog_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport)PG_GETARG_POINTER(0);
+
+	ssup->comparator = gserialized_gist_geog_cmp_full;
+	ssup->ssup_extra = NULL;
+	/* Enable sortsupport only on 64 bit Datum */
+	if (ssup->abbreviate && sizeof(Datum) == 8)
+	{
+		ssup->comparator = gserialized_gist_cmp_abbrev;
+		ssup->abbrev_converter = gserialized_gist_geog_abbrev_convert;
+		ssup->abbrev_abort = gserialized_gist_abbrev_abort;
+		ssup->abbrev_full_comparator = gserialized_gist_geog_cmp_full;
+	}
+
+	PG_RETURN_VOID();
+}
+
 PG_FUNCTION_INFO_V1(gserialized_gist_geog_distance);
 Datum gserialized_gist_geog_distance(PG_FUNCTION_ARGS)
 {
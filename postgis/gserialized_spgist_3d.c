@@ -363,6 +363,51 @@ overBack6D(CubeBox3D *cube_box, BOX3D *query)
 	return (cube_box->left.zmin >= query->zmin);
 }
 
+/*
+ * Lower bound of the planar distance between query and any box of cube_box.
+ *
+ * Only X and Y are used: the <<->> operator falls back to the 2D distance
+ * as soon as one of its arguments has no Z, while BOX3D keys of such
+ * geometries carry a zero Z range, so a bound including Z could exceed
+ * the exact distance.
+ */
+static double
+distance6D(CubeBox3D *cube_box, BOX3D *query)
+{
+	double dx = 0.0, dy = 0.0;
+
+	if (cube_box->right.xmax < query->xmin)
+		dx = query->xmin - cube_box->right.xmax;
+	else if (cube_box->left.xmin > query->xmax)
+		dx = cube_box->left.xmin - query->xmax;
+
+	if (cube_box->right.ymax < query->ymin)
+		dy = query->ymin - cube_box->right.ymax;
+	else if (cube_box->left.ymin > query->ymax)
+		dy = cube_box->left.ymin - query->ymax;
+
+	return sqrt(dx * dx + dy * dy);
+}
+
+/* Planar distance between a leaf box and the query box */
+static double
+distanceBox3D(BOX3D *leaf, BOX3D *query)
+{
+	double dx = 0.0, dy = 0.0;
+
+	if (leaf->xmax < query->xmin)
+		dx = query->xmin - leaf->xmax;
+	else if (leaf->xmin > query->xmax)
+		dx = leaf->xmin - query->xmax;
+
+	if (leaf->ymax < query->ymin)
+		dy = query->ymin - leaf->ymax;
+	else if (leaf->ymin > query->ymax)
+		dy = leaf->ymin - query->ymax;
+
+	return sqrt(dx * dx + dy * dy);
+}
+
 /*
  * SP-GiST config function
  */
@@ -515,6 +560,26 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_3d(PG_FUNCTION_ARGS)
 	BOX3D *centroid;
 	int *nodeNumbers;
 	void **traversalValues;
+	double **distances = NULL;
+	BOX3D **orderbys = NULL;
+
+	/*
+	 * We are saving the traversal value or initialize it an unbounded one, if
+	 * we have just begun to walk the tree.
+	 */
+	if (in->traversalValue)
+		cube_box = in->traversalValue;
+	else
+		cube_box = initCubeBox();
+
+	/* Bounding boxes of the ordering arguments, for KNN searches */
+	if (in->norderbys > 0)
+	{
+		orderbys = (BOX3D **)palloc(sizeof(BOX3D *) * in->norderbys);
+		for (i = 0; i < in->norderbys; i++)
+			orderbys[i] =
+			    DatumGetBox3DP(DirectFunctionCall1(LWGEOM_to_BOX3D, in->orderbys[i].sk_argument));
+	}
 
 	if (in->allTheSame)
 	{
@@ -524,24 +589,29 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_3d(PG_FUNCTION_ARGS)
 		for (i = 0; i < in->nNodes; i++)
 			out->nodeNumbers[i] = i;
 
+		if (in->norderbys > 0)
+		{
+			/* All nodes share the bounds of the current one */
+			int j;
+			out->distances = (double **)palloc(sizeof(double *) * in->nNodes);
+			out->distances[0] = (double *)palloc(sizeof(double) * in->norderbys);
+			for (j = 0; j < in->norderbys; j++)
+				out->distances[0][j] = distance6D(cube_box, orderbys[j]);
+			for (i = 1; i < in->nNodes; i++)
+				out->distances[i] = out->distances[0];
+		}
+
 		PG_RETURN_VOID();
 	}
 
-	/*
-	 * We are saving the traversal value or initialize it an unbounded one, if
-	 * we have just begun to walk the tree.
-	 */
-	if (in->traversalValue)
-		cube_box = in->traversalValue;
-	else
-		cube_box = initCubeBox();
-
 	centroid = DatumGetBox3DP(in->prefixDatum);
 
 	/* Allocate enough memory for nodes */
 	out->nNodes = 0;
 	nodeNumbers = (int *)palloc(sizeof(int) * in->nNodes);
 	traversalValues = (void **)palloc(sizeof(void *) * in->nNodes);
+	if (in->norderbys > 0)
+		distances = (double **)palloc(sizeof(double *) * in->nNodes);
 
 	/*
 	 * We switch memory context, because we want to allocate memory for new
@@ -632,6 +702,14 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_3d(PG_FUNCTION_ARGS)
 
 		if (flag)
 		{
+			if (in->norderbys > 0)
+			{
+				int j;
+				double *node_distances = (double *)palloc(sizeof(double) * in->norderbys);
+				for (j = 0; j < in->norderbys; j++)
+					node_distances[j] = distance6D(next_cube_box, orderbys[j]);
+				distances[out->nNodes] = node_distances;
+			}
 			traversalValues[out->nNodes] = next_cube_box;
 			nodeNumbers[out->nNodes] = octant;
 			out->nNodes++;
@@ -654,6 +732,13 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_3d(PG_FUNCTION_ARGS)
 		out->nodeNumbers[i] = nodeNumbers[i];
 		out->traversalValues[i] = traversalValues[i];
 	}
+	if (in->norderbys > 0)
+	{
+		out->distances = (double **)palloc(sizeof(double *) * out->nNodes);
+		for (i = 0; i < out->nNodes; i++)
+			out->distances[i] = distances[i];
+		pfree(distances);
+	}
 	pfree(nodeNumbers);
 	pfree(traversalValues);
 
@@ -764,6 +849,19 @@ PGDLLEXPORT Datum gserialized_spgist_leaf_consistent_3d(PG_FUNCTION_ARGS)
 			break;
 	}
 
+	/* Box distances are lower bounds, the executor rechecks them */
+	if (flag && in->norderbys > 0)
+	{
+		out->distances = (double *)palloc(sizeof(double) * in->norderbys);
+		out->recheckDistances = true;
+		for (i = 0; i < in->norderbys; i++)
+		{
+			BOX3D *box = DatumGetBox3DP(
+			    DirectFunctionCall1(LWGEOM_to_BOX3D, in->orderbys[i].sk_argument));
+			out->distances[i] = distanceBox3D(leaf, box);
+		}
+	}
+
 	PG_RETURN_BOOL(flag);
 }
 
@@ -74,6 +74,8 @@
 #include "lwgeom_pg.h"
 #include "gserialized_gist.h"
 
+#include <float.h>
+
 /* Maximum number of children nodes given that GIDX_MAX_DIM = 4 */
 #define GIDX_MAX_NODES 256
 
@@ -86,6 +88,8 @@ Datum gserialized_spgist_choose_nd(PG_FUNCTION_ARGS);
 Datum gserialized_spgist_picksplit_nd(PG_FUNCTION_ARGS);
 Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS);
 Datum gserialized_spgist_leaf_consistent_nd(PG_FUNCTION_ARGS);
+Datum gserialized_spgist_geog_inner_consistent_nd(PG_FUNCTION_ARGS);
+Datum gserialized_spgist_geog_leaf_consistent_nd(PG_FUNCTION_ARGS);
 Datum gserialized_spgist_compress_nd(PG_FUNCTION_ARGS);
 
 /* Structure storing the n-dimensional bounding box */
@@ -182,24 +186,37 @@ initCubeBox(int ndims)
  * All centroids are bounded by CubeGIDX, but SP-GiST only keeps
  * boxes.  When we are traversing the tree, we must calculate CubeGIDX,
  * using centroid and octant.
+ *
+ * The first fixed_dims dimensions are present in every key of the index
+ * (X and Y for geometries, the geocentric X, Y and Z for geographies), so
+ * the octant bits of these dimensions always line up with getOctant() and
+ * they can be narrowed unconditionally.
  */
 static CubeGIDX *
-nextCubeBox(CubeGIDX *cube_box, GIDX *centroid, uint16_t octant)
+nextCubeBox(CubeGIDX *cube_box, GIDX *centroid, uint16_t octant, int fixed_dims)
 {
-	int ndims = GIDX_NDIMS(centroid), i;
-	CubeGIDX *next_cube_box = (CubeGIDX *)palloc(sizeof(CubeGIDX));
-	GIDX *left = (GIDX *)palloc(GIDX_SIZE(ndims));
-	GIDX *right = (GIDX *)palloc(GIDX_SIZE(ndims));
+	int ndims = GIDX_NDIMS(centroid), cube_ndims = GIDX_NDIMS(cube_box->left), i;
+	CubeGIDX *next_cube_box;
 	uint16_t dim = 0x01;
 
-	memcpy(left, cube_box->left, VARSIZE(cube_box->left));
-	memcpy(right, cube_box->right, VARSIZE(cube_box->right));
-	next_cube_box->left = left;
-	next_cube_box->right = right;
+	/* The centroid may have more dimensions than its parent */
+	if (ndims > cube_ndims)
+	{
+		next_cube_box = initCubeBox(ndims);
+		memcpy(next_cube_box->left->c, cube_box->left->c, 2 * cube_ndims * sizeof(float));
+		memcpy(next_cube_box->right->c, cube_box->right->c, 2 * cube_ndims * sizeof(float));
+	}
+	else
+	{
+		next_cube_box = (CubeGIDX *)palloc(sizeof(CubeGIDX));
+		next_cube_box->left = gidx_copy(cube_box->left);
+		next_cube_box->right = gidx_copy(cube_box->right);
+	}
 
 	for (i = 0; i < ndims; i++)
 	{
-		if (GIDX_GET_MAX(cube_box->left, i) != FLT_MAX && GIDX_GET_MAX(centroid, i) != FLT_MAX)
+		if ((i < fixed_dims || GIDX_GET_MAX(next_cube_box->left, i) != FLT_MAX) &&
+		    GIDX_GET_MAX(centroid, i) != FLT_MAX)
 		{
 			if (octant & dim)
 				GIDX_GET_MIN(next_cube_box->right, i) = GIDX_GET_MAX(centroid, i);
@@ -258,6 +275,36 @@ containND(CubeGIDX *cube_box, GIDX *query)
 	return result;
 }
 
+/*
+ * Lower bound of the distance between query and any box of cube_box,
+ * computed the same way as gidx_distance() for the leaf boxes.
+ */
+static double
+distanceND(CubeGIDX *cube_box, GIDX *query)
+{
+	int i, ndims;
+	double sum = 0.0;
+
+	ndims = Min(GIDX_NDIMS(cube_box->left), GIDX_NDIMS(query));
+
+	for (i = 0; i < ndims; i++)
+	{
+		double d = 0.0;
+
+		/* If the missing dimension was not padded with -+FLT_MAX */
+		if (GIDX_GET_MAX(query, i) == FLT_MAX)
+			continue;
+
+		if (GIDX_GET_MAX(cube_box->right, i) < GIDX_GET_MIN(query, i))
+			d = (double)GIDX_GET_MIN(query, i) - GIDX_GET_MAX(cube_box->right, i);
+		else if (GIDX_GET_MIN(cube_box->left, i) > GIDX_GET_MAX(query, i))
+			d = (double)GIDX_GET_MIN(cube_box->left, i) - GIDX_GET_MAX(query, i);
+
+		sum += d * d;
+	}
+	return sqrt(sum);
+}
+
 /*
  * SP-GiST config function
  */
@@ -389,23 +436,61 @@ PGDLLEXPORT Datum gserialized_spgist_picksplit_nd(PG_FUNCTION_ARGS)
 }
 
 /*
- * SP-GiST inner consistent function
+ * Fill the KNN distances of the ordering arguments, scaled by the
+ * given factor (the earth radius for geocentric geography keys).
  */
-PG_FUNCTION_INFO_V1(gserialized_spgist_inner_consistent_nd);
+static double *
+spgist_nd_distances(CubeGIDX *cube_box, GIDX **orderbys, int norderbys, double factor)
+{
+	double *distances = (double *)palloc(sizeof(double) * norderbys);
+	int i;
 
-PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
+	for (i = 0; i < norderbys; i++)
+	{
+		if (orderbys[i])
+			distances[i] = factor * distanceND(cube_box, orderbys[i]);
+		else
+			distances[i] = 0.0;
+	}
+	return distances;
+}
+
+/*
+ * Inner consistent implementation shared by geometry and geography, the
+ * latter reporting distances in meters over the geocentric keys.
+ */
+static void
+gserialized_spgist_inner_consistent_internal(spgInnerConsistentIn *in, spgInnerConsistentOut *out, bool geodetic)
 {
-	spgInnerConsistentIn *in = (spgInnerConsistentIn *)PG_GETARG_POINTER(0);
-	spgInnerConsistentOut *out = (spgInnerConsistentOut *)PG_GETARG_POINTER(1);
 	MemoryContext old_ctx;
 	CubeGIDX *cube_box;
 	int *nodeNumbers, i, j;
 	void **traversalValues;
+	double **distances = NULL;
+	GIDX **orderbys = NULL;
 	char gidxmem[GIDX_MAX_SIZE];
 	GIDX *centroid, *query_gbox_index = (GIDX *)gidxmem;
+	int fixed_dims = geodetic ? 3 : 2;
+	double factor = geodetic ? WGS84_RADIUS : 1.0;
 
 	POSTGIS_DEBUG(4, "[SPGIST] 'inner consistent' function called");
 
+	centroid = (GIDX *)DatumGetPointer(in->prefixDatum);
+
+	/* Boxes of the ordering arguments, for KNN searches */
+	if (in->norderbys > 0)
+	{
+		orderbys = (GIDX **)palloc(sizeof(GIDX *) * in->norderbys);
+		for (i = 0; i < in->norderbys; i++)
+		{
+			Datum query = in->orderbys[i].sk_argument;
+			orderbys[i] = NULL;
+			if (DatumGetPointer(query) != NULL &&
+			    gserialized_datum_get_gidx_p(query, query_gbox_index) == LW_SUCCESS)
+				orderbys[i] = gidx_copy(query_gbox_index);
+		}
+	}
+
 	if (in->allTheSame)
 	{
 		/* Report that all nodes should be visited */
@@ -414,7 +499,16 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 		for (i = 0; i < in->nNodes; i++)
 			out->nodeNumbers[i] = i;
 
-		PG_RETURN_VOID();
+		if (in->norderbys > 0)
+		{
+			/* All nodes share the bounds of the current one */
+			cube_box = in->traversalValue ? in->traversalValue : initCubeBox(GIDX_NDIMS(centroid));
+			out->distances = (double **)palloc(sizeof(double *) * in->nNodes);
+			for (i = 0; i < in->nNodes; i++)
+				out->distances[i] = spgist_nd_distances(cube_box, orderbys, in->norderbys, factor);
+		}
+
+		return;
 	}
 
 	/*
@@ -424,8 +518,6 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 	 */
 	old_ctx = MemoryContextSwitchTo(in->traversalMemoryContext);
 
-	centroid = (GIDX *)DatumGetPointer(in->prefixDatum);
-
 	/*
 	 * We are saving the traversal value or initialize it an unbounded one, if
 	 * we have just begun to walk the tree.
@@ -439,10 +531,12 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 	out->nNodes = 0;
 	nodeNumbers = (int *)palloc(sizeof(int) * in->nNodes);
 	traversalValues = (void **)palloc(sizeof(void *) * in->nNodes);
+	if (in->norderbys > 0)
+		distances = (double **)palloc(sizeof(double *) * in->nNodes);
 
 	for (i = 0; i < in->nNodes; i++)
 	{
-		CubeGIDX *next_cube_box = nextCubeBox(cube_box, centroid, (uint16_t)i);
+		CubeGIDX *next_cube_box = nextCubeBox(cube_box, centroid, (uint16_t)i, fixed_dims);
 		bool flag = true;
 
 		for (j = 0; j < in->nkeys; j++)
@@ -489,6 +583,9 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 
 		if (flag)
 		{
+			if (in->norderbys > 0)
+				distances[out->nNodes] =
+				    spgist_nd_distances(next_cube_box, orderbys, in->norderbys, factor);
 			traversalValues[out->nNodes] = next_cube_box;
 			nodeNumbers[out->nNodes] = i;
 			out->nNodes++;
@@ -499,6 +596,8 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 			 * If this node is not selected, we don't need to keep the next
 			 * traversal value in the memory context.
 			 */
+			pfree(next_cube_box->left);
+			pfree(next_cube_box->right);
 			pfree(next_cube_box);
 		}
 	}
@@ -511,24 +610,56 @@ PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
 		out->nodeNumbers[i] = nodeNumbers[i];
 		out->traversalValues[i] = traversalValues[i];
 	}
+	if (in->norderbys > 0)
+	{
+		out->distances = (double **)palloc(sizeof(double *) * out->nNodes);
+		for (i = 0; i < out->nNodes; i++)
+			out->distances[i] = distances[i];
+		pfree(distances);
+	}
 	pfree(nodeNumbers);
 	pfree(traversalValues);
 
 	/* Switch after */
 	MemoryContextSwitchTo(old_ctx);
+}
+
+/*
+ * SP-GiST inner consistent function
+ */
+PG_FUNCTION_INFO_V1(gserialized_spgist_inner_consistent_nd);
+
+PGDLLEXPORT Datum gserialized_spgist_inner_consistent_nd(PG_FUNCTION_ARGS)
+{
+	spgInnerConsistentIn *in = (spgInnerConsistentIn *)PG_GETARG_POINTER(0);
+	spgInnerConsistentOut *out = (spgInnerConsistentOut *)PG_GETARG_POINTER(1);
+
+	gserialized_spgist_inner_consistent_internal(in, out, false);
 
 	PG_RETURN_VOID();
 }
 
 /*
- * SP-GiST inner consistent function
+ * SP-GiST inner consistent function for geography
  */
-PG_FUNCTION_INFO_V1(gserialized_spgist_leaf_consistent_nd);
+PG_FUNCTION_INFO_V1(gserialized_spgist_geog_inner_consistent_nd);
 
-PGDLLEXPORT Datum gserialized_spgist_leaf_consistent_nd(PG_FUNCTION_ARGS)
+PGDLLEXPORT Datum gserialized_spgist_geog_inner_consistent_nd(PG_FUNCTION_ARGS)
+{
+	spgInnerConsistentIn *in = (spgInnerConsistentIn *)PG_GETARG_POINTER(0);
+	spgInnerConsistentOut *out = (spgInnerConsistentOut *)PG_GETARG_POINTER(1);
+
+	gserialized_spgist_inner_consistent_internal(in, out, true);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Leaf consistent implementation shared by geometry and geography
+ */
+static bool
+gserialized_spgist_leaf_consistent_internal(spgLeafConsistentIn *in, spgLeafConsistentOut *out, bool geodetic)
 {
-	spgLeafConsistentIn *in = (spgLeafConsistentIn *)PG_GETARG_POINTER(0);
-	spgLeafConsistentOut *out = (spgLeafConsistentOut *)PG_GETARG_POINTER(1);
 	bool flag = true;
 	int i;
 	char gidxmem[GIDX_MAX_SIZE];
@@ -589,7 +720,52 @@ PGDLLEXPORT Datum gserialized_spgist_leaf_consistent_nd(PG_FUNCTION_ARGS)
 			break;
 	}
 
-	PG_RETURN_BOOL(flag);
+	/* Box distances are lower bounds, the executor rechecks them */
+	if (flag && in->norderbys > 0)
+	{
+		out->distances = (double *)palloc(sizeof(double) * in->norderbys);
+		out->recheckDistances = true;
+		for (i = 0; i < in->norderbys; i++)
+		{
+			Datum query = in->orderbys[i].sk_argument;
+
+			if (gidx_is_unknown(leaf) || DatumGetPointer(query) == NULL ||
+			    gserialized_datum_get_gidx_p(query, query_gbox_index) == LW_FAILURE)
+				out->distances[i] = DBL_MAX;
+			else if (geodetic)
+				out->distances[i] = WGS84_RADIUS * gidx_distance(leaf, query_gbox_index, 0);
+			else
+				out->distances[i] = gidx_distance(leaf, query_gbox_index, 0);
+		}
+	}
+
+	return flag;
+}
+
+/*
+ * SP-GiST leaf consistent function
+ */
+PG_FUNCTION_INFO_V1(gserialized_spgist_leaf_consistent_nd);
+
+PGDLLEXPORT Datum gserialized_spgist_leaf_consistent_nd(PG_FUNCTION_ARGS)
+{
+	spgLeafConsistentIn *in = (spgLeafConsistentIn *)PG_GETARG_POINTER(0);
+	spgLeafConsistentOut *out = (spgLeafConsistentOut *)PG_GETARG_POINTER(1);
+
+	PG_RETURN_BOOL(gserialized_spgist_leaf_consistent_internal(in, out, false));
+}
+
+/*
+ * SP-GiST leaf consistent function for geography
+ */
+PG_FUNCTION_INFO_V1(gserialized_spgist_geog_leaf_consistent_nd);
+
+PGDLLEXPORT Datum gserialized_spgist_geog_leaf_consistent_nd(PG_FUNCTION_ARGS)
+{
+	spgLeafConsistentIn *in = (spgLeafConsistentIn *)PG_GETARG_POINTER(0);
+	spgLeafConsistentOut *out = (spgLeafConsistentOut *)PG_GETARG_POINTER(1);
+
+	PG_RETURN_BOOL(gserialized_spgist_leaf_consistent_internal(in, out, true));
 }
 
 PG_FUNCTION_INFO_V1(gserialized_spgist_compress_nd);
@@ -52,6 +52,7 @@ Datum postgis_index_supportfn(PG_FUNCTION_ARGS);
 /* From gserialized_estimate.c */
 float8 gserialized_joinsel_internal(PlannerInfo *root, List *args, JoinType jointype, int mode);
 float8 gserialized_sel_internal(PlannerInfo *root, List *args, int varRelid, int mode);
+float8 gserialized_sel_within_distance(PlannerInfo *root, List *args, int varRelid, int mode, double distance);
 
 enum ST_FUNCTION_IDX
 {
@@ -71,7 +72,8 @@ enum ST_FUNCTION_IDX
 	ST_3DDFULLYWITHIN_IDX = 13,
 	ST_LINECROSSINGDIRECTION_IDX = 14,
 	ST_ORDERINGEQUALS_IDX = 15,
-	ST_EQUALS_IDX = 16
+	ST_EQUALS_IDX = 16,
+	ST_CPAWITHIN_IDX = 17
 };
 
 static const int16 GeometryStrategies[] = {
@@ -91,7 +93,8 @@ static const int16 GeometryStrategies[] = {
 	[ST_3DDFULLYWITHIN_IDX]         = RTOverlapStrategyNumber,
 	[ST_LINECROSSINGDIRECTION_IDX]  = RTOverlapStrategyNumber,
 	[ST_ORDERINGEQUALS_IDX]         = RTSameStrategyNumber,
-	[ST_EQUALS_IDX]                 = RTSameStrategyNumber
+	[ST_EQUALS_IDX]                 = RTSameStrategyNumber,
+	[ST_CPAWITHIN_IDX]              = RTOverlapStrategyNumber
 };
 
 /* We use InvalidStrategy for the functions that don't currently exist for geography */
@@ -112,7 +115,8 @@ static const int16 GeographyStrategies[] = {
 	[ST_3DDFULLYWITHIN_IDX]         = InvalidStrategy,
 	[ST_LINECROSSINGDIRECTION_IDX]  = InvalidStrategy,
 	[ST_ORDERINGEQUALS_IDX]         = InvalidStrategy,
-	[ST_EQUALS_IDX]                 = InvalidStrategy
+	[ST_EQUALS_IDX]                 = InvalidStrategy,
+	[ST_CPAWITHIN_IDX]              = InvalidStrategy
 };
 
 static int16
@@ -172,6 +176,7 @@ static const IndexableFunction IndexableFunctions[] = {
 	{"st_linecrossingdirection", ST_LINECROSSINGDIRECTION_IDX, 2, 0, 2},
 	{"st_orderingequals", ST_ORDERINGEQUALS_IDX, 2, 0, 2},
 	{"st_equals", ST_EQUALS_IDX, 2, 0, 2},
+	{"st_cpawithin", ST_CPAWITHIN_IDX, 3, 3, 3},
 	{NULL, 0, 0, 0, 0}
 };
 
@@ -273,19 +278,21 @@ opFamilyAmOid(Oid opfamilyoid, uint8_t* dims)
 * To apply the "expand for radius search" pattern
 * we need access to the expand function, so lookup
 * the function Oid using the function name and
-* type number.
+* type number. The two argument form expands every
+* dimension by the radius, the five argument form
+* (geometry only) takes separate x, y, z and m deltas.
 */
 static Oid
-expandFunctionOid(Oid geotype, Oid callingfunc)
+expandFunctionOid(Oid geotype, Oid callingfunc, int nargs)
 {
 	const Oid radiustype = FLOAT8OID; /* Should always be FLOAT8OID */
-	const Oid expandfn_args[2] = {geotype, radiustype};
+	const Oid expandfn_args[5] = {geotype, radiustype, radiustype, radiustype, radiustype};
 	const bool noError = true;
 	/* Expand function must be in same namespace as the caller */
 	char *nspname = get_namespace_name(get_func_namespace(callingfunc));
 	List *expandfn_name = list_make2(makeString(nspname), makeString("st_expand"));
-	Oid expandfn_oid = LookupFuncName(expandfn_name, 2, expandfn_args, noError);
-	if (expandfn_oid == InvalidOid)
+	Oid expandfn_oid = LookupFuncName(expandfn_name, nargs, expandfn_args, noError);
+	if (expandfn_oid == InvalidOid && nargs == 2)
 	{
 		/*
 		* This is ugly, but we first lookup the geometry variant of expand
@@ -294,10 +301,10 @@ expandFunctionOid(Oid geotype, Oid callingfunc)
 		* one, which would not be the end of the world.
 		*/
 		expandfn_name = list_make2(makeString(nspname), makeString("_st_expand"));
-		expandfn_oid = LookupFuncName(expandfn_name, 2, expandfn_args, noError);
-		if (expandfn_oid == InvalidOid)
-			elog(ERROR, "%s: unable to lookup 'st_expand(Oid[%u], Oid[%u])'", __func__, geotype, radiustype);
+		expandfn_oid = LookupFuncName(expandfn_name, nargs, expandfn_args, noError);
 	}
+	if (expandfn_oid == InvalidOid)
+		elog(ERROR, "%s: unable to lookup 'st_expand(Oid[%u], Oid[%u])' with %d arguments", __func__, geotype, radiustype, nargs);
 	return expandfn_oid;
 }
 
@@ -388,7 +395,26 @@ Datum postgis_index_supportfn(PG_FUNCTION_ARGS)
 		}
 		else
 		{
-			req->selectivity = gserialized_sel_internal(req->root, req->args, req->varRelid, 2);
+			IndexableFunction idxfn = {NULL, 0, 0, 0, 0};
+			Node *radiusarg = NULL;
+
+			/* With a constant radius, within-distance calls are estimated on the grown box */
+			if (needsSpatialIndex(req->funcid, &idxfn) && idxfn.expand_arg &&
+			    list_length(req->args) >= idxfn.expand_arg)
+				radiusarg = estimate_expression_value(req->root, (Node *)list_nth(req->args, idxfn.expand_arg - 1));
+
+			if (radiusarg && IsA(radiusarg, Const) && !((Const *)radiusarg)->constisnull &&
+			    ((Const *)radiusarg)->consttype == FLOAT8OID)
+			{
+				req->selectivity = gserialized_sel_within_distance(
+				    req->root,
+				    list_make2(linitial(req->args), lsecond(req->args)),
+				    req->varRelid,
+				    2,
+				    DatumGetFloat8(((Const *)radiusarg)->constvalue));
+			}
+			else
+				req->selectivity = gserialized_sel_internal(req->root, req->args, req->varRelid, 2);
 		}
 		POSTGIS_DEBUGF(2, "%s: got selectivity %g", __func__, req->selectivity);
 		PG_RETURN_POINTER(req);
@@ -515,10 +541,30 @@ Datum postgis_index_supportfn(PG_FUNCTION_ARGS)
 				{
 					Expr *expr;
 					Node *radiusarg = (Node *) list_nth(clause->args, idxfn.expand_arg-1);
-					Oid expandfn_oid = expandFunctionOid(rightdatatype, clause->funcid);
+					List *expandargs;
+					Oid expandfn_oid;
+					FuncExpr *expandexpr;
 
-					FuncExpr *expandexpr = makeFuncExpr(expandfn_oid, rightdatatype,
-					    list_make2(rightarg, radiusarg),
+					/*
+					* ST_CPAWithin compares positions at a common time,
+					* so the measure is a time axis and not a distance:
+					* expand x, y and z by the radius but keep the M range,
+					* which lets an ND index (&&&) prune on time as well.
+					* st_cpawithin(g1, g2, radius) yields:
+					* g1 &&& st_expand(g2, radius, radius, radius, 0)
+					*/
+					if (idxfn.index == ST_CPAWITHIN_IDX)
+					{
+						Node *zeroarg = (Node *) makeConst(FLOAT8OID, -1, InvalidOid,
+						    sizeof(float8), Float8GetDatum(0.0), false, FLOAT8PASSBYVAL);
+						expandargs = lappend(list_make4(rightarg, radiusarg, radiusarg, radiusarg), zeroarg);
+					}
+					else
+					{
+						expandargs = list_make2(rightarg, radiusarg);
+					}
+					expandfn_oid = expandFunctionOid(rightdatatype, clause->funcid, list_length(expandargs));
+					expandexpr = makeFuncExpr(expandfn_oid, rightdatatype, expandargs,
 						InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
 
 					/*
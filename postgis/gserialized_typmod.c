@@ -152,7 +152,11 @@ GSERIALIZED* postgis_valid_typmod(GSERIALIZED *gser, int32_t typmod)
 	/* Typmod has a preference for SRID, but geometry does not? Harmonize the geometry SRID. */
 	if ( typmod_srid > 0 && geom_srid == 0 )
 	{
+		int32_t hash;
 		gserialized_set_srid(gser, typmod_srid);
+		/* A stored hash covers the SRID, refresh it in place */
+		if (gserialized_get_stored_hash(gser, &hash))
+			gserialized_set_hash(gser);
 		geom_srid = typmod_srid;
 	}
 
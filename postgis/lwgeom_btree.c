@@ -28,6 +28,7 @@
 #include "postgres.h"
 #include "fmgr.h"
 #include "access/hash.h"
+#include "access/detoast.h" /* For toast_raw_datum_size */
 #include "utils/geo_decls.h"
 #include "utils/sortsupport.h" /* SortSupport */
 
@@ -48,6 +49,42 @@ Datum lwgeom_ge(PG_FUNCTION_ARGS);
 Datum lwgeom_gt(PG_FUNCTION_ARGS);
 Datum lwgeom_cmp(PG_FUNCTION_ARGS);
 
+/*
+ * Below this size a geometry is cheaper to detoast whole than to
+ * read its header first to look for a stored hash.
+ */
+#define STORED_HASH_MIN_SIZE (64 * 1024)
+
+static bool
+lwgeom_is_large_toasted(Datum d)
+{
+	return VARATT_IS_EXTENDED(DatumGetPointer(d)) && toast_raw_datum_size(d) >= STORED_HASH_MIN_SIZE;
+}
+
+/*
+ * Large geometries stamped with postgis_addhash can be told apart
+ * from their headers alone, without detoasting the coordinates.
+ */
+static bool
+lwgeom_stored_hashes_differ(FunctionCallInfo fcinfo)
+{
+	GSERIALIZED *h1, *h2;
+	int32_t hash1, hash2;
+	bool differ;
+
+	if (!lwgeom_is_large_toasted(PG_GETARG_DATUM(0)) || !lwgeom_is_large_toasted(PG_GETARG_DATUM(1)))
+		return false;
+
+	h1 = PG_GETARG_GSERIALIZED_HEADER(0);
+	h2 = PG_GETARG_GSERIALIZED_HEADER(1);
+	differ = gserialized_get_stored_hash(h1, &hash1) &&
+		 gserialized_get_stored_hash(h2, &hash2) &&
+		 hash1 != hash2;
+	POSTGIS_FREE_IF_COPY_P(h1, PG_GETARG_DATUM(0));
+	POSTGIS_FREE_IF_COPY_P(h2, PG_GETARG_DATUM(1));
+	return differ;
+}
+
 PG_FUNCTION_INFO_V1(lwgeom_lt);
 Datum lwgeom_lt(PG_FUNCTION_ARGS)
 {
@@ -73,9 +110,15 @@ Datum lwgeom_le(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(lwgeom_eq);
 Datum lwgeom_eq(PG_FUNCTION_ARGS)
 {
-	GSERIALIZED *g1 = PG_GETARG_GSERIALIZED_P(0);
-	GSERIALIZED *g2 = PG_GETARG_GSERIALIZED_P(1);
-	int cmp = gserialized_cmp(g1, g2);
+	GSERIALIZED *g1, *g2;
+	int cmp;
+
+	if (lwgeom_stored_hashes_differ(fcinfo))
+		PG_RETURN_BOOL(false);
+
+	g1 = PG_GETARG_GSERIALIZED_P(0);
+	g2 = PG_GETARG_GSERIALIZED_P(1);
+	cmp = gserialized_cmp(g1, g2);
 	PG_FREE_IF_COPY(g1, 0);
 	PG_FREE_IF_COPY(g2, 1);
 	PG_RETURN_BOOL(cmp == 0);
@@ -84,9 +127,15 @@ Datum lwgeom_eq(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(lwgeom_neq);
 Datum lwgeom_neq(PG_FUNCTION_ARGS)
 {
-	GSERIALIZED *g1 = PG_GETARG_GSERIALIZED_P(0);
-	GSERIALIZED *g2 = PG_GETARG_GSERIALIZED_P(1);
-	int cmp = gserialized_cmp(g1, g2);
+	GSERIALIZED *g1, *g2;
+	int cmp;
+
+	if (lwgeom_stored_hashes_differ(fcinfo))
+		PG_RETURN_BOOL(true);
+
+	g1 = PG_GETARG_GSERIALIZED_P(0);
+	g2 = PG_GETARG_GSERIALIZED_P(1);
+	cmp = gserialized_cmp(g1, g2);
 	PG_FREE_IF_COPY(g1, 0);
 	PG_FREE_IF_COPY(g2, 1);
 	PG_RETURN_BOOL(cmp != 0);
@@ -128,9 +177,23 @@ Datum lwgeom_cmp(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(lwgeom_hash);
 Datum lwgeom_hash(PG_FUNCTION_ARGS)
 {
-	GSERIALIZED *g1 = PG_GETARG_GSERIALIZED_P(0);
+	GSERIALIZED *g1;
+	int32_t hval;
+
+	/* Large geometries may carry their hash in the header */
+	if (lwgeom_is_large_toasted(PG_GETARG_DATUM(0)))
+	{
+		g1 = PG_GETARG_GSERIALIZED_HEADER(0);
+		if (gserialized_get_stored_hash(g1, &hval))
+		{
+			POSTGIS_FREE_IF_COPY_P(g1, PG_GETARG_DATUM(0));
+			PG_RETURN_INT32(hval);
+		}
+		POSTGIS_FREE_IF_COPY_P(g1, PG_GETARG_DATUM(0));
+	}
 
-	int32_t hval = gserialized_hash(g1);
+	g1 = PG_GETARG_GSERIALIZED_P(0);
+	hval = gserialized_hash(g1);
 	PG_FREE_IF_COPY(g1, 0);
 	PG_RETURN_INT32(hval);
 }
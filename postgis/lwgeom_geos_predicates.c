@@ -61,6 +61,7 @@ Datum covers(PG_FUNCTION_ARGS);
 Datum overlaps(PG_FUNCTION_ARGS);
 Datum coveredby(PG_FUNCTION_ARGS);
 Datum ST_Equals(PG_FUNCTION_ARGS);
+Datum ST_SpatialJoin(PG_FUNCTION_ARGS);
 
 
 /*
@@ -1207,3 +1208,530 @@ Datum LWGEOM_dwithin(PG_FUNCTION_ARGS)
 
 	PG_RETURN_BOOL(is_dwithin);
 }
+
+
+/*
+ * ST_SpatialJoin(geoms1 geometry[], geoms2 geometry[], predicate text)
+ *
+ * In-memory spatial join of two geometry arrays. Both sides are ordered
+ * along a Hilbert curve and cut into small spatially compact partitions.
+ * A plane sweep over the partition extents yields overlapping partition
+ * pairs one at a time, their members are swept against each other to
+ * produce bounding box candidates, and the candidates are grouped by
+ * their first element so that the exact predicate can be run from one
+ * prepared geometry for the whole batch. Only the pairs of the current
+ * partition pair are held in memory, rows are returned as they are found.
+ */
+
+#define SJOIN_PARTITION_SIZE 64
+
+typedef enum
+{
+	SJOIN_INTERSECTS,
+	SJOIN_CONTAINS,
+	SJOIN_WITHIN,
+	SJOIN_COVERS,
+	SJOIN_COVEREDBY,
+	SJOIN_TOUCHES,
+	SJOIN_CROSSES,
+	SJOIN_OVERLAPS
+} SpatialJoinPredicate;
+
+static const struct
+{
+	const char *name;
+	SpatialJoinPredicate pred;
+} sjoin_predicates[] = {
+	{"intersects", SJOIN_INTERSECTS},
+	{"contains", SJOIN_CONTAINS},
+	{"within", SJOIN_WITHIN},
+	{"covers", SJOIN_COVERS},
+	{"coveredby", SJOIN_COVEREDBY},
+	{"touches", SJOIN_TOUCHES},
+	{"crosses", SJOIN_CROSSES},
+	{"overlaps", SJOIN_OVERLAPS}
+};
+
+/* Bounding box of one input geometry, or of one partition of them */
+typedef struct
+{
+	double xmin, xmax, ymin, ymax;
+	uint64_t key;
+	uint32_t id;
+} SpatialJoinBox;
+
+typedef struct
+{
+	uint32_t a;
+	uint32_t b;
+} SpatialJoinPair;
+
+/* Side of the join: boxes plus the serialized geometries they came from */
+typedef struct
+{
+	SpatialJoinBox *boxes;
+	const GSERIALIZED **geoms;
+	int32_t *positions;
+	uint32_t nboxes;
+	SpatialJoinBox *parts;
+	uint32_t nparts;
+} SpatialJoinSide;
+
+static int
+sjoin_cmp_key(const void *a, const void *b)
+{
+	const SpatialJoinBox *ba = a;
+	const SpatialJoinBox *bb = b;
+	return ba->key < bb->key ? -1 : (ba->key > bb->key ? 1 : 0);
+}
+
+static int
+sjoin_cmp_xmin(const void *a, const void *b)
+{
+	const SpatialJoinBox *ba = a;
+	const SpatialJoinBox *bb = b;
+	return ba->xmin < bb->xmin ? -1 : (ba->xmin > bb->xmin ? 1 : 0);
+}
+
+static int
+sjoin_cmp_pair(const void *a, const void *b)
+{
+	const SpatialJoinPair *pa = a;
+	const SpatialJoinPair *pb = b;
+	if (pa->a != pb->a)
+		return pa->a < pb->a ? -1 : 1;
+	return pa->b < pb->b ? -1 : (pa->b > pb->b ? 1 : 0);
+}
+
+/*
+ * Forward scan plane sweep over two box lists already sorted on xmin:
+ * every pair of boxes overlapping on both axes is reported exactly once.
+ * The sweep is resumable, each call returns the next pair.
+ */
+typedef struct
+{
+	const SpatialJoinBox *a;
+	const SpatialJoinBox *b;
+	uint32_t na, nb;
+	uint32_t i, j, k;
+	bool scanning;
+	bool a_first;
+} SpatialJoinSweep;
+
+static void
+sjoin_sweep_init(SpatialJoinSweep *sweep, const SpatialJoinBox *a, uint32_t na, const SpatialJoinBox *b, uint32_t nb)
+{
+	memset(sweep, 0, sizeof(SpatialJoinSweep));
+	sweep->a = a;
+	sweep->na = na;
+	sweep->b = b;
+	sweep->nb = nb;
+}
+
+static bool
+sjoin_sweep_next(SpatialJoinSweep *sweep, uint32_t *ida, uint32_t *idb)
+{
+	for (;;)
+	{
+		if (!sweep->scanning)
+		{
+			if (sweep->i >= sweep->na || sweep->j >= sweep->nb)
+				return false;
+			sweep->a_first = sweep->a[sweep->i].xmin <= sweep->b[sweep->j].xmin;
+			sweep->k = sweep->a_first ? sweep->j : sweep->i;
+			sweep->scanning = true;
+		}
+
+		if (sweep->a_first)
+		{
+			const SpatialJoinBox *box = &sweep->a[sweep->i];
+			while (sweep->k < sweep->nb && sweep->b[sweep->k].xmin <= box->xmax)
+			{
+				const SpatialJoinBox *other = &sweep->b[sweep->k++];
+				if (box->ymin <= other->ymax && other->ymin <= box->ymax)
+				{
+					*ida = box->id;
+					*idb = other->id;
+					return true;
+				}
+			}
+			sweep->i++;
+		}
+		else
+		{
+			const SpatialJoinBox *box = &sweep->b[sweep->j];
+			while (sweep->k < sweep->na && sweep->a[sweep->k].xmin <= box->xmax)
+			{
+				const SpatialJoinBox *other = &sweep->a[sweep->k++];
+				if (box->ymin <= other->ymax && other->ymin <= box->ymax)
+				{
+					*ida = other->id;
+					*idb = box->id;
+					return true;
+				}
+			}
+			sweep->j++;
+		}
+		sweep->scanning = false;
+	}
+}
+
+/* At most every member of a partition against every member of another */
+#define SJOIN_MAX_CANDIDATES (SJOIN_PARTITION_SIZE * SJOIN_PARTITION_SIZE)
+
+/* Per-call state: the sweep position and the pairs of one partition pair */
+typedef struct
+{
+	SpatialJoinPredicate pred;
+	SpatialJoinSide s1, s2;
+	SpatialJoinSweep parts;
+	SpatialJoinPair candidates[SJOIN_MAX_CANDIDATES];
+	SpatialJoinPair result[SJOIN_MAX_CANDIDATES];
+	uint32_t nresult;
+	uint32_t next;
+	/* GEOS copies of the second side, built on first use */
+	GEOSGeometry **g2cache;
+	MemoryContextCallback callback;
+} SpatialJoinState;
+
+/* Free the GEOS geometries when the SRF context goes away, even on early exit */
+static void
+sjoin_state_delete(void *arg)
+{
+	SpatialJoinState *state = arg;
+	uint32_t i;
+
+	for (i = 0; i < state->s2.nboxes; i++)
+		if (state->g2cache[i])
+			GEOSGeom_destroy(state->g2cache[i]);
+}
+
+/*
+ * Read the non-null, non-empty members of an array into a join side.
+ * Positions are reported 1-based, counting null members too.
+ */
+static void
+sjoin_side_load(ArrayType *array, SpatialJoinSide *side, int32_t *srid, bool *gotsrid)
+{
+	uint32_t nelems = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+	ArrayIterator iterator = array_create_iterator(array, 0, NULL);
+	Datum value;
+	bool isnull;
+	int32_t position = 0;
+
+	side->boxes = palloc(sizeof(SpatialJoinBox) * Max(nelems, 1));
+	side->geoms = palloc(sizeof(GSERIALIZED *) * Max(nelems, 1));
+	side->positions = palloc(sizeof(int32_t) * Max(nelems, 1));
+	side->nboxes = 0;
+
+	while (array_iterate(iterator, &value, &isnull))
+	{
+		GSERIALIZED *geom;
+		GBOX gbox;
+		SpatialJoinBox *box;
+
+		position++;
+		if (isnull)
+			continue;
+
+		geom = (GSERIALIZED *)PG_DETOAST_DATUM(value);
+		if (!*gotsrid)
+		{
+			*srid = gserialized_get_srid(geom);
+			*gotsrid = true;
+		}
+		else
+			gserialized_error_if_srid_mismatch_reference(geom, *srid, __func__);
+
+		if (gserialized_get_gbox_p(geom, &gbox) == LW_FAILURE)
+			continue;
+
+		box = &side->boxes[side->nboxes];
+		box->xmin = gbox.xmin;
+		box->xmax = gbox.xmax;
+		box->ymin = gbox.ymin;
+		box->ymax = gbox.ymax;
+		box->id = side->nboxes;
+		side->geoms[side->nboxes] = geom;
+		side->positions[side->nboxes] = position;
+		side->nboxes++;
+	}
+	array_free_iterator(iterator);
+}
+
+/*
+ * Put the boxes of a side in Hilbert order relative to the common extent,
+ * cut them into partitions of SJOIN_PARTITION_SIZE neighbours and sort
+ * each partition, and the partition list itself, on xmin for the sweep.
+ */
+static void
+sjoin_side_partition(SpatialJoinSide *side, const SpatialJoinBox *extent)
+{
+	/* Keys only need to be local, 31 bits per axis keeps the casts in range */
+	double xscale = extent->xmax > extent->xmin ? 2147483648.0 / (extent->xmax - extent->xmin) : 0.0;
+	double yscale = extent->ymax > extent->ymin ? 2147483648.0 / (extent->ymax - extent->ymin) : 0.0;
+	uint32_t i, p;
+
+	for (i = 0; i < side->nboxes; i++)
+	{
+		SpatialJoinBox *box = &side->boxes[i];
+		double cx = (box->xmin + box->xmax) / 2.0;
+		double cy = (box->ymin + box->ymax) / 2.0;
+		box->key = uint32_hilbert((uint32_t)((cx - extent->xmin) * xscale),
+					  (uint32_t)((cy - extent->ymin) * yscale));
+	}
+	qsort(side->boxes, side->nboxes, sizeof(SpatialJoinBox), sjoin_cmp_key);
+
+	side->nparts = (side->nboxes + SJOIN_PARTITION_SIZE - 1) / SJOIN_PARTITION_SIZE;
+	side->parts = palloc(sizeof(SpatialJoinBox) * Max(side->nparts, 1));
+	for (p = 0; p < side->nparts; p++)
+	{
+		SpatialJoinBox *part = &side->parts[p];
+		SpatialJoinBox *members = side->boxes + p * SJOIN_PARTITION_SIZE;
+		uint32_t nmembers = Min(SJOIN_PARTITION_SIZE, side->nboxes - p * SJOIN_PARTITION_SIZE);
+
+		*part = members[0];
+		part->id = p;
+		for (i = 1; i < nmembers; i++)
+		{
+			part->xmin = Min(part->xmin, members[i].xmin);
+			part->xmax = Max(part->xmax, members[i].xmax);
+			part->ymin = Min(part->ymin, members[i].ymin);
+			part->ymax = Max(part->ymax, members[i].ymax);
+		}
+		qsort(members, nmembers, sizeof(SpatialJoinBox), sjoin_cmp_xmin);
+	}
+	qsort(side->parts, side->nparts, sizeof(SpatialJoinBox), sjoin_cmp_xmin);
+}
+
+static char
+sjoin_test(SpatialJoinPredicate pred, const GEOSPreparedGeometry *prep, const GEOSGeometry *g1, const GEOSGeometry *g2)
+{
+	if (prep)
+	{
+		switch (pred)
+		{
+			case SJOIN_INTERSECTS: return GEOSPreparedIntersects(prep, g2);
+			case SJOIN_CONTAINS: return GEOSPreparedContains(prep, g2);
+			case SJOIN_WITHIN: return GEOSPreparedWithin(prep, g2);
+			case SJOIN_COVERS: return GEOSPreparedCovers(prep, g2);
+			case SJOIN_COVEREDBY: return GEOSPreparedCoveredBy(prep, g2);
+			case SJOIN_TOUCHES: return GEOSPreparedTouches(prep, g2);
+			case SJOIN_CROSSES: return GEOSPreparedCrosses(prep, g2);
+			case SJOIN_OVERLAPS: return GEOSPreparedOverlaps(prep, g2);
+		}
+	}
+	else
+	{
+		switch (pred)
+		{
+			case SJOIN_INTERSECTS: return GEOSIntersects(g1, g2);
+			case SJOIN_CONTAINS: return GEOSContains(g1, g2);
+			case SJOIN_WITHIN: return GEOSWithin(g1, g2);
+			case SJOIN_COVERS: return GEOSCovers(g1, g2);
+			case SJOIN_COVEREDBY: return GEOSCoveredBy(g1, g2);
+			case SJOIN_TOUCHES: return GEOSTouches(g1, g2);
+			case SJOIN_CROSSES: return GEOSCrosses(g1, g2);
+			case SJOIN_OVERLAPS: return GEOSOverlaps(g1, g2);
+		}
+	}
+	return 2;
+}
+
+/* Box-level refinement of a candidate beyond plain overlap */
+static inline bool
+sjoin_box_candidate(SpatialJoinPredicate pred, const GBOX *a, const GBOX *b)
+{
+	switch (pred)
+	{
+		case SJOIN_CONTAINS:
+		case SJOIN_COVERS:
+			return gbox_contains_2d(a, b);
+		case SJOIN_WITHIN:
+		case SJOIN_COVEREDBY:
+			return gbox_contains_2d(b, a);
+		default:
+			return true;
+	}
+}
+
+/*
+ * Run the exact predicate on the candidates of one partition pair and
+ * keep the accepted pairs, as array positions, in the state result.
+ */
+static void
+sjoin_evaluate(SpatialJoinState *state, uint32_t ncandidates)
+{
+	SpatialJoinSide *s1 = &state->s1;
+	SpatialJoinSide *s2 = &state->s2;
+	SpatialJoinPair *candidates = state->candidates;
+	uint32_t i = 0, j;
+
+	qsort(candidates, ncandidates, sizeof(SpatialJoinPair), sjoin_cmp_pair);
+
+	while (i < ncandidates)
+	{
+		uint32_t a = candidates[i].a;
+		uint32_t batch_end = i;
+		const GEOSPreparedGeometry *prep = NULL;
+		GEOSGeometry *g1;
+		GBOX box1;
+
+		while (batch_end < ncandidates && candidates[batch_end].a == a)
+			batch_end++;
+
+		gserialized_get_gbox_p(s1->geoms[a], &box1);
+		g1 = POSTGIS2GEOS(s1->geoms[a]);
+		if (!g1)
+			HANDLE_GEOS_ERROR("First argument geometry could not be converted to GEOS");
+
+		/* Preparing only pays off when the geometry is tested more than once */
+		if (batch_end - i > 1)
+		{
+			prep = GEOSPrepare(g1);
+			if (!prep)
+				HANDLE_GEOS_ERROR("GEOSPrepare");
+		}
+
+		for (j = i; j < batch_end; j++)
+		{
+			uint32_t b = candidates[j].b;
+			GBOX box2;
+			char rv;
+
+			gserialized_get_gbox_p(s2->geoms[b], &box2);
+			if (!sjoin_box_candidate(state->pred, &box1, &box2))
+				continue;
+
+			if (!state->g2cache[b])
+			{
+				state->g2cache[b] = POSTGIS2GEOS(s2->geoms[b]);
+				if (!state->g2cache[b])
+					HANDLE_GEOS_ERROR("Second argument geometry could not be converted to GEOS");
+			}
+
+			rv = sjoin_test(state->pred, prep, g1, state->g2cache[b]);
+			if (rv == 2)
+				HANDLE_GEOS_ERROR("ST_SpatialJoin");
+			if (rv)
+			{
+				state->result[state->nresult].a = s1->positions[a];
+				state->result[state->nresult].b = s2->positions[b];
+				state->nresult++;
+			}
+		}
+
+		if (prep)
+			GEOSPreparedGeom_destroy(prep);
+		GEOSGeom_destroy(g1);
+		i = batch_end;
+	}
+}
+
+PG_FUNCTION_INFO_V1(ST_SpatialJoin);
+Datum ST_SpatialJoin(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	SpatialJoinState *state;
+	Datum values[2];
+	bool nulls[2] = {false, false};
+	HeapTuple tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		char *predname;
+		SpatialJoinBox extent;
+		int32_t srid = SRID_UNKNOWN;
+		bool gotsrid = false;
+		bool found = false;
+		uint32_t i;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		state = palloc0(sizeof(SpatialJoinState));
+		predname = text_to_cstring(PG_GETARG_TEXT_P(2));
+		for (i = 0; i < sizeof(sjoin_predicates) / sizeof(sjoin_predicates[0]); i++)
+		{
+			if (pg_strcasecmp(predname, sjoin_predicates[i].name) == 0)
+			{
+				state->pred = sjoin_predicates[i].pred;
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("%s: unsupported predicate '%s'", __func__, predname)));
+
+		if (get_call_result_type(fcinfo, 0, &funcctx->tuple_desc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("set-valued function called in context that cannot accept a set")));
+		BlessTupleDesc(funcctx->tuple_desc);
+
+		sjoin_side_load(PG_GETARG_ARRAYTYPE_P(0), &state->s1, &srid, &gotsrid);
+		sjoin_side_load(PG_GETARG_ARRAYTYPE_P(1), &state->s2, &srid, &gotsrid);
+		state->g2cache = palloc0(sizeof(GEOSGeometry *) * Max(state->s2.nboxes, 1));
+
+		state->callback.func = sjoin_state_delete;
+		state->callback.arg = state;
+		MemoryContextRegisterResetCallback(funcctx->multi_call_memory_ctx, &state->callback);
+		funcctx->user_fctx = state;
+
+		if (state->s1.nboxes && state->s2.nboxes)
+		{
+			extent = state->s1.boxes[0];
+			for (i = 0; i < state->s1.nboxes + state->s2.nboxes; i++)
+			{
+				const SpatialJoinBox *box = i < state->s1.nboxes ? &state->s1.boxes[i] : &state->s2.boxes[i - state->s1.nboxes];
+				extent.xmin = Min(extent.xmin, box->xmin);
+				extent.xmax = Max(extent.xmax, box->xmax);
+				extent.ymin = Min(extent.ymin, box->ymin);
+				extent.ymax = Max(extent.ymax, box->ymax);
+			}
+			sjoin_side_partition(&state->s1, &extent);
+			sjoin_side_partition(&state->s2, &extent);
+			initGEOS(lwpgnotice, lwgeom_geos_error);
+		}
+
+		/* Sweep the partitions first, then the members of each overlapping pair */
+		sjoin_sweep_init(&state->parts, state->s1.parts, state->s1.nparts, state->s2.parts, state->s2.nparts);
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	while (state->next >= state->nresult)
+	{
+		SpatialJoinSweep members;
+		uint32_t p1, p2, a, b, ncandidates = 0;
+
+		if (!sjoin_sweep_next(&state->parts, &p1, &p2))
+			SRF_RETURN_DONE(funcctx);
+
+		sjoin_sweep_init(&members,
+				 state->s1.boxes + p1 * SJOIN_PARTITION_SIZE,
+				 Min(SJOIN_PARTITION_SIZE, state->s1.nboxes - p1 * SJOIN_PARTITION_SIZE),
+				 state->s2.boxes + p2 * SJOIN_PARTITION_SIZE,
+				 Min(SJOIN_PARTITION_SIZE, state->s2.nboxes - p2 * SJOIN_PARTITION_SIZE));
+		while (sjoin_sweep_next(&members, &a, &b))
+		{
+			state->candidates[ncandidates].a = a;
+			state->candidates[ncandidates].b = b;
+			ncandidates++;
+		}
+
+		state->nresult = state->next = 0;
+		sjoin_evaluate(state, ncandidates);
+	}
+
+	values[0] = Int32GetDatum(state->result[state->next].a);
+	values[1] = Int32GetDatum(state->result[state->next].b);
+	state->next++;
+
+	tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
@@ -289,21 +289,42 @@ pgis_fromflatgeobuf(PG_FUNCTION_ARGS)
 						format_type_be(pgtype))));
 		}
 
+		/* Optional bbox filter, answered from the packed R-tree when the
+		 * input has one, so only the matching features get decoded */
+		if (PG_NARGS() > 2 && !PG_ARGISNULL(2))
+		{
+			GBOX *bbox = (GBOX *)PG_GETARG_POINTER(2);
+			ctx->has_bbox = true;
+			ctx->bbox = *bbox;
+
+			if (ctx->ctx->index_node_size > 0 && ctx->ctx->features_count > 0)
+			{
+				flatgeobuf_index_search(
+				    ctx->ctx, bbox->xmin, bbox->ymin, bbox->xmax, bbox->ymax);
+				POSTGIS_DEBUGF(2, "index search found %llu features", ctx->ctx->search_results_len);
+				if (ctx->ctx->search_results_len == 0)
+				{
+					MemoryContextSwitchTo(oldcontext);
+					SRF_RETURN_DONE(funcctx);
+				}
+			}
+		}
+
 		MemoryContextSwitchTo(oldcontext);
 	}
 
 	funcctx = SRF_PERCALL_SETUP();
 	ctx = funcctx->user_fctx;
 
-	if (!ctx->done)
-	{
-		flatgeobuf_decode_row(ctx);
-		POSTGIS_DEBUG(2, "Calling SRF_RETURN_NEXT");
-		SRF_RETURN_NEXT(funcctx, ctx->result);
-	}
-	else
+	while (!ctx->done)
 	{
-		POSTGIS_DEBUG(2, "Calling SRF_RETURN_DONE");
-		SRF_RETURN_DONE(funcctx);
+		if (flatgeobuf_decode_row(ctx))
+		{
+			POSTGIS_DEBUG(2, "Calling SRF_RETURN_NEXT");
+			SRF_RETURN_NEXT(funcctx, ctx->result);
+		}
 	}
+
+	POSTGIS_DEBUG(2, "Calling SRF_RETURN_DONE");
+	SRF_RETURN_DONE(funcctx);
 }
@@ -0,0 +1,90 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+#include "postgres.h"
+#include "funcapi.h"
+
+#include "../postgis_config.h"
+#include "lwgeom_pg.h"
+#include "liblwgeom.h"
+#include "lwgeom_cache.h"
+
+typedef struct GeoArrowState
+{
+	bytea *geoarrow;
+	LWGEOARROW_ITERATOR *iterator;
+	int32_t srid;
+}
+GeoArrowState;
+
+/*
+ * Read the geometry column of an Arrow IPC stream one row per call,
+ * decoding each geometry straight from the buffers of its batch.
+ */
+PG_FUNCTION_INFO_V1(pgis_fromgeoarrow);
+Datum pgis_fromgeoarrow(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	GeoArrowState *state;
+	LWGEOM *lwgeom;
+	GSERIALIZED *geom;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		char *srs = NULL;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		/* The iterator reads from the bytea, keep it for the whole scan */
+		state = palloc(sizeof(GeoArrowState));
+		state->geoarrow = PG_GETARG_BYTEA_P(0);
+		state->iterator = lwgeoarrow_iterator_create((uint8_t *)VARDATA(state->geoarrow),
+							     VARSIZE(state->geoarrow) - VARHDRSZ, &srs);
+		state->srid = SRID_UNKNOWN;
+		if (srs)
+		{
+			/* fn_extra holds the FuncCallContext, so no SRID cache here */
+			state->srid = getSRIDbySRS(fcinfo, srs);
+			lwfree(srs);
+		}
+		funcctx->user_fctx = state;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* stuff done on every call of the function */
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	if (!lwgeoarrow_iterator_next(state->iterator, &lwgeom))
+	{
+		lwgeoarrow_iterator_destroy(state->iterator);
+		SRF_RETURN_DONE(funcctx);
+	}
+
+	if (!lwgeom)
+		SRF_RETURN_NEXT_NULL(funcctx);
+
+	lwgeom_set_srid(lwgeom, state->srid);
+	geom = geometry_serialize(lwgeom);
+	lwgeom_free(lwgeom);
+	SRF_RETURN_NEXT(funcctx, PointerGetDatum(geom));
+}
@@ -26,6 +26,7 @@
 #include <assert.h>
 
 #include "postgres.h"
+#include "funcapi.h"
 
 #include "../postgis_config.h"
 #include "lwgeom_pg.h"
@@ -60,6 +61,7 @@ text2cstring(const text *textptr)
 #endif
 
 Datum geom_from_geojson(PG_FUNCTION_ARGS);
+Datum geom_from_geojson_features(PG_FUNCTION_ARGS);
 Datum postgis_libjson_version(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(postgis_libjson_version);
@@ -122,3 +124,101 @@ Datum geom_from_geojson(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(geom);
 #endif
 }
+
+#if defined(HAVE_LIBJSON)
+typedef struct GeoJSONFeaturesState
+{
+	char *geojson;
+	LWGEOJSON_ITERATOR *iterator;
+	int32_t srid;
+}
+GeoJSONFeaturesState;
+#endif
+
+/*
+ * Read a FeatureCollection one feature per call, so only the
+ * feature being returned is ever parsed into memory.
+ */
+PG_FUNCTION_INFO_V1(geom_from_geojson_features);
+Datum geom_from_geojson_features(PG_FUNCTION_ARGS)
+{
+#ifndef HAVE_LIBJSON
+	elog(ERROR, "You need JSON-C for ST_FromGeoJSONFeatures");
+	PG_RETURN_NULL();
+#else /* HAVE_LIBJSON  */
+
+	FuncCallContext *funcctx;
+	GeoJSONFeaturesState *state;
+	LWGEOM *lwgeom;
+	const char *properties;
+	size_t properties_len;
+	bool isnull[2] = {false, false};
+	Datum tuple_arr[2];
+	HeapTuple tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		char *srs = NULL;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		/* The iterator reads from the text, keep it for the whole scan */
+		state = palloc(sizeof(GeoJSONFeaturesState));
+		state->geojson = text2cstring(PG_GETARG_TEXT_P(0));
+		state->iterator = lwgeojson_iterator_create(state->geojson, &srs);
+		state->srid = WGS84_SRID;
+		if (srs)
+		{
+			/* fn_extra holds the FuncCallContext, so no SRID cache here */
+			state->srid = getSRIDbySRS(fcinfo, srs);
+			lwfree(srs);
+		}
+		funcctx->user_fctx = state;
+
+		/* get tuple description for return type */
+		if (get_call_result_type(fcinfo, 0, &funcctx->tuple_desc) != TYPEFUNC_COMPOSITE)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("set-valued function called in context that cannot accept a set")));
+		}
+
+		BlessTupleDesc(funcctx->tuple_desc);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* stuff done on every call of the function */
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	if (!lwgeojson_iterator_next(state->iterator, &lwgeom, &properties, &properties_len))
+	{
+		lwgeojson_iterator_destroy(state->iterator);
+		SRF_RETURN_DONE(funcctx);
+	}
+
+	if (lwgeom)
+	{
+		lwgeom_set_srid(lwgeom, state->srid);
+		tuple_arr[0] = PointerGetDatum(geometry_serialize(lwgeom));
+		lwgeom_free(lwgeom);
+	}
+	else
+		isnull[0] = true;
+
+	/* json is stored as its text */
+	if (properties)
+	{
+		text *props = (text *)palloc(properties_len + VARHDRSZ);
+		SET_VARSIZE(props, properties_len + VARHDRSZ);
+		memcpy(VARDATA(props), properties, properties_len);
+		tuple_arr[1] = PointerGetDatum(props);
+	}
+	else
+		isnull[1] = true;
+
+	tuple = heap_form_tuple(funcctx->tuple_desc, tuple_arr, isnull);
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+#endif
+}
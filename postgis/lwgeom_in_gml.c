@@ -52,8 +52,7 @@
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
-#include <libxml/xpath.h>
-#include <libxml/xpathInternals.h>
+#include <libxml/hash.h>
 
 #include "../postgis_config.h"
 #include "lwgeom_pg.h"
@@ -245,70 +244,99 @@ static bool is_xlink(xmlNodePtr node)
 }
 
 
+/**
+ * Marks an xlink index entry shared by several elements, which
+ * can't be a link target
+ */
+static const char gml_xlink_duplicate = 0;
+
+/**
+ * Index the elements of a document by id, element name and namespace,
+ * so that each xlink is resolved without scanning the whole document.
+ * Only an id in the namespace of its element can be a link target,
+ * as in gml:Point/@gml:id. The index lives in the document private
+ * pointer and is freed along with the document by lwgeom_from_gml.
+ */
+static xmlHashTablePtr gml_xlink_index(xmlDocPtr xmldoc)
+{
+	xmlHashTablePtr index;
+	xmlNodePtr node;
+
+	if (xmldoc->_private)
+		return (xmlHashTablePtr) xmldoc->_private;
+
+	index = xmlHashCreate(64);
+	if (index == NULL)
+		return NULL;
+
+	node = xmlDocGetRootElement(xmldoc);
+	while (node != NULL)
+	{
+		if (node->type == XML_ELEMENT_NODE)
+		{
+			const xmlChar *ns_href = node->ns ? node->ns->href : NULL;
+			xmlAttrPtr attr;
+
+			for (attr = node->properties; attr != NULL; attr = attr->next)
+			{
+				const xmlChar *attr_ns_href = attr->ns ? attr->ns->href : NULL;
+				xmlChar *id;
+
+				if (xmlStrcmp(attr->name, (xmlChar *)"id") || !xmlStrEqual(attr_ns_href, ns_href))
+					continue;
+
+				id = xmlNodeGetContent((xmlNodePtr)attr);
+				if (id == NULL)
+					continue;
+				if (xmlHashAddEntry3(index, id, node->name, ns_href, node) < 0)
+					xmlHashUpdateEntry3(index, id, node->name, ns_href, (void *)&gml_xlink_duplicate, NULL);
+				xmlFree(id);
+			}
+
+			if (node->children)
+			{
+				node = node->children;
+				continue;
+			}
+		}
+
+		/* Next sibling, or the next sibling of the closest ancestor having one */
+		while (node != NULL && node->next == NULL)
+			node = node->parent;
+		if (node != NULL)
+			node = node->next;
+	}
+
+	xmldoc->_private = index;
+	return index;
+}
+
+
 /**
  * Return a xmlNodePtr on a node referenced by a XLink or NULL otherwise
  */
 static xmlNodePtr get_xlink_node(xmlNodePtr xnode)
 {
-	char *id;
-	xmlNsPtr *ns, *n;
-	xmlXPathContext *ctx;
-	xmlXPathObject *xpath;
+	xmlHashTablePtr index;
 	xmlNodePtr node, ret_node;
 	xmlChar *href, *p, *node_id;
 
+	index = gml_xlink_index(xnode->doc);
+	if (index == NULL)
+		return NULL;
+
 	href = xmlGetNsProp(xnode, (xmlChar *)"href", (xmlChar *) XLINK_NS);
 	p = href;
 	p++; /* ignore '#' first char */
 
-	if (xnode->ns)
-	{
-		id = lwalloc((xmlStrlen(xnode->ns->prefix) * 2 + xmlStrlen(xnode->name) +
-		              xmlStrlen(href) + sizeof("//:[@:id='']") + 1));
-		/* XPath pattern look like: //gml:point[@gml:id='p1'] */
-		sprintf(id, "//%s:%s[@%s:id='%s']",
-		        (char *) xnode->ns->prefix,
-		        (char *) xnode->name,
-		        (char *) xnode->ns->prefix,
-		        (char *) p);
-	}
-	else
-	{
-		id = lwalloc((xmlStrlen(xnode->name) +
-		              xmlStrlen(href) + sizeof("//:[@:id='']") + 1));
-		/* XPath pattern look like: //gml:point[@gml:id='p1'] */
-		sprintf(id, "//%s[@id='%s']",
-		        (char *) xnode->name,
-		        (char *) p);
-	}
-
-	ctx = xmlXPathNewContext(xnode->doc);
-	if (ctx == NULL)
+	/* Link target must have the same element name and namespace, and be unique */
+	ret_node = xmlHashLookup3(index, p, xnode->name, xnode->ns ? xnode->ns->href : NULL);
+	if (ret_node == NULL || ret_node == (xmlNodePtr)&gml_xlink_duplicate)
 	{
 		xmlFree(href);
-		lwfree(id);
 		return NULL;
 	}
 
-	/* Handle namespaces */
-	ns = xmlGetNsList(xnode->doc, xnode);
-	for (n=ns ; *n; n++) xmlXPathRegisterNs(ctx, (*n)->prefix, (*n)->href);
-	xmlFree(ns);
-
-	/* Execute XPath expression */
-	xpath = xmlXPathEvalExpression((xmlChar *) id, ctx);
-	lwfree(id);
-	if (xpath == NULL || xpath->nodesetval == NULL || xpath->nodesetval->nodeNr != 1)
-	{
-		xmlFree(href);
-		xmlXPathFreeObject(xpath);
-		xmlXPathFreeContext(ctx);
-		return NULL;
-	}
-	ret_node = xpath->nodesetval->nodeTab[0];
-	xmlXPathFreeObject(xpath);
-	xmlXPathFreeContext(ctx);
-
 	/* Protection against circular calls */
 	for (node = xnode ; node != NULL ; node = node->parent)
 	{
@@ -893,8 +921,9 @@ static POINTARRAY* parse_gml_poslist(xmlNodePtr xnode, bool *hasz)
 	xmlChar *dimension, *gmlposlist;
 	char *poslist, *p;
 	int dim, gml_dim;
+	uint32_t ncoords;
 	POINTARRAY *dpa;
-	POINT4D pt = {0, 0, 0, 0};
+	double *dlist;
 	bool digit;
 
 	/* Retrieve gml:srsDimension attribute if any */
@@ -914,13 +943,27 @@ static POINTARRAY* parse_gml_poslist(xmlNodePtr xnode, bool *hasz)
 	gmlposlist = xmlNodeGetContent(xnode);
 	poslist = (char *) gmlposlist;
 
-	/* HasZ?, !HasM, 1 point */
-	dpa = ptarray_construct_empty(1, 0, 1);
-
 	/* gml:posList pattern: 	x1 y1 x2 y2
 	 * 				x1 y1 z1 x2 y2 z2
 	 */
 	while (isspace(*poslist)) poslist++;	/* Eat extra whitespaces if any */
+
+	/* Count the coordinates first, so the points can be written */
+	/* straight into an array of the right size */
+	for (p=poslist, ncoords=0, digit=false ; *p ; p++)
+	{
+		if (isdigit(*p)) digit = true;
+		if (digit && (*p == ' ' || *(p+1) == '\0'))
+		{
+			ncoords++;
+			digit = false;
+		}
+	}
+
+	/* HasZ?, !HasM, rounding up for a trailing partial tuple */
+	dpa = ptarray_construct_empty(1, 0, ncoords ? (ncoords + dim - 1) / dim : 1);
+	dlist = (double *) dpa->serialized_pointlist;
+
 	for (p=poslist, gml_dim=0, digit=false ; *poslist ; poslist++)
 	{
 		if (isdigit(*poslist)) digit = true;
@@ -928,16 +971,14 @@ static POINTARRAY* parse_gml_poslist(xmlNodePtr xnode, bool *hasz)
 		{
 			if (*poslist == ' ') *poslist = '\0';
 
+			/* Store the ordinate straight into the point array */
+			dlist[3 * dpa->npoints + gml_dim] = parse_gml_double(p, true, true);
 			gml_dim++;
-			if 	(gml_dim == 1) pt.x = parse_gml_double(p, true, true);
-			else if (gml_dim == 2) pt.y = parse_gml_double(p, true, true);
-			else if (gml_dim == 3) pt.z = parse_gml_double(p, true, true);
 
 			if (gml_dim == dim)
 			{
-				/* Add to ptarray, allowing dupes */
-				ptarray_append_point(dpa, &pt, LW_TRUE);
-				pt.x = pt.y = pt.z = pt.m = 0.0;
+				if (dim == 2) dlist[3 * dpa->npoints + 2] = 0.0;
+				dpa->npoints++;
 				gml_dim = 0;
 			}
 			else if (*(poslist+1) == '\0')
@@ -2177,7 +2218,8 @@ lwgeom_from_gml(const char *xml, int xml_size)
 	/* Begin to Parse XML doc */
 	xmlInitParser();
 
-	xmldoc = xmlReadMemory(xml, xml_size, NULL, NULL, 0);
+	/* Text nodes are only read, so small ones can be stored in the node */
+	xmldoc = xmlReadMemory(xml, xml_size, NULL, NULL, XML_PARSE_COMPACT);
 	if (!xmldoc)
 	{
 		xmlCleanupParser();
@@ -2196,6 +2238,8 @@ lwgeom_from_gml(const char *xml, int xml_size)
 
 	lwgeom = parse_gml(xmlroot, &hasz, &root_srid);
 
+	if (xmldoc->_private)
+		xmlHashFree((xmlHashTablePtr) xmldoc->_private, NULL);
 	xmlFreeDoc(xmldoc);
 	xmlCleanupParser();
 	/* shouldn't we be releasing xmldoc too here ? */
@@ -134,16 +134,12 @@ Datum LWGEOM_in(PG_FUNCTION_ARGS)
 		size_t hexsize = strlen(str);
 		unsigned char *wkb = bytes_from_hexbytes(str, hexsize);
 		/* TODO: 20101206: No parser checks! This is inline with current 1.5 behavior, but needs discussion */
-		lwgeom = lwgeom_from_wkb(wkb, hexsize/2, LW_PARSER_CHECK_NONE);
+		ret = geometry_serialize_wkb(wkb, hexsize/2, LW_PARSER_CHECK_NONE);
+		lwfree(wkb);
 		/* Parser should throw error, but if not, catch here. */
-		if ( !lwgeom ) PG_RETURN_NULL();
+		if ( !ret ) PG_RETURN_NULL();
 		/* If we picked up an SRID at the head of the WKB set it manually */
-		if ( srid ) lwgeom_set_srid(lwgeom, srid);
-		/* Add a bbox if necessary */
-		if ( lwgeom_needs_bbox(lwgeom) ) lwgeom_add_bbox(lwgeom);
-		lwfree(wkb);
-		ret = geometry_serialize(lwgeom);
-		lwgeom_free(lwgeom);
+		if ( srid ) gserialized_set_srid(ret, srid);
 	}
 	else if (str[0] == '{')
 	{
@@ -291,8 +287,7 @@ PG_FUNCTION_INFO_V1(LWGEOM_out);
 Datum LWGEOM_out(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom = lwgeom_from_gserialized(geom);
-	PG_RETURN_CSTRING(lwgeom_to_hexwkb_buffer(lwgeom, WKB_EXTENDED));
+	PG_RETURN_CSTRING((char *)gserialized_to_wkb_buffer(geom, WKB_EXTENDED | WKB_HEX));
 }
 
 /*
@@ -302,7 +297,6 @@ PG_FUNCTION_INFO_V1(LWGEOM_asHEXEWKB);
 Datum LWGEOM_asHEXEWKB(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom;
 	uint8_t variant = 0;
 
 	/* If user specified endianness, respect it */
@@ -322,8 +316,7 @@ Datum LWGEOM_asHEXEWKB(PG_FUNCTION_ARGS)
 	}
 
 	/* Create WKB hex string */
-	lwgeom = lwgeom_from_gserialized(geom);
-	PG_RETURN_TEXT_P(lwgeom_to_hexwkb_varlena(lwgeom, variant | WKB_EXTENDED));
+	PG_RETURN_TEXT_P(gserialized_to_wkb_varlena(geom, variant | WKB_EXTENDED | WKB_HEX));
 }
 
 
@@ -338,8 +331,7 @@ PG_FUNCTION_INFO_V1(LWGEOM_to_text);
 Datum LWGEOM_to_text(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom = lwgeom_from_gserialized(geom);
-	PG_RETURN_TEXT_P(lwgeom_to_hexwkb_varlena(lwgeom, WKB_EXTENDED));
+	PG_RETURN_TEXT_P(gserialized_to_wkb_varlena(geom, WKB_EXTENDED | WKB_HEX));
 }
 
 /*
@@ -354,24 +346,18 @@ Datum LWGEOMFromEWKB(PG_FUNCTION_ARGS)
 {
 	bytea *bytea_wkb = PG_GETARG_BYTEA_P(0);
 	GSERIALIZED *geom;
-	LWGEOM *lwgeom;
 	uint8_t *wkb = (uint8_t*)VARDATA(bytea_wkb);
 
-	lwgeom = lwgeom_from_wkb(wkb, VARSIZE_ANY_EXHDR(bytea_wkb), LW_PARSER_CHECK_ALL);
-	if (!lwgeom)
+	geom = geometry_serialize_wkb(wkb, VARSIZE_ANY_EXHDR(bytea_wkb), LW_PARSER_CHECK_ALL);
+	if (!geom)
 		lwpgerror("Unable to parse WKB");
 
 	if ((PG_NARGS() > 1) && (!PG_ARGISNULL(1)))
 	{
 		int32 srid = PG_GETARG_INT32(1);
-		lwgeom_set_srid(lwgeom, srid);
+		gserialized_set_srid(geom, srid);
 	}
 
-	if ( lwgeom_needs_bbox(lwgeom) )
-		lwgeom_add_bbox(lwgeom);
-
-	geom = geometry_serialize(lwgeom);
-	lwgeom_free(lwgeom);
 	PG_FREE_IF_COPY(bytea_wkb, 0);
 	PG_RETURN_POINTER(geom);
 }
@@ -407,7 +393,6 @@ PG_FUNCTION_INFO_V1(WKBFromLWGEOM);
 Datum WKBFromLWGEOM(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(0);
-	LWGEOM *lwgeom;
 	uint8_t variant = 0;
 
 	/* If user specified endianness, respect it */
@@ -426,9 +411,8 @@ Datum WKBFromLWGEOM(PG_FUNCTION_ARGS)
 		}
 	}
 
-	/* Create WKB hex string */
-	lwgeom = lwgeom_from_gserialized(geom);
-	PG_RETURN_BYTEA_P(lwgeom_to_wkb_varlena(lwgeom, variant | WKB_EXTENDED));
+	/* Create WKB, straight from the serialization when it can be */
+	PG_RETURN_BYTEA_P(gserialized_to_wkb_varlena(geom, variant | WKB_EXTENDED));
 }
 
 PG_FUNCTION_INFO_V1(TWKBFromLWGEOM);
@@ -646,6 +630,18 @@ Datum LWGEOM_dropBBOX(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(gserialized_drop_gbox(geom));
 }
 
+/* stores the hash inside the geometry, for hash aggregates and joins */
+PG_FUNCTION_INFO_V1(LWGEOM_addHash);
+Datum LWGEOM_addHash(PG_FUNCTION_ARGS)
+{
+	GSERIALIZED *geom = (GSERIALIZED *)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(0));
+	GSERIALIZED *result = gserialized_set_hash(geom);
+
+	if (result != geom)
+		pfree(geom);
+	PG_RETURN_POINTER(result);
+}
+
 
 /* for the wkt parser */
 void elog_ERROR(const char* string)
@@ -695,28 +691,21 @@ Datum LWGEOM_recv(PG_FUNCTION_ARGS)
 	StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
 	int32 geom_typmod = -1;
 	GSERIALIZED *geom;
-	LWGEOM *lwgeom;
 
 	if ( (PG_NARGS()>2) && (!PG_ARGISNULL(2)) ) {
 		geom_typmod = PG_GETARG_INT32(2);
 	}
 
-	lwgeom = lwgeom_from_wkb((uint8_t*)buf->data, buf->len, LW_PARSER_CHECK_ALL);
-	if ( !lwgeom )
+	geom = geometry_serialize_wkb((uint8_t*)buf->data, buf->len, LW_PARSER_CHECK_ALL);
+	if ( !geom )
 	{
 		ereport(ERROR,(errmsg("recv error - invalid geometry")));
 		PG_RETURN_NULL();
 	}
 
-	if ( lwgeom_needs_bbox(lwgeom) )
-		lwgeom_add_bbox(lwgeom);
-
 	/* Set cursor to the end of buffer (so the backend is happy) */
 	buf->cursor = buf->len;
 
-	geom = geometry_serialize(lwgeom);
-	lwgeom_free(lwgeom);
-
 	if ( geom_typmod >= 0 )
 	{
 		geom = postgis_valid_typmod(geom, geom_typmod);
@@ -153,7 +153,11 @@ Datum LWGEOM_set_srid(PG_FUNCTION_ARGS)
 {
 	GSERIALIZED *g = (GSERIALIZED *)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(0));
 	int32_t srid = PG_GETARG_INT32(1);
+	int32_t hash;
 	gserialized_set_srid(g, srid);
+	/* A stored hash covers the SRID, refresh it in place */
+	if (gserialized_get_stored_hash(g, &hash))
+		gserialized_set_hash(g);
 	PG_RETURN_POINTER(g);
 }
 
@@ -1344,15 +1348,12 @@ Datum LWGEOM_from_WKB(PG_FUNCTION_ARGS)
 	bytea *bytea_wkb = PG_GETARG_BYTEA_P(0);
 	int32 srid = 0;
 	GSERIALIZED *geom;
-	LWGEOM *lwgeom;
 	uint8_t *wkb = (uint8_t*)VARDATA(bytea_wkb);
 
-	lwgeom = lwgeom_from_wkb(wkb, VARSIZE_ANY_EXHDR(bytea_wkb), LW_PARSER_CHECK_ALL);
-	if (!lwgeom)
+	geom = geometry_serialize_wkb(wkb, VARSIZE_ANY_EXHDR(bytea_wkb), LW_PARSER_CHECK_ALL);
+	if (!geom)
 		lwpgerror("Unable to parse WKB");
 
-	geom = geometry_serialize(lwgeom);
-	lwgeom_free(lwgeom);
 	PG_FREE_IF_COPY(bytea_wkb, 0);
 
 	if ( gserialized_get_srid(geom) != SRID_UNKNOWN )
@@ -94,3 +94,62 @@ Datum pgis_asflatgeobuf_finalfn(PG_FUNCTION_ARGS)
 	buf = flatgeobuf_agg_finalfn(ctx);
 	PG_RETURN_BYTEA_P(buf);
 }
+
+/**
+ * Serialize aggregation state for parallel workers
+ */
+PG_FUNCTION_INFO_V1(pgis_asflatgeobuf_serialfn);
+Datum pgis_asflatgeobuf_serialfn(PG_FUNCTION_ARGS)
+{
+	flatgeobuf_agg_ctx *ctx;
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	ctx = (flatgeobuf_agg_ctx *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(flatgeobuf_agg_serialize(ctx));
+}
+
+/**
+ * Deserialize aggregation state received from a parallel worker
+ */
+PG_FUNCTION_INFO_V1(pgis_asflatgeobuf_deserialfn);
+Datum pgis_asflatgeobuf_deserialfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, oldcontext;
+	flatgeobuf_agg_ctx *ctx;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	ctx = flatgeobuf_agg_deserialize(PG_GETARG_BYTEA_P(0));
+	MemoryContextSwitchTo(oldcontext);
+	PG_RETURN_POINTER(ctx);
+}
+
+/**
+ * Combine two aggregation states by appending their features
+ */
+PG_FUNCTION_INFO_V1(pgis_asflatgeobuf_combinefn);
+Datum pgis_asflatgeobuf_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, oldcontext;
+	flatgeobuf_agg_ctx *ctx, *ctx1 = NULL, *ctx2 = NULL;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (!PG_ARGISNULL(0))
+		ctx1 = (flatgeobuf_agg_ctx *) PG_GETARG_POINTER(0);
+	if (!PG_ARGISNULL(1))
+		ctx2 = (flatgeobuf_agg_ctx *) PG_GETARG_POINTER(1);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	ctx = flatgeobuf_agg_combine(ctx1, ctx2);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (ctx == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_POINTER(ctx);
+}
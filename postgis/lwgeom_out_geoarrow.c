@@ -0,0 +1,281 @@
+/**********************************************************************
+ *
+ * PostGIS - Spatial Types for PostgreSQL
+ * http://postgis.net
+ *
+ * PostGIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * PostGIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PostGIS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * GeoArrow export functions
+ */
+
+#include "postgres.h"
+#include "fmgr.h"
+
+#include "../postgis_config.h"
+#include "lwgeom_pg.h"
+#include "lwgeom_cache.h"
+#include "liblwgeom.h"
+
+/*
+ * Aggregation state. The layout of the column is only known once all
+ * the rows are in, so the rows are kept serialized until then.
+ */
+typedef struct geoarrow_agg_context
+{
+	LWGEOARROW_LAYOUT layout;
+	int32_t srid;
+	bool has_srid;
+	/* Serialized geometries of the rows one after the other, */
+	/* a null row is a bare varlena header */
+	uint8_t *geoms;
+	size_t geoms_size;
+	size_t geoms_capacity;
+} geoarrow_agg_context;
+
+/* Fixed part of a serialized aggregation state, followed by the geometries */
+typedef struct geoarrow_agg_state
+{
+	uint64_t geoms_size;
+	int32_t srid;
+	bool has_srid;
+	LWGEOARROW_LAYOUT layout;
+} geoarrow_agg_state;
+
+/**
+ * Copy a row at the end of the geometry arena of the context. Every
+ * row starts on a MAXALIGN boundary, so it can be read in place, and
+ * the arena can be moved as a whole.
+ */
+static void
+geoarrow_agg_append(geoarrow_agg_context *ctx, const struct varlena *row)
+{
+	size_t size = VARSIZE(row);
+	size_t padded_size = MAXALIGN(size);
+	uint8_t *ptr;
+
+	if (ctx->geoms_size + padded_size > ctx->geoms_capacity)
+	{
+		size_t new_capacity = ctx->geoms_capacity ? ctx->geoms_capacity : 1024;
+		while (new_capacity < ctx->geoms_size + padded_size)
+			new_capacity *= 2;
+		if (ctx->geoms)
+			ctx->geoms = repalloc(ctx->geoms, new_capacity);
+		else
+			ctx->geoms = palloc(new_capacity);
+		ctx->geoms_capacity = new_capacity;
+	}
+
+	ptr = ctx->geoms + ctx->geoms_size;
+	memcpy(ptr, row, size);
+	memset(ptr + size, 0, padded_size - size);
+	ctx->geoms_size += padded_size;
+}
+
+/**
+ * Process input geometry into state, null ones included
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeoarrow_transfn);
+Datum pgis_asgeoarrow_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, oldcontext;
+	geoarrow_agg_context *ctx;
+	GSERIALIZED *gs;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+
+	if (PG_ARGISNULL(0))
+		ctx = palloc0(sizeof(geoarrow_agg_context));
+	else
+		ctx = (geoarrow_agg_context *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		struct varlena null_row;
+		SET_VARSIZE(&null_row, VARHDRSZ);
+		geoarrow_agg_append(ctx, &null_row);
+	}
+	else
+	{
+		gs = PG_GETARG_GSERIALIZED_P(1);
+		if (ctx->has_srid)
+			gserialized_error_if_srid_mismatch_reference(gs, ctx->srid, __func__);
+		ctx->srid = gserialized_get_srid(gs);
+		ctx->has_srid = true;
+		lwgeoarrow_layout_add(&ctx->layout, gserialized_get_type(gs), gserialized_has_z(gs), gserialized_has_m(gs));
+		geoarrow_agg_append(ctx, (struct varlena *) gs);
+		PG_FREE_IF_COPY(gs, 1);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	PG_RETURN_POINTER(ctx);
+}
+
+/**
+ * Encode final state to an Arrow IPC stream
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeoarrow_finalfn);
+Datum pgis_asgeoarrow_finalfn(PG_FUNCTION_ARGS)
+{
+	geoarrow_agg_context *ctx;
+	LWGEOARROW_WRITER *writer;
+	const char *srs = NULL;
+	const uint8_t *row;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	ctx = (geoarrow_agg_context *) PG_GETARG_POINTER(0);
+	if (ctx->has_srid && ctx->srid != SRID_UNKNOWN)
+		srs = GetSRSCacheBySRID(fcinfo, ctx->srid, true);
+
+	writer = lwgeoarrow_writer_create(&ctx->layout, srs);
+	for (row = ctx->geoms; row < ctx->geoms + ctx->geoms_size; row += MAXALIGN(VARSIZE(row)))
+		lwgeoarrow_writer_add(writer, VARSIZE(row) > VARHDRSZ ? (const GSERIALIZED *) row : NULL);
+
+	PG_RETURN_BYTEA_P((bytea *) lwgeoarrow_writer_finish(writer));
+}
+
+/**
+ * Serialize aggregation state so it can be passed between
+ * parallel workers.
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeoarrow_serialfn);
+Datum pgis_asgeoarrow_serialfn(PG_FUNCTION_ARGS)
+{
+	geoarrow_agg_context *ctx;
+	geoarrow_agg_state state;
+	bytea *result;
+	size_t size;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	ctx = (geoarrow_agg_context *) PG_GETARG_POINTER(0);
+	memset(&state, 0, sizeof(state));
+	state.geoms_size = ctx->geoms_size;
+	state.srid = ctx->srid;
+	state.has_srid = ctx->has_srid;
+	state.layout = ctx->layout;
+
+	size = VARHDRSZ + sizeof(state) + ctx->geoms_size;
+	result = palloc(size);
+	memcpy(VARDATA(result), &state, sizeof(state));
+	if (ctx->geoms_size)
+		memcpy(VARDATA(result) + sizeof(state), ctx->geoms, ctx->geoms_size);
+
+	SET_VARSIZE(result, size);
+	PG_RETURN_BYTEA_P(result);
+}
+
+/**
+ * Deserialize aggregation state received from a parallel worker
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeoarrow_deserialfn);
+Datum pgis_asgeoarrow_deserialfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, oldcontext;
+	geoarrow_agg_context *ctx;
+	geoarrow_agg_state state;
+	bytea *ba;
+	size_t size;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	ba = PG_GETARG_BYTEA_P(0);
+	size = VARSIZE(ba) - VARHDRSZ;
+	if (size < sizeof(state))
+		elog(ERROR, "%s: invalid serialized state", __func__);
+	memcpy(&state, VARDATA(ba), sizeof(state));
+	if (size - sizeof(state) != state.geoms_size)
+		elog(ERROR, "%s: invalid serialized state", __func__);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	ctx = palloc0(sizeof(geoarrow_agg_context));
+	ctx->srid = state.srid;
+	ctx->has_srid = state.has_srid;
+	ctx->layout = state.layout;
+
+	/* palloc is MAXALIGNed, keeping the geometries aligned */
+	if (state.geoms_size)
+	{
+		ctx->geoms = palloc(state.geoms_size);
+		memcpy(ctx->geoms, VARDATA(ba) + sizeof(state), state.geoms_size);
+	}
+	ctx->geoms_size = ctx->geoms_capacity = state.geoms_size;
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_RETURN_POINTER(ctx);
+}
+
+/**
+ * Combine two aggregation states by appending the rows of the
+ * second one to the first one.
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeoarrow_combinefn);
+Datum pgis_asgeoarrow_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext, oldcontext;
+	geoarrow_agg_context *ctx1, *ctx2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (PG_ARGISNULL(0) && PG_ARGISNULL(1))
+		PG_RETURN_NULL();
+	if (PG_ARGISNULL(0))
+		PG_RETURN_POINTER(PG_GETARG_POINTER(1));
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+
+	ctx1 = (geoarrow_agg_context *) PG_GETARG_POINTER(0);
+	ctx2 = (geoarrow_agg_context *) PG_GETARG_POINTER(1);
+
+	if (ctx1->has_srid && ctx2->has_srid && ctx1->srid != ctx2->srid)
+		elog(ERROR, "%s: Operation on mixed SRID geometries (%d != %d)", __func__, ctx1->srid, ctx2->srid);
+	if (ctx2->has_srid)
+	{
+		ctx1->srid = ctx2->srid;
+		ctx1->has_srid = true;
+	}
+	lwgeoarrow_layout_merge(&ctx1->layout, &ctx2->layout);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	if (ctx1->geoms_size + ctx2->geoms_size > ctx1->geoms_capacity)
+	{
+		if (ctx1->geoms)
+			ctx1->geoms = repalloc(ctx1->geoms, ctx1->geoms_size + ctx2->geoms_size);
+		else
+			ctx1->geoms = palloc(ctx1->geoms_size + ctx2->geoms_size);
+		ctx1->geoms_capacity = ctx1->geoms_size + ctx2->geoms_size;
+	}
+	MemoryContextSwitchTo(oldcontext);
+	if (ctx2->geoms_size)
+		memcpy(ctx1->geoms + ctx1->geoms_size, ctx2->geoms, ctx2->geoms_size);
+	ctx1->geoms_size += ctx2->geoms_size;
+
+	PG_RETURN_POINTER(ctx1);
+}
@@ -109,3 +109,78 @@ Datum pgis_asgeobuf_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_BYTEA_P(buf);
 #endif
 }
+
+/**
+ * Serialize aggregation state so it can be passed between
+ * parallel workers.
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_serialfn);
+Datum pgis_asgeobuf_serialfn(PG_FUNCTION_ARGS)
+{
+#if !(defined HAVE_LIBPROTOBUF)
+	elog(ERROR, "ST_AsGeobuf: Compiled without protobuf-c support");
+	PG_RETURN_NULL();
+#else
+	struct geobuf_agg_context *ctx;
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	ctx = (struct geobuf_agg_context *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(geobuf_agg_serialize(ctx));
+#endif
+}
+
+/**
+ * Deserialize aggregation state received from a parallel worker
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_deserialfn);
+Datum pgis_asgeobuf_deserialfn(PG_FUNCTION_ARGS)
+{
+#if !(defined HAVE_LIBPROTOBUF)
+	elog(ERROR, "ST_AsGeobuf: Compiled without protobuf-c support");
+	PG_RETURN_NULL();
+#else
+	MemoryContext aggcontext, oldcontext;
+	struct geobuf_agg_context *ctx;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	ctx = geobuf_agg_deserialize(PG_GETARG_BYTEA_P(0));
+	MemoryContextSwitchTo(oldcontext);
+	PG_RETURN_POINTER(ctx);
+#endif
+}
+
+/**
+ * Combine two aggregation states by appending their features
+ */
+PG_FUNCTION_INFO_V1(pgis_asgeobuf_combinefn);
+Datum pgis_asgeobuf_combinefn(PG_FUNCTION_ARGS)
+{
+#if !(defined HAVE_LIBPROTOBUF)
+	elog(ERROR, "ST_AsGeobuf: Compiled without protobuf-c support");
+	PG_RETURN_NULL();
+#else
+	MemoryContext aggcontext, oldcontext;
+	struct geobuf_agg_context *ctx, *ctx1 = NULL, *ctx2 = NULL;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", __func__);
+
+	if (!PG_ARGISNULL(0))
+		ctx1 = (struct geobuf_agg_context *) PG_GETARG_POINTER(0);
+	if (!PG_ARGISNULL(1))
+		ctx2 = (struct geobuf_agg_context *) PG_GETARG_POINTER(1);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	ctx = geobuf_agg_combine(ctx1, ctx2);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (ctx == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_POINTER(ctx);
+#endif
+}
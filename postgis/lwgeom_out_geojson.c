@@ -116,11 +116,17 @@ ST_AsGeoJsonRow(PG_FUNCTION_ARGS)
 	if (strlen(id_column) == 0)
 		id_column = NULL;
 
+	/*
+	 * Reserve the text header at the front of the buffer so the
+	 * feature can be handed back without a copy.
+	 */
 	initStringInfo(&result);
+	appendStringInfoSpaces(&result, VARHDRSZ);
 
 	composite_to_geojson(fcinfo, array, geom_column, id_column, maxdecimaldigits, &result, do_pretty, geom_oid, geog_oid);
 
-	PG_RETURN_TEXT_P(cstring_to_text_with_len(result.data, result.len));
+	SET_VARSIZE(result.data, result.len);
+	PG_RETURN_TEXT_P((text *)result.data);
 }
 
 /*
@@ -145,10 +151,14 @@ composite_to_geojson(FunctionCallInfo fcinfo,
 	int i;
 	bool needsep = false;
 	const char *sep;
-	StringInfo props = makeStringInfo();
-	StringInfo id = makeStringInfo();
-	bool geom_column_found = false;
+	int geom_column = -1;
 	bool id_column_found = false;
+	bool *is_id_column;
+	text *geojson = NULL;
+	Datum val;
+	bool isnull;
+	JsonTypeCategory tcategory;
+	Oid outfuncoid;
 	HTAB *prop_keys = NULL;
 	HASHCTL ctl;
 
@@ -184,18 +194,18 @@ composite_to_geojson(FunctionCallInfo fcinfo,
 	tmptup.t_data = td;
 	tuple = &tmptup;
 
-	appendStringInfoString(result, "{\"type\": \"Feature\", \"geometry\": ");
-
+	/*
+	 * First pass: find the geometry and id columns, so that the
+	 * feature members can be written straight into the result in
+	 * order, rather than collected in side buffers and copied.
+	 */
+	is_id_column = palloc0(sizeof(bool) * Max(tupdesc->natts, 1));
 	for (i = 0; i < tupdesc->natts; i++)
 	{
-		Datum val;
-		bool isnull;
 		char *attname;
-		JsonTypeCategory tcategory;
-		Oid outfuncoid;
 		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
 		bool is_geom_column = false;
-		bool is_id_column = false;
+		bool found;
 
 		if (att->attisdropped)
 			continue;
@@ -208,66 +218,67 @@ composite_to_geojson(FunctionCallInfo fcinfo,
 			is_geom_column = (att->atttypid == geom_oid || att->atttypid == geog_oid);
 
 		if (id_column_name)
-			is_id_column = (strcmp(attname, id_column_name) == 0);
+			is_id_column[i] = (strcmp(attname, id_column_name) == 0);
 
-		if ((!geom_column_found) && is_geom_column)
+		if (geom_column < 0 && is_geom_column)
 		{
 			/* this is our geom column */
-			geom_column_found = true;
-
-			val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
-			if (!isnull)
-			{
-				appendStringInfo(
-				    result,
-				    "%s",
-				    TextDatumGetCString(CallerFInfoFunctionCall2(LWGEOM_asGeoJson,
-										 fcinfo->flinfo,
-										 InvalidOid,
-										 val,
-										 Int32GetDatum(maxdecimaldigits))));
-			}
-			else
-			{
-				appendStringInfoString(result, "null");
-			}
+			geom_column = i;
+			is_id_column[i] = false;
+			continue;
 		}
-		else if (is_id_column)
+		else if (is_id_column[i])
 		{
 			id_column_found = true;
+			continue;
+		}
 
-			val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
+		(void)hash_search(prop_keys, attname, HASH_ENTER, &found);
+		if (found)
+		{
+			ereport(
+			    WARNING,
+			    (errmsg("duplicate key \"%s\" encountered while building GeoJSON properties",
+				    attname),
+			     errhint("Only the last value for each key is preserved when casting to JSONB.")));
+		}
+	}
 
-			if (isnull)
-			{
-				tcategory = JSONTYPE_NULL;
-				outfuncoid = InvalidOid;
-			}
-			else
-				json_categorize_type(att->atttypid, &tcategory, &outfuncoid);
+	if (geom_column < 0)
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("geometry column is missing")));
 
-			datum_to_json(val, isnull, id, tcategory, outfuncoid, false);
-		}
-		else
-		{
-			bool found;
+	if (id_column_name && !id_column_found)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("Specified id column \"%s\" is missing", id_column_name)));
 
-			if (needsep)
-				appendStringInfoString(props, sep);
-			needsep = true;
+	val = heap_getattr(tuple, geom_column + 1, tupdesc, &isnull);
+	if (!isnull)
+	{
+		geojson = DatumGetTextPP(CallerFInfoFunctionCall2(
+		    LWGEOM_asGeoJson, fcinfo->flinfo, InvalidOid, val, Int32GetDatum(maxdecimaldigits)));
+		/* The geometry is usually most of the feature, size for it once */
+		enlargeStringInfo(result, VARSIZE_ANY_EXHDR(geojson) + 64 + 32 * tupdesc->natts);
+	}
 
-			(void)hash_search(prop_keys, attname, HASH_ENTER, &found);
-			if (found)
-			{
-				ereport(
-				    WARNING,
-				    (errmsg("duplicate key \"%s\" encountered while building GeoJSON properties",
-					    attname),
-				     errhint("Only the last value for each key is preserved when casting to JSONB.")));
-			}
+	appendStringInfoString(result, "{\"type\": \"Feature\", \"geometry\": ");
+	if (geojson)
+	{
+		appendBinaryStringInfo(result, VARDATA_ANY(geojson), VARSIZE_ANY_EXHDR(geojson));
+		pfree(geojson);
+	}
+	else
+	{
+		appendStringInfoString(result, "null");
+	}
 
-			escape_json(props, attname);
-			appendStringInfoString(props, ": ");
+	if (id_column_name)
+	{
+		appendStringInfoString(result, ", \"id\": ");
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			if (!is_id_column[i])
+				continue;
 
 			val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
 
@@ -277,30 +288,42 @@ composite_to_geojson(FunctionCallInfo fcinfo,
 				outfuncoid = InvalidOid;
 			}
 			else
-				json_categorize_type(att->atttypid, &tcategory, &outfuncoid);
+				json_categorize_type(TupleDescAttr(tupdesc, i)->atttypid, &tcategory, &outfuncoid);
 
-			datum_to_json(val, isnull, props, tcategory, outfuncoid, false);
+			datum_to_json(val, isnull, result, tcategory, outfuncoid, false);
 		}
 	}
 
-	if (!geom_column_found)
-		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("geometry column is missing")));
-
-	if (id_column_name)
+	appendStringInfoString(result, ", \"properties\": {");
+	for (i = 0; i < tupdesc->natts; i++)
 	{
-		if (!id_column_found)
-			ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("Specified id column \"%s\" is missing", id_column_name)));
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
 
-		appendStringInfoString(result, ", \"id\": ");
-		appendStringInfo(result, "%s", id->data);
-	}
+		if (att->attisdropped || i == geom_column || is_id_column[i])
+			continue;
 
-	appendStringInfoString(result, ", \"properties\": {");
-	appendStringInfo(result, "%s", props->data);
+		if (needsep)
+			appendStringInfoString(result, sep);
+		needsep = true;
+
+		escape_json(result, NameStr(att->attname));
+		appendStringInfoString(result, ": ");
+
+		val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
+
+		if (isnull)
+		{
+			tcategory = JSONTYPE_NULL;
+			outfuncoid = InvalidOid;
+		}
+		else
+			json_categorize_type(att->atttypid, &tcategory, &outfuncoid);
+
+		datum_to_json(val, isnull, result, tcategory, outfuncoid, false);
+	}
 
 	appendStringInfoString(result, "}}");
+	pfree(is_id_column);
 	hash_destroy(prop_keys);
 	ReleaseTupleDesc(tupdesc);
 }
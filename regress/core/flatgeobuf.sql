@@ -206,6 +206,55 @@ select 'QI2' where exists (
     where table_schema = 'public' and table_name = 'flatgeobuf_t1'
 );
 
+select '--- Bounding box filter ---';
+
+-- indexed input, only features inside the box are decoded
+select 'BB1', count(*), sum(ST_X(geom)), sum(ST_Y(geom)) from ST_FromFlatGeobuf(null::flatgeobuf_t1, (
+    select ST_AsFlatGeobuf(q, true) fgb from (
+        select ST_MakePoint(x, y) from generate_series(1, 10) x, generate_series(1, 10) y) q),
+    'BOX(2.5 2.5,4.5 5.5)'::box2d);
+-- input without index falls back to filtering decoded features
+select 'BB2', count(*), sum(ST_X(geom)), sum(ST_Y(geom)) from ST_FromFlatGeobuf(null::flatgeobuf_t1, (
+    select ST_AsFlatGeobuf(q) fgb from (
+        select ST_MakePoint(x, y) from generate_series(1, 10) x, generate_series(1, 10) y) q),
+    'BOX(2.5 2.5,4.5 5.5)'::box2d);
+-- no feature in the box
+select 'BB3', count(*) from ST_FromFlatGeobuf(null::flatgeobuf_t1, (
+    select ST_AsFlatGeobuf(q, true) fgb from (
+        select ST_MakePoint(x, y) from generate_series(1, 10) x, generate_series(1, 10) y) q),
+    'BOX(20 20,30 30)'::box2d);
+-- ids of filtered features match the unfiltered read
+with d as (
+    select ST_AsFlatGeobuf(q, true) fgb from (
+        select ST_MakePoint(x, y) from generate_series(1, 10) x, generate_series(1, 10) y) q
+)
+select 'BB4', count(*) from (
+    select f.id, ST_AsText(f.geom) from d, ST_FromFlatGeobuf(null::flatgeobuf_t1, d.fgb, 'BOX(2.5 2.5,4.5 5.5)'::box2d) f
+    except
+    select f.id, ST_AsText(f.geom) from d, ST_FromFlatGeobuf(null::flatgeobuf_t1, d.fgb) f
+) s;
+
+select '--- Parallel aggregate ---';
+
+create table public.flatgeobuf_par as
+    select x as id, ST_MakePoint(x % 100, x / 100) as geom from generate_series(0, 9999) x;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+call p_force_parallel_mode('on');
+select 'PAR0', f_plan_has('select ST_AsFlatGeobuf(q) from public.flatgeobuf_par q', 'Partial Aggregate');
+with d as (select ST_AsFlatGeobuf(q) fgb from public.flatgeobuf_par q)
+select 'PAR1', count(*), sum(ST_X(geom)), sum(ST_Y(geom)) from d, ST_FromFlatGeobuf(null::flatgeobuf_t1, d.fgb) f;
+with d as (select ST_AsFlatGeobuf(q, true) fgb from public.flatgeobuf_par q)
+select 'PAR2', count(*), sum(ST_X(geom)), sum(ST_Y(geom)) from d, ST_FromFlatGeobuf(null::flatgeobuf_t1, d.fgb, 'BOX(10 10,19.5 19.5)'::box2d) f;
+call p_force_parallel_mode('off');
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+drop table if exists public.flatgeobuf_par;
+
 drop table if exists public.flatgeobuf_t1;
 drop table if exists public.flatgeobuf_a1;
 drop table if exists public.flatgeobuf_e1;
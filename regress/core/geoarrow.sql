@@ -0,0 +1,84 @@
+select '--- Null geometry ---';
+
+select 'N1', ST_AsText(g) from ST_FromGeoArrow((select ST_AsGeoArrow(null::geometry))) g;
+select 'N2', ST_AsGeoArrow(g) is null from (select null::geometry g limit 0) q;
+
+select '--- Geometry roundtrips ---';
+
+select 'P1', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POINT(1 2)'::geometry), (2, null), (3, 'POINT EMPTY'), (4, 'POINT(3 4)')) q(id, g)
+)) with ordinality as t(g, n);
+select 'P2', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POINT ZM (1 2 3 4)'::geometry), (2, 'POINT ZM (5 6 7 8)')) q(id, g)
+)) with ordinality as t(g, n);
+select 'L1', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'LINESTRING Z (0 0 0,1 1 1)'::geometry), (2, 'LINESTRING Z EMPTY'), (3, null)) q(id, g)
+)) with ordinality as t(g, n);
+select 'A1', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POLYGON((35 10,45 45,15 40,10 20,35 10),(20 30,35 35,30 20,20 30))'::geometry),
+        (2, 'POLYGON((0 0,1 0,1 1,0 0))')) q(id, g)
+)) with ordinality as t(g, n);
+select 'M1', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POINT(1 2)'::geometry), (2, 'MULTIPOINT((3 4),(5 6))')) q(id, g)
+)) with ordinality as t(g, n);
+select 'M2', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'MULTILINESTRING((10 10,20 20,10 40),(40 40,30 30,40 20,30 10))'::geometry),
+        (2, 'LINESTRING(1 2,3 4)')) q(id, g)
+)) with ordinality as t(g, n);
+select 'M3', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'MULTIPOLYGON(((40 40,20 45,45 30,40 40)),((20 35,10 30,10 10,30 5,45 20,20 35),(30 20,20 15,20 25,30 20)))'::geometry),
+        (2, 'POLYGON EMPTY')) q(id, g)
+)) with ordinality as t(g, n);
+
+select '--- WKB fallback ---';
+
+select 'W1', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POINT(1 2)'::geometry), (2, 'LINESTRING(0 0,1 1)'), (3, null),
+        (4, 'GEOMETRYCOLLECTION(POINT(40 10),LINESTRING(10 10,20 20,10 40))')) q(id, g)
+)) with ordinality as t(g, n);
+select 'W2', n, ST_AsText(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g order by id) from (values
+        (1, 'POINT(1 2)'::geometry), (2, 'POINT Z (1 2 3)'), (3, 'CIRCULARSTRING(0 0,1 1,2 0)')) q(id, g)
+)) with ordinality as t(g, n);
+
+select '--- SRID ---';
+
+select 'S1', ST_AsEWKT(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g) from (values ('SRID=4326;POINT(1 2)'::geometry)) q(g)
+)) g;
+select 'S2', ST_AsEWKT(g) from ST_FromGeoArrow((
+    select ST_AsGeoArrow(g) from (values ('SRID=3857;LINESTRING(0 0,1 1)'::geometry), (null)) q(g)
+)) g;
+select 'S3', ST_AsGeoArrow(g) from (values ('SRID=4326;POINT(1 2)'::geometry), ('SRID=3857;POINT(1 2)')) q(g);
+
+select '--- Errors ---';
+
+select 'E1', ST_AsText(g) from ST_FromGeoArrow('\x00'::bytea) g;
+select 'E2', ST_AsText(g) from ST_FromGeoArrow('\xffffffff00000000'::bytea) g;
+
+select '--- Parallel ---';
+
+create table geoarrow_par as
+    select x as id, ST_MakePoint(x % 100 + 0.5, x / 100) as geom from generate_series(0, 9999) x;
+insert into geoarrow_par values (10000, null);
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+call p_force_parallel_mode('on');
+select 'PAR0', f_plan_has('select ST_AsGeoArrow(geom) from geoarrow_par', 'Partial Aggregate');
+select 'PAR1', count(*), count(g), sum(ST_X(g)), sum(ST_Y(g)) from ST_FromGeoArrow((select ST_AsGeoArrow(geom) from geoarrow_par)) g;
+call p_force_parallel_mode('off');
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+drop table geoarrow_par;
@@ -36,3 +36,31 @@ FROM (VALUES ('POINT(0 0)'::geometry, 'A0006', 300),
 SELECT '#4916.b', ST_AsGeobuf(NULL::pg_class) over (order by b)
 FROM (VALUES ('POINT(0 0)'::geometry, 'A0006', 300),
 	         ('POINT(1 1)'::geometry, 'A0006', 302)) t(g, a, b);
+
+create table geobuf_par as
+    select x as id, ST_MakePoint(x % 100 + 0.5, x / 100) as geom from generate_series(0, 9999) x;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+call p_force_parallel_mode('on');
+select 'PAR0', f_plan_has('select ST_AsGeobuf(q) from geobuf_par q', 'Partial Aggregate');
+-- Equal rows encode the same whatever order the workers hand them back in
+select md5(ST_AsGeobuf(q)) as geobuf_par1
+    from (select 7 as id, 'POINT(0.5 1.5)'::geometry as geom from geobuf_par) q \gset
+-- Distinct rows come back in worker order, so compare the sorted bytes
+select length(b) || ':' || md5(string_agg(get_byte(b, i)::text, ',' order by get_byte(b, i))) as geobuf_par2
+    from (select ST_AsGeobuf(q, 'geom') as b from geobuf_par q) d, generate_series(0, length(b) - 1) i
+    group by b \gset
+call p_force_parallel_mode('off');
+set max_parallel_workers_per_gather = 0;
+select 'PAR1', md5(ST_AsGeobuf(q)) = :'geobuf_par1'
+    from (select 7 as id, 'POINT(0.5 1.5)'::geometry as geom from geobuf_par) q;
+select 'PAR2', length(b) || ':' || md5(string_agg(get_byte(b, i)::text, ',' order by get_byte(b, i))) = :'geobuf_par2'
+    from (select ST_AsGeobuf(q, 'geom') as b from geobuf_par q) d, generate_series(0, length(b) - 1) i
+    group by b;
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+drop table geobuf_par;
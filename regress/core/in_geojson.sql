@@ -59,3 +59,10 @@ SELECT '#4470.d', ST_AsText(ST_GeomFromGeoJSON('{"type":"MultiPolygon","coordina
 -- ::geometry cast
 SELECT 'cast1', ST_AsEWKT('{"type":"Point","coordinates":[1,1]}'::geometry);
 SELECT 'cast2', ST_AsEWKT(st_asgeojson('SRID=3005;MULTIPOINT(1 1, 1 1)'::geometry)::geometry);
+
+-- FeatureCollection
+SELECT 'features_1', ST_AsEWKT(geom), properties::text FROM ST_FromGeoJSONFeatures('{"type":"FeatureCollection","features":[{"type":"Feature","properties":{"name":"a","n":[1,2]},"geometry":{"type":"Point","coordinates":[1,2]}},{"type":"Feature","properties":null,"geometry":null},{"type":"Feature","geometry":{"type":"LineString","coordinates":[[0,0,1],[1,1,2]]}}]}');
+SELECT 'features_2', ST_AsEWKT(geom) FROM ST_FromGeoJSONFeatures('{"type":"FeatureCollection","crs":{"type":"name","properties":{"name":"EPSG:3395"}},"features":[{"type":"Feature","geometry":{"type":"GeometryCollection","geometries":[{"type":"Point","coordinates":[100.0,0.0]}]}}]}');
+SELECT 'features_3', count(*) FROM ST_FromGeoJSONFeatures('{"type":"FeatureCollection","features":[]}');
+SELECT 'features_4', count(*) FROM ST_FromGeoJSONFeatures('{"type":"Feature","geometry":null}');
+SELECT 'features_5', count(*) FROM ST_FromGeoJSONFeatures('{"type":"FeatureCollection","features":[{"geometry":null}');
@@ -260,3 +260,20 @@ FROM (VALUES
     ('GEOMETRYCOLLECTION EMPTY'::geometry)
 ) AS f(geom)
 GROUP BY geom ORDER BY 2;
+
+-- stored hash
+SELECT 'hash.1', ST_MemSize(postgis_addhash(g)) - ST_MemSize(g),
+    geometry_hash(postgis_addhash(g)) = geometry_hash(g),
+    postgis_addhash(g) = g,
+    geometry_hash(ST_SetSRID(postgis_addhash(g), 4326)) = geometry_hash(ST_SetSRID(g, 4326))
+FROM (SELECT 'LINESTRING(0 0,1 1)'::geometry AS g) AS f;
+
+CREATE TEMP TABLE stored_hash AS
+SELECT postgis_addhash(ST_Segmentize('LINESTRING(0 0,100000 0)'::geometry, 1)) AS g;
+INSERT INTO stored_hash SELECT postgis_addhash(ST_Translate(g, 0, 1)) FROM stored_hash;
+SELECT 'hash.2', geometry_hash(g) = geometry_hash(ST_Reverse(ST_Reverse(g))),
+    g = ST_Reverse(ST_Reverse(g))
+FROM stored_hash;
+SELECT 'hash.3', count(*) FROM stored_hash a JOIN stored_hash b ON a.g = b.g;
+SELECT 'hash.4', count(*) FROM stored_hash a JOIN stored_hash b ON a.g <> b.g;
+DROP TABLE stored_hash;
@@ -0,0 +1,111 @@
+-- GiST indexes built after loading the data go through the opclass
+-- sortsupport on PostgreSQL 15 and newer. Their answers must match
+-- a sequential scan.
+
+CREATE FUNCTION gist_sorted_check(q text) RETURNS text
+LANGUAGE 'plpgsql' AS
+$$
+DECLARE
+	seq_res text;
+	idx_res text;
+BEGIN
+	PERFORM set_config('enable_seqscan', 'on', true);
+	PERFORM set_config('enable_indexscan', 'off', true);
+	PERFORM set_config('enable_bitmapscan', 'off', true);
+	EXECUTE q INTO seq_res;
+
+	PERFORM set_config('enable_seqscan', 'off', true);
+	PERFORM set_config('enable_indexscan', 'on', true);
+	PERFORM set_config('enable_bitmapscan', 'on', true);
+	IF NOT f_plan_has(q, 'Index') THEN
+		RETURN 'no index scan';
+	END IF;
+	EXECUTE q INTO idx_res;
+
+	IF seq_res IS NULL THEN
+		RETURN 'no rows';
+	END IF;
+	IF seq_res IS DISTINCT FROM idx_res THEN
+		RETURN 'seq scan ' || seq_res || ' index scan ' || coalesce(idx_res, 'NULL');
+	END IF;
+	RETURN 'ok';
+END;
+$$;
+
+-------------------------------------------------------------------------------
+-- N-D geometry: 2D boxes take the Hilbert key, 3D and 4D the Morton key
+
+CREATE TABLE gist_sorted_nd AS
+	SELECT i AS id, ST_MakePoint(i % 37 - 18.5, (i * 7) % 41 - 20.5, (i * 13) % 43 - 21.5, i % 5) AS g
+	FROM generate_series(1, 4000) i;
+INSERT INTO gist_sorted_nd
+	SELECT i, ST_MakePoint(i % 37 - 18.5, (i * 7) % 41 - 20.5)
+	FROM generate_series(4001, 5000) i;
+INSERT INTO gist_sorted_nd VALUES
+	(5001, 'POINT EMPTY'),
+	(5002, 'LINESTRING Z (-100 -100 -100, 100 100 100)'),
+	(5003, NULL);
+
+CREATE INDEX gist_sorted_nd_idx ON gist_sorted_nd USING gist (g gist_geometry_ops_nd);
+ANALYZE gist_sorted_nd;
+
+SELECT 'nd_overlaps', gist_sorted_check($q$
+	SELECT count(*) || ':' || md5(string_agg(id::text, ',' ORDER BY id))
+	FROM gist_sorted_nd
+	WHERE g &&& 'LINESTRING Z (-5 -5 -5, 5 5 5)'::geometry
+$q$);
+
+SELECT 'nd_overlaps_4d', gist_sorted_check($q$
+	SELECT count(*) || ':' || md5(string_agg(id::text, ',' ORDER BY id))
+	FROM gist_sorted_nd
+	WHERE g &&& 'LINESTRING ZM (-5 -5 -5 0, 5 5 5 2)'::geometry
+$q$);
+
+SELECT 'nd_within', gist_sorted_check($q$
+	SELECT count(*) || ':' || md5(string_agg(id::text, ',' ORDER BY id))
+	FROM gist_sorted_nd
+	WHERE 'LINESTRING Z (-10 -12 -14, 8 6 4)'::geometry ~~ g
+$q$);
+
+-------------------------------------------------------------------------------
+-- Geography: geocentric boxes are quantized linearly
+
+CREATE TABLE gist_sorted_geog AS
+	SELECT i AS id, ST_MakePoint((i * 37) % 360 - 180 + (i % 7) * 0.1, (i * 11) % 180 - 90 + (i % 3) * 0.1)::geography AS g
+	FROM generate_series(1, 5000) i;
+INSERT INTO gist_sorted_geog VALUES
+	(5001, 'POINT EMPTY'),
+	(5002, 'LINESTRING(-170 -10, 170 10)'),
+	(5003, NULL);
+
+CREATE INDEX gist_sorted_geog_idx ON gist_sorted_geog USING gist (g);
+ANALYZE gist_sorted_geog;
+
+SELECT 'geog_overlaps', gist_sorted_check($q$
+	SELECT count(*) || ':' || md5(string_agg(id::text, ',' ORDER BY id))
+	FROM gist_sorted_geog
+	WHERE g && ST_MakeEnvelope(-30, -20, 40, 35, 4326)::geography
+$q$);
+
+SELECT 'geog_dwithin', gist_sorted_check($q$
+	SELECT count(*) || ':' || md5(string_agg(id::text, ',' ORDER BY id))
+	FROM gist_sorted_geog
+	WHERE ST_DWithin(g, 'POINT(10 10)'::geography, 1500000)
+$q$);
+
+-- Equal points tie on distance, so compare the distances
+SELECT 'geog_knn', gist_sorted_check($q$
+	SELECT array_agg(round(d::numeric, 3) ORDER BY d)::text
+	FROM (
+		SELECT g <-> 'POINT(10 10)'::geography AS d
+		FROM gist_sorted_geog
+		ORDER BY g <-> 'POINT(10 10)'::geography
+		LIMIT 20
+	) s
+$q$);
+
+-------------------------------------------------------------------------------
+
+DROP TABLE gist_sorted_nd;
+DROP TABLE gist_sorted_geog;
+DROP FUNCTION gist_sorted_check(text);
@@ -69,6 +69,18 @@ SELECT 'scan_seq', qnodes('select * from test where the_geom && ST_MakePoint(0,0
 SELECT 'gist 2d @ idx', qnodes('select * from test_gist_idx_2d where geom @ ST_MakeEnvelope(120,120,140,140)'), count(*) FROM test_gist_idx_2d WHERE geom @ ST_MakeEnvelope(120,120,140,140);
 SELECT 'gist 2d ~ idx', qnodes('select * from test_gist_idx_2d where geom ~ ST_MakePoint(125,125)'), count(*) FROM test_gist_idx_2d WHERE geom ~ ST_MakePoint(125,125);
 
+-- Compact 2D GiST index, lossy keys are rechecked
+CREATE TABLE test_gist_compact AS SELECT num, the_geom FROM test;
+CREATE INDEX test_gist_compact_idx on test_gist_compact using gist (the_geom gist_geometry_ops_2d_compact);
+SELECT 'gist 2d compact', qnodes('select * from test_gist_compact where the_geom && ST_MakeEnvelope(125,125,135,135)');
+SELECT 'gist 2d compact &&', num FROM test_gist_compact WHERE the_geom && ST_MakeEnvelope(125,125,135,135) ORDER BY num;
+SELECT 'gist 2d compact @', count(*) FROM test_gist_compact WHERE the_geom @ ST_MakeEnvelope(125,125,135,135);
+SELECT 'gist 2d compact ~=', count(*) FROM test_gist_compact WHERE the_geom ~= (SELECT the_geom FROM test WHERE num = 11208);
+SELECT 'gist 2d compact <->',
+  (SELECT array_agg(num) FROM (SELECT num FROM test_gist_compact ORDER BY the_geom <-> ST_MakePoint(130,130) LIMIT 5) a) =
+  (SELECT array_agg(num) FROM (SELECT num FROM test ORDER BY ST_Distance(the_geom, ST_MakePoint(130,130)) LIMIT 5) b);
+DROP TABLE test_gist_compact;
+
 CREATE FUNCTION estimate_error(qry text, tol int)
 RETURNS text
 LANGUAGE 'plpgsql' VOLATILE AS $$
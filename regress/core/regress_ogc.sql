@@ -273,3 +273,29 @@ select 'ST_SetEndM5', ST_AsText(ST_SetEndM('LINESTRING M EMPTY'::geometry, 999))
 select 'ST_SetEndM6', ST_AsText(ST_SetEndM('NURBSCURVE(2, (0 0, 1 1, 2 0))'::geometry, 999));
 select 'ST_SetEndM7', ST_AsText(ST_SetEndM('COMPOUNDCURVE M EMPTY'::geometry, 999));
 select 'ST_SetEndM8', ST_AsText(ST_SetEndM('POINT(1 2)'::geometry, 9));
+
+-- ST_SpatialJoin
+select 'ST_SpatialJoin1', index1, index2 from ST_SpatialJoin(
+	ARRAY['POLYGON((0 0,10 0,10 10,0 10,0 0))', 'POLYGON((20 20,30 20,30 30,20 30,20 20))', NULL, 'POINT EMPTY']::geometry[],
+	ARRAY['POINT(5 5)', 'POINT(10 5)', 'POINT(25 25)', 'LINESTRING(9 9,21 21)', 'POINT(15 15)']::geometry[])
+	order by 2, 3;
+select 'ST_SpatialJoin2', index1, index2 from ST_SpatialJoin(
+	ARRAY['POLYGON((0 0,10 0,10 10,0 10,0 0))', 'POLYGON((20 20,30 20,30 30,20 30,20 20))']::geometry[],
+	ARRAY['POINT(5 5)', 'POINT(10 5)', 'POINT(25 25)', 'LINESTRING(9 9,21 21)']::geometry[], 'contains')
+	order by 2, 3;
+select 'ST_SpatialJoin3', index1, index2 from ST_SpatialJoin(
+	ARRAY['POINT(5 5)', 'POINT(10 5)', 'POINT(25 25)']::geometry[],
+	ARRAY['POLYGON((0 0,10 0,10 10,0 10,0 0))', 'POLYGON((20 20,30 20,30 30,20 30,20 20))']::geometry[], 'Within')
+	order by 2, 3;
+select 'ST_SpatialJoin4', index1, index2 from ST_SpatialJoin(
+	ARRAY['POLYGON((0 0,10 0,10 10,0 10,0 0))']::geometry[],
+	ARRAY['POINT(5 5)', 'POINT(10 5)']::geometry[], 'touches')
+	order by 2, 3;
+select 'ST_SpatialJoin5', count(*) from ST_SpatialJoin(
+	ARRAY(select ST_MakeEnvelope(i, j, i + 1.5, j + 1.5) from generate_series(0, 29) i, generate_series(0, 29) j),
+	ARRAY(select ST_MakePoint(i + 0.25, j + 0.25) from generate_series(0, 29) i, generate_series(0, 29) j));
+select 'ST_SpatialJoin5.1', count(*) from (select * from ST_SpatialJoin(
+	ARRAY(select ST_MakeEnvelope(i, j, i + 1.5, j + 1.5) from generate_series(0, 29) i, generate_series(0, 29) j),
+	ARRAY(select ST_MakePoint(i + 0.25, j + 0.25) from generate_series(0, 29) i, generate_series(0, 29) j)) limit 5) q;
+select 'ST_SpatialJoin6', count(*) from ST_SpatialJoin(ARRAY['POINT(0 0)']::geometry[], ARRAY['POINT EMPTY']::geometry[]);
+select 'ST_SpatialJoin7', index1, index2 from ST_SpatialJoin(ARRAY['POINT(0 0)']::geometry[], ARRAY['POINT(0 0)']::geometry[], 'nearby');
@@ -83,6 +83,17 @@ select * from test_spgist_idx_3d;
 
 -------------------------------------------------------------------------------
 
+-- KNN ordering through the index matches the sequential sort
+create temp table knn_3d as select row_number() over () as n, d from (select g <<->> 'POINT(500 500 500)'::geometry as d from tbl_geomcollection order by g <<->> 'POINT(500 500 500)'::geometry limit 10) s;
+select 'knn', qnodes('select g <<->> ''POINT(500 500 500)''::geometry as d from tbl_geomcollection order by g <<->> ''POINT(500 500 500)''::geometry limit 10');
+
+set enable_indexscan = off;
+set enable_seqscan = on;
+
+select 'knn', count(*) from (select row_number() over () as n, d from (select g <<->> 'POINT(500 500 500)'::geometry as d from tbl_geomcollection order by g <<->> 'POINT(500 500 500)'::geometry limit 10) s) q join knn_3d using (n) where q.d = knn_3d.d;
+
+-------------------------------------------------------------------------------
+
 DROP TABLE tbl_geomcollection CASCADE;
 DROP TABLE test_spgist_idx_3d CASCADE;
 DROP FUNCTION qnodes;
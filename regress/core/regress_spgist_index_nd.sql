@@ -83,6 +83,46 @@ select * from test_spgist_idx_nd;
 
 -------------------------------------------------------------------------------
 
+-- KNN ordering through the index matches the sequential sort
+create temp table knn_nd as select row_number() over () as n, d from (select g <<->> 'POINT(500 500 500)'::geometry as d from tbl_geomcollection_nd order by g <<->> 'POINT(500 500 500)'::geometry limit 10) s;
+select 'knn', qnodes('select g <<->> ''POINT(500 500 500)''::geometry as d from tbl_geomcollection_nd order by g <<->> ''POINT(500 500 500)''::geometry limit 10');
+
+set enable_indexscan = off;
+set enable_seqscan = on;
+
+select 'knn', count(*) from (select row_number() over () as n, d from (select g <<->> 'POINT(500 500 500)'::geometry as d from tbl_geomcollection_nd order by g <<->> 'POINT(500 500 500)'::geometry limit 10) s) q join knn_nd using (n) where q.d = knn_nd.d;
+
+-------------------------------------------------------------------------------
+
+-- Geography KNN through spgist_geography_ops_nd matches the sequential sort
+-- and the GiST geography opclass
+create table tbl_geography_nd as select i as k, ST_MakePoint((i * 37) % 360 - 180 + (i % 7) * 0.1, (i * 11) % 180 - 90 + (i % 3) * 0.1)::geography as g from generate_series(1, 5000) i;
+insert into tbl_geography_nd values (5001, 'POINT EMPTY'), (5002, NULL), (5003, 'LINESTRING(-170 -10, 170 10)');
+
+create index tbl_geography_nd_spgist_idx on tbl_geography_nd using spgist(g);
+
+set enable_indexscan = on;
+set enable_seqscan = off;
+
+create temp table knn_geog_spgist as select row_number() over () as n, d from (select g <-> 'POINT(10 10)'::geography as d from tbl_geography_nd order by g <-> 'POINT(10 10)'::geography limit 10) s;
+select 'knn_geog', qnodes('select g <-> ''POINT(10 10)''::geography as d from tbl_geography_nd order by g <-> ''POINT(10 10)''::geography limit 10');
+
+drop index tbl_geography_nd_spgist_idx;
+create index tbl_geography_nd_gist_idx on tbl_geography_nd using gist(g);
+
+create temp table knn_geog_gist as select row_number() over () as n, d from (select g <-> 'POINT(10 10)'::geography as d from tbl_geography_nd order by g <-> 'POINT(10 10)'::geography limit 10) s;
+select 'knn_geog', qnodes('select g <-> ''POINT(10 10)''::geography as d from tbl_geography_nd order by g <-> ''POINT(10 10)''::geography limit 10');
+
+set enable_indexscan = off;
+set enable_seqscan = on;
+
+select 'knn_geog', count(*) from (select row_number() over () as n, d from (select g <-> 'POINT(10 10)'::geography as d from tbl_geography_nd order by g <-> 'POINT(10 10)'::geography limit 10) s) q join knn_geog_spgist using (n) where q.d = knn_geog_spgist.d;
+select 'knn_geog', count(*) from knn_geog_gist join knn_geog_spgist using (n) where knn_geog_gist.d = knn_geog_spgist.d;
+
+DROP TABLE tbl_geography_nd;
+
+-------------------------------------------------------------------------------
+
 DROP TABLE tbl_geomcollection_nd CASCADE;
 DROP TABLE test_spgist_idx_nd CASCADE;
 DROP FUNCTION qnodes;
@@ -91,3 +91,38 @@ SELECT 'cpaw4', ST_CPAWithin(
 SELECT 'cpaw_invalid', ST_CPAWithin(
        'LINESTRING(0 0 0, 1 0 0)'::geometry
       ,'LINESTRING(0 0 3 0, 1 0 2 1)'::geometry, 1e16);
+
+-- ST_CPAWithin index support, M is time and is not expanded
+CREATE FUNCTION cpaw_index_cond(q text) RETURNS text
+LANGUAGE 'plpgsql' AS
+$$
+DECLARE
+  exp TEXT;
+BEGIN
+  FOR exp IN EXECUTE 'EXPLAIN ' || q
+  LOOP
+    IF exp ~ 'Index Cond: .*&&&' THEN
+      RETURN 'index';
+    END IF;
+  END LOOP;
+  RETURN 'no index';
+END;
+$$;
+CREATE TABLE cpaw_tracks (id int, g geometry);
+INSERT INTO cpaw_tracks
+  SELECT i, ST_MakeLine(ST_MakePointM(i, 0, i), ST_MakePointM(i, 1, i + 1))
+  FROM generate_series(0, 99) i;
+CREATE INDEX cpaw_tracks_gix ON cpaw_tracks USING GIST (g gist_geometry_ops_nd);
+ANALYZE cpaw_tracks;
+SET enable_seqscan = off;
+SELECT 'cpaw_idx1', cpaw_index_cond('SELECT id FROM cpaw_tracks
+  WHERE ST_CPAWithin(g, ''LINESTRINGM(50 0 50.25, 50 1 50.75)''::geometry, 0.5)');
+SELECT 'cpaw_idx2', array_agg(id ORDER BY id) FROM cpaw_tracks
+  WHERE ST_CPAWithin(g, 'LINESTRINGM(50 0 50.25, 50 1 50.75)'::geometry, 0.5);
+SELECT 'cpaw_idx3', array_agg(id ORDER BY id) FROM cpaw_tracks
+  WHERE ST_CPAWithin(g, 'LINESTRINGM(50 0 50.25, 50 1 50.75)'::geometry, 1000);
+SELECT 'cpaw_idx4', array_agg(id ORDER BY id) FROM cpaw_tracks
+  WHERE ST_CPAWithin(g, 'LINESTRINGM(50 0 49.5, 51 1 51.5)'::geometry, 1.5);
+RESET enable_seqscan;
+DROP TABLE cpaw_tracks;
+DROP FUNCTION cpaw_index_cond(text);
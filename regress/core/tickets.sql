@@ -1547,26 +1547,7 @@ SELECT x AS id, ST_Point(40000 + 10000, -100000 , 27700) AS geom
 FROM generate_series(1,1000000) AS x ;
 
 set max_parallel_workers_per_gather=3;
-/** PG16 force_parallel_mode was renamed to debug_parallel_query, thus the need for this conditional **/
-CREATE OR REPLACE PROCEDURE p_force_parellel_mode(param_state text) language plpgsql AS
-$$
-BEGIN
-	IF (_postgis_pgsql_version())::integer < 160 THEN
-		IF param_state = 'on' THEN
-			SET force_parallel_mode=on;
-		ELSE
-			SET force_parallel_mode=off;
-		END IF;
-	ELSE
-		IF param_state = 'on' THEN
-			SET debug_parallel_query=on;
-		ELSE
-			SET debug_parallel_query=off;
-		END IF;
-	END IF;
-END;
-$$;
-CALL p_force_parellel_mode('on');
+CALL p_force_parallel_mode('on');
 DROP TABLE IF EXISTS object_list_temp;
 WITH object_list AS (
 	SELECT '#5139'::text AS t, id, to_jsonb(geom) AS json_data
@@ -1580,7 +1561,7 @@ SELECT t, id FROM object_list_temp ORDER BY id;
 DROP TABLE IF EXISTS object_list_temp;
 DROP TABLE IF EXISTS a;
 reset max_parallel_workers_per_gather;
-CALL p_force_parellel_mode('off');
+CALL p_force_parallel_mode('off');
 
 SET client_min_messages TO NOTICE;
 -- https://trac.osgeo.org/postgis/ticket/5315
@@ -1588,7 +1569,6 @@ SELECT '#5315', ST_Buffer('0106000020E864000001000000010300000001000000050000000
 
 SELECT '#5320', ST_SimplifyPreserveTopology('0106000020E86400000100000001030000000100000005000000000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F000000000000F07F'::geometry, 1);
 
-DROP PROCEDURE IF EXISTS p_force_parellel_mode(text);
 SELECT '#5378', ST_SRID( ST_Buffer(ST_GeomFromText('POINT(-94 29.53)', 4269)::geography, 12)::geometry );
 
 SELECT '#5425', ST_AsText(ST_SnapToGrid(
@@ -1837,20 +1817,6 @@ SELECT 'makepolygon-null-holes', ST_NPoints(ST_MakePolygon(
 -- #6110, geometry_columns view should be fast even with many spatial tables
 CREATE SCHEMA test6110;
 
-CREATE FUNCTION test6110_plan_has(param_sql text, needle text) RETURNS boolean
-AS $$
-DECLARE
-    plan_line text;
-BEGIN
-    FOR plan_line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || param_sql LOOP
-        IF plan_line LIKE '%' || needle || '%' THEN
-            RETURN true;
-        END IF;
-    END LOOP;
-    RETURN false;
-END;
-$$ LANGUAGE plpgsql;
-
 CREATE FUNCTION test6110_check() RETURNS text AS $check$
 DECLARE
     n bigint;
@@ -1863,7 +1829,7 @@ BEGIN
 
     /* The #6110 fix depends on inlining the three-use CTE in
      * geometry_columns.  Wall-clock time also measures concurrent CI work. */
-    IF test6110_plan_has(
+    IF f_plan_has(
         $sql$SELECT count(*) FROM geometry_columns
               WHERE f_table_schema = 'test6110'$sql$,
         'CTE Scan on s'
@@ -1872,7 +1838,7 @@ BEGIN
     END IF;
 
     /* Verify the assertion with a deliberately materialized three-use CTE. */
-    IF NOT test6110_plan_has(
+    IF NOT f_plan_has(
         $sql$WITH s AS MATERIALIZED (SELECT 1 AS n)
               SELECT count(*) FROM s AS s1, s AS s2, s AS s3$sql$,
         'CTE Scan on s'
@@ -1905,6 +1871,5 @@ SELECT '#6110', test6110_check();
 
 SET client_min_messages TO WARNING;
 DROP FUNCTION test6110_check();
-DROP FUNCTION test6110_plan_has(text, text);
 DROP SCHEMA test6110 CASCADE;
 RESET client_min_messages;
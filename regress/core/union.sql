@@ -30,31 +30,11 @@ SELECT ST_AsText(ST_Union(geom)) FROM geoms;
 INSERT INTO geoms SELECT ST_GeomFromText('POLYGON EMPTY') AS geom;
 SELECT ST_AsText(ST_Union(geom)) FROM geoms;
 
-/** PG16 force_parallel_mode was renamed to debug_parallel_query, thus the need for this conditional **/
-CREATE OR REPLACE PROCEDURE p_force_parellel_mode(param_state text) language plpgsql AS
-$$
-BEGIN
-	IF (_postgis_pgsql_version())::integer < 160 THEN
-		IF param_state = 'on' THEN
-			SET force_parallel_mode=on;
-		ELSE
-			SET force_parallel_mode=off;
-		END IF;
-	ELSE
-		IF param_state = 'on' THEN
-			SET debug_parallel_query=on;
-		ELSE
-			SET debug_parallel_query=off;
-		END IF;
-	END IF;
-END;
-$$;
-
 -- Test in parallel mode
 
 TRUNCATE TABLE geoms;
 
-CALL p_force_parellel_mode('on'::text);
+CALL p_force_parallel_mode('on'::text);
 SET parallel_setup_cost = 0;
 SET parallel_tuple_cost = 0;
 SET min_parallel_table_scan_size = 0;
@@ -87,4 +67,3 @@ SELECT ST_AsText(ST_Union(geom)) FROM geoms;
 
 DROP TABLE geoms;
 
-DROP PROCEDURE IF EXISTS p_force_parellel_mode(text);
@@ -0,0 +1,2 @@
+drop table c;
+delete from spatial_ref_sys where srid = 1;
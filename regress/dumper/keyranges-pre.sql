@@ -0,0 +1,9 @@
+insert into spatial_ref_sys(srid,srtext) values (1,'fake["srs"],text');
+-- Same rows as nullsintable, inserted out of gid order: dumping over
+-- two connections splits them into several gid ranges, which must still
+-- be written in gid order.
+CREATE TABLE c ( gid integer, id integer NOT NULL, geom geometry(Point, 1));
+INSERT INTO c VALUES(3, 3, 'SRID=1;POINT(1 1)');
+INSERT INTO c VALUES(1, 1, NULL);
+INSERT INTO c VALUES(4, 4, NULL);
+INSERT INTO c VALUES(2, 2, NULL);
@@ -51,3 +51,46 @@ $$;
 CREATE EVENT TRIGGER trg_autovac_disable ON ddl_command_end
 WHEN TAG IN ('CREATE TABLE','CREATE TABLE AS')
 EXECUTE PROCEDURE trg_test_disable_table_autovacuum();
+
+--
+-- Helpers for the tests that check parallel aggregates.
+--
+
+-- PG16 renamed force_parallel_mode to debug_parallel_query
+CREATE OR REPLACE PROCEDURE p_force_parallel_mode(param_state text)
+LANGUAGE plpgsql
+AS $$
+BEGIN
+	IF (_postgis_pgsql_version())::integer < 160 THEN
+		IF param_state = 'on' THEN
+			SET force_parallel_mode = on;
+		ELSE
+			SET force_parallel_mode = off;
+		END IF;
+	ELSE
+		IF param_state = 'on' THEN
+			SET debug_parallel_query = on;
+		ELSE
+			SET debug_parallel_query = off;
+		END IF;
+	END IF;
+END;
+$$;
+
+-- Does any line of the plan for this query mention the needle?
+CREATE OR REPLACE FUNCTION f_plan_has(param_sql text, needle text)
+RETURNS boolean
+LANGUAGE plpgsql
+AS $$
+DECLARE
+	plan_line text;
+BEGIN
+	FOR plan_line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || param_sql
+	LOOP
+		IF plan_line LIKE '%' || needle || '%' THEN
+			RETURN true;
+		END IF;
+	END LOOP;
+	RETURN false;
+END;
+$$;
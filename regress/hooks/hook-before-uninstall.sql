@@ -1,2 +1,4 @@
 DROP EVENT TRIGGER IF EXISTS trg_autovac_disable;
 DROP FUNCTION IF EXISTS trg_test_disable_table_autovacuum();
+DROP PROCEDURE IF EXISTS p_force_parallel_mode(text);
+DROP FUNCTION IF EXISTS f_plan_has(text, text);
@@ -0,0 +1,3 @@
+select 'rows', count(*) from loadedshp;
+select 'binary only', count(*) from (select t::text from loadedshp t except all select c::text from loadedshp_copy c) s;
+select 'copy only', count(*) from (select c::text from loadedshp_copy c except all select t::text from loadedshp t) s;
@@ -0,0 +1 @@
+select count(*), count(the_geom), count(name), count(dt) from loadedshp;
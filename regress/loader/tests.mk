@@ -35,6 +35,8 @@ TESTS += \
 	$(top_srcdir)/regress/loader/ReprojectPtsD \
 	$(top_srcdir)/regress/loader/ReprojectPtsGeog \
 	$(top_srcdir)/regress/loader/ReprojectPtsGeogD \
+	$(top_srcdir)/regress/loader/Jobs \
+	$(top_srcdir)/regress/loader/Binary \
 	$(top_srcdir)/regress/loader/Latin1 \
 	$(top_srcdir)/regress/loader/Latin1-implicit \
 	$(top_srcdir)/regress/loader/mfile \
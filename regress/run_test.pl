@@ -1138,6 +1138,88 @@ sub run_loader_and_check_output
 	return 1;
 }
 
+##################################################################
+# This loads the shapefile twice, once as text COPY data into
+# ${tblname}_copy and once as binary COPY data (-B) into $tblname,
+# then runs the select script, which can compare both tables.
+#
+# $1 - Description of this run of the loader, used for error messages.
+# $2 - Table name to load into.
+# $3 - Select script to run after both loads.
+# $4 - "Expected" select results file.
+# $5 - Command-line options for the loader.
+##################################################################
+sub run_loader_binary_and_check_output
+{
+	my $description = shift;
+	my $tblname = shift;
+	my $select_file = shift;
+	my $expected_select_results_file = shift;
+	my $loader_options = shift;
+
+	my ( $cmd, $rv );
+	my $outfile = "${TMPDIR}/loader.out";
+	my $binfile = "${TMPDIR}/loader.bin";
+	my $errfile = "${TMPDIR}/loader.err";
+
+	# ON_ERROR_STOP is used by psql to return non-0 on an error
+	my $psql_opts = " --quiet --no-psqlrc --variable ON_ERROR_STOP=true";
+
+	# Load the reference table through text COPY, then create the
+	# binary target table empty.
+	foreach my $mode ( "-D $loader_options -g the_geom ${TEST}.shp ${tblname}_copy",
+	                   "-p $loader_options -g the_geom ${TEST}.shp $tblname" )
+	{
+		show_progress();
+		$cmd = shp2pgsql() . " $mode > $outfile 2> $errfile";
+		$rv = system($cmd);
+		if ( $rv )
+		{
+			fail(" $description: running $cmd", "$errfile");
+			return 0;
+		}
+
+		$cmd = "psql $psql_opts -f $outfile $DB > $errfile 2>&1";
+		$rv = system($cmd);
+		if ( $rv )
+		{
+			fail(" $description: running shp2pgsql output","$errfile");
+			return 0;
+		}
+	}
+
+	# The binary stream goes to stdout and its COPY command to stderr.
+	show_progress();
+	$cmd = shp2pgsql() . " -B $loader_options -g the_geom ${TEST}.shp $tblname > $binfile 2> $errfile";
+	$rv = system($cmd);
+	if ( $rv )
+	{
+		fail(" $description: running $cmd", "$errfile");
+		return 0;
+	}
+
+	open(ERRFILE, "$errfile") or die "Cannot open $errfile\n";
+	my ($copy) = grep { /^COPY / } <ERRFILE>;
+	close(ERRFILE);
+	if ( ! $copy )
+	{
+		fail(" $description: no COPY command from shp2pgsql -B", "$errfile");
+		return 0;
+	}
+	chomp($copy);
+
+	show_progress();
+	$cmd = "psql $psql_opts -c '$copy' $DB < $binfile > $errfile 2>&1";
+	$rv = system($cmd);
+	if ( $rv )
+	{
+		fail(" $description: loading shp2pgsql -B output","$errfile");
+		return 0;
+	}
+
+	return run_simple_test($select_file, $expected_select_results_file, $description);
+}
+
 ##################################################################
 # This runs the dumper once and checks the output of it.
 # It will NOT run if the expected shp file does not exist, unless
@@ -1340,6 +1422,22 @@ sub run_loader_test
 	}
 	drop_table($tblname);
 
+	# If we have a select script to compare them with, load the rows as text and binary COPY data.
+	if ( -r "${TEST}-B.select.sql" )
+	{
+		if ( ! run_loader_binary_and_check_output("binary test", $tblname, "${TEST}-B.select.sql", "${TEST}-B.select.expected", "$custom_opts") )
+		{
+			unless ( $OPT_NODROP )
+			{
+				drop_table($tblname);
+				drop_table("${tblname}_copy");
+			}
+			return 0;
+		}
+		drop_table($tblname);
+		drop_table("${tblname}_copy");
+	}
+
 	# Some custom parameters can be incompatible with -D.
 	if ( $custom_opts )
 	{